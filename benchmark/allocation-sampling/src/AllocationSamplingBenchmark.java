@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+public class AllocationSamplingBenchmark {
+    static class Node {
+        Node next;
+        int value;
+    }
+
+    public static Object sink;
+
+    public void timeAllocSmallObject(int count) {
+        Node head = null;
+        for (int i = 0; i < count; ++i) {
+            Node node = new Node();
+            node.value = i;
+            // Keep only a short list alive so that the benchmark measures allocation, not GC.
+            node.next = ((i & 15) != 0) ? head : null;
+            head = node;
+        }
+        sink = head;
+    }
+
+    public void timeAllocSmallArray(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            int[] array = new int[4];
+            array[i & 3] = i;
+            sum += array.length;
+            sink = array;
+        }
+        if (sum != count * 4) {
+            throw new AssertionError();
+        }
+    }
+
+    public void timeAllocLargeArray(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            byte[] array = new byte[16 * 1024];
+            sum += array.length;
+            sink = array;
+        }
+        if (sum != count * 16 * 1024) {
+            throw new AssertionError();
+        }
+    }
+
+    public void timeAllocString(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            String s = Integer.toString(i);
+            sum += s.length();
+        }
+        sink = sum;
+    }
+}
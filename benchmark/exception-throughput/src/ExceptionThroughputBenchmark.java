@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+public class ExceptionThroughputBenchmark {
+    // Preallocated exception without a stack trace, so that we measure only the delivery.
+    private static final RuntimeException PREALLOCATED =
+        new RuntimeException("preallocated", null, false, false) {};
+
+    public void timeThrowCatchDepth1(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            try {
+                throwAt(1, PREALLOCATED);
+            } catch (RuntimeException e) {
+                ++sum;
+            }
+        }
+        result = sum;
+    }
+
+    public void timeThrowCatchDepth10(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            try {
+                throwAt(10, PREALLOCATED);
+            } catch (RuntimeException e) {
+                ++sum;
+            }
+        }
+        result = sum;
+    }
+
+    public void timeThrowNewCatchDepth10(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            try {
+                throwAt(10, null);
+            } catch (RuntimeException e) {
+                ++sum;
+            }
+        }
+        result = sum;
+    }
+
+    public void timeFillInStackTraceDepth10(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += stackTraceAt(10).length;
+        }
+        result = sum;
+    }
+
+    public void timeFillInStackTraceDepth50(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += stackTraceAt(50).length;
+        }
+        result = sum;
+    }
+
+    public void timeNewThrowableDepth10(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += throwableAt(10).hashCode() & 1;
+        }
+        result = sum;
+    }
+
+    public void timeNewThrowableDepth50(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += throwableAt(50).hashCode() & 1;
+        }
+        result = sum;
+    }
+
+    private static void throwAt(int depth, RuntimeException e) {
+        if (depth > 1) {
+            throwAt(depth - 1, e);
+        } else if (e != null) {
+            throw e;
+        } else {
+            throw new IllegalStateException();
+        }
+    }
+
+    private static Throwable throwableAt(int depth) {
+        return (depth > 1) ? throwableAt(depth - 1) : new Throwable();
+    }
+
+    private static StackTraceElement[] stackTraceAt(int depth) {
+        return (depth > 1) ? stackTraceAt(depth - 1) : new Throwable().getStackTrace();
+    }
+
+    public static int result;
+}
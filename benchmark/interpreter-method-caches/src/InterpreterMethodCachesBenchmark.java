@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+public class InterpreterMethodCachesBenchmark {
+    static class Data {
+        int f0;
+        int f1;
+        int f2;
+        int f3;
+        int f4;
+        int f5;
+        int f6;
+        int f7;
+        int f8;
+        int f9;
+        int f10;
+        int f11;
+        int f12;
+        int f13;
+        int f14;
+        int f15;
+
+        int get(int i) {
+            return i == 0 ? f0 : f1;
+        }
+    }
+
+    private static final int NUM_THREADS = 4;
+
+    public static int sink;
+
+    private final Data data = new Data();
+
+    private static int sites0(Data d) {
+        int sum = 0;
+        sum += d.f0;
+        d.f0 = sum;
+        sum += d.f1;
+        d.f1 = sum;
+        sum += d.get(1);
+        sum += d.f2;
+        d.f2 = sum;
+        sum += d.f3;
+        d.f3 = sum;
+        sum += d.get(0);
+        sum += d.f4;
+        d.f4 = sum;
+        sum += d.f5;
+        d.f5 = sum;
+        sum += d.get(1);
+        sum += d.f6;
+        d.f6 = sum;
+        sum += d.f7;
+        d.f7 = sum;
+        sum += d.get(0);
+        sum += d.f8;
+        d.f8 = sum;
+        sum += d.f9;
+        d.f9 = sum;
+        sum += d.get(1);
+        sum += d.f10;
+        d.f10 = sum;
+        sum += d.f11;
+        d.f11 = sum;
+        sum += d.get(0);
+        sum += d.f12;
+        d.f12 = sum;
+        sum += d.f13;
+        d.f13 = sum;
+        sum += d.get(1);
+        sum += d.f14;
+        d.f14 = sum;
+        sum += d.f15;
+        d.f15 = sum;
+        sum += d.get(0);
+        return sum;
+    }
+
+    private static int sites1(Data d) {
+        int sum = 1;
+        sum += d.f0;
+        d.f0 = sum;
+        sum += d.f1;
+        d.f1 = sum;
+        sum += d.get(1);
+        sum += d.f2;
+        d.f2 = sum;
+        sum += d.f3;
+        d.f3 = sum;
+        sum += d.get(0);
+        sum += d.f4;
+        d.f4 = sum;
+        sum += d.f5;
+        d.f5 = sum;
+        sum += d.get(1);
+        sum += d.f6;
+        d.f6 = sum;
+        sum += d.f7;
+        d.f7 = sum;
+        sum += d.get(0);
+        sum += d.f8;
+        d.f8 = sum;
+        sum += d.f9;
+        d.f9 = sum;
+        sum += d.get(1);
+        sum += d.f10;
+        d.f10 = sum;
+        sum += d.f11;
+        d.f11 = sum;
+        sum += d.get(0);
+        sum += d.f12;
+        d.f12 = sum;
+        sum += d.f13;
+        d.f13 = sum;
+        sum += d.get(1);
+        sum += d.f14;
+        d.f14 = sum;
+        sum += d.f15;
+        d.f15 = sum;
+        sum += d.get(0);
+        return sum;
+    }
+
+    private static int sites2(Data d) {
+        int sum = 2;
+        sum += d.f0;
+        d.f0 = sum;
+        sum += d.f1;
+        d.f1 = sum;
+        sum += d.get(1);
+        sum += d.f2;
+        d.f2 = sum;
+        sum += d.f3;
+        d.f3 = sum;
+        sum += d.get(0);
+        sum += d.f4;
+        d.f4 = sum;
+        sum += d.f5;
+        d.f5 = sum;
+        sum += d.get(1);
+        sum += d.f6;
+        d.f6 = sum;
+        sum += d.f7;
+        d.f7 = sum;
+        sum += d.get(0);
+        sum += d.f8;
+        d.f8 = sum;
+        sum += d.f9;
+        d.f9 = sum;
+        sum += d.get(1);
+        sum += d.f10;
+        d.f10 = sum;
+        sum += d.f11;
+        d.f11 = sum;
+        sum += d.get(0);
+        sum += d.f12;
+        d.f12 = sum;
+        sum += d.f13;
+        d.f13 = sum;
+        sum += d.get(1);
+        sum += d.f14;
+        d.f14 = sum;
+        sum += d.f15;
+        d.f15 = sum;
+        sum += d.get(0);
+        return sum;
+    }
+
+    private static int sites3(Data d) {
+        int sum = 3;
+        sum += d.f0;
+        d.f0 = sum;
+        sum += d.f1;
+        d.f1 = sum;
+        sum += d.get(1);
+        sum += d.f2;
+        d.f2 = sum;
+        sum += d.f3;
+        d.f3 = sum;
+        sum += d.get(0);
+        sum += d.f4;
+        d.f4 = sum;
+        sum += d.f5;
+        d.f5 = sum;
+        sum += d.get(1);
+        sum += d.f6;
+        d.f6 = sum;
+        sum += d.f7;
+        d.f7 = sum;
+        sum += d.get(0);
+        sum += d.f8;
+        d.f8 = sum;
+        sum += d.f9;
+        d.f9 = sum;
+        sum += d.get(1);
+        sum += d.f10;
+        d.f10 = sum;
+        sum += d.f11;
+        d.f11 = sum;
+        sum += d.get(0);
+        sum += d.f12;
+        d.f12 = sum;
+        sum += d.f13;
+        d.f13 = sum;
+        sum += d.get(1);
+        sum += d.f14;
+        d.f14 = sum;
+        sum += d.f15;
+        d.f15 = sum;
+        sum += d.get(0);
+        return sum;
+    }
+
+    private static int run(Data d, int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += sites0(d);
+            sum += sites1(d);
+            sum += sites2(d);
+            sum += sites3(d);
+        }
+        return sum;
+    }
+
+    public void timeManySites(int count) {
+        sink = run(data, count);
+    }
+
+    public void timeManySitesThreads(final int count) throws Exception {
+        Thread[] threads = new Thread[NUM_THREADS];
+        for (int t = 0; t < NUM_THREADS; ++t) {
+            final Data d = new Data();
+            threads[t] = new Thread() {
+                public void run() {
+                    sink += InterpreterMethodCachesBenchmark.run(d, count);
+                }
+            };
+            threads[t].start();
+        }
+        for (Thread thread : threads) {
+            thread.join();
+        }
+    }
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+public class InterpreterPairsBenchmark {
+    static class Node {
+        Node next;
+        boolean enabled;
+        int value;
+        long wide;
+
+        Node(Node next, int value) {
+            this.next = next;
+            this.enabled = (value & 1) != 0;
+            this.value = value;
+            this.wide = value;
+        }
+
+        int getValue() {
+            return value;
+        }
+
+        long getWide() {
+            return wide;
+        }
+
+        Node getNext() {
+            return next;
+        }
+    }
+
+    private static final int LIST_LENGTH = 64;
+
+    public static int sink;
+
+    private final Node head;
+
+    public InterpreterPairsBenchmark() {
+        Node node = null;
+        for (int i = 0; i < LIST_LENGTH; ++i) {
+            node = new Node(node, i);
+        }
+        head = node;
+    }
+
+    public void timeInvokeMoveResult(int count) {
+        int sum = 0;
+        long wide = 0;
+        for (int i = 0; i < count; ++i) {
+            for (Node node = head; node != null; node = node.getNext()) {
+                sum += node.getValue();
+                wide += node.getWide();
+            }
+        }
+        sink = sum + (int) wide;
+    }
+
+    public void timeFieldGetIfz(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            Node node = head;
+            while (node.next != null) {
+                if (node.enabled) {
+                    ++sum;
+                }
+                node = node.next;
+            }
+        }
+        sink = sum;
+    }
+}
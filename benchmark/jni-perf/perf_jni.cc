@@ -34,6 +34,46 @@ extern "C" JNIEXPORT void JNICALL Java_JniPerfBenchmark_perfSOAUncheckedCall(JNI
   ScopedObjectAccessUnchecked soa(Thread::Current());
 }
 
+jint SumFirstAndLastCritical(JNIEnv* env, jbyteArray array) {
+  jsize length = env->GetArrayLength(array);
+  jbyte* data = reinterpret_cast<jbyte*>(env->GetPrimitiveArrayCritical(array, nullptr));
+  jint sum = data[0] + data[length - 1];
+  env->ReleasePrimitiveArrayCritical(array, data, JNI_ABORT);
+  return sum;
+}
+
+extern "C" JNIEXPORT jint JNICALL Java_JniPerfBenchmark_perfByteArrayCritical(JNIEnv* env,
+                                                                              jobject,
+                                                                              jbyteArray array) {
+  return SumFirstAndLastCritical(env, array);
+}
+
+extern "C" JNIEXPORT jint JNICALL Java_JniPerfBenchmark_perfFastByteArrayCritical(
+    JNIEnv* env, jobject, jbyteArray array) {
+  return SumFirstAndLastCritical(env, array);
+}
+
+extern "C" JNIEXPORT jint JNICALL Java_JniPerfBenchmark_perfByteArrayRegion(JNIEnv* env,
+                                                                            jobject,
+                                                                            jbyteArray array) {
+  jbyte first;
+  env->GetByteArrayRegion(array, 0, 1, &first);
+  return first;
+}
+
+jint PinnedByteArray(jbyte* data, jint length) {
+  return data[0] + data[length - 1];
+}
+
+extern "C" JNIEXPORT void JNICALL Java_JniPerfBenchmark_registerPinnedNatives(JNIEnv* env,
+                                                                             jclass klass) {
+  // @PinnedArrayNative methods are not looked up by name.
+  static const JNINativeMethod kMethods[] = {
+    { "perfPinnedByteArray", "([BI)I", reinterpret_cast<void*>(PinnedByteArray) },
+  };
+  CHECK_EQ(env->RegisterNatives(klass, kMethods, arraysize(kMethods)), JNI_OK);
+}
+
 }  // namespace
 
 }  // namespace art
@@ -14,12 +14,25 @@
  * limitations under the License.
  */
 
+import dalvik.annotation.optimization.FastNative;
+import dalvik.annotation.optimization.PinnedArrayNative;
+
 public class JniPerfBenchmark {
   private static final String MSG = "ABCDE";
+  private static final byte[] BYTES = new byte[4096];
 
   native void perfJniEmptyCall();
   native void perfSOACall();
   native void perfSOAUncheckedCall();
+  // Add the first and last element of the array with Get/ReleasePrimitiveArrayCritical.
+  native int perfByteArrayCritical(byte[] array);
+  @FastNative
+  native int perfFastByteArrayCritical(byte[] array);
+  native int perfByteArrayRegion(byte[] array);
+  // Add the first and last element of the array, passed as a pointer to its data.
+  @PinnedArrayNative
+  static native int perfPinnedByteArray(byte[] array, int length);
+  static native void registerPinnedNatives();
 
   public void timeFastJNI(int N) {
     // TODO: This might be an intrinsic.
@@ -46,7 +59,32 @@ public class JniPerfBenchmark {
     }
   }
 
+  public void timeByteArrayCritical(int N) {
+    for (long i = 0; i < N; i++) {
+      perfByteArrayCritical(BYTES);
+    }
+  }
+
+  public void timeFastByteArrayCritical(int N) {
+    for (long i = 0; i < N; i++) {
+      perfFastByteArrayCritical(BYTES);
+    }
+  }
+
+  public void timeByteArrayRegion(int N) {
+    for (long i = 0; i < N; i++) {
+      perfByteArrayRegion(BYTES);
+    }
+  }
+
+  public void timePinnedByteArray(int N) {
+    for (long i = 0; i < N; i++) {
+      perfPinnedByteArray(BYTES, BYTES.length);
+    }
+  }
+
   {
     System.loadLibrary("artbenchmark");
+    registerPinnedNatives();
   }
 }
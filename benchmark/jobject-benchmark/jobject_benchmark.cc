@@ -57,6 +57,25 @@ extern "C" JNIEXPORT void JNICALL Java_JObjectBenchmark_timeAddRemoveGlobal(
   }
 }
 
+// Keeps a window of global references alive and replaces the oldest one in each iteration,
+// so that removals do not happen in the reverse order of additions.
+extern "C" JNIEXPORT void JNICALL Java_JObjectBenchmark_churnGlobal(
+    JNIEnv* env, jobject jobj, jint reps) {
+  ScopedObjectAccess soa(env);
+  ObjPtr<mirror::Object> obj = soa.Decode<mirror::Object>(jobj);
+  CHECK(obj != nullptr);
+  static constexpr size_t kWindowSize = 16;
+  jobject refs[kWindowSize] = {};
+  for (jint i = 0; i < reps; ++i) {
+    jobject& ref = refs[static_cast<size_t>(i) % kWindowSize];
+    soa.Vm()->DeleteGlobalRef(soa.Self(), ref);
+    ref = soa.Vm()->AddGlobalRef(soa.Self(), obj);
+  }
+  for (jobject ref : refs) {
+    soa.Vm()->DeleteGlobalRef(soa.Self(), ref);
+  }
+}
+
 extern "C" JNIEXPORT void JNICALL Java_JObjectBenchmark_timeDecodeGlobal(
     JNIEnv* env, jobject jobj, jint reps) {
   ScopedObjectAccess soa(env);
@@ -25,6 +25,26 @@ public class JObjectBenchmark {
     timeAddRemoveWeakGlobal(1);
     timeDecodeWeakGlobal(1);
     timeDecodeHandleScopeRef(1);
+    churnGlobal(1);
+  }
+
+  private static final int CHURN_THREADS = 4;
+
+  // Each thread adds and removes its own global references, so the threads only contend on
+  // the global reference table.
+  public void timeChurnGlobalMultiThreaded(final int reps) throws InterruptedException {
+    Thread[] threads = new Thread[CHURN_THREADS];
+    for (int i = 0; i < CHURN_THREADS; ++i) {
+      threads[i] = new Thread(new Runnable() {
+        public void run() {
+          churnGlobal(reps);
+        }
+      });
+      threads[i].start();
+    }
+    for (Thread thread : threads) {
+      thread.join();
+    }
   }
 
   public native void timeAddRemoveLocal(int reps);
@@ -34,4 +54,5 @@ public class JObjectBenchmark {
   public native void timeAddRemoveWeakGlobal(int reps);
   public native void timeDecodeWeakGlobal(int reps);
   public native void timeDecodeHandleScopeRef(int reps);
+  public native void churnGlobal(int reps);
 }
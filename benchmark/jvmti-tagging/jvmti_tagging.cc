@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jni.h"
+#include "jvmti.h"
+
+namespace art {
+namespace {
+
+// The version of the environments that do not need the runtime to be debuggable.
+static constexpr jint kArtTiVersion = JVMTI_VERSION_1_2 | 0x40000000;
+
+static jvmtiEnv* gJvmtiEnv = nullptr;
+
+extern "C" JNIEXPORT jboolean JNICALL Java_JvmtiTaggingBenchmark_initJvmti(JNIEnv* env, jclass) {
+  if (gJvmtiEnv != nullptr) {
+    return JNI_TRUE;
+  }
+  JavaVM* vm;
+  jvmtiEnv* jvmti_env;
+  if (env->GetJavaVM(&vm) != JNI_OK ||
+      vm->GetEnv(reinterpret_cast<void**>(&jvmti_env), kArtTiVersion) != JNI_OK) {
+    return JNI_FALSE;
+  }
+  jvmtiCapabilities caps = {};
+  caps.can_tag_objects = 1;
+  if (jvmti_env->AddCapabilities(&caps) != JVMTI_ERROR_NONE) {
+    jvmti_env->DisposeEnvironment();
+    return JNI_FALSE;
+  }
+  gJvmtiEnv = jvmti_env;
+  return JNI_TRUE;
+}
+
+// Tags the objects with consecutive tags starting at `first_tag`.
+extern "C" JNIEXPORT void JNICALL Java_JvmtiTaggingBenchmark_setTags(
+    JNIEnv* env, jclass, jobjectArray objects, jlong first_tag) {
+  jsize length = env->GetArrayLength(objects);
+  for (jsize i = 0; i != length; ++i) {
+    jobject obj = env->GetObjectArrayElement(objects, i);
+    gJvmtiEnv->SetTag(obj, first_tag + i);
+    env->DeleteLocalRef(obj);
+  }
+}
+
+// Returns the sum of the tags of the objects.
+extern "C" JNIEXPORT jlong JNICALL Java_JvmtiTaggingBenchmark_sumTags(
+    JNIEnv* env, jclass, jobjectArray objects) {
+  jsize length = env->GetArrayLength(objects);
+  jlong sum = 0;
+  for (jsize i = 0; i != length; ++i) {
+    jobject obj = env->GetObjectArrayElement(objects, i);
+    jlong tag = 0;
+    gJvmtiEnv->GetTag(obj, &tag);
+    sum += tag;
+    env->DeleteLocalRef(obj);
+  }
+  return sum;
+}
+
+}  // namespace
+}  // namespace art
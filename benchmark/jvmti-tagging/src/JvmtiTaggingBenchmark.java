@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+public class JvmtiTaggingBenchmark {
+  public JvmtiTaggingBenchmark() {
+    // Make sure to link methods before benchmark starts.
+    System.loadLibrary("artbenchmark");
+    if (!initJvmti()) {
+      throw new IllegalStateException("JVMTI is not available, run with -Xplugin");
+    }
+    for (int i = 0; i < TAGGED_OBJECTS; ++i) {
+      live[i] = new Object();
+    }
+    setTags(live, 1);
+  }
+
+  private static final int TAGGED_OBJECTS = 256 * 1024;
+
+  private final Object[] live = new Object[TAGGED_OBJECTS];
+
+  private static native boolean initJvmti();
+  private static native void setTags(Object[] objects, long firstTag);
+  private static native long sumTags(Object[] objects);
+
+  // Replaces the tags of the live objects, without adding entries.
+  public void timeSetTag(int reps) {
+    for (int i = 0; i < reps; ++i) {
+      setTags(live, i * (long) TAGGED_OBJECTS + 1);
+    }
+  }
+
+  public long timeGetTag(int reps) {
+    long sum = 0;
+    for (int i = 0; i < reps; ++i) {
+      sum += sumTags(live);
+    }
+    return sum;
+  }
+
+  // Tags as many short-lived objects as there are tagged live objects, then collects. The
+  // collection sweeps the live entries, which may move, and removes the dead ones.
+  public void timeSweep(int reps) {
+    Object[] garbage = new Object[TAGGED_OBJECTS];
+    for (int i = 0; i < reps; ++i) {
+      for (int j = 0; j < TAGGED_OBJECTS; ++j) {
+        garbage[j] = new Object();
+      }
+      setTags(garbage, -TAGGED_OBJECTS);
+      java.util.Arrays.fill(garbage, null);
+      Runtime.getRuntime().gc();
+    }
+  }
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.lang.invoke.MethodHandle;
+import java.lang.invoke.MethodHandles;
+import java.lang.invoke.MethodType;
+
+public class MethodHandleChainBenchmark {
+    private static final MethodHandle ADD;
+    private static final MethodHandle BOUND_RECEIVER;
+    private static final MethodHandle INSERTED_ARGUMENT;
+    private static final MethodHandle DROPPED_ARGUMENT;
+    private static final MethodHandle FILTERED_ARGUMENT;
+    private static final MethodHandle AS_TYPE;
+    private static final MethodHandle CHAIN;
+
+    static {
+        try {
+            MethodHandles.Lookup lookup = MethodHandles.lookup();
+            MethodType addType = MethodType.methodType(int.class, int.class, int.class);
+            ADD = lookup.findStatic(MethodHandleChainBenchmark.class, "add", addType);
+            BOUND_RECEIVER = lookup.bind(new MethodHandleChainBenchmark(), "virtualAdd", addType);
+            INSERTED_ARGUMENT = MethodHandles.insertArguments(ADD, 1, 1);
+            DROPPED_ARGUMENT = MethodHandles.dropArguments(ADD, 0, String.class);
+            MethodHandle twice = lookup.findStatic(
+                MethodHandleChainBenchmark.class,
+                "twice",
+                MethodType.methodType(int.class, int.class));
+            FILTERED_ARGUMENT = MethodHandles.filterArguments(ADD, 0, twice);
+            AS_TYPE = ADD.asType(MethodType.methodType(long.class, short.class, byte.class));
+            CHAIN = MethodHandles.dropArguments(
+                MethodHandles.filterArguments(MethodHandles.insertArguments(ADD, 1, 1), 0, twice),
+                0,
+                String.class);
+        } catch (ReflectiveOperationException e) {
+            throw new Error(e);
+        }
+    }
+
+    public int result;
+
+    public static int add(int a, int b) {
+        return a + b;
+    }
+
+    public int virtualAdd(int a, int b) {
+        return a + b;
+    }
+
+    public static int twice(int a) {
+        return a * 2;
+    }
+
+    public void timeDirectCall(int count) {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum = add(sum, i);
+        }
+        result = sum;
+    }
+
+    public void timeInvokeExactDirect(int count) throws Throwable {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum = (int) ADD.invokeExact(sum, i);
+        }
+        result = sum;
+    }
+
+    public void timeInvokeExactBoundReceiver(int count) throws Throwable {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum = (int) BOUND_RECEIVER.invokeExact(sum, i);
+        }
+        result = sum;
+    }
+
+    public void timeInvokeExactInsertedArgument(int count) throws Throwable {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum = (int) INSERTED_ARGUMENT.invokeExact(sum);
+        }
+        result = sum;
+    }
+
+    public void timeInvokeExactDroppedArgument(int count) throws Throwable {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum = (int) DROPPED_ARGUMENT.invokeExact("dropped", sum, i);
+        }
+        result = sum;
+    }
+
+    public void timeInvokeExactFilteredArgument(int count) throws Throwable {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum = (int) FILTERED_ARGUMENT.invokeExact(i, sum);
+        }
+        result = sum;
+    }
+
+    public void timeInvokeExactAsType(int count) throws Throwable {
+        long sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += (long) AS_TYPE.invokeExact((short) i, (byte) 1);
+        }
+        result = (int) sum;
+    }
+
+    public void timeInvokeExactChain(int count) throws Throwable {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += (int) CHAIN.invokeExact("dropped", i);
+        }
+        result = sum;
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.io.File;
+import java.lang.reflect.Method;
+
+public class MethodTraceBenchmark {
+    private static final Method startMethodTracingMethod;
+    private static final Method stopMethodTracingMethod;
+
+    static {
+        try {
+            Class<?> c = Class.forName("dalvik.system.VMDebug");
+            startMethodTracingMethod = c.getDeclaredMethod("startMethodTracing", String.class,
+                    Integer.TYPE, Integer.TYPE, Boolean.TYPE, Integer.TYPE);
+            stopMethodTracingMethod = c.getDeclaredMethod("stopMethodTracing");
+        } catch (Exception e) {
+            throw new RuntimeException(e);
+        }
+    }
+
+    public static int sink;
+
+    private int field;
+
+    private static int staticCallee(int value) {
+        return value + 1;
+    }
+
+    private int instanceCallee(int value) {
+        field += value;
+        return field;
+    }
+
+    private static long longCallee(long value) {
+        return value * 3;
+    }
+
+    private static double doubleCallee(double value) {
+        return value * 0.5;
+    }
+
+    private int runCalls(int count) {
+        int result = 0;
+        long l = 1;
+        double d = 1.0;
+        for (int i = 0; i < count; ++i) {
+            result = staticCallee(result);
+            result += instanceCallee(i);
+            l = longCallee(l) & 0xffff;
+            d = doubleCallee(d) + 1.0;
+        }
+        return result + (int) l + (int) d;
+    }
+
+    public void timeCallsUntraced(int count) {
+        sink = runCalls(count);
+    }
+
+    public void timeCallsTraced(int count) throws Exception {
+        File traceFile = File.createTempFile("method-trace", ".trace");
+        try {
+            startMethodTracingMethod.invoke(null, traceFile.getPath(), 0, 0, false, 0);
+            try {
+                sink = runCalls(count);
+            } finally {
+                stopMethodTracingMethod.invoke(null);
+            }
+        } finally {
+            traceFile.delete();
+        }
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <vector>
+
+#include "jni.h"
+
+#include "base/bit_utils.h"
+#include "base/globals.h"
+#include "mirror/object-inl.h"
+#include "mirror/object_array-inl.h"
+#include "scoped_thread_state_change-inl.h"
+
+namespace art {
+namespace {
+
+// Returns the ratio of the resident pages holding the given objects that are on another NUMA
+// node than the calling thread, or -1 if the nodes cannot be queried.
+extern "C" JNIEXPORT jdouble JNICALL Java_NumaAllocationBenchmark_remotePageRatio(
+    JNIEnv* env, jclass, jobjectArray jobjects) {
+#if defined(__linux__)
+  std::vector<void*> pages;
+  {
+    ScopedObjectAccess soa(env);
+    ObjPtr<mirror::ObjectArray<mirror::Object>> objects =
+        soa.Decode<mirror::ObjectArray<mirror::Object>>(jobjects);
+    for (int32_t i = 0; i < objects->GetLength(); ++i) {
+      ObjPtr<mirror::Object> obj = objects->Get(i);
+      if (obj != nullptr) {
+        void* page = AlignDown(reinterpret_cast<uint8_t*>(obj.Ptr()), kPageSize);
+        if (pages.empty() || pages.back() != page) {
+          pages.push_back(page);
+        }
+      }
+    }
+  }
+  // The objects may move after leaving the runnable state, the result is only an estimate.
+  std::vector<int> status(pages.size());
+  unsigned cpu;
+  unsigned node;
+  if (pages.empty() ||
+      syscall(__NR_getcpu, &cpu, &node, nullptr) != 0 ||
+      syscall(__NR_move_pages, 0, pages.size(), pages.data(), nullptr, status.data(), 0) != 0) {
+    return -1.0;
+  }
+  size_t resident = 0u;
+  size_t remote = 0u;
+  for (int page_node : status) {
+    if (page_node >= 0) {
+      ++resident;
+      if (static_cast<unsigned>(page_node) != node) {
+        ++remote;
+      }
+    }
+  }
+  return resident != 0u ? static_cast<double>(remote) / resident : -1.0;
+#else
+  UNUSED(env, jobjects);
+  return -1.0;
+#endif
+}
+
+}  // namespace
+}  // namespace art
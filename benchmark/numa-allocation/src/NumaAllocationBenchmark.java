@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+public class NumaAllocationBenchmark {
+  public NumaAllocationBenchmark() {
+    // Make sure to link methods before benchmark starts.
+    System.loadLibrary("artbenchmark");
+    remotePageRatio(new Object[0]);
+  }
+
+  private static final int THREADS = 8;
+  private static final int LIVE_OBJECTS = 4096;
+
+  static class Node {
+    long value;
+  }
+
+  private static native double remotePageRatio(Object[] objects);
+
+  // Each thread keeps a window of live objects that it reads and replaces, so that the window
+  // survives collections and is evacuated while the thread keeps accessing it.
+  private static double allocateAndTouch(int reps) {
+    Node[] live = new Node[LIVE_OBJECTS];
+    long sum = 0;
+    for (int i = 0; i < reps; ++i) {
+      int index = i % LIVE_OBJECTS;
+      Node node = new Node();
+      node.value = i;
+      live[index] = node;
+      // Read some older objects of the window.
+      for (int j = 1; j <= 8; ++j) {
+        Node old = live[(index + j * 509) % LIVE_OBJECTS];
+        if (old != null) {
+          sum += old.value;
+        }
+      }
+    }
+    if (sum < 0) {
+      throw new AssertionError();
+    }
+    return remotePageRatio(live);
+  }
+
+  public void timeAllocateMultiThreaded(final int reps) throws InterruptedException {
+    final double[] ratios = new double[THREADS];
+    Thread[] threads = new Thread[THREADS];
+    for (int i = 0; i < THREADS; ++i) {
+      final int id = i;
+      threads[i] = new Thread(new Runnable() {
+        public void run() {
+          ratios[id] = allocateAndTouch(reps);
+        }
+      });
+    }
+    for (Thread thread : threads) {
+      thread.start();
+    }
+    for (Thread thread : threads) {
+      thread.join();
+    }
+    double total = 0.0;
+    int valid = 0;
+    for (double ratio : ratios) {
+      if (ratio >= 0.0) {
+        total += ratio;
+        ++valid;
+      }
+    }
+    if (valid != 0) {
+      System.out.println("Remote page ratio: " + (total / valid));
+    }
+  }
+}
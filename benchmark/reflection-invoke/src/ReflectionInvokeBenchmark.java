@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.lang.reflect.Constructor;
+import java.lang.reflect.Method;
+
+public class ReflectionInvokeBenchmark {
+    private static final Object[] NO_ARGS = new Object[0];
+
+    private final Method staticNoArgs;
+    private final Method virtualObjectArg;
+    private final Method virtualStringArg;
+    private final Method staticIntArgs;
+    private final Method staticLongArg;
+    private final Constructor<Target> constructor;
+
+    private final Target target = new Target(0, "");
+    private final Object[] objectArg = new Object[] { new Object() };
+    private final Object[] stringArg = new Object[] { "string" };
+    private final Object[] intArgs = new Object[] { 1, 2, 3 };
+    private final Object[] longArg = new Object[] { 42L };
+    private final Object[] widenedLongArg = new Object[] { 42 };
+    private final Object[] constructorArgs = new Object[] { 1, "string" };
+
+    public int result;
+
+    public ReflectionInvokeBenchmark() throws Exception {
+        staticNoArgs = Target.class.getDeclaredMethod("staticNoArgs");
+        virtualObjectArg = Target.class.getDeclaredMethod("virtualObjectArg", Object.class);
+        virtualStringArg = Target.class.getDeclaredMethod("virtualStringArg", String.class);
+        staticIntArgs =
+            Target.class.getDeclaredMethod("staticIntArgs", int.class, int.class, int.class);
+        staticLongArg = Target.class.getDeclaredMethod("staticLongArg", long.class);
+        constructor = Target.class.getDeclaredConstructor(int.class, String.class);
+    }
+
+    public void timeInvokeStaticNoArgs(int count) throws Exception {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += (Integer) staticNoArgs.invoke(null, NO_ARGS);
+        }
+        result = sum;
+    }
+
+    public void timeInvokeVirtualObjectArg(int count) throws Exception {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += (Integer) virtualObjectArg.invoke(target, objectArg);
+        }
+        result = sum;
+    }
+
+    public void timeInvokeVirtualStringArg(int count) throws Exception {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += (Integer) virtualStringArg.invoke(target, stringArg);
+        }
+        result = sum;
+    }
+
+    public void timeInvokeStaticIntArgs(int count) throws Exception {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += (Integer) staticIntArgs.invoke(null, intArgs);
+        }
+        result = sum;
+    }
+
+    public void timeInvokeStaticLongArg(int count) throws Exception {
+        long sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += (Long) staticLongArg.invoke(null, longArg);
+        }
+        result = (int) sum;
+    }
+
+    public void timeInvokeStaticLongArgWidened(int count) throws Exception {
+        long sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += (Long) staticLongArg.invoke(null, widenedLongArg);
+        }
+        result = (int) sum;
+    }
+
+    public void timeNewInstance(int count) throws Exception {
+        int sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += constructor.newInstance(constructorArgs).value;
+        }
+        result = sum;
+    }
+
+    static class Target {
+        final int value;
+        final String name;
+
+        Target(int value, String name) {
+            this.value = value;
+            this.name = name;
+        }
+
+        static int staticNoArgs() {
+            return 1;
+        }
+
+        int virtualObjectArg(Object o) {
+            return value + 1;
+        }
+
+        int virtualStringArg(String s) {
+            return value + s.length();
+        }
+
+        static int staticIntArgs(int a, int b, int c) {
+            return a + b + c;
+        }
+
+        static long staticLongArg(long a) {
+            return a + 1;
+        }
+    }
+}
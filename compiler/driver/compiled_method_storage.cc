@@ -144,15 +144,21 @@ class CompiledMethodStorage::ThunkMapValue {
   std::string debug_name_;
 };
 
-CompiledMethodStorage::CompiledMethodStorage(int swap_fd)
+CompiledMethodStorage::CompiledMethodStorage(int swap_fd, size_t thread_count)
     : swap_space_(swap_fd == -1 ? nullptr : new SwapSpace(swap_fd, 10 * MB)),
       dedupe_enabled_(true),
-      dedupe_code_("dedupe code", LengthPrefixedArrayAlloc<uint8_t>(swap_space_.get())),
+      dedupe_code_("dedupe code",
+                   LengthPrefixedArrayAlloc<uint8_t>(swap_space_.get()),
+                   std::max(thread_count, kMinDedupeShards)),
       dedupe_vmap_table_("dedupe vmap table",
-                         LengthPrefixedArrayAlloc<uint8_t>(swap_space_.get())),
-      dedupe_cfi_info_("dedupe cfi info", LengthPrefixedArrayAlloc<uint8_t>(swap_space_.get())),
+                         LengthPrefixedArrayAlloc<uint8_t>(swap_space_.get()),
+                         std::max(thread_count, kMinDedupeShards)),
+      dedupe_cfi_info_("dedupe cfi info",
+                       LengthPrefixedArrayAlloc<uint8_t>(swap_space_.get()),
+                       std::max(thread_count, kMinDedupeShards)),
       dedupe_linker_patches_("dedupe cfi info",
-                             LengthPrefixedArrayAlloc<linker::LinkerPatch>(swap_space_.get())),
+                             LengthPrefixedArrayAlloc<linker::LinkerPatch>(swap_space_.get()),
+                             std::max(thread_count, kMinDedupeShards)),
       thunk_map_lock_("thunk_map_lock"),
       thunk_map_(std::less<ThunkMapKey>(), SwapAllocator<ThunkMapValueType>(swap_space_.get())) {
 }
@@ -35,7 +35,9 @@ class LinkerPatch;
 
 class CompiledMethodStorage {
  public:
-  explicit CompiledMethodStorage(int swap_fd);
+  // The dedupe sets get a shard per compiler thread, but no less than kMinDedupeShards, so that
+  // threads adding different methods rarely take the same shard lock.
+  explicit CompiledMethodStorage(int swap_fd, size_t thread_count = 1u);
   ~CompiledMethodStorage();
 
   void DumpMemoryUsage(std::ostream& os, bool extended) const;
@@ -101,13 +103,15 @@ class CompiledMethodStorage {
   template <typename T>
   class LengthPrefixedArrayAlloc;
 
+  static constexpr size_t kMinDedupeShards = 4u;
+
   template <typename T>
   using ArrayDedupeSet = DedupeSet<ArrayRef<const T>,
                                    LengthPrefixedArray<T>,
                                    LengthPrefixedArrayAlloc<T>,
                                    size_t,
                                    DedupeHashFunc<const T>,
-                                   4>;
+                                   kMinDedupeShards>;
 
   // Swap pool and allocator used for native allocations. May be file-backed. Needs to be first
   // as other fields rely on this.
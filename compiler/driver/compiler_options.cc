@@ -55,6 +55,7 @@ CompilerOptions::CompilerOptions()
       compile_art_test_(false),
       baseline_(false),
       debuggable_(false),
+      method_entry_exit_hooks_(false),
       generate_debug_info_(kDefaultGenerateDebugInfo),
       generate_mini_debug_info_(kDefaultGenerateMiniDebugInfo),
       generate_build_id_(false),
@@ -169,6 +169,12 @@ class CompilerOptions final {
     return GetDebuggable() && GetGenerateDebugInfo();
   }
 
+  // Whether compiled code reports method entry and exit through the runtime's
+  // method entry/exit hooks.
+  bool GetMethodEntryExitHooks() const {
+    return method_entry_exit_hooks_;
+  }
+
   // This flag controls whether the compiler collects debugging information.
   // The other flags control how the information is written to disk.
   bool GenerateAnyDebugInfo() const {
@@ -411,6 +417,7 @@ class CompilerOptions final {
   bool compile_art_test_;
   bool baseline_;
   bool debuggable_;
+  bool method_entry_exit_hooks_;
   bool generate_debug_info_;
   bool generate_mini_debug_info_;
   bool generate_build_id_;
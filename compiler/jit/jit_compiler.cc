@@ -29,6 +29,7 @@
 #include "compiler.h"
 #include "debug/elf_debug_writer.h"
 #include "driver/compiler_options.h"
+#include "instrumentation.h"
 #include "jit/debugger_interface.h"
 #include "jit/jit.h"
 #include "jit/jit_code_cache.h"
@@ -67,6 +68,8 @@ void JitCompiler::ParseCompilerOptions() {
   if (!compiler_options_->GetDebuggable()) {
     compiler_options_->SetDebuggable(runtime->IsJavaDebuggable());
   }
+  compiler_options_->method_entry_exit_hooks_ =
+      runtime->GetInstrumentation()->JitCodeHasEntryExitHooks();
 
   const InstructionSet instruction_set = compiler_options_->GetInstructionSet();
   if (kRuntimeISA == InstructionSet::kArm) {
@@ -380,6 +380,7 @@ class JniCompilerTest : public CommonCompilerTest {
   void NormalNativeImpl();
   void FastNativeImpl();
   void CriticalNativeImpl();
+  void PinnedArrayNativeImpl();
 
   JNIEnv* env_;
   jmethodID jmethod_;
@@ -2241,4 +2242,69 @@ void JniCompilerTest::CriticalNativeImpl() {
 // TODO: just rename the java functions  to the standard convention and remove duplicated tests
 JNI_TEST_NORMAL_ONLY(CriticalNative)
 
+int gJava_myClassNatives_pinnedArrays_calls[kJniKindCount] = {};
+// Methods annotated with @PinnedArrayNative receive pointers to the array data
+// -- Check that the pointers can be read and written and that null stays null.
+jlong Java_MyClassNatives_pinnedArrays(jint i, jbyte* bytes, jlong l, jlong* longs) {
+  gJava_myClassNatives_pinnedArrays_calls[gCurrentJni]++;
+  EXPECT_EQ(kRunnable, Thread::Current()->GetState());
+  jlong result = i + l;
+  if (bytes != nullptr) {
+    result += bytes[0];
+    bytes[1] = static_cast<jbyte>(i);
+  }
+  if (longs != nullptr) {
+    result += longs[1];
+  }
+  return result;
+}
+
+void JniCompilerTest::PinnedArrayNativeImpl() {
+  SetUpForTest(/* direct= */ true,
+               "pinnedArrays",
+               "(I[BJ[J)J",
+               reinterpret_cast<void*>(&Java_MyClassNatives_pinnedArrays));
+
+  ArtMethod* method = jni::DecodeArtMethod(jmethod_);
+  ASSERT_TRUE(method != nullptr);
+
+  EXPECT_TRUE(method->IsCriticalNative());
+  EXPECT_TRUE(method->IsPinnedArrayNative());
+  EXPECT_FALSE(method->IsFastNative());
+
+  ScopedLocalRef<jbyteArray> bytes(env_, env_->NewByteArray(2));
+  jbyte byte_values[] = { 5, 0 };
+  env_->SetByteArrayRegion(bytes.get(), 0, 2, byte_values);
+  ScopedLocalRef<jlongArray> longs(env_, env_->NewLongArray(2));
+  jlong long_values[] = { 0, 100 };
+  env_->SetLongArrayRegion(longs.get(), 0, 2, long_values);
+
+  EXPECT_EQ(0, gJava_myClassNatives_pinnedArrays_calls[gCurrentJni]);
+  jlong result =
+      env_->CallStaticLongMethod(jklass_, jmethod_, 3, bytes.get(), INT64_C(7), longs.get());
+  EXPECT_EQ(3 + 5 + 7 + 100, result);
+  EXPECT_EQ(1, gJava_myClassNatives_pinnedArrays_calls[gCurrentJni]);
+  env_->GetByteArrayRegion(bytes.get(), 1, 1, &byte_values[1]);
+  EXPECT_EQ(3, byte_values[1]);
+
+  jobject null = nullptr;
+  result = env_->CallStaticLongMethod(jklass_, jmethod_, 3, null, INT64_C(7), null);
+  EXPECT_EQ(3 + 7, result);
+  EXPECT_EQ(2, gJava_myClassNatives_pinnedArrays_calls[gCurrentJni]);
+
+  // Without RegisterNatives(), the call throws instead of looking up the native method.
+  env_->UnregisterNatives(jklass_);
+  env_->CallStaticLongMethod(jklass_, jmethod_, 3, bytes.get(), INT64_C(7), longs.get());
+  ScopedLocalRef<jthrowable> exception(env_, env_->ExceptionOccurred());
+  ASSERT_TRUE(exception.get() != nullptr);
+  env_->ExceptionClear();
+  ScopedLocalRef<jclass> jule(env_, env_->FindClass("java/lang/UnsatisfiedLinkError"));
+  EXPECT_TRUE(env_->IsInstanceOf(exception.get(), jule.get()));
+  EXPECT_EQ(2, gJava_myClassNatives_pinnedArrays_calls[gCurrentJni]);
+
+  gJava_myClassNatives_pinnedArrays_calls[gCurrentJni] = 0;
+}
+
+JNI_TEST_NORMAL_ONLY(PinnedArrayNative)
+
 }  // namespace art
@@ -38,6 +38,7 @@
 #include "driver/compiler_options.h"
 #include "entrypoints/quick/quick_entrypoints.h"
 #include "jni/jni_env_ext.h"
+#include "mirror/array.h"
 #include "thread.h"
 #include "utils/arm/managed_register_arm.h"
 #include "utils/arm64/managed_register_arm64.h"
@@ -125,10 +126,14 @@ static JniCompiledMethod ArtJniCompileMethodInternal(const CompilerOptions& comp
   const InstructionSetFeatures* instruction_set_features =
       compiler_options.GetInstructionSetFeatures();
 
+  // i.e. if the method was annotated with @PinnedArrayNative
+  const bool is_pinned_array_native =
+      (access_flags & kAccPinnedArrayNative) == kAccPinnedArrayNative;
+
   // i.e. if the method was annotated with @FastNative
-  const bool is_fast_native = (access_flags & kAccFastNative) != 0u;
+  const bool is_fast_native = !is_pinned_array_native && (access_flags & kAccFastNative) != 0u;
 
-  // i.e. if the method was annotated with @CriticalNative
+  // i.e. if the method was annotated with @CriticalNative or @PinnedArrayNative
   const bool is_critical_native = (access_flags & kAccCriticalNative) != 0u;
 
   VLOG(jni) << "JniCompile: Method :: "
@@ -145,8 +150,43 @@ static JniCompiledMethod ArtJniCompileMethodInternal(const CompilerOptions& comp
               << dex_file.PrettyMethod(method_idx, /* with signature */ true);
   }
 
+  // @PinnedArrayNative methods are @CriticalNative methods that may also take primitive
+  // arrays. The native method receives a pointer to the array data instead of each array, so
+  // the native calling convention sees a pointer-sized integer in its place. The thread stays
+  // runnable without a suspend point until the native method returns, so the GC cannot move
+  // the arrays while the native method uses the pointers.
+  std::string native_shorty;
+  std::vector<uint32_t> array_data_offsets;
+  if (UNLIKELY(is_pinned_array_native)) {
+    VLOG(jni) << "JniCompile: Pinned array native method detected :: "
+              << dex_file.PrettyMethod(method_idx, /* with signature */ true);
+    CHECK(is_static && !is_synchronized)
+        << "@PinnedArrayNative methods must be static and not synchronized "
+        << dex_file.PrettyMethod(method_idx, /* with_signature= */ true);
+    const dex::TypeList* params =
+        dex_file.GetProtoParameters(dex_file.GetMethodPrototype(dex_file.GetMethodId(method_idx)));
+    native_shorty = shorty;
+    array_data_offsets.resize(native_shorty.size() - 1u, 0u);
+    for (size_t i = 1; i != native_shorty.size(); ++i) {
+      if (native_shorty[i] != 'L') {
+        continue;
+      }
+      const char* descriptor = dex_file.StringByTypeIdx(params->GetTypeItem(i - 1u).type_idx_);
+      Primitive::Type component_type = Primitive::GetType(descriptor[1]);
+      CHECK(descriptor[0] == '[' &&
+            component_type != Primitive::kPrimNot &&
+            component_type != Primitive::kPrimVoid)
+          << "@PinnedArrayNative methods' reference parameters must be primitive arrays "
+          << dex_file.PrettyMethod(method_idx, /* with_signature= */ true);
+      native_shorty[i] = Is64BitInstructionSet(instruction_set) ? 'J' : 'I';
+      array_data_offsets[i - 1u] =
+          mirror::Array::DataOffset(Primitive::ComponentSize(component_type)).Uint32Value();
+    }
+  }
+
   if (kIsDebugBuild) {
     // Don't allow both @FastNative and @CriticalNative. They are mutually exclusive.
+    // (@PinnedArrayNative sets both flags but is_fast_native is false for it.)
     if (UNLIKELY(is_fast_native && is_critical_native)) {
       LOG(FATAL) << "JniCompile: Method cannot be both @CriticalNative and @FastNative"
                  << dex_file.PrettyMethod(method_idx, /* with_signature= */ true);
@@ -156,6 +196,7 @@ static JniCompiledMethod ArtJniCompileMethodInternal(const CompilerOptions& comp
     // -- Don't allow virtual criticals
     // -- Don't allow synchronized criticals
     // -- Don't allow any objects as parameter or return value
+    //    (@PinnedArrayNative arrays were checked above and do not appear in native_shorty)
     if (UNLIKELY(is_critical_native)) {
       CHECK(is_static)
           << "@CriticalNative functions cannot be virtual since that would"
@@ -165,8 +206,9 @@ static JniCompiledMethod ArtJniCompileMethodInternal(const CompilerOptions& comp
           << "@CriticalNative functions cannot be synchronized since that would"
           << "require passing a (class and/or this) reference parameter, which is illegal "
           << dex_file.PrettyMethod(method_idx, /* with_signature= */ true);
-      for (size_t i = 0; i < strlen(shorty); ++i) {
-        CHECK_NE(Primitive::kPrimNot, Primitive::GetType(shorty[i]))
+      const char* critical_shorty = is_pinned_array_native ? native_shorty.c_str() : shorty;
+      for (size_t i = 0; i < strlen(critical_shorty); ++i) {
+        CHECK_NE(Primitive::kPrimNot, Primitive::GetType(critical_shorty[i]))
             << "@CriticalNative methods' shorty types must not have illegal references "
             << dex_file.PrettyMethod(method_idx, /* with_signature= */ true);
       }
@@ -182,7 +224,7 @@ static JniCompiledMethod ArtJniCompileMethodInternal(const CompilerOptions& comp
                                    is_static,
                                    is_synchronized,
                                    is_critical_native,
-                                   shorty,
+                                   is_pinned_array_native ? native_shorty.c_str() : shorty,
                                    instruction_set);
   bool reference_return = main_jni_conv->IsReturnAReference();
 
@@ -434,11 +476,34 @@ static JniCompiledMethod ArtJniCompileMethodInternal(const CompilerOptions& comp
     size_t pointer_size = static_cast<size_t>(kPointerSize);
     dest_args.push_back(ArgumentLocation(main_jni_conv->HiddenArgumentRegister(), pointer_size));
     src_args.push_back(ArgumentLocation(mr_conv->MethodRegister(), pointer_size));
-    // Move normal arguments to their locations.
+    // Move normal arguments to their locations. For @PinnedArrayNative, make sure the array
+    // references are in their managed stack slots and create the data pointers afterwards,
+    // when the native argument registers no longer hold managed arguments.
+    struct PinnedArrayArgument {
+      FrameOffset ref_offset;
+      ArgumentLocation dest;
+      uint32_t data_offset;
+    };
+    ArenaVector<PinnedArrayArgument> pinned_array_args(allocator.Adapter());
     mr_conv->ResetIterator(FrameOffset(current_frame_size));
     main_jni_conv->ResetIterator(FrameOffset(main_out_arg_size));
-    for (; mr_conv->HasNext(); mr_conv->Next(), main_jni_conv->Next()) {
+    for (size_t param_index = 0u;
+         mr_conv->HasNext();
+         mr_conv->Next(), main_jni_conv->Next(), ++param_index) {
       DCHECK(main_jni_conv->HasNext());
+      if (UNLIKELY(mr_conv->IsCurrentParamAReference())) {
+        DCHECK(is_pinned_array_native);
+        if (mr_conv->IsCurrentParamInRegister()) {
+          __ Store(mr_conv->CurrentParamStackOffset(), mr_conv->CurrentParamRegister(), 4u);
+        }
+        pinned_array_args.push_back(PinnedArrayArgument{
+            mr_conv->CurrentParamStackOffset(),
+            main_jni_conv->IsCurrentParamInRegister()
+                ? ArgumentLocation(main_jni_conv->CurrentParamRegister(), pointer_size)
+                : ArgumentLocation(main_jni_conv->CurrentParamStackOffset(), pointer_size),
+            array_data_offsets[param_index]});
+        continue;
+      }
       size_t size = mr_conv->IsCurrentParamALongOrDouble() ? 8u : 4u;
       src_args.push_back(mr_conv->IsCurrentParamInRegister()
           ? ArgumentLocation(mr_conv->CurrentParamRegister(), size)
@@ -449,6 +514,13 @@ static JniCompiledMethod ArtJniCompileMethodInternal(const CompilerOptions& comp
     }
     DCHECK(!main_jni_conv->HasNext());
     __ MoveArguments(ArrayRef<ArgumentLocation>(dest_args), ArrayRef<ArgumentLocation>(src_args));
+    for (const PinnedArrayArgument& arg : pinned_array_args) {
+      if (arg.dest.IsRegister()) {
+        __ CreateArrayDataPointer(arg.dest.GetRegister(), arg.ref_offset, arg.data_offset);
+      } else {
+        __ CreateArrayDataPointer(arg.dest.GetFrameOffset(), arg.ref_offset, arg.data_offset);
+      }
+    }
   } else {
     // Iterate over arguments placing values from managed calling convention in
     // to the convention required for a native call (shuffling). For references
@@ -29,6 +29,7 @@
 #include "gc/accounting/card_table.h"
 #include "gc/space/image_space.h"
 #include "heap_poisoning.h"
+#include "instrumentation.h"
 #include "interpreter/mterp/nterp.h"
 #include "intrinsics.h"
 #include "intrinsics_arm64.h"
@@ -459,6 +460,35 @@ class SuspendCheckSlowPathARM64 : public SlowPathCodeARM64 {
   DISALLOW_COPY_AND_ASSIGN(SuspendCheckSlowPathARM64);
 };
 
+class MethodEntryExitHooksSlowPathARM64 : public SlowPathCodeARM64 {
+ public:
+  explicit MethodEntryExitHooksSlowPathARM64(HInstruction* instruction)
+      : SlowPathCodeARM64(instruction) {}
+
+  void EmitNativeCode(CodeGenerator* codegen) override {
+    LocationSummary* locations = instruction_->GetLocations();
+    CodeGeneratorARM64* arm64_codegen = down_cast<CodeGeneratorARM64*>(codegen);
+    __ Bind(GetEntryLabel());
+    SaveLiveRegisters(codegen, locations);  // Only saves live vector regs for SIMD.
+    if (instruction_->IsMethodExitHook()) {
+      arm64_codegen->InvokeRuntime(
+          kQuickMethodExitHook, instruction_, instruction_->GetDexPc(), this);
+      CheckEntrypointTypes<kQuickMethodExitHook, void, void>();
+    } else {
+      arm64_codegen->InvokeRuntime(
+          kQuickMethodEntryHook, instruction_, instruction_->GetDexPc(), this);
+      CheckEntrypointTypes<kQuickMethodEntryHook, void, void>();
+    }
+    RestoreLiveRegisters(codegen, locations);  // Only restores live vector regs for SIMD.
+    __ B(GetExitLabel());
+  }
+
+  const char* GetDescription() const override { return "MethodEntryExitHooksSlowPathARM64"; }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(MethodEntryExitHooksSlowPathARM64);
+};
+
 class TypeCheckSlowPathARM64 : public SlowPathCodeARM64 {
  public:
   TypeCheckSlowPathARM64(HInstruction* instruction, bool is_fatal)
@@ -5703,6 +5733,57 @@ void InstructionCodeGeneratorARM64::VisitMemoryBarrier(HMemoryBarrier* memory_ba
   codegen_->GenerateMemoryBarrier(memory_barrier->GetBarrierKind());
 }
 
+static void SetUpMethodEntryExitHooksLocations(ArenaAllocator* allocator,
+                                               HInstruction* instruction,
+                                               bool has_simd) {
+  LocationSummary* locations =
+      new (allocator) LocationSummary(instruction, LocationSummary::kCallOnSlowPath);
+  // The entrypoints save and restore all registers, except for the upper
+  // part of SIMD registers, see VisitSuspendCheck.
+  locations->SetCustomSlowPathCallerSaves(has_simd ? RegisterSet::AllFpu() : RegisterSet::Empty());
+  if (instruction->InputCount() != 0u) {
+    // The exit hook reads the return value from the return register.
+    locations->SetInAt(0, ARM64ReturnLocation(instruction->InputAt(0)->GetType()));
+  }
+}
+
+void InstructionCodeGeneratorARM64::GenerateMethodEntryExitHook(HInstruction* instruction) {
+  SlowPathCodeARM64* slow_path =
+      new (codegen_->GetScopedAllocator()) MethodEntryExitHooksSlowPathARM64(instruction);
+  codegen_->AddSlowPath(slow_path);
+
+  uint64_t address = reinterpret_cast64<uint64_t>(
+      Runtime::Current()->GetInstrumentation()->GetEntryExitHooksEnabledAddress());
+  UseScratchRegisterScope temps(GetVIXLAssembler());
+  Register temp = temps.AcquireX();
+  __ Mov(temp, address);
+  __ Ldrb(temp.W(), MemOperand(temp));
+  __ Cbnz(temp.W(), slow_path->GetEntryLabel());
+  __ Bind(slow_path->GetExitLabel());
+}
+
+void LocationsBuilderARM64::VisitMethodEntryHook(HMethodEntryHook* instruction) {
+  SetUpMethodEntryExitHooksLocations(GetGraph()->GetAllocator(),
+                                     instruction,
+                                     GetGraph()->HasSIMD());
+}
+
+void InstructionCodeGeneratorARM64::VisitMethodEntryHook(HMethodEntryHook* instruction) {
+  GenerateMethodEntryExitHook(instruction);
+  codegen_->MaybeGenerateMarkingRegisterCheck(/* code= */ __LINE__);
+}
+
+void LocationsBuilderARM64::VisitMethodExitHook(HMethodExitHook* instruction) {
+  SetUpMethodEntryExitHooksLocations(GetGraph()->GetAllocator(),
+                                     instruction,
+                                     GetGraph()->HasSIMD());
+}
+
+void InstructionCodeGeneratorARM64::VisitMethodExitHook(HMethodExitHook* instruction) {
+  GenerateMethodEntryExitHook(instruction);
+  codegen_->MaybeGenerateMarkingRegisterCheck(/* code= */ __LINE__);
+}
+
 void LocationsBuilderARM64::VisitReturn(HReturn* instruction) {
   LocationSummary* locations = new (GetGraph()->GetAllocator()) LocationSummary(instruction);
   DataType::Type return_type = instruction->InputAt(0)->GetType();
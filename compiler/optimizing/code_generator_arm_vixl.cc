@@ -29,6 +29,7 @@
 #include "gc/accounting/card_table.h"
 #include "gc/space/image_space.h"
 #include "heap_poisoning.h"
+#include "instrumentation.h"
 #include "intrinsics.h"
 #include "intrinsics_arm_vixl.h"
 #include "linker/linker_patch.h"
@@ -464,6 +465,32 @@ class SuspendCheckSlowPathARMVIXL : public SlowPathCodeARMVIXL {
   DISALLOW_COPY_AND_ASSIGN(SuspendCheckSlowPathARMVIXL);
 };
 
+class MethodEntryExitHooksSlowPathARMVIXL : public SlowPathCodeARMVIXL {
+ public:
+  explicit MethodEntryExitHooksSlowPathARMVIXL(HInstruction* instruction)
+      : SlowPathCodeARMVIXL(instruction) {}
+
+  void EmitNativeCode(CodeGenerator* codegen) override {
+    CodeGeneratorARMVIXL* arm_codegen = down_cast<CodeGeneratorARMVIXL*>(codegen);
+    __ Bind(GetEntryLabel());
+    if (instruction_->IsMethodExitHook()) {
+      arm_codegen->InvokeRuntime(
+          kQuickMethodExitHook, instruction_, instruction_->GetDexPc(), this);
+      CheckEntrypointTypes<kQuickMethodExitHook, void, void>();
+    } else {
+      arm_codegen->InvokeRuntime(
+          kQuickMethodEntryHook, instruction_, instruction_->GetDexPc(), this);
+      CheckEntrypointTypes<kQuickMethodEntryHook, void, void>();
+    }
+    __ B(GetExitLabel());
+  }
+
+  const char* GetDescription() const override { return "MethodEntryExitHooksSlowPathARMVIXL"; }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(MethodEntryExitHooksSlowPathARMVIXL);
+};
+
 class BoundsCheckSlowPathARMVIXL : public SlowPathCodeARMVIXL {
  public:
   explicit BoundsCheckSlowPathARMVIXL(HBoundsCheck* instruction)
@@ -3248,6 +3275,45 @@ void InstructionCodeGeneratorARMVIXL::VisitReturnVoid(HReturnVoid* ret ATTRIBUTE
   codegen_->GenerateFrameExit();
 }
 
+void InstructionCodeGeneratorARMVIXL::GenerateMethodEntryExitHook(HInstruction* instruction) {
+  SlowPathCodeARMVIXL* slow_path =
+      new (codegen_->GetScopedAllocator()) MethodEntryExitHooksSlowPathARMVIXL(instruction);
+  codegen_->AddSlowPath(slow_path);
+
+  uint32_t address = reinterpret_cast32<uint32_t>(
+      Runtime::Current()->GetInstrumentation()->GetEntryExitHooksEnabledAddress());
+  UseScratchRegisterScope temps(GetVIXLAssembler());
+  vixl32::Register temp = temps.Acquire();
+  __ Mov(temp, address);
+  __ Ldrb(temp, MemOperand(temp));
+  __ CompareAndBranchIfNonZero(temp, slow_path->GetEntryLabel());
+  __ Bind(slow_path->GetExitLabel());
+}
+
+void LocationsBuilderARMVIXL::VisitMethodEntryHook(HMethodEntryHook* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetAllocator()) LocationSummary(
+      instruction, LocationSummary::kCallOnSlowPath);
+  locations->SetCustomSlowPathCallerSaves(RegisterSet::Empty());  // No caller-save registers.
+}
+
+void InstructionCodeGeneratorARMVIXL::VisitMethodEntryHook(HMethodEntryHook* instruction) {
+  GenerateMethodEntryExitHook(instruction);
+}
+
+void LocationsBuilderARMVIXL::VisitMethodExitHook(HMethodExitHook* instruction) {
+  LocationSummary* locations = new (GetGraph()->GetAllocator()) LocationSummary(
+      instruction, LocationSummary::kCallOnSlowPath);
+  locations->SetCustomSlowPathCallerSaves(RegisterSet::Empty());  // No caller-save registers.
+  if (instruction->InputCount() != 0u) {
+    // The exit hook reads the return value from the return register.
+    locations->SetInAt(0, parameter_visitor_.GetReturnLocation(instruction->InputAt(0)->GetType()));
+  }
+}
+
+void InstructionCodeGeneratorARMVIXL::VisitMethodExitHook(HMethodExitHook* instruction) {
+  GenerateMethodEntryExitHook(instruction);
+}
+
 void LocationsBuilderARMVIXL::VisitReturn(HReturn* ret) {
   LocationSummary* locations =
       new (GetGraph()->GetAllocator()) LocationSummary(ret, LocationSummary::kNoCall);
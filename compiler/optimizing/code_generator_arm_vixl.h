@@ -323,6 +323,7 @@ class InstructionCodeGeneratorARMVIXL : public InstructionCodeGenerator {
   // is the block to branch to if the suspend check is not needed, and after
   // the suspend call.
   void GenerateSuspendCheck(HSuspendCheck* instruction, HBasicBlock* successor);
+  void GenerateMethodEntryExitHook(HInstruction* instruction);
   void GenerateClassInitializationCheck(LoadClassSlowPathARMVIXL* slow_path,
                                         vixl32::Register class_reg);
   void GenerateBitstringTypeCheckCompare(HTypeCheckInstruction* check,
@@ -25,6 +25,7 @@
 #include "gc/accounting/card_table.h"
 #include "gc/space/image_space.h"
 #include "heap_poisoning.h"
+#include "instrumentation.h"
 #include "intrinsics.h"
 #include "intrinsics_x86.h"
 #include "jit/profiling_info.h"
@@ -235,6 +236,35 @@ class SuspendCheckSlowPathX86 : public SlowPathCode {
   DISALLOW_COPY_AND_ASSIGN(SuspendCheckSlowPathX86);
 };
 
+class MethodEntryExitHooksSlowPathX86 : public SlowPathCode {
+ public:
+  explicit MethodEntryExitHooksSlowPathX86(HInstruction* instruction)
+      : SlowPathCode(instruction) {}
+
+  void EmitNativeCode(CodeGenerator* codegen) override {
+    LocationSummary* locations = instruction_->GetLocations();
+    CodeGeneratorX86* x86_codegen = down_cast<CodeGeneratorX86*>(codegen);
+    __ Bind(GetEntryLabel());
+    SaveLiveRegisters(codegen, locations);  // Only saves full width XMM for SIMD.
+    if (instruction_->IsMethodExitHook()) {
+      x86_codegen->InvokeRuntime(
+          kQuickMethodExitHook, instruction_, instruction_->GetDexPc(), this);
+      CheckEntrypointTypes<kQuickMethodExitHook, void, void>();
+    } else {
+      x86_codegen->InvokeRuntime(
+          kQuickMethodEntryHook, instruction_, instruction_->GetDexPc(), this);
+      CheckEntrypointTypes<kQuickMethodEntryHook, void, void>();
+    }
+    RestoreLiveRegisters(codegen, locations);  // Only restores full width XMM for SIMD.
+    __ jmp(GetExitLabel());
+  }
+
+  const char* GetDescription() const override { return "MethodEntryExitHooksSlowPathX86"; }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(MethodEntryExitHooksSlowPathX86);
+};
+
 class LoadStringSlowPathX86 : public SlowPathCode {
  public:
   explicit LoadStringSlowPathX86(HLoadString* instruction): SlowPathCode(instruction) {}
@@ -2185,6 +2215,53 @@ void InstructionCodeGeneratorX86::VisitReturnVoid(HReturnVoid* ret ATTRIBUTE_UNU
   codegen_->GenerateFrameExit();
 }
 
+static void SetUpMethodEntryExitHooksLocations(ArenaAllocator* allocator,
+                                               HInstruction* instruction,
+                                               bool has_simd) {
+  LocationSummary* locations =
+      new (allocator) LocationSummary(instruction, LocationSummary::kCallOnSlowPath);
+  // The entrypoints save and restore all registers, except for the upper
+  // part of SIMD registers, see VisitSuspendCheck.
+  locations->SetCustomSlowPathCallerSaves(has_simd ? RegisterSet::AllFpu() : RegisterSet::Empty());
+  if (instruction->InputCount() != 0u) {
+    // The exit hook reads the return value from the return register.
+    DataType::Type type = instruction->InputAt(0)->GetType();
+    locations->SetInAt(0, InvokeDexCallingConventionVisitorX86().GetReturnLocation(type));
+  }
+}
+
+void InstructionCodeGeneratorX86::GenerateMethodEntryExitHook(HInstruction* instruction) {
+  SlowPathCode* slow_path =
+      new (codegen_->GetScopedAllocator()) MethodEntryExitHooksSlowPathX86(instruction);
+  codegen_->AddSlowPath(slow_path);
+
+  uint32_t address = reinterpret_cast32<uint32_t>(
+      Runtime::Current()->GetInstrumentation()->GetEntryExitHooksEnabledAddress());
+  __ cmpb(Address::Absolute(address), Immediate(0));
+  __ j(kNotEqual, slow_path->GetEntryLabel());
+  __ Bind(slow_path->GetExitLabel());
+}
+
+void LocationsBuilderX86::VisitMethodEntryHook(HMethodEntryHook* instruction) {
+  SetUpMethodEntryExitHooksLocations(GetGraph()->GetAllocator(),
+                                     instruction,
+                                     GetGraph()->HasSIMD());
+}
+
+void InstructionCodeGeneratorX86::VisitMethodEntryHook(HMethodEntryHook* instruction) {
+  GenerateMethodEntryExitHook(instruction);
+}
+
+void LocationsBuilderX86::VisitMethodExitHook(HMethodExitHook* instruction) {
+  SetUpMethodEntryExitHooksLocations(GetGraph()->GetAllocator(),
+                                     instruction,
+                                     GetGraph()->HasSIMD());
+}
+
+void InstructionCodeGeneratorX86::VisitMethodExitHook(HMethodExitHook* instruction) {
+  GenerateMethodEntryExitHook(instruction);
+}
+
 void LocationsBuilderX86::VisitReturn(HReturn* ret) {
   LocationSummary* locations =
       new (GetGraph()->GetAllocator()) LocationSummary(ret, LocationSummary::kNoCall);
@@ -214,6 +214,7 @@ class InstructionCodeGeneratorX86 : public InstructionCodeGenerator {
   // is the block to branch to if the suspend check is not needed, and after
   // the suspend call.
   void GenerateSuspendCheck(HSuspendCheck* check, HBasicBlock* successor);
+  void GenerateMethodEntryExitHook(HInstruction* instruction);
   void GenerateClassInitializationCheck(SlowPathCode* slow_path, Register class_reg);
   void GenerateBitstringTypeCheckCompare(HTypeCheckInstruction* check, Register temp);
   void HandleBitwiseOperation(HBinaryOperation* instruction);
@@ -24,6 +24,7 @@
 #include "gc/accounting/card_table.h"
 #include "gc/space/image_space.h"
 #include "heap_poisoning.h"
+#include "instrumentation.h"
 #include "interpreter/mterp/nterp.h"
 #include "intrinsics.h"
 #include "intrinsics_x86_64.h"
@@ -187,6 +188,35 @@ class SuspendCheckSlowPathX86_64 : public SlowPathCode {
   DISALLOW_COPY_AND_ASSIGN(SuspendCheckSlowPathX86_64);
 };
 
+class MethodEntryExitHooksSlowPathX86_64 : public SlowPathCode {
+ public:
+  explicit MethodEntryExitHooksSlowPathX86_64(HInstruction* instruction)
+      : SlowPathCode(instruction) {}
+
+  void EmitNativeCode(CodeGenerator* codegen) override {
+    LocationSummary* locations = instruction_->GetLocations();
+    CodeGeneratorX86_64* x86_64_codegen = down_cast<CodeGeneratorX86_64*>(codegen);
+    __ Bind(GetEntryLabel());
+    SaveLiveRegisters(codegen, locations);  // Only saves full width XMM for SIMD.
+    if (instruction_->IsMethodExitHook()) {
+      x86_64_codegen->InvokeRuntime(
+          kQuickMethodExitHook, instruction_, instruction_->GetDexPc(), this);
+      CheckEntrypointTypes<kQuickMethodExitHook, void, void>();
+    } else {
+      x86_64_codegen->InvokeRuntime(
+          kQuickMethodEntryHook, instruction_, instruction_->GetDexPc(), this);
+      CheckEntrypointTypes<kQuickMethodEntryHook, void, void>();
+    }
+    RestoreLiveRegisters(codegen, locations);  // Only restores full width XMM for SIMD.
+    __ jmp(GetExitLabel());
+  }
+
+  const char* GetDescription() const override { return "MethodEntryExitHooksSlowPathX86_64"; }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(MethodEntryExitHooksSlowPathX86_64);
+};
+
 class BoundsCheckSlowPathX86_64 : public SlowPathCode {
  public:
   explicit BoundsCheckSlowPathX86_64(HBoundsCheck* instruction)
@@ -2343,6 +2373,54 @@ void InstructionCodeGeneratorX86_64::VisitReturnVoid(HReturnVoid* ret ATTRIBUTE_
   codegen_->GenerateFrameExit();
 }
 
+static void SetUpMethodEntryExitHooksLocations(ArenaAllocator* allocator,
+                                               HInstruction* instruction,
+                                               bool has_simd) {
+  LocationSummary* locations =
+      new (allocator) LocationSummary(instruction, LocationSummary::kCallOnSlowPath);
+  // The entrypoints save and restore all registers, except for the upper
+  // part of SIMD registers, see VisitSuspendCheck.
+  locations->SetCustomSlowPathCallerSaves(has_simd ? RegisterSet::AllFpu() : RegisterSet::Empty());
+  if (instruction->InputCount() != 0u) {
+    // The exit hook reads the return value from the return register.
+    DataType::Type type = instruction->InputAt(0)->GetType();
+    locations->SetInAt(0, InvokeDexCallingConventionVisitorX86_64().GetReturnLocation(type));
+  }
+}
+
+void InstructionCodeGeneratorX86_64::GenerateMethodEntryExitHook(HInstruction* instruction) {
+  SlowPathCode* slow_path =
+      new (codegen_->GetScopedAllocator()) MethodEntryExitHooksSlowPathX86_64(instruction);
+  codegen_->AddSlowPath(slow_path);
+
+  uint64_t address = reinterpret_cast64<uint64_t>(
+      Runtime::Current()->GetInstrumentation()->GetEntryExitHooksEnabledAddress());
+  __ movq(CpuRegister(TMP), Immediate(address));
+  __ cmpb(Address(CpuRegister(TMP), 0), Immediate(0));
+  __ j(kNotEqual, slow_path->GetEntryLabel());
+  __ Bind(slow_path->GetExitLabel());
+}
+
+void LocationsBuilderX86_64::VisitMethodEntryHook(HMethodEntryHook* instruction) {
+  SetUpMethodEntryExitHooksLocations(GetGraph()->GetAllocator(),
+                                     instruction,
+                                     GetGraph()->HasSIMD());
+}
+
+void InstructionCodeGeneratorX86_64::VisitMethodEntryHook(HMethodEntryHook* instruction) {
+  GenerateMethodEntryExitHook(instruction);
+}
+
+void LocationsBuilderX86_64::VisitMethodExitHook(HMethodExitHook* instruction) {
+  SetUpMethodEntryExitHooksLocations(GetGraph()->GetAllocator(),
+                                     instruction,
+                                     GetGraph()->HasSIMD());
+}
+
+void InstructionCodeGeneratorX86_64::VisitMethodExitHook(HMethodExitHook* instruction) {
+  GenerateMethodEntryExitHook(instruction);
+}
+
 void LocationsBuilderX86_64::VisitReturn(HReturn* ret) {
   LocationSummary* locations =
       new (GetGraph()->GetAllocator()) LocationSummary(ret, LocationSummary::kNoCall);
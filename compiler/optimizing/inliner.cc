@@ -31,6 +31,7 @@
 #include "driver/compiler_options.h"
 #include "driver/dex_compilation_unit.h"
 #include "instruction_simplifier.h"
+#include "instrumentation.h"
 #include "intrinsics.h"
 #include "jit/jit.h"
 #include "jit/jit_code_cache.h"
@@ -134,6 +135,12 @@ bool HInliner::Run() {
     // For simplicity, we currently never inline when the graph is debuggable. This avoids
     // doing some logic in the runtime to discover if a method could have been inlined.
     return false;
+  } else if (codegen_->GetCompilerOptions().GetMethodEntryExitHooks() &&
+             Runtime::Current()->GetInstrumentation()->AreEntryExitHooksEnabled()) {
+    // Inlined methods would not report their entry and exit. Code compiled with inlining while
+    // the hooks are disabled is replaced by the interpreter when they get enabled, see
+    // Instrumentation::CanRunWithEntryExitHooks.
+    return false;
   }
 
   bool didInline = false;
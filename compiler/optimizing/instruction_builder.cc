@@ -334,6 +334,11 @@ bool HInstructionBuilder::Build() {
 
     if (current_block_->IsEntryBlock()) {
       InitializeParameters();
+      if (NeedsMethodEntryExitHooks()) {
+        // Keep the suspend check right before the goto, see
+        // CodeGenerator::GenerateSuspendCheck and HGraph::InsertConstant.
+        AppendInstruction(new (allocator_) HMethodEntryHook(0u));
+      }
       AppendInstruction(new (allocator_) HSuspendCheck(0u));
       AppendInstruction(new (allocator_) HGoto(0u));
       continue;
@@ -430,6 +435,9 @@ void HInstructionBuilder::BuildIntrinsic(ArtMethod* method) {
   current_block_ = current_block_->GetSingleSuccessor();
   InitializeBlockLocals();
   DCHECK(!IsBlockPopulated(current_block_));
+  if (NeedsMethodEntryExitHooks()) {
+    AppendInstruction(new (allocator_) HMethodEntryHook(0u));
+  }
 
   // Add the intermediate representation, if available, or invoke instruction.
   size_t in_vregs = graph_->GetNumberOfInVRegs();
@@ -465,8 +473,10 @@ void HInstructionBuilder::BuildIntrinsic(ArtMethod* method) {
 
   // Add the return instruction.
   if (return_type_ == DataType::Type::kVoid) {
+    BuildMethodExitHook(/* value= */ nullptr, kNoDexPc);
     AppendInstruction(new (allocator_) HReturnVoid());
   } else {
+    BuildMethodExitHook(latest_result_, kNoDexPc);
     AppendInstruction(new (allocator_) HReturn(latest_result_));
   }
 
@@ -790,15 +800,28 @@ void HInstructionBuilder::BuildReturn(const Instruction& instruction,
           compilation_stats_,
           MethodCompilationStat::kConstructorFenceGeneratedFinal);
     }
+    BuildMethodExitHook(/* value= */ nullptr, dex_pc);
     AppendInstruction(new (allocator_) HReturnVoid(dex_pc));
   } else {
     DCHECK(!RequiresConstructorBarrier(dex_compilation_unit_));
     HInstruction* value = LoadLocal(instruction.VRegA(), type);
+    BuildMethodExitHook(value, dex_pc);
     AppendInstruction(new (allocator_) HReturn(value, dex_pc));
   }
   current_block_ = nullptr;
 }
 
+bool HInstructionBuilder::NeedsMethodEntryExitHooks() const {
+  return code_generator_ != nullptr &&
+         code_generator_->GetCompilerOptions().GetMethodEntryExitHooks();
+}
+
+void HInstructionBuilder::BuildMethodExitHook(HInstruction* value, uint32_t dex_pc) {
+  if (NeedsMethodEntryExitHooks()) {
+    AppendInstruction(new (allocator_) HMethodExitHook(allocator_, value, dex_pc));
+  }
+}
+
 static InvokeType GetInvokeTypeFromOpCode(Instruction::Code opcode) {
   switch (opcode) {
     case Instruction::INVOKE_STATIC:
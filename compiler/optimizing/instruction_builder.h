@@ -74,6 +74,10 @@ class HInstructionBuilder : public ValueObject {
   ArenaBitVector* FindNativeDebugInfoLocations();
 
   bool CanDecodeQuickenedInfo() const;
+
+  // Whether the compiled code reports method entry and exit to the runtime.
+  bool NeedsMethodEntryExitHooks() const;
+  void BuildMethodExitHook(HInstruction* value, uint32_t dex_pc);
   uint16_t LookupQuickenedInfo(uint32_t quicken_index);
 
   HBasicBlock* FindBlockStartingAt(uint32_t dex_pc) const;
@@ -1487,6 +1487,8 @@ class HLoopInformationOutwardIterator : public ValueObject {
   M(LongConstant, Constant)                                             \
   M(Max, Instruction)                                                   \
   M(MemoryBarrier, Instruction)                                         \
+  M(MethodEntryHook, Instruction)                                       \
+  M(MethodExitHook, Instruction)                                        \
   M(Min, BinaryOperation)                                               \
   M(MonitorOperation, Instruction)                                      \
   M(Mul, BinaryOperation)                                               \
@@ -6298,6 +6300,60 @@ class HSuspendCheck final : public HExpression<0> {
   SlowPathCode* slow_path_;
 };
 
+// Reports the entry of the method to the runtime when method entry/exit hooks are enabled.
+class HMethodEntryHook : public HExpression<0> {
+ public:
+  explicit HMethodEntryHook(uint32_t dex_pc)
+      : HExpression<0>(kMethodEntryHook, SideEffects::All(), dex_pc) {
+  }
+
+  bool NeedsEnvironment() const override {
+    return true;
+  }
+
+  // The exception of a throwing listener is delivered to the caller, see
+  // Thread::QuickDeliverException.
+  bool CanThrow() const override {
+    return true;
+  }
+
+  DECLARE_INSTRUCTION(MethodEntryHook);
+
+ protected:
+  DEFAULT_COPY_CONSTRUCTOR(MethodEntryHook);
+};
+
+// Reports the exit of the method to the runtime when method entry/exit hooks are enabled.
+// Takes the return value as input, if the method returns one, so that it can be passed to
+// the listeners.
+class HMethodExitHook : public HVariableInputSizeInstruction {
+ public:
+  HMethodExitHook(ArenaAllocator* allocator, HInstruction* value, uint32_t dex_pc)
+      : HVariableInputSizeInstruction(kMethodExitHook,
+                                      SideEffects::All(),
+                                      dex_pc,
+                                      allocator,
+                                      /* number_of_inputs= */ (value != nullptr) ? 1u : 0u,
+                                      kArenaAllocMisc) {
+    if (value != nullptr) {
+      SetRawInputAt(0, value);
+    }
+  }
+
+  bool NeedsEnvironment() const override {
+    return true;
+  }
+
+  bool CanThrow() const override {
+    return true;
+  }
+
+  DECLARE_INSTRUCTION(MethodExitHook);
+
+ protected:
+  DEFAULT_COPY_CONSTRUCTOR(MethodExitHook);
+};
+
 // Pseudo-instruction which provides the native debugger with mapping information.
 // It ensures that we can generate line number and local variables at this point.
 class HNativeDebugInfo : public HExpression<0> {
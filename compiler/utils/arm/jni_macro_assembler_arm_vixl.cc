@@ -866,6 +866,39 @@ void ArmVIXLJNIMacroAssembler::CreateHandleScopeEntry(FrameOffset out_off,
   asm_.StoreToOffset(kStoreWord, scratch, sp, out_off.Int32Value());
 }
 
+void ArmVIXLJNIMacroAssembler::CreateArrayDataPointer(ManagedRegister mout_reg,
+                                                      FrameOffset ref_offset,
+                                                      uint32_t data_offset) {
+  vixl::aarch32::Register out_reg = AsVIXLRegister(mout_reg.AsArm());
+  // e.g. out_reg = (ref == 0) ? 0 : (ref + data_offset)
+  asm_.LoadFromOffset(kLoadWord, out_reg, sp, ref_offset.Int32Value());
+  ___ Cmp(out_reg, 0);
+  CHECK(asm_.ShifterOperandCanHold(ADD, data_offset));
+  ExactAssemblyScope guard(asm_.GetVIXLAssembler(),
+                           2 * vixl32::kMaxInstructionSizeInBytes,
+                           CodeBufferCheckScope::kMaximumSize);
+  ___ it(ne, 0x8);
+  asm_.AddConstantInIt(out_reg, out_reg, data_offset, ne);
+}
+
+void ArmVIXLJNIMacroAssembler::CreateArrayDataPointer(FrameOffset out_off,
+                                                      FrameOffset ref_offset,
+                                                      uint32_t data_offset) {
+  UseScratchRegisterScope temps(asm_.GetVIXLAssembler());
+  vixl32::Register scratch = temps.Acquire();
+  asm_.LoadFromOffset(kLoadWord, scratch, sp, ref_offset.Int32Value());
+  ___ Cmp(scratch, 0);
+  CHECK(asm_.ShifterOperandCanHold(ADD, data_offset));
+  {
+    ExactAssemblyScope guard(asm_.GetVIXLAssembler(),
+                             2 * vixl32::kMaxInstructionSizeInBytes,
+                             CodeBufferCheckScope::kMaximumSize);
+    ___ it(ne, 0x8);
+    asm_.AddConstantInIt(scratch, scratch, data_offset, ne);
+  }
+  asm_.StoreToOffset(kStoreWord, scratch, sp, out_off.Int32Value());
+}
+
 void ArmVIXLJNIMacroAssembler::LoadReferenceFromHandleScope(
     ManagedRegister mout_reg ATTRIBUTE_UNUSED,
     ManagedRegister min_reg ATTRIBUTE_UNUSED) {
@@ -698,6 +698,35 @@ void Arm64JNIMacroAssembler::CreateHandleScopeEntry(FrameOffset out_off,
   ___ Str(scratch, MEM_OP(reg_x(SP), out_off.Int32Value()));
 }
 
+void Arm64JNIMacroAssembler::CreateArrayDataPointer(ManagedRegister m_out_reg,
+                                                    FrameOffset ref_offset,
+                                                    uint32_t data_offset) {
+  Arm64ManagedRegister out_reg = m_out_reg.AsArm64();
+  CHECK(out_reg.IsXRegister()) << out_reg;
+  Register out = reg_x(out_reg.AsXRegister());
+  UseScratchRegisterScope temps(asm_.GetVIXLAssembler());
+  Register scratch = temps.AcquireX();
+  // Loading the W register zero-extends the reference.
+  // e.g. out_reg = (ref == 0) ? 0 : (ref + data_offset)
+  ___ Ldr(out.W(), MEM_OP(reg_x(SP), ref_offset.Int32Value()));
+  ___ Add(scratch, out, data_offset);
+  ___ Cmp(out, 0);
+  ___ Csel(out, scratch, xzr, ne);
+}
+
+void Arm64JNIMacroAssembler::CreateArrayDataPointer(FrameOffset out_off,
+                                                    FrameOffset ref_offset,
+                                                    uint32_t data_offset) {
+  UseScratchRegisterScope temps(asm_.GetVIXLAssembler());
+  Register scratch = temps.AcquireX();
+  Register scratch2 = temps.AcquireX();
+  ___ Ldr(scratch.W(), MEM_OP(reg_x(SP), ref_offset.Int32Value()));
+  ___ Add(scratch2, scratch, data_offset);
+  ___ Cmp(scratch, 0);
+  ___ Csel(scratch, scratch2, xzr, ne);
+  ___ Str(scratch, MEM_OP(reg_x(SP), out_off.Int32Value()));
+}
+
 void Arm64JNIMacroAssembler::LoadReferenceFromHandleScope(ManagedRegister m_out_reg,
                                                           ManagedRegister m_in_reg) {
   Arm64ManagedRegister out_reg = m_out_reg.AsArm64();
@@ -150,6 +150,18 @@ class Arm64JNIMacroAssembler final : public JNIMacroAssemblerFwd<Arm64Assembler,
                               FrameOffset handlescope_offset,
                               bool null_allowed) override;
 
+  // Set up out_reg to hold a pointer to the data of the primitive array whose reference is in
+  // the stack slot at ref_offset, or to be null if the reference is null.
+  void CreateArrayDataPointer(ManagedRegister out_reg,
+                              FrameOffset ref_offset,
+                              uint32_t data_offset) override;
+
+  // Set up out_off to hold a pointer to the data of the primitive array whose reference is in
+  // the stack slot at ref_offset, or to be null if the reference is null.
+  void CreateArrayDataPointer(FrameOffset out_off,
+                              FrameOffset ref_offset,
+                              uint32_t data_offset) override;
+
   // src holds a handle scope entry (Object**) load this into dst.
   void LoadReferenceFromHandleScope(ManagedRegister dst, ManagedRegister src) override;
 
@@ -22,11 +22,13 @@
 #include <inttypes.h>
 
 #include <algorithm>
+#include <atomic>
 #include <unordered_map>
+#include <vector>
 
 #include "android-base/stringprintf.h"
 
-#include "base/hash_set.h"
+#include "base/bit_utils.h"
 #include "base/mutex.h"
 #include "base/stl_util.h"
 #include "base/time_utils.h"
@@ -58,43 +60,63 @@ class DedupeSet<InKey, StoreKey, Alloc, HashType, HashFunc, kShard>::Shard {
       : alloc_(alloc),
         lock_name_(lock_name),
         lock_(lock_name_.c_str()),
-        keys_() {
+        size_(0u),
+        tables_(),
+        table_(nullptr) {
+    tables_.emplace_back(new Table(kMinCapacity));
+    table_.store(tables_.back().get(), std::memory_order_release);
   }
 
   ~Shard() {
-    for (const HashedKey<StoreKey>& key : keys_) {
-      DCHECK(key.Key() != nullptr);
-      alloc_.Destroy(key.Key());
+    const Table* table = table_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i != table->Capacity(); ++i) {
+      const StoreKey* key = table->GetSlot(i).key.load(std::memory_order_relaxed);
+      if (key != nullptr) {
+        alloc_.Destroy(key);
+      }
     }
   }
 
   const StoreKey* Add(Thread* self, size_t hash, const InKey& in_key) REQUIRES(!lock_) {
+    // Fast path: the key is usually already present, look it up without taking the lock.
+    const StoreKey* store_key = Find(table_.load(std::memory_order_acquire), hash, in_key);
+    if (store_key != nullptr) {
+      return store_key;
+    }
     MutexLock lock(self, lock_);
-    HashedKey<InKey> hashed_in_key(hash, &in_key);
-    auto it = keys_.find(hashed_in_key);
-    if (it != keys_.end()) {
-      DCHECK(it->Key() != nullptr);
-      return it->Key();
+    // Only insertions are serialized, so check again for a key inserted in the meantime.
+    Table* table = table_.load(std::memory_order_relaxed);
+    store_key = Find(table, hash, in_key);
+    if (store_key != nullptr) {
+      return store_key;
+    }
+    if ((size_ + 1u) * kMaxLoadFactorDenominator > table->Capacity()) {
+      table = Grow(table);
     }
-    const StoreKey* store_key = alloc_.Copy(in_key);
-    keys_.insert(HashedKey<StoreKey> { hash, store_key });
+    store_key = alloc_.Copy(in_key);
+    Insert(table, hash, store_key);
+    ++size_;
     return store_key;
   }
 
   void UpdateStats(Thread* self, Stats* global_stats) REQUIRES(!lock_) {
-    // HashSet<> doesn't keep entries ordered by hash, so we actually allocate memory
+    // The table doesn't keep entries ordered by hash, so we actually allocate memory
     // for bookkeeping while collecting the stats.
     std::unordered_map<HashType, size_t> stats;
     {
       MutexLock lock(self, lock_);
-      // Note: The total_probe_distance will be updated with the current state.
-      // It may have been higher before a re-hash.
-      global_stats->total_probe_distance += keys_.TotalProbeDistance();
-      global_stats->total_size += keys_.size();
-      for (const HashedKey<StoreKey>& key : keys_) {
-        auto it = stats.find(key.Hash());
+      const Table* table = table_.load(std::memory_order_relaxed);
+      global_stats->total_size += size_;
+      for (size_t i = 0; i != table->Capacity(); ++i) {
+        const Slot& slot = table->GetSlot(i);
+        if (slot.key.load(std::memory_order_relaxed) == nullptr) {
+          continue;
+        }
+        size_t hash = slot.hash.load(std::memory_order_relaxed);
+        global_stats->total_probe_distance += (i - hash) & table->Mask();
+        auto it = stats.find(hash);
         if (it == stats.end()) {
-          stats.insert({key.Hash(), 1u});
+          stats.insert({hash, 1u});
         } else {
           ++it->second;
         }
@@ -110,74 +132,98 @@ class DedupeSet<InKey, StoreKey, Alloc, HashType, HashFunc, kShard>::Shard {
   }
 
  private:
-  template <typename T>
-  class HashedKey {
-   public:
-    HashedKey() : hash_(0u), key_(nullptr) { }
-    HashedKey(size_t hash, const T* key) : hash_(hash), key_(key) { }
+  static constexpr size_t kMinCapacity = 64u;
+  // Keep the table at most half full so that probe sequences stay short and always
+  // end at an empty slot.
+  static constexpr size_t kMaxLoadFactorDenominator = 2u;
 
-    size_t Hash() const {
-      return hash_;
-    }
+  // A slot is published by storing the key with release semantics after the hash. Readers
+  // load the key with acquire semantics, so a non-null key implies a valid hash and contents.
+  struct Slot {
+    std::atomic<size_t> hash;
+    std::atomic<const StoreKey*> key;
+  };
 
-    const T* Key() const {
-      return key_;
+  // Open-addressing table with linear probing. Tables only grow; a replaced table is kept
+  // alive until the shard is destroyed since lock-free readers may still be probing it.
+  class Table {
+   public:
+    explicit Table(size_t capacity) : mask_(capacity - 1u), slots_(new Slot[capacity]) {
+      DCHECK(IsPowerOfTwo(capacity));
+      for (size_t i = 0; i != capacity; ++i) {
+        slots_[i].hash.store(0u, std::memory_order_relaxed);
+        slots_[i].key.store(nullptr, std::memory_order_relaxed);
+      }
     }
 
-    bool IsEmpty() const {
-      return Key() == nullptr;
+    size_t Capacity() const {
+      return mask_ + 1u;
     }
 
-    void MakeEmpty() {
-      key_ = nullptr;
+    size_t Mask() const {
+      return mask_;
     }
 
-   private:
-    size_t hash_;
-    const T* key_;
-  };
-
-  class ShardEmptyFn {
-   public:
-    bool IsEmpty(const HashedKey<StoreKey>& key) const {
-      return key.IsEmpty();
+    Slot& GetSlot(size_t index) {
+      return slots_[index];
     }
 
-    void MakeEmpty(HashedKey<StoreKey>& key) {
-      key.MakeEmpty();
+    const Slot& GetSlot(size_t index) const {
+      return slots_[index];
     }
+
+   private:
+    const size_t mask_;
+    const std::unique_ptr<Slot[]> slots_;
   };
 
-  struct ShardHashFn {
-    template <typename T>
-    size_t operator()(const HashedKey<T>& key) const {
-      return key.Hash();
+  template <typename KeyType>
+  static const StoreKey* Find(const Table* table, size_t hash, const KeyType& key) {
+    for (size_t index = hash & table->Mask(); ; index = (index + 1u) & table->Mask()) {
+      const Slot& slot = table->GetSlot(index);
+      const StoreKey* store_key = slot.key.load(std::memory_order_acquire);
+      if (store_key == nullptr) {
+        return nullptr;
+      }
+      if (slot.hash.load(std::memory_order_relaxed) == hash &&
+          store_key->size() == key.size() &&
+          std::equal(store_key->begin(), store_key->end(), key.begin())) {
+        return store_key;
+      }
     }
-  };
+  }
 
-  struct ShardPred {
-    typename std::enable_if<!std::is_same<StoreKey, InKey>::value, bool>::type
-    operator()(const HashedKey<StoreKey>& lhs, const HashedKey<StoreKey>& rhs) const {
-      DCHECK(lhs.Key() != nullptr);
-      DCHECK(rhs.Key() != nullptr);
-      // Rehashing: stored keys are already deduplicated, so we can simply compare key pointers.
-      return lhs.Key() == rhs.Key();
+  static void Insert(Table* table, size_t hash, const StoreKey* store_key) {
+    size_t index = hash & table->Mask();
+    while (table->GetSlot(index).key.load(std::memory_order_relaxed) != nullptr) {
+      index = (index + 1u) & table->Mask();
     }
+    Slot& slot = table->GetSlot(index);
+    slot.hash.store(hash, std::memory_order_relaxed);
+    slot.key.store(store_key, std::memory_order_release);
+  }
 
-    template <typename LeftT, typename RightT>
-    bool operator()(const HashedKey<LeftT>& lhs, const HashedKey<RightT>& rhs) const {
-      DCHECK(lhs.Key() != nullptr);
-      DCHECK(rhs.Key() != nullptr);
-      return lhs.Hash() == rhs.Hash() &&
-          lhs.Key()->size() == rhs.Key()->size() &&
-          std::equal(lhs.Key()->begin(), lhs.Key()->end(), rhs.Key()->begin());
+  Table* Grow(const Table* old_table) REQUIRES(lock_) {
+    tables_.emplace_back(new Table(old_table->Capacity() * 2u));
+    Table* new_table = tables_.back().get();
+    for (size_t i = 0; i != old_table->Capacity(); ++i) {
+      const Slot& slot = old_table->GetSlot(i);
+      const StoreKey* store_key = slot.key.load(std::memory_order_relaxed);
+      if (store_key != nullptr) {
+        Insert(new_table, slot.hash.load(std::memory_order_relaxed), store_key);
+      }
     }
-  };
+    table_.store(new_table, std::memory_order_release);
+    return new_table;
+  }
 
   Alloc alloc_;
   const std::string lock_name_;
   Mutex lock_;
-  HashSet<HashedKey<StoreKey>, ShardEmptyFn, ShardHashFn, ShardPred> keys_ GUARDED_BY(lock_);
+  size_t size_ GUARDED_BY(lock_);
+  // All tables ever allocated, the last one is the current table.
+  std::vector<std::unique_ptr<Table>> tables_ GUARDED_BY(lock_);
+  std::atomic<Table*> table_;
 };
 
 template <typename InKey,
@@ -195,10 +241,10 @@ const StoreKey* DedupeSet<InKey, StoreKey, Alloc, HashType, HashFunc, kShard>::A
   HashType raw_hash = HashFunc()(key);
   if (kIsDebugBuild) {
     uint64_t hash_end = NanoTime();
-    hash_time_ += hash_end - hash_start;
+    hash_time_.fetch_add(hash_end - hash_start, std::memory_order_relaxed);
   }
-  HashType shard_hash = raw_hash / kShard;
-  HashType shard_bin = raw_hash % kShard;
+  HashType shard_hash = raw_hash / num_shards_;
+  HashType shard_bin = raw_hash % num_shards_;
   return shards_[shard_bin]->Add(self, shard_hash, key);
 }
 
@@ -209,9 +255,13 @@ template <typename InKey,
           typename HashFunc,
           HashType kShard>
 DedupeSet<InKey, StoreKey, Alloc, HashType, HashFunc, kShard>::DedupeSet(const char* set_name,
-                                                                         const Alloc& alloc)
-    : hash_time_(0) {
-  for (HashType i = 0; i < kShard; ++i) {
+                                                                         const Alloc& alloc,
+                                                                         HashType num_shards)
+    : num_shards_(num_shards),
+      shards_(new std::unique_ptr<Shard>[num_shards]),
+      hash_time_(0u) {
+  DCHECK_NE(num_shards, 0u);
+  for (HashType i = 0; i < num_shards_; ++i) {
     std::ostringstream oss;
     oss << set_name << " lock " << i;
     shards_[i].reset(new Shard(alloc, oss.str()));
@@ -237,7 +287,7 @@ template <typename InKey,
 std::string DedupeSet<InKey, StoreKey, Alloc, HashType, HashFunc, kShard>::DumpStats(
     Thread* self) const {
   Stats stats;
-  for (HashType shard = 0; shard < kShard; ++shard) {
+  for (HashType shard = 0; shard < num_shards_; ++shard) {
     shards_[shard]->UpdateStats(self, &stats);
   }
   return android::base::StringPrintf("%zu collisions, %zu max hash collisions, "
@@ -246,7 +296,7 @@ std::string DedupeSet<InKey, StoreKey, Alloc, HashType, HashFunc, kShard>::DumpS
                                      stats.collision_max,
                                      stats.total_probe_distance,
                                      stats.total_size,
-                                     hash_time_);
+                                     hash_time_.load(std::memory_order_relaxed));
 }
 
 
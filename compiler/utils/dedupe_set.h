@@ -18,6 +18,8 @@
 #define ART_COMPILER_UTILS_DEDUPE_SET_H_
 
 #include <stdint.h>
+
+#include <atomic>
 #include <memory>
 #include <string>
 
@@ -28,8 +30,9 @@ namespace art {
 class Thread;
 
 // A set of Keys that support a HashFunc returning HashType. Used to find duplicates of Key in the
-// Add method. The data-structure is thread-safe through the use of internal locks, it also
-// supports the lock being sharded.
+// Add method. The data-structure is thread-safe. Keys are distributed over shards by hash; lookups
+// of keys already in the set are lock-free and only insertions take the shard's lock. The number
+// of shards defaults to `kShard` and can be increased for heavily contended sets.
 template <typename InKey,
           typename StoreKey,
           typename Alloc,
@@ -41,18 +44,23 @@ class DedupeSet {
   // Add a new key to the dedupe set if not present. Return the equivalent deduplicated stored key.
   const StoreKey* Add(Thread* self, const InKey& key);
 
-  DedupeSet(const char* set_name, const Alloc& alloc);
+  DedupeSet(const char* set_name, const Alloc& alloc, HashType num_shards = kShard);
 
   ~DedupeSet();
 
+  HashType GetNumberOfShards() const {
+    return num_shards_;
+  }
+
   std::string DumpStats(Thread* self) const;
 
  private:
   struct Stats;
   class Shard;
 
-  std::unique_ptr<Shard> shards_[kShard];
-  uint64_t hash_time_;
+  const HashType num_shards_;
+  std::unique_ptr<std::unique_ptr<Shard>[]> shards_;
+  std::atomic<uint64_t> hash_time_;
 
   DISALLOW_COPY_AND_ASSIGN(DedupeSet);
 };
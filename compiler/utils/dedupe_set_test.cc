@@ -18,9 +18,13 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <thread>
 #include <vector>
 
+#include "android-base/logging.h"
+
 #include "base/array_ref.h"
+#include "base/time_utils.h"
 #include "dedupe_set-inl.h"
 #include "gtest/gtest.h"
 #include "thread-current-inl.h"
@@ -88,4 +92,75 @@ TEST(DedupeSetTest, Test) {
   }
 }
 
+using TestDedupeSet = DedupeSet<ArrayRef<const uint8_t>,
+                                std::vector<uint8_t>,
+                                DedupeSetTestAlloc,
+                                size_t,
+                                DedupeSetTestHashFunc>;
+
+TEST(DedupeSetTest, Grow) {
+  Thread* self = Thread::Current();
+  DedupeSetTestAlloc alloc;
+  TestDedupeSet deduplicator("test", alloc, /* num_shards= */ 2u);
+  ASSERT_EQ(2u, deduplicator.GetNumberOfShards());
+  std::vector<const std::vector<uint8_t>*> added;
+  for (size_t i = 0; i != 1000u; ++i) {
+    uint8_t raw[] = { static_cast<uint8_t>(i), static_cast<uint8_t>(i >> 8) };
+    added.push_back(deduplicator.Add(self, ArrayRef<const uint8_t>(raw)));
+  }
+  // All keys are still found after the shards have grown.
+  for (size_t i = 0; i != 1000u; ++i) {
+    uint8_t raw[] = { static_cast<uint8_t>(i), static_cast<uint8_t>(i >> 8) };
+    ASSERT_EQ(added[i], deduplicator.Add(self, ArrayRef<const uint8_t>(raw)));
+  }
+}
+
+// Contention benchmark: many threads adding keys with a high duplication rate, similar to
+// compiled method storage deduplicating stack maps and CFI data from all compiler threads.
+TEST(DedupeSetTest, Contention) {
+  static constexpr size_t kNumThreads = 16u;
+  static constexpr size_t kNumKeys = 4096u;
+  static constexpr size_t kAddsPerThread = 64u * 1024u;
+
+  std::vector<std::vector<uint8_t>> keys;
+  for (size_t i = 0; i != kNumKeys; ++i) {
+    keys.push_back({ static_cast<uint8_t>(i), static_cast<uint8_t>(i >> 8), 1u, 2u, 3u, 4u });
+  }
+
+  for (size_t num_shards : { 1u, 4u, 64u }) {
+    DedupeSetTestAlloc alloc;
+    TestDedupeSet deduplicator("test", alloc, num_shards);
+    std::vector<std::vector<const std::vector<uint8_t>*>> results(kNumThreads);
+    uint64_t start_ns = NanoTime();
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t != kNumThreads; ++t) {
+      threads.emplace_back([&, t]() {
+        std::vector<const std::vector<uint8_t>*>& result = results[t];
+        result.resize(kNumKeys);
+        for (size_t i = 0; i != kAddsPerThread; ++i) {
+          size_t key_index = (i * 7u + t * 131u) % kNumKeys;
+          const std::vector<uint8_t>& key = keys[key_index];
+          result[key_index] = deduplicator.Add(/* self= */ nullptr, ArrayRef<const uint8_t>(key));
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    uint64_t duration_ns = NanoTime() - start_ns;
+    LOG(INFO) << "DedupeSet contention: " << kNumThreads << " threads, " << num_shards
+              << " shards: " << PrettyDuration(duration_ns) << " for "
+              << kNumThreads * kAddsPerThread << " adds";
+
+    // Every thread must have received the same deduplicated key for equal contents.
+    for (size_t i = 0; i != kNumKeys; ++i) {
+      ASSERT_NE(nullptr, results[0][i]);
+      ASSERT_TRUE(*results[0][i] == keys[i]);
+      for (size_t t = 1; t != kNumThreads; ++t) {
+        ASSERT_EQ(results[0][i], results[t][i]);
+      }
+    }
+  }
+}
+
 }  // namespace art
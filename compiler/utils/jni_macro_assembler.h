@@ -223,6 +223,19 @@ class JNIMacroAssembler : public DeletableArenaObject<kArenaAllocAssembler> {
                                       FrameOffset handlescope_offset,
                                       bool null_allowed) = 0;
 
+  // Set up out_reg to hold a pointer to the data of the primitive array whose reference is in
+  // the stack slot at ref_offset, or to be null if the reference is null. The data starts at
+  // data_offset from the array. The result is zero-extended to the pointer size.
+  virtual void CreateArrayDataPointer(ManagedRegister out_reg,
+                                      FrameOffset ref_offset,
+                                      uint32_t data_offset) = 0;
+
+  // Set up out_off to hold a pointer to the data of the primitive array whose reference is in
+  // the stack slot at ref_offset, or to be null if the reference is null.
+  virtual void CreateArrayDataPointer(FrameOffset out_off,
+                                      FrameOffset ref_offset,
+                                      uint32_t data_offset) = 0;
+
   // src holds a handle scope entry (Object**) load this into dst
   virtual void LoadReferenceFromHandleScope(ManagedRegister dst, ManagedRegister src) = 0;
 
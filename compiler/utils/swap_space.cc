@@ -62,19 +62,23 @@ inline void SwapSpace::InsertChunk(const SpaceChunk& chunk) {
 SwapSpace::SwapSpace(int fd, size_t initial_size)
     : fd_(fd),
       size_(0),
+      segment_pos_(nullptr),
+      segment_end_(nullptr),
       lock_("SwapSpace lock", static_cast<LockLevel>(LockLevel::kDefaultMutexLevel - 1)) {
   // Assume that the file is unlinked.
 
+  std::fill_n(small_free_lists_, kNumSizeClasses, nullptr);
   InsertChunk(NewFileChunk(initial_size));
 }
 
 SwapSpace::~SwapSpace() {
-  // Unmap all mmapped chunks. Nothing should be allocated anymore at
-  // this point, so there should be only full size chunks in free_by_start_.
-  for (const SpaceChunk& chunk : free_by_start_) {
-    if (munmap(chunk.ptr, chunk.size) != 0) {
+  // Unmap all mmapped chunks. Nothing should be allocated anymore at this point. Segments for
+  // small allocations are never returned to the chunk free lists, so unmap the recorded
+  // mappings rather than the free chunks.
+  for (const std::pair<uint8_t*, size_t>& map : maps_) {
+    if (munmap(map.first, map.second) != 0) {
       PLOG(ERROR) << "Failed to unmap swap space chunk at "
-          << static_cast<const void*>(chunk.ptr) << " size=" << chunk.size;
+          << static_cast<const void*>(map.first) << " size=" << map.second;
     }
   }
   // All arenas are backed by the same file. Just close the descriptor.
@@ -107,8 +111,49 @@ static size_t CollectFree(const FreeByStartSet& free_by_start, const FreeBySizeS
 
 void* SwapSpace::Alloc(size_t size) {
   MutexLock lock(Thread::Current(), lock_);
-  size = RoundUp(size, 8U);
+  size = std::max(RoundUp(size, kAlignment), kAlignment);
+  return (size <= kMaxSmallAllocSize) ? AllocSmall(size) : AllocLarge(size);
+}
 
+void SwapSpace::Free(void* ptr, size_t size) {
+  MutexLock lock(Thread::Current(), lock_);
+  size = std::max(RoundUp(size, kAlignment), kAlignment);
+  if (size <= kMaxSmallAllocSize) {
+    FreeSmall(ptr, size);
+  } else {
+    FreeLarge(ptr, size);
+  }
+}
+
+void* SwapSpace::AllocSmall(size_t size) {
+  size_t index = SizeClassIndex(size);
+  FreeSlot* slot = small_free_lists_[index];
+  if (slot != nullptr) {
+    small_free_lists_[index] = slot->next;
+    return slot;
+  }
+  if (static_cast<size_t>(segment_end_ - segment_pos_) < size) {
+    // Keep the tail of the exhausted segment in the free list of its own size class.
+    size_t remainder = static_cast<size_t>(segment_end_ - segment_pos_);
+    if (remainder != 0u) {
+      FreeSmall(segment_pos_, remainder);
+    }
+    segment_pos_ = reinterpret_cast<uint8_t*>(AllocLarge(kSegmentSize));
+    segment_end_ = segment_pos_ + kSegmentSize;
+  }
+  void* result = segment_pos_;
+  segment_pos_ += size;
+  return result;
+}
+
+void SwapSpace::FreeSmall(void* ptr, size_t size) {
+  size_t index = SizeClassIndex(size);
+  FreeSlot* slot = reinterpret_cast<FreeSlot*>(ptr);
+  slot->next = small_free_lists_[index];
+  small_free_lists_[index] = slot;
+}
+
+void* SwapSpace::AllocLarge(size_t size) {
   // Check the free list for something that fits.
   // TODO: Smarter implementation. Global biggest chunk, ...
   auto it = free_by_start_.empty()
@@ -162,6 +207,7 @@ SwapSpace::SpaceChunk SwapSpace::NewFileChunk(size_t min_size) {
     LOG(FATAL) << "Aborting...";
   }
   size_ += next_part;
+  maps_.emplace_back(ptr, next_part);
   SpaceChunk new_chunk = {ptr, next_part};
   return new_chunk;
 #else
@@ -172,10 +218,7 @@ SwapSpace::SpaceChunk SwapSpace::NewFileChunk(size_t min_size) {
 }
 
 // TODO: Full coalescing.
-void SwapSpace::Free(void* ptr, size_t size) {
-  MutexLock lock(Thread::Current(), lock_);
-  size = RoundUp(size, 8U);
-
+void SwapSpace::FreeLarge(void* ptr, size_t size) {
   size_t free_before = 0;
   if (kCheckFreeMaps) {
     free_before = CollectFree(free_by_start_, free_by_size_);
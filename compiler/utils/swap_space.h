@@ -22,16 +22,22 @@
 #include <cstdlib>
 #include <list>
 #include <set>
+#include <utility>
 #include <vector>
 
 #include <android-base/logging.h>
 
+#include "base/globals.h"
 #include "base/macros.h"
 #include "base/mutex.h"
 
 namespace art {
 
 // An arena pool that creates arenas backed by an mmaped file.
+//
+// Small allocations, which make up the bulk of compiled method data, are served in O(1) from
+// per-size-class free lists refilled by bump allocation from segments of the file. Larger
+// allocations use best-fit free lists with coalescing.
 class SwapSpace {
  public:
   SwapSpace(int fd, size_t initial_size);
@@ -43,7 +49,32 @@ class SwapSpace {
     return size_;
   }
 
+  // Allocations up to this size (after rounding to kAlignment) use the size-class free lists.
+  static constexpr size_t kMaxSmallAllocSize = 512u;
+
  private:
+  static constexpr size_t kAlignment = 8u;
+  static constexpr size_t kNumSizeClasses = kMaxSmallAllocSize / kAlignment;
+  // Size of the segments carved from the file for small allocations.
+  static constexpr size_t kSegmentSize = 64 * KB;
+
+  // A freed small allocation, linked into the free list of its size class.
+  struct FreeSlot {
+    FreeSlot* next;
+  };
+
+  static size_t SizeClassIndex(size_t size) {
+    DCHECK_ALIGNED(size, kAlignment);
+    DCHECK_NE(size, 0u);
+    DCHECK_LE(size, kMaxSmallAllocSize);
+    return size / kAlignment - 1u;
+  }
+
+  void* AllocSmall(size_t size) REQUIRES(lock_);
+  void FreeSmall(void* ptr, size_t size) REQUIRES(lock_);
+  void* AllocLarge(size_t size) REQUIRES(lock_);
+  void FreeLarge(void* ptr, size_t size) REQUIRES(lock_);
+
   // Chunk of space.
   struct SpaceChunk {
     // We need mutable members as we keep these objects in a std::set<> (providing only const
@@ -97,6 +128,15 @@ class SwapSpace {
   int fd_;
   size_t size_;
 
+  // All mappings of the swap file, unmapped on destruction.
+  std::vector<std::pair<uint8_t*, size_t>> maps_ GUARDED_BY(lock_);
+
+  // Heads of the free lists for small allocations, indexed by size class.
+  FreeSlot* small_free_lists_[kNumSizeClasses] GUARDED_BY(lock_);
+  // The unused part of the current segment for small allocations.
+  uint8_t* segment_pos_ GUARDED_BY(lock_);
+  uint8_t* segment_end_ GUARDED_BY(lock_);
+
   // NOTE: Boost.Bimap would be useful for the two following members.
 
   // Map start of a free chunk to its size.
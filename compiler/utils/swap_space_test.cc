@@ -20,12 +20,17 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <algorithm>
 #include <cstdio>
+#include <utility>
+#include <vector>
 
 #include "gtest/gtest.h"
 
 #include "base/os.h"
+#include "base/time_utils.h"
 #include "base/unix_file/fd_file.h"
+#include "base/utils.h"
 #include "common_runtime_test.h"
 
 namespace art {
@@ -80,4 +85,60 @@ TEST_F(SwapSpaceTest, Swap) {
   SwapTest(true);
 }
 
+// Allocation pattern similar to compiled method storage: many small arrays of varying size,
+// a fraction of which are released again, mixed with occasional large allocations.
+static void SmallAllocationsTest(bool use_file) {
+  ScratchFile scratch;
+  int fd = scratch.GetFd();
+  unlink(scratch.GetFilename().c_str());
+
+  SwapSpace pool(fd, 1 * MB);
+  SwapAllocator<uint8_t> alloc(use_file ? &pool : nullptr);
+
+  constexpr size_t kNumAllocations = 200000u;
+  std::vector<std::pair<uint8_t*, size_t>> allocations;
+  allocations.reserve(kNumAllocations);
+  uint64_t start_ns = NanoTime();
+  for (size_t i = 0; i != kNumAllocations; ++i) {
+    size_t size = (i % 97u == 0u)
+        ? 4 * KB + i % 1000u
+        : 1u + (i * 37u) % SwapSpace::kMaxSmallAllocSize;
+    uint8_t* ptr = alloc.allocate(size);
+    std::fill_n(ptr, size, static_cast<uint8_t>(i));
+    allocations.emplace_back(ptr, size);
+    if (i % 3u == 0u) {
+      // Release an earlier allocation to exercise the free lists.
+      std::pair<uint8_t*, size_t>& victim = allocations[i / 2u];
+      if (victim.first != nullptr) {
+        alloc.deallocate(victim.first, victim.second);
+        victim.first = nullptr;
+      }
+    }
+  }
+  uint64_t duration_ns = NanoTime() - start_ns;
+
+  // Verify contents of the remaining allocations and release them.
+  for (size_t i = 0; i != kNumAllocations; ++i) {
+    if (allocations[i].first != nullptr) {
+      for (size_t j = 0; j != allocations[i].second; ++j) {
+        ASSERT_EQ(static_cast<uint8_t>(i), allocations[i].first[j]);
+      }
+      alloc.deallocate(allocations[i].first, allocations[i].second);
+    }
+  }
+  LOG(INFO) << (use_file ? "Swap" : "Memory") << " small allocations: "
+            << PrettyDuration(duration_ns)
+            << (use_file ? ", swap file size " + PrettySize(pool.GetSize()) : "");
+
+  scratch.Close();
+}
+
+TEST_F(SwapSpaceTest, SmallAllocationsMemory) {
+  SmallAllocationsTest(false);
+}
+
+TEST_F(SwapSpaceTest, SmallAllocationsSwap) {
+  SmallAllocationsTest(true);
+}
+
 }  // namespace art
@@ -496,6 +496,32 @@ void X86JNIMacroAssembler::CreateHandleScopeEntry(FrameOffset out_off,
   __ movl(Address(ESP, out_off), scratch);
 }
 
+void X86JNIMacroAssembler::CreateArrayDataPointer(ManagedRegister mout_reg,
+                                                  FrameOffset ref_offset,
+                                                  uint32_t data_offset) {
+  X86ManagedRegister out_reg = mout_reg.AsX86();
+  CHECK(out_reg.IsCpuRegister());
+  Label null_arg;
+  __ movl(out_reg.AsCpuRegister(), Address(ESP, ref_offset));
+  __ testl(out_reg.AsCpuRegister(), out_reg.AsCpuRegister());
+  __ j(kZero, &null_arg);
+  __ addl(out_reg.AsCpuRegister(), Immediate(data_offset));
+  __ Bind(&null_arg);
+}
+
+void X86JNIMacroAssembler::CreateArrayDataPointer(FrameOffset out_off,
+                                                  FrameOffset ref_offset,
+                                                  uint32_t data_offset) {
+  Register scratch = GetScratchRegister();
+  Label null_arg;
+  __ movl(scratch, Address(ESP, ref_offset));
+  __ testl(scratch, scratch);
+  __ j(kZero, &null_arg);
+  __ addl(scratch, Immediate(data_offset));
+  __ Bind(&null_arg);
+  __ movl(Address(ESP, out_off), scratch);
+}
+
 // Given a handle scope entry, load the associated reference.
 void X86JNIMacroAssembler::LoadReferenceFromHandleScope(ManagedRegister mout_reg,
                                                         ManagedRegister min_reg) {
@@ -587,6 +587,33 @@ void X86_64JNIMacroAssembler::CreateHandleScopeEntry(FrameOffset out_off,
   __ movq(Address(CpuRegister(RSP), out_off), scratch);
 }
 
+void X86_64JNIMacroAssembler::CreateArrayDataPointer(ManagedRegister mout_reg,
+                                                     FrameOffset ref_offset,
+                                                     uint32_t data_offset) {
+  X86_64ManagedRegister out_reg = mout_reg.AsX86_64();
+  CHECK(out_reg.IsCpuRegister());
+  Label null_arg;
+  // The 32-bit load zero-extends the reference.
+  __ movl(out_reg.AsCpuRegister(), Address(CpuRegister(RSP), ref_offset));
+  __ testl(out_reg.AsCpuRegister(), out_reg.AsCpuRegister());
+  __ j(kZero, &null_arg);
+  __ addq(out_reg.AsCpuRegister(), Immediate(data_offset));
+  __ Bind(&null_arg);
+}
+
+void X86_64JNIMacroAssembler::CreateArrayDataPointer(FrameOffset out_off,
+                                                     FrameOffset ref_offset,
+                                                     uint32_t data_offset) {
+  CpuRegister scratch = GetScratchRegister();
+  Label null_arg;
+  __ movl(scratch, Address(CpuRegister(RSP), ref_offset));
+  __ testl(scratch, scratch);
+  __ j(kZero, &null_arg);
+  __ addq(scratch, Immediate(data_offset));
+  __ Bind(&null_arg);
+  __ movq(Address(CpuRegister(RSP), out_off), scratch);
+}
+
 // Given a handle scope entry, load the associated reference.
 void X86_64JNIMacroAssembler::LoadReferenceFromHandleScope(ManagedRegister mout_reg,
                                                            ManagedRegister min_reg) {
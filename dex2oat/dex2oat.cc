@@ -73,6 +73,7 @@
 #include "dex2oat_options.h"
 #include "dex2oat_return_codes.h"
 #include "dexlayout.h"
+#include "driver/compiled_method_cache.h"
 #include "driver/compiler_driver.h"
 #include "driver/compiler_options.h"
 #include "driver/compiler_options_map-inl.h"
@@ -284,8 +285,9 @@ NO_RETURN static void Usage(const char* fmt, ...) {
   UsageError("  --image-fd=<number>: same as --image but accepts a file descriptor instead.");
   UsageError("      Cannot be used together with --image.");
   UsageError("");
-  UsageError("  --image-format=(uncompressed|lz4|lz4hc):");
-  UsageError("      Which format to store the image.");
+  UsageError("  --image-format=(uncompressed|lz4|lz4hc|zstd):");
+  UsageError("      Which format to store the image. The zstd format gives the smallest images");
+  UsageError("      but is slower to decompress than lz4.");
   UsageError("      Example: --image-format=lz4");
   UsageError("      Default: uncompressed");
   UsageError("");
@@ -426,6 +428,14 @@ NO_RETURN static void Usage(const char* fmt, ...) {
   UsageError("      Example: --swap-dex-count-threshold=10");
   UsageError("      Default: %zu", kDefaultMinDexFilesForSwap);
   UsageError("");
+  UsageError("  --compiled-method-cache-dir=<directory>: specifies a directory used to share");
+  UsageError("      compiled methods between dex2oat invocations. Entries are keyed by the dex");
+  UsageError("      code and profile data of the method and by the compilation context,");
+  UsageError("      including all dex files being compiled and the class loader context. The");
+  UsageError("      directory should be specific to a dex2oat build. Not supported when");
+  UsageError("      compiling a boot image.");
+  UsageError("      Example: --compiled-method-cache-dir=/tmp/dex2oat-cache");
+  UsageError("");
   UsageError("  --very-large-app-threshold=<size>: specifies the minimum total dex file size in");
   UsageError("      bytes to consider the input \"very large\" and reduce compilation done.");
   UsageError("      Example: --very-large-app-threshold=100000000");
@@ -1331,6 +1341,7 @@ class Dex2Oat final {
     AssignIfExists(args, M::SwapDexSizeThreshold, &min_dex_file_cumulative_size_for_swap_);
     AssignIfExists(args, M::SwapDexCountThreshold, &min_dex_files_for_swap_);
     AssignIfExists(args, M::VeryLargeAppThreshold, &very_large_threshold_);
+    AssignIfExists(args, M::CompiledMethodCacheDir, &compiled_method_cache_dir_);
     AssignIfExists(args, M::AppImageFile, &app_image_file_name_);
     AssignIfExists(args, M::AppImageFileFd, &app_image_fd_);
     AssignIfExists(args, M::NoInlineFrom, &no_inline_from_string_);
@@ -2084,6 +2095,10 @@ class Dex2Oat final {
 
     driver_->PrepareDexFilesForOatFile(timings_);
 
+    if (!compiled_method_cache_dir_.empty()) {
+      SetUpCompiledMethodCache();
+    }
+
     if (!IsBootImage() && !IsBootImageExtension()) {
       driver_->SetClasspathDexFiles(class_loader_context_->FlattenOpenedDexFiles());
     }
@@ -2133,6 +2148,74 @@ class Dex2Oat final {
     return CompileDexFiles(dex_files);
   }
 
+  void SetUpCompiledMethodCache() {
+    if (IsBootImage() || IsBootImageExtension()) {
+      // Image classes and compile-time class initialization are not part of the context.
+      LOG(WARNING) << "Compiled method cache is not supported for boot images, ignoring.";
+      return;
+    }
+    std::string error_msg;
+    std::unique_ptr<CompiledMethodCache> cache =
+        CompiledMethodCache::Create(compiled_method_cache_dir_,
+                                    GetCompiledMethodCacheContext(),
+                                    compiler_options_->GetDexFilesForOatFile(),
+                                    compiler_options_->GetProfileCompilationInfo(),
+                                    &error_msg);
+    if (cache == nullptr) {
+      LOG(WARNING) << error_msg;
+      return;
+    }
+    driver_->SetCompiledMethodCache(std::move(cache));
+  }
+
+  // Returns the compilation-wide part of the compiled method cache keys. This must cover
+  // everything, other than the method's own dex code and profile data, that can change the
+  // generated code. The cache adds the dex files being compiled.
+  std::string GetCompiledMethodCacheContext() const {
+    const CompilerOptions& options = *compiler_options_;
+    std::ostringstream oss;
+    oss << "oat=" << OatHeader::kOatVersion.data()
+        << ";isa=" << options.GetInstructionSet()
+        << ";features=" << options.GetInstructionSetFeatures()->GetFeatureString()
+        << ";backend=" << static_cast<int>(compiler_kind_)
+        << ";filter=" << CompilerFilter::NameOfFilter(options.GetCompilerFilter())
+        << ";image_type=" << static_cast<int>(options.image_type_)
+        << ";thresholds=" << options.huge_method_threshold_
+        << "," << options.large_method_threshold_
+        << "," << options.num_dex_methods_threshold_
+        << "," << options.inline_max_code_units_
+        << ";flags=" << options.baseline_
+        << options.debuggable_
+        << options.generate_debug_info_
+        << options.generate_mini_debug_info_
+        << options.implicit_null_checks_
+        << options.implicit_so_checks_
+        << options.implicit_suspend_checks_
+        << options.compile_pic_
+        << options.count_hotness_in_compiled_code_
+        << kUseReadBarrier
+        << ";regalloc=" << static_cast<int>(options.register_allocation_strategy_);
+    if (options.passes_to_run_ != nullptr) {
+      oss << ";passes=" << android::base::Join(*options.passes_to_run_, ',');
+    }
+    for (const DexFile* dex_file : options.no_inline_from_) {
+      oss << ";no_inline_from=" << dex_file->GetLocation();
+    }
+
+    // Boot image and class path, including their checksums.
+    Runtime* runtime = Runtime::Current();
+    ArrayRef<ImageSpace* const> image_spaces(runtime->GetHeap()->GetBootImageSpaces());
+    ArrayRef<const DexFile* const> bcp_dex_files(runtime->GetClassLinker()->GetBootClassPath());
+    oss << ";bcp=" << android::base::Join(runtime->GetBootClassPathLocations(), ':')
+        << ";bcp_checksums="
+        << gc::space::ImageSpace::GetBootClassPathChecksums(image_spaces, bcp_dex_files);
+    // The class loader context with checksums. This is the context used for compiling, which
+    // may differ from the one stored in the oat file.
+    DCHECK(class_loader_context_ != nullptr);
+    oss << ";clc=" << class_loader_context_->EncodeContextForOatFile(classpath_dir_) << ";";
+    return oss.str();
+  }
+
   // Create the class loader, use it to compile, and return.
   jobject CompileDexFiles(const std::vector<const DexFile*>& dex_files) {
     ClassLinker* const class_linker = Runtime::Current()->GetClassLinker();
@@ -2971,6 +3054,13 @@ class Dex2Oat final {
               << ((Runtime::Current() != nullptr && driver_ != nullptr) ?
                   driver_->GetMemoryUsageString(kIsDebugBuild || VLOG_IS_ON(compiler)) :
                   "");
+    if (VLOG_IS_ON(compiler) &&
+        driver_ != nullptr &&
+        driver_->GetCompiledMethodCache() != nullptr) {
+      std::ostringstream oss;
+      driver_->GetCompiledMethodCache()->DumpStats(oss);
+      VLOG(compiler) << oss.str();
+    }
   }
 
   std::string StripIsaFrom(const char* image_filename, InstructionSet isa) {
@@ -3072,6 +3162,7 @@ class Dex2Oat final {
   size_t min_dex_files_for_swap_ = kDefaultMinDexFilesForSwap;
   size_t min_dex_file_cumulative_size_for_swap_ = kDefaultMinDexFileCumulativeSizeForSwap;
   size_t very_large_threshold_ = std::numeric_limits<size_t>::max();
+  std::string compiled_method_cache_dir_;
   std::string app_image_file_name_;
   int app_image_fd_;
   std::string profile_file_;
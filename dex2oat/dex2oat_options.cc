@@ -138,6 +138,7 @@ static void AddImageMappings(Builder& builder) {
           .WithType<ImageHeader::StorageMode>()
           .WithValueMap({{"lz4", ImageHeader::kStorageModeLZ4},
                          {"lz4hc", ImageHeader::kStorageModeLZ4HC},
+                         {"zstd", ImageHeader::kStorageModeZstd},
                          {"uncompressed", ImageHeader::kStorageModeUncompressed}})
           .IntoKey(M::ImageFormat);
 }
@@ -155,7 +156,10 @@ static void AddSwapMappings(Builder& builder) {
           .IntoKey(M::SwapDexSizeThreshold)
       .Define("--swap-dex-count-threshold=_")
           .WithType<unsigned int>()
-          .IntoKey(M::SwapDexCountThreshold);
+          .IntoKey(M::SwapDexCountThreshold)
+      .Define("--compiled-method-cache-dir=_")
+          .WithType<std::string>()
+          .IntoKey(M::CompiledMethodCacheDir);
 }
 
 static void AddCompilerMappings(Builder& builder) {
@@ -0,0 +1,503 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "compiled_method_cache.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <ostream>
+#include <sstream>
+
+#include "android-base/file.h"
+#include "android-base/logging.h"
+#include "android-base/stringprintf.h"
+
+#include "base/array_ref.h"
+#include "base/leb128.h"
+#include "base/utils.h"
+#include "compiled_method-inl.h"
+#include "dex/dex_file-inl.h"
+#include "dex/invoke_type.h"
+#include "dex/method_reference.h"
+#include "driver/compiled_method_storage.h"
+#include "linker/linker_patch.h"
+#include "profile/profile_compilation_info.h"
+
+namespace art {
+
+namespace {  // anonymous namespace
+
+static constexpr uint8_t kEntryMagic[] = { 'c', 'm', 'c', '\n' };
+// Increment when the entry layout or the encoding of linker patches changes.
+static constexpr uint32_t kEntryVersion = 3u;
+
+static constexpr uint64_t kHashSeed1 = UINT64_C(0xcbf29ce484222325);
+static constexpr uint64_t kHashSeed2 = UINT64_C(0x84222325cbf29ce4);
+
+// 64-bit FNV-1a. Used for naming the entry files, where collisions are harmless since the
+// full key is stored in each entry.
+uint64_t HashKey(const std::string& key, uint64_t seed) {
+  uint64_t hash = seed;
+  for (char c : key) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * UINT64_C(0x100000001b3);
+  }
+  return hash;
+}
+
+// The dex files being compiled are part of the context. Linker patches refer to them by index.
+std::string DescribeDexFiles(const std::vector<const DexFile*>& dex_files) {
+  std::ostringstream oss;
+  for (const DexFile* dex_file : dex_files) {
+    oss << "dex=" << dex_file->GetLocation() << "*" << std::hex
+        << dex_file->GetLocationChecksum() << std::dec << ";";
+  }
+  return oss.str();
+}
+
+// Patch types for which `CompiledMethodStorage` may hold thunk code.
+bool MayHaveThunk(linker::LinkerPatch::Type type) {
+  return type == linker::LinkerPatch::Type::kCallEntrypoint ||
+         type == linker::LinkerPatch::Type::kBakerReadBarrierBranch ||
+         type == linker::LinkerPatch::Type::kCallRelative;
+}
+
+void EncodeBytes(std::vector<uint8_t>* out, ArrayRef<const uint8_t> data) {
+  EncodeUnsignedLeb128(out, data.size());
+  out->insert(out->end(), data.begin(), data.end());
+}
+
+void EncodeString(std::vector<uint8_t>* out, const std::string& str) {
+  EncodeBytes(out, ArrayRef<const uint8_t>(reinterpret_cast<const uint8_t*>(str.data()),
+                                           str.size()));
+}
+
+class EntryReader {
+ public:
+  explicit EntryReader(const std::string& data)
+      : ptr_(reinterpret_cast<const uint8_t*>(data.data())), end_(ptr_ + data.size()) {}
+
+  bool ReadUint32(/*out*/ uint32_t* value) {
+    return DecodeUnsignedLeb128Checked(&ptr_, end_, value);
+  }
+
+  bool ReadBytes(/*out*/ ArrayRef<const uint8_t>* data) {
+    uint32_t size;
+    if (!ReadUint32(&size) || static_cast<size_t>(end_ - ptr_) < size) {
+      return false;
+    }
+    *data = ArrayRef<const uint8_t>(ptr_, size);
+    ptr_ += size;
+    return true;
+  }
+
+  bool ReadString(/*out*/ std::string* str) {
+    ArrayRef<const uint8_t> data;
+    if (!ReadBytes(&data)) {
+      return false;
+    }
+    str->assign(reinterpret_cast<const char*>(data.data()), data.size());
+    return true;
+  }
+
+  bool ReadMagic() {
+    if (static_cast<size_t>(end_ - ptr_) < sizeof(kEntryMagic) ||
+        !std::equal(kEntryMagic, kEntryMagic + sizeof(kEntryMagic), ptr_)) {
+      return false;
+    }
+    ptr_ += sizeof(kEntryMagic);
+    return true;
+  }
+
+  bool IsAtEnd() const {
+    return ptr_ == end_;
+  }
+
+ private:
+  const uint8_t* ptr_;
+  const uint8_t* const end_;
+};
+
+}  // anonymous namespace
+
+std::unique_ptr<CompiledMethodCache> CompiledMethodCache::Create(
+    const std::string& directory,
+    const std::string& context_fingerprint,
+    const std::vector<const DexFile*>& dex_files,
+    const ProfileCompilationInfo* profile,
+    /*out*/ std::string* error_msg) {
+  struct stat st;
+  if (stat(directory.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+    *error_msg = "Compiled method cache directory does not exist: " + directory;
+    return nullptr;
+  }
+  if (access(directory.c_str(), R_OK | W_OK | X_OK) != 0) {
+    *error_msg = "Compiled method cache directory is not accessible: " + directory;
+    return nullptr;
+  }
+  return std::unique_ptr<CompiledMethodCache>(
+      new CompiledMethodCache(directory, context_fingerprint, dex_files, profile));
+}
+
+CompiledMethodCache::CompiledMethodCache(const std::string& directory,
+                                         const std::string& context_fingerprint,
+                                         const std::vector<const DexFile*>& dex_files,
+                                         const ProfileCompilationInfo* profile)
+    : directory_(directory),
+      context_fingerprint_(context_fingerprint + DescribeDexFiles(dex_files)),
+      dex_files_(dex_files),
+      profile_(profile),
+      hits_(0u),
+      misses_(0u),
+      stores_(0u),
+      uncacheable_(0u),
+      write_failures_(0u) {}
+
+std::string CompiledMethodCache::HashData(const std::string& data) {
+  return android::base::StringPrintf("%016" PRIx64 "%016" PRIx64,
+                                     HashKey(data, kHashSeed1),
+                                     HashKey(data, kHashSeed2));
+}
+
+std::string CompiledMethodCache::ComputeKey(const DexFile& dex_file,
+                                            uint32_t method_idx,
+                                            const dex::CodeItem* code_item,
+                                            uint32_t access_flags,
+                                            InvokeType invoke_type) const {
+  std::vector<uint8_t> method_part;
+  uint32_t dex_file_index;
+  bool found = GetDexFileIndex(&dex_file, &dex_file_index);
+  DCHECK(found) << dex_file.GetLocation();
+  EncodeUnsignedLeb128(&method_part, dex_file_index);
+  EncodeUnsignedLeb128(&method_part, method_idx);
+  EncodeUnsignedLeb128(&method_part, access_flags);
+  EncodeUnsignedLeb128(&method_part, static_cast<uint32_t>(invoke_type));
+  if (code_item != nullptr) {
+    const uint8_t* code_item_begin = reinterpret_cast<const uint8_t*>(code_item);
+    EncodeBytes(&method_part,
+                ArrayRef<const uint8_t>(code_item_begin, dex_file.GetCodeItemSize(*code_item)));
+  }
+  // The inliner uses the inline caches of the method. The whole profile is not part of the key,
+  // so that profile changes for other methods do not invalidate the entry.
+  std::unique_ptr<ProfileCompilationInfo::OfflineProfileMethodInfo> method_info =
+      (profile_ != nullptr) ? profile_->GetHotMethodInfo(MethodReference(&dex_file, method_idx))
+                            : nullptr;
+  if (method_info != nullptr) {
+    EncodeUnsignedLeb128(&method_part, method_info->inline_caches->size());
+    for (const auto& entry : *method_info->inline_caches) {
+      const ProfileCompilationInfo::DexPcData& dex_pc_data = entry.second;
+      EncodeUnsignedLeb128(&method_part, entry.first);
+      EncodeUnsignedLeb128(&method_part, (dex_pc_data.is_missing_types ? 1u : 0u) |
+                                         (dex_pc_data.is_megamorphic ? 2u : 0u));
+      EncodeUnsignedLeb128(&method_part, dex_pc_data.classes.size());
+      for (const ProfileCompilationInfo::ClassReference& class_ref : dex_pc_data.classes) {
+        DCHECK_LT(class_ref.dex_profile_index, method_info->dex_references.size());
+        EncodeUnsignedLeb128(
+            &method_part, method_info->dex_references[class_ref.dex_profile_index].dex_checksum);
+        EncodeUnsignedLeb128(&method_part, class_ref.type_index.index_);
+      }
+    }
+  }
+  std::string key = context_fingerprint_;
+  key.append(reinterpret_cast<const char*>(method_part.data()), method_part.size());
+  return key;
+}
+
+std::string CompiledMethodCache::GetEntryPath(const std::string& key) const {
+  return directory_ + "/" + HashData(key) + ".cm";
+}
+
+bool CompiledMethodCache::GetDexFileIndex(const DexFile* dex_file,
+                                          /*out*/ uint32_t* index) const {
+  if (dex_file == nullptr) {
+    *index = kNoDexFileIndex;
+    return true;
+  }
+  auto it = std::find(dex_files_.begin(), dex_files_.end(), dex_file);
+  if (it == dex_files_.end()) {
+    return false;
+  }
+  *index = static_cast<uint32_t>(std::distance(dex_files_.begin(), it));
+  return true;
+}
+
+CompiledMethod* CompiledMethodCache::Lookup(const std::string& key,
+                                            CompiledMethodStorage* storage) {
+  std::string data;
+  if (!android::base::ReadFileToString(GetEntryPath(key), &data)) {
+    ++misses_;
+    return nullptr;
+  }
+
+  EntryReader reader(data);
+  uint32_t version;
+  std::string entry_key;
+  uint32_t isa;
+  uint32_t is_intrinsic;
+  ArrayRef<const uint8_t> code;
+  ArrayRef<const uint8_t> vmap_table;
+  ArrayRef<const uint8_t> cfi_info;
+  uint32_t num_patches;
+  if (!reader.ReadMagic() ||
+      !reader.ReadUint32(&version) ||
+      version != kEntryVersion ||
+      !reader.ReadString(&entry_key) ||
+      entry_key != key ||
+      !reader.ReadUint32(&isa) ||
+      isa > static_cast<uint32_t>(InstructionSet::kLast) ||
+      !reader.ReadUint32(&is_intrinsic) ||
+      !reader.ReadBytes(&code) ||
+      !reader.ReadBytes(&vmap_table) ||
+      !reader.ReadBytes(&cfi_info) ||
+      !reader.ReadUint32(&num_patches)) {
+    ++misses_;
+    return nullptr;
+  }
+
+  std::vector<linker::LinkerPatch> patches;
+  patches.reserve(num_patches);
+  for (uint32_t i = 0; i != num_patches; ++i) {
+    uint32_t type;
+    uint32_t literal_offset;
+    uint32_t dex_file_index;
+    uint32_t value1;
+    uint32_t value2;
+    if (!reader.ReadUint32(&type) ||
+        !reader.ReadUint32(&literal_offset) ||
+        !reader.ReadUint32(&dex_file_index) ||
+        !reader.ReadUint32(&value1) ||
+        !reader.ReadUint32(&value2) ||
+        literal_offset >= code.size() ||
+        (dex_file_index != kNoDexFileIndex && dex_file_index >= dex_files_.size())) {
+      ++misses_;
+      return nullptr;
+    }
+    const DexFile* dex_file =
+        (dex_file_index != kNoDexFileIndex) ? dex_files_[dex_file_index] : nullptr;
+    using Type = linker::LinkerPatch::Type;
+    switch (static_cast<Type>(type)) {
+      case Type::kIntrinsicReference:
+        patches.push_back(
+            linker::LinkerPatch::IntrinsicReferencePatch(literal_offset, value2, value1));
+        break;
+      case Type::kDataBimgRelRo:
+        patches.push_back(
+            linker::LinkerPatch::DataBimgRelRoPatch(literal_offset, value2, value1));
+        break;
+      case Type::kMethodRelative:
+        patches.push_back(
+            linker::LinkerPatch::RelativeMethodPatch(literal_offset, dex_file, value2, value1));
+        break;
+      case Type::kMethodBssEntry:
+        patches.push_back(
+            linker::LinkerPatch::MethodBssEntryPatch(literal_offset, dex_file, value2, value1));
+        break;
+      case Type::kCallRelative:
+        patches.push_back(
+            linker::LinkerPatch::RelativeCodePatch(literal_offset, dex_file, value1));
+        break;
+      case Type::kTypeRelative:
+        patches.push_back(
+            linker::LinkerPatch::RelativeTypePatch(literal_offset, dex_file, value2, value1));
+        break;
+      case Type::kTypeBssEntry:
+        patches.push_back(
+            linker::LinkerPatch::TypeBssEntryPatch(literal_offset, dex_file, value2, value1));
+        break;
+      case Type::kStringRelative:
+        patches.push_back(
+            linker::LinkerPatch::RelativeStringPatch(literal_offset, dex_file, value2, value1));
+        break;
+      case Type::kStringBssEntry:
+        patches.push_back(
+            linker::LinkerPatch::StringBssEntryPatch(literal_offset, dex_file, value2, value1));
+        break;
+      case Type::kCallEntrypoint:
+        patches.push_back(linker::LinkerPatch::CallEntrypointPatch(literal_offset, value1));
+        break;
+      case Type::kBakerReadBarrierBranch:
+        patches.push_back(
+            linker::LinkerPatch::BakerReadBarrierBranchPatch(literal_offset, value1, value2));
+        break;
+      default:
+        ++misses_;
+        return nullptr;
+    }
+  }
+
+  // Thunks are shared between methods, so they are recorded with each entry that needs them.
+  uint32_t num_thunks;
+  if (!reader.ReadUint32(&num_thunks)) {
+    ++misses_;
+    return nullptr;
+  }
+  for (uint32_t i = 0; i != num_thunks; ++i) {
+    uint32_t patch_index;
+    std::string debug_name;
+    ArrayRef<const uint8_t> thunk_code;
+    if (!reader.ReadUint32(&patch_index) ||
+        patch_index >= patches.size() ||
+        !reader.ReadString(&debug_name) ||
+        !reader.ReadBytes(&thunk_code) ||
+        thunk_code.empty()) {
+      ++misses_;
+      return nullptr;
+    }
+    if (!MayHaveThunk(patches[patch_index].GetType())) {
+      ++misses_;
+      return nullptr;
+    }
+    if (storage->GetThunkCode(patches[patch_index]).empty()) {
+      storage->SetThunkCode(patches[patch_index], thunk_code, debug_name);
+    }
+  }
+  if (!reader.IsAtEnd()) {
+    ++misses_;
+    return nullptr;
+  }
+
+  CompiledMethod* compiled_method = CompiledMethod::SwapAllocCompiledMethod(
+      storage,
+      static_cast<InstructionSet>(isa),
+      code,
+      vmap_table,
+      cfi_info,
+      ArrayRef<const linker::LinkerPatch>(patches));
+  if (is_intrinsic != 0u) {
+    compiled_method->MarkAsIntrinsic();
+  }
+  ++hits_;
+  return compiled_method;
+}
+
+void CompiledMethodCache::Store(const std::string& key,
+                                const CompiledMethod* compiled_method,
+                                CompiledMethodStorage* storage) {
+  DCHECK(compiled_method != nullptr);
+  std::vector<uint8_t> data(kEntryMagic, kEntryMagic + sizeof(kEntryMagic));
+  EncodeUnsignedLeb128(&data, kEntryVersion);
+  EncodeString(&data, key);
+  EncodeUnsignedLeb128(&data, static_cast<uint32_t>(compiled_method->GetInstructionSet()));
+  EncodeUnsignedLeb128(&data, compiled_method->IsIntrinsic() ? 1u : 0u);
+  EncodeBytes(&data, compiled_method->GetQuickCode());
+  EncodeBytes(&data, compiled_method->GetVmapTable());
+  EncodeBytes(&data, compiled_method->GetCFIInfo());
+
+  ArrayRef<const linker::LinkerPatch> patches = compiled_method->GetPatches();
+  EncodeUnsignedLeb128(&data, patches.size());
+  std::vector<uint32_t> thunk_patch_indexes;
+  for (size_t i = 0; i != patches.size(); ++i) {
+    const linker::LinkerPatch& patch = patches[i];
+    const DexFile* target_dex_file = nullptr;
+    uint32_t value1 = 0u;
+    uint32_t value2 = 0u;
+    using Type = linker::LinkerPatch::Type;
+    switch (patch.GetType()) {
+      case Type::kIntrinsicReference:
+        value1 = patch.IntrinsicData();
+        value2 = patch.PcInsnOffset();
+        break;
+      case Type::kDataBimgRelRo:
+        value1 = patch.BootImageOffset();
+        value2 = patch.PcInsnOffset();
+        break;
+      case Type::kMethodRelative:
+      case Type::kMethodBssEntry:
+        target_dex_file = patch.TargetMethod().dex_file;
+        value1 = patch.TargetMethod().index;
+        value2 = patch.PcInsnOffset();
+        break;
+      case Type::kCallRelative:
+        target_dex_file = patch.TargetMethod().dex_file;
+        value1 = patch.TargetMethod().index;
+        break;
+      case Type::kTypeRelative:
+      case Type::kTypeBssEntry:
+        target_dex_file = patch.TargetTypeDexFile();
+        value1 = patch.TargetTypeIndex().index_;
+        value2 = patch.PcInsnOffset();
+        break;
+      case Type::kStringRelative:
+      case Type::kStringBssEntry:
+        target_dex_file = patch.TargetStringDexFile();
+        value1 = patch.TargetStringIndex().index_;
+        value2 = patch.PcInsnOffset();
+        break;
+      case Type::kCallEntrypoint:
+        value1 = patch.EntrypointOffset();
+        break;
+      case Type::kBakerReadBarrierBranch:
+        value1 = patch.GetBakerCustomValue1();
+        value2 = patch.GetBakerCustomValue2();
+        break;
+    }
+    uint32_t dex_file_index;
+    if (!GetDexFileIndex(target_dex_file, &dex_file_index)) {
+      // The target dex file is not described by the context, so the entry could not be
+      // relinked by another invocation.
+      ++uncacheable_;
+      return;
+    }
+    EncodeUnsignedLeb128(&data, static_cast<uint32_t>(patch.GetType()));
+    EncodeUnsignedLeb128(&data, patch.LiteralOffset());
+    EncodeUnsignedLeb128(&data, dex_file_index);
+    EncodeUnsignedLeb128(&data, value1);
+    EncodeUnsignedLeb128(&data, value2);
+    if (MayHaveThunk(patch.GetType()) && !storage->GetThunkCode(patch).empty()) {
+      thunk_patch_indexes.push_back(i);
+    }
+  }
+
+  EncodeUnsignedLeb128(&data, thunk_patch_indexes.size());
+  for (uint32_t patch_index : thunk_patch_indexes) {
+    std::string debug_name;
+    ArrayRef<const uint8_t> thunk_code = storage->GetThunkCode(patches[patch_index], &debug_name);
+    EncodeUnsignedLeb128(&data, patch_index);
+    EncodeString(&data, debug_name);
+    EncodeBytes(&data, thunk_code);
+  }
+
+  // Write to a temporary file and rename it, so that concurrent dex2oat invocations never see
+  // a partially written entry.
+  std::string path = GetEntryPath(key);
+  std::string temp_path = android::base::StringPrintf("%s.%d.%d", path.c_str(), getpid(), GetTid());
+  std::string content(reinterpret_cast<const char*>(data.data()), data.size());
+  if (!android::base::WriteStringToFile(content, temp_path) ||
+      rename(temp_path.c_str(), path.c_str()) != 0) {
+    PLOG(WARNING) << "Failed to write compiled method cache entry " << path;
+    unlink(temp_path.c_str());
+    ++write_failures_;
+    return;
+  }
+  ++stores_;
+}
+
+void CompiledMethodCache::DumpStats(std::ostream& os) const {
+  size_t hits = hits_.load(std::memory_order_relaxed);
+  size_t misses = misses_.load(std::memory_order_relaxed);
+  size_t lookups = hits + misses;
+  os << "Compiled method cache: hits=" << hits
+     << " misses=" << misses
+     << " (" << (lookups != 0u ? hits * 100u / lookups : 0u) << "% hit rate)"
+     << " stores=" << stores_.load(std::memory_order_relaxed)
+     << " uncacheable=" << uncacheable_.load(std::memory_order_relaxed)
+     << " write failures=" << write_failures_.load(std::memory_order_relaxed);
+}
+
+}  // namespace art
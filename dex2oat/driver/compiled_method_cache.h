@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_DEX2OAT_DRIVER_COMPILED_METHOD_CACHE_H_
+#define ART_DEX2OAT_DRIVER_COMPILED_METHOD_CACHE_H_
+
+#include <atomic>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+
+namespace art {
+
+namespace dex {
+struct CodeItem;
+}  // namespace dex
+
+class CompiledMethod;
+class CompiledMethodStorage;
+class DexFile;
+enum InvokeType : uint32_t;
+class ProfileCompilationInfo;
+
+// An on-disk cache of compiled methods shared between dex2oat invocations.
+//
+// Entries are content-addressed: the key is built from a compilation-wide context fingerprint
+// (ISA and features, compiler options, boot image checksums, the class loader context and the
+// locations and checksums of all dex files being compiled) and from the method itself: its dex
+// code and its inline caches in the profile. The generated code depends on classes in the other
+// dex files of the oat file, for example through field offsets, vtable indexes and inlining, so
+// an entry is only found when all of them are unchanged. The full key is stored in each entry
+// and compared on lookup, so a collision of the file name hash results in a miss rather than in
+// wrong code.
+//
+// Linker patches refer to dex files by pointer. The cache stores them as indexes into the list
+// of dex files for the oat file, which is part of the context, and methods with patches that
+// target any other dex file are not cached.
+class CompiledMethodCache {
+ public:
+  // Creates a cache in the given directory. Returns null and sets `error_msg` on failure.
+  static std::unique_ptr<CompiledMethodCache> Create(const std::string& directory,
+                                                     const std::string& context_fingerprint,
+                                                     const std::vector<const DexFile*>& dex_files,
+                                                     const ProfileCompilationInfo* profile,
+                                                     /*out*/ std::string* error_msg);
+
+  // Returns a short hex digest of `data`, used for naming the entry files.
+  static std::string HashData(const std::string& data);
+
+  // Returns the key for the given method. The result is only meaningful for this cache.
+  std::string ComputeKey(const DexFile& dex_file,
+                         uint32_t method_idx,
+                         const dex::CodeItem* code_item,
+                         uint32_t access_flags,
+                         InvokeType invoke_type) const;
+
+  // Returns a swap-allocated compiled method for the key, or null if there is no valid entry.
+  // Thunks recorded with the entry are added to the `storage` if they are not present yet.
+  CompiledMethod* Lookup(const std::string& key, CompiledMethodStorage* storage);
+
+  // Writes the compiled method to the cache. Failures are not fatal and are only counted.
+  void Store(const std::string& key,
+             const CompiledMethod* compiled_method,
+             CompiledMethodStorage* storage);
+
+  void DumpStats(std::ostream& os) const;
+
+ private:
+  CompiledMethodCache(const std::string& directory,
+                      const std::string& context_fingerprint,
+                      const std::vector<const DexFile*>& dex_files,
+                      const ProfileCompilationInfo* profile);
+
+  std::string GetEntryPath(const std::string& key) const;
+
+  // Returns the index of `dex_file` in `dex_files_` or `kNoDexFileIndex` for null.
+  // Returns false if the dex file is not one of the dex files for the oat file.
+  bool GetDexFileIndex(const DexFile* dex_file, /*out*/ uint32_t* index) const;
+
+  static constexpr uint32_t kNoDexFileIndex = static_cast<uint32_t>(-1);
+
+  const std::string directory_;
+  // The context passed to Create(), followed by the locations and checksums of `dex_files_`.
+  const std::string context_fingerprint_;
+  const std::vector<const DexFile*> dex_files_;
+  // The profile used for the compilation, if any. The inline caches of the method are part of
+  // its key.
+  const ProfileCompilationInfo* const profile_;
+
+  std::atomic<size_t> hits_;
+  std::atomic<size_t> misses_;
+  std::atomic<size_t> stores_;
+  std::atomic<size_t> uncacheable_;
+  std::atomic<size_t> write_failures_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompiledMethodCache);
+};
+
+}  // namespace art
+
+#endif  // ART_DEX2OAT_DRIVER_COMPILED_METHOD_CACHE_H_
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "driver/compiled_method_cache.h"
+
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "common_runtime_test.h"
+#include "compiled_method-inl.h"
+#include "dex/dex_file.h"
+#include "dex/invoke_type.h"
+#include "driver/compiled_method_storage.h"
+#include "linker/linker_patch.h"
+
+namespace art {
+
+class CompiledMethodCacheTest : public CommonRuntimeTest {
+ protected:
+  void SetUp() override {
+    CommonRuntimeTest::SetUp();
+    dex_file_ = OpenTestDexFile("Main");
+    other_dex_file_ = OpenTestDexFile("Nested");
+    cache_dir_.reset(new ScratchDir());
+  }
+
+  void TearDown() override {
+    cache_dir_.reset();
+    CommonRuntimeTest::TearDown();
+  }
+
+  std::unique_ptr<CompiledMethodCache> CreateCache(
+      const std::string& context, const std::vector<const DexFile*>& dex_files) {
+    std::string error_msg;
+    std::unique_ptr<CompiledMethodCache> cache = CompiledMethodCache::Create(
+        cache_dir_->GetPath(), context, dex_files, /* profile= */ nullptr, &error_msg);
+    CHECK(cache != nullptr) << error_msg;
+    return cache;
+  }
+
+  std::unique_ptr<const DexFile> dex_file_;
+  std::unique_ptr<const DexFile> other_dex_file_;
+  std::unique_ptr<ScratchDir> cache_dir_;
+};
+
+TEST_F(CompiledMethodCacheTest, RoundTrip) {
+  CompiledMethodStorage storage(/* swap_fd= */ -1);
+  std::unique_ptr<CompiledMethodCache> cache = CreateCache("context", { dex_file_.get() });
+  std::string key = cache->ComputeKey(*dex_file_, 0u, nullptr, 0u, kStatic);
+
+  EXPECT_EQ(nullptr, cache->Lookup(key, &storage));
+
+  const uint8_t raw_code[] = { 1u, 2u, 3u, 4u, 5u, 6u, 7u, 8u };
+  const uint8_t raw_vmap_table[] = { 2u, 4u, 6u };
+  const uint8_t raw_cfi_info[] = { 1u, 3u, 5u };
+  const linker::LinkerPatch raw_patches[] = {
+      linker::LinkerPatch::IntrinsicReferencePatch(0u, 0u, 42u),
+      linker::LinkerPatch::RelativeMethodPatch(2u, dex_file_.get(), 1u, 3u),
+      linker::LinkerPatch::TypeBssEntryPatch(4u, dex_file_.get(), 3u, 5u),
+      linker::LinkerPatch::RelativeStringPatch(6u, dex_file_.get(), 5u, 7u),
+  };
+  CompiledMethod* compiled_method = CompiledMethod::SwapAllocCompiledMethod(
+      &storage,
+      InstructionSet::kArm64,
+      ArrayRef<const uint8_t>(raw_code),
+      ArrayRef<const uint8_t>(raw_vmap_table),
+      ArrayRef<const uint8_t>(raw_cfi_info),
+      ArrayRef<const linker::LinkerPatch>(raw_patches));
+  cache->Store(key, compiled_method, &storage);
+
+  // A different invocation with the same context finds the entry.
+  std::unique_ptr<CompiledMethodCache> other_cache = CreateCache("context", { dex_file_.get() });
+  CompiledMethod* cached_method = other_cache->Lookup(key, &storage);
+  ASSERT_NE(nullptr, cached_method);
+  EXPECT_TRUE(*compiled_method == *cached_method);
+  EXPECT_EQ(compiled_method->GetVmapTable(), cached_method->GetVmapTable());
+  EXPECT_EQ(compiled_method->GetCFIInfo(), cached_method->GetCFIInfo());
+  EXPECT_EQ(compiled_method->GetPatches(), cached_method->GetPatches());
+
+  // A different context or method does not.
+  std::unique_ptr<CompiledMethodCache> changed_cache =
+      CreateCache("changed context", { dex_file_.get() });
+  std::string changed_key = changed_cache->ComputeKey(*dex_file_, 0u, nullptr, 0u, kStatic);
+  EXPECT_EQ(nullptr, changed_cache->Lookup(changed_key, &storage));
+  EXPECT_EQ(nullptr, other_cache->Lookup(
+      other_cache->ComputeKey(*dex_file_, 1u, nullptr, 0u, kStatic), &storage));
+
+  std::ostringstream oss;
+  other_cache->DumpStats(oss);
+  EXPECT_NE(std::string::npos, oss.str().find("hits=1 misses=1")) << oss.str();
+
+  CompiledMethod::ReleaseSwapAllocatedCompiledMethod(&storage, cached_method);
+  CompiledMethod::ReleaseSwapAllocatedCompiledMethod(&storage, compiled_method);
+}
+
+TEST_F(CompiledMethodCacheTest, OtherDexFiles) {
+  // The code of a method depends on the other dex files being compiled, so a change to them
+  // invalidates the entry even if the dex file of the method is unchanged.
+  std::unique_ptr<CompiledMethodCache> cache = CreateCache("context", { dex_file_.get() });
+  std::unique_ptr<CompiledMethodCache> multidex_cache =
+      CreateCache("context", { dex_file_.get(), other_dex_file_.get() });
+  std::string key = cache->ComputeKey(*dex_file_, 0u, nullptr, 0u, kStatic);
+  EXPECT_NE(key, multidex_cache->ComputeKey(*dex_file_, 0u, nullptr, 0u, kStatic));
+
+  // Patches that target another dex file being compiled are relinked against it.
+  CompiledMethodStorage storage(/* swap_fd= */ -1);
+  std::string multidex_key = multidex_cache->ComputeKey(*dex_file_, 0u, nullptr, 0u, kStatic);
+  const uint8_t raw_code[] = { 1u, 2u, 3u, 4u };
+  const linker::LinkerPatch raw_patches[] = {
+      linker::LinkerPatch::TypeBssEntryPatch(0u, other_dex_file_.get(), 1u, 2u),
+  };
+  CompiledMethod* compiled_method = CompiledMethod::SwapAllocCompiledMethod(
+      &storage,
+      InstructionSet::kArm64,
+      ArrayRef<const uint8_t>(raw_code),
+      ArrayRef<const uint8_t>(),
+      ArrayRef<const uint8_t>(),
+      ArrayRef<const linker::LinkerPatch>(raw_patches));
+  multidex_cache->Store(multidex_key, compiled_method, &storage);
+
+  std::unique_ptr<CompiledMethodCache> other_multidex_cache =
+      CreateCache("context", { dex_file_.get(), other_dex_file_.get() });
+  CompiledMethod* cached_method = other_multidex_cache->Lookup(multidex_key, &storage);
+  ASSERT_NE(nullptr, cached_method);
+  ASSERT_EQ(1u, cached_method->GetPatches().size());
+  EXPECT_EQ(other_dex_file_.get(), cached_method->GetPatches()[0].TargetTypeDexFile());
+  EXPECT_EQ(nullptr, cache->Lookup(key, &storage));
+
+  CompiledMethod::ReleaseSwapAllocatedCompiledMethod(&storage, cached_method);
+  CompiledMethod::ReleaseSwapAllocatedCompiledMethod(&storage, compiled_method);
+}
+
+TEST_F(CompiledMethodCacheTest, PatchOutsideContext) {
+  CompiledMethodStorage storage(/* swap_fd= */ -1);
+  std::unique_ptr<CompiledMethodCache> cache = CreateCache("context", { dex_file_.get() });
+  std::string key = cache->ComputeKey(*dex_file_, 0u, nullptr, 0u, kStatic);
+
+  const uint8_t raw_code[] = { 1u, 2u, 3u, 4u };
+  const linker::LinkerPatch raw_patches[] = {
+      linker::LinkerPatch::RelativeMethodPatch(0u, other_dex_file_.get(), 0u, 1u),
+  };
+  CompiledMethod* compiled_method = CompiledMethod::SwapAllocCompiledMethod(
+      &storage,
+      InstructionSet::kArm64,
+      ArrayRef<const uint8_t>(raw_code),
+      ArrayRef<const uint8_t>(),
+      ArrayRef<const uint8_t>(),
+      ArrayRef<const linker::LinkerPatch>(raw_patches));
+  cache->Store(key, compiled_method, &storage);
+  EXPECT_EQ(nullptr, cache->Lookup(key, &storage));
+
+  std::ostringstream oss;
+  cache->DumpStats(oss);
+  EXPECT_NE(std::string::npos, oss.str().find("uncacheable=1")) << oss.str();
+
+  CompiledMethod::ReleaseSwapAllocatedCompiledMethod(&storage, compiled_method);
+}
+
+}  // namespace art
@@ -55,6 +55,7 @@
 #include "dex/dex_to_dex_compiler.h"
 #include "dex/verification_results.h"
 #include "dex/verified_method.h"
+#include "driver/compiled_method_cache.h"
 #include "driver/compiler_options.h"
 #include "driver/dex_compilation_unit.h"
 #include "gc/accounting/card_table-inl.h"
@@ -265,7 +266,7 @@ CompilerDriver::CompilerDriver(
       had_hard_verifier_failure_(false),
       parallel_thread_count_(thread_count),
       stats_(new AOTCompilationStats),
-      compiled_method_storage_(swap_fd),
+      compiled_method_storage_(swap_fd, thread_count),
       max_arena_alloc_(0),
       dex_to_dex_compiler_(this) {
   DCHECK(compiler_options_ != nullptr);
@@ -584,15 +585,26 @@ static void CompileMethodQuick(
               driver->ShouldCompileBasedOnProfile(method_ref);
 
       if (compile) {
-        // NOTE: if compiler declines to compile this method, it will return null.
-        compiled_method = driver->GetCompiler()->Compile(code_item,
-                                                         access_flags,
-                                                         invoke_type,
-                                                         class_def_idx,
-                                                         method_idx,
-                                                         class_loader,
-                                                         dex_file,
-                                                         dex_cache);
+        CompiledMethodCache* cache = driver->GetCompiledMethodCache();
+        std::string cache_key;
+        if (cache != nullptr) {
+          cache_key = cache->ComputeKey(dex_file, method_idx, code_item, access_flags, invoke_type);
+          compiled_method = cache->Lookup(cache_key, driver->GetCompiledMethodStorage());
+        }
+        if (compiled_method == nullptr) {
+          // NOTE: if compiler declines to compile this method, it will return null.
+          compiled_method = driver->GetCompiler()->Compile(code_item,
+                                                           access_flags,
+                                                           invoke_type,
+                                                           class_def_idx,
+                                                           method_idx,
+                                                           class_loader,
+                                                           dex_file,
+                                                           dex_cache);
+          if (cache != nullptr && compiled_method != nullptr) {
+            cache->Store(cache_key, compiled_method, driver->GetCompiledMethodStorage());
+          }
+        }
         ProfileMethodsCheck check_type =
             driver->GetCompilerOptions().CheckProfiledMethodsCompiled();
         if (UNLIKELY(check_type != ProfileMethodsCheck::kNone)) {
@@ -2903,6 +2915,10 @@ std::string CompilerDriver::GetMemoryUsageString(bool extended) const {
   return oss.str();
 }
 
+void CompilerDriver::SetCompiledMethodCache(std::unique_ptr<CompiledMethodCache> cache) {
+  compiled_method_cache_ = std::move(cache);
+}
+
 void CompilerDriver::InitializeThreadPools() {
   size_t parallel_count = parallel_thread_count_ > 0 ? parallel_thread_count_ - 1 : 0;
   parallel_thread_pool_.reset(
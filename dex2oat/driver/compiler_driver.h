@@ -18,6 +18,7 @@
 #define ART_DEX2OAT_DRIVER_COMPILER_DRIVER_H_
 
 #include <atomic>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -61,6 +62,7 @@ class VerifierDepsTest;
 class ArtField;
 class BitVector;
 class CompiledMethod;
+class CompiledMethodCache;
 class CompilerOptions;
 class DexCompilationUnit;
 class DexFile;
@@ -229,6 +231,13 @@ class CompilerDriver {
     return dex_to_dex_compiler_;
   }
 
+  // Set the on-disk cache consulted before compiling each method. May be null.
+  void SetCompiledMethodCache(std::unique_ptr<CompiledMethodCache> cache);
+
+  CompiledMethodCache* GetCompiledMethodCache() const {
+    return compiled_method_cache_.get();
+  }
+
  private:
   void LoadImageClasses(TimingLogger* timings, /*inout*/ HashSet<std::string>* image_classes)
       REQUIRES(!Locks::mutator_lock_);
@@ -341,6 +350,9 @@ class CompilerDriver {
   // Compiler for dex to dex (quickening).
   optimizer::DexToDexCompiler dex_to_dex_compiler_;
 
+  // Cache of compiled methods shared with other dex2oat invocations, if enabled.
+  std::unique_ptr<CompiledMethodCache> compiled_method_cache_;
+
   friend class CommonCompilerDriverTest;
   friend class CompileClassVisitor;
   friend class DexToDexDecompilerTest;
@@ -20,6 +20,7 @@
 #include <lz4hc.h>
 #include <sys/stat.h>
 #include <zlib.h>
+#include <zstd.h>
 
 #include <memory>
 #include <numeric>
@@ -92,6 +93,11 @@ using ::art::mirror::String;
 namespace art {
 namespace linker {
 
+// Compression level for the zstd storage mode. Images are written once at build or install
+// time and read on every startup, so we favor the compression ratio over the compression speed.
+// Decompression speed barely depends on the level.
+static constexpr int kZstdCompressionLevel = 19;
+
 static ArrayRef<const uint8_t> MaybeCompressData(ArrayRef<const uint8_t> source,
                                                  ImageHeader::StorageMode image_storage_mode,
                                                  /*out*/ std::vector<uint8_t>* storage) {
@@ -120,6 +126,17 @@ static ArrayRef<const uint8_t> MaybeCompressData(ArrayRef<const uint8_t> source,
       storage->resize(data_size);
       break;
     }
+    case ImageHeader::kStorageModeZstd: {
+      storage->resize(ZSTD_compressBound(source.size()));
+      size_t data_size = ZSTD_compress(storage->data(),
+                                       storage->size(),
+                                       source.data(),
+                                       source.size(),
+                                       kZstdCompressionLevel);
+      CHECK(!ZSTD_isError(data_size)) << ZSTD_getErrorName(data_size);
+      storage->resize(data_size);
+      break;
+    }
     case ImageHeader::kStorageModeUncompressed: {
       return source;
     }
@@ -130,17 +147,19 @@ static ArrayRef<const uint8_t> MaybeCompressData(ArrayRef<const uint8_t> source,
   }
 
   DCHECK(image_storage_mode == ImageHeader::kStorageModeLZ4 ||
-         image_storage_mode == ImageHeader::kStorageModeLZ4HC);
+         image_storage_mode == ImageHeader::kStorageModeLZ4HC ||
+         image_storage_mode == ImageHeader::kStorageModeZstd);
   VLOG(compiler) << "Compressed from " << source.size() << " to " << storage->size() << " in "
                  << PrettyDuration(NanoTime() - compress_start_time);
   if (kIsDebugBuild) {
     std::vector<uint8_t> decompressed(source.size());
-    const size_t decompressed_size = LZ4_decompress_safe(
-        reinterpret_cast<char*>(storage->data()),
-        reinterpret_cast<char*>(decompressed.data()),
-        storage->size(),
-        decompressed.size());
-    CHECK_EQ(decompressed_size, decompressed.size());
+    ImageHeader::Block block(image_storage_mode,
+                             /*data_offset=*/ 0u,
+                             storage->size(),
+                             /*image_offset=*/ 0u,
+                             decompressed.size());
+    std::string error_msg;
+    CHECK(block.Decompress(decompressed.data(), storage->data(), &error_msg)) << error_msg;
     CHECK_EQ(memcmp(source.data(), decompressed.data(), source.size()), 0) << image_storage_mode;
   }
   return ArrayRef<const uint8_t>(*storage);
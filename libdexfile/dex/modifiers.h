@@ -72,6 +72,10 @@ static constexpr uint32_t kAccDefault =               0x00400000;  // method (ru
 // Reuse the values of kAccSkipAccessChecks and kAccMiranda which are not used for native methods.
 static constexpr uint32_t kAccFastNative =            0x00080000;  // method (runtime; native only)
 static constexpr uint32_t kAccCriticalNative =        0x00200000;  // method (runtime; native only)
+// Set for methods annotated with @dalvik.annotation.optimization.PinnedArrayNative. These are
+// @CriticalNative methods that may also take primitive arrays, passed as pointers to the array
+// data. Both native flags are set; @FastNative and @CriticalNative are exclusive otherwise.
+static constexpr uint32_t kAccPinnedArrayNative = kAccFastNative | kAccCriticalNative;
 
 // Set by the JIT when clearing profiling infos to denote that a method was previously warm.
 static constexpr uint32_t kAccPreviouslyWarm =        0x00800000;  // method (runtime)
@@ -34,11 +34,12 @@
 
 #include "jvmti_weak_table.h"
 
-#include <limits>
+#include <utility>
 
 #include <android-base/logging.h>
 
 #include "art_jvmti.h"
+#include "base/bit_utils.h"
 #include "gc/allocation_listener.h"
 #include "instrumentation.h"
 #include "jni/jni_env_ext-inl.h"
@@ -50,6 +51,13 @@
 
 namespace openjdkjvmti {
 
+template <typename T>
+JvmtiWeakTable<T>::~JvmtiWeakTable() {
+  if (entries_ != nullptr) {
+    JvmtiAllocator<Entry>().deallocate(entries_, capacity_);
+  }
+}
+
 template <typename T>
 void JvmtiWeakTable<T>::Lock() {
   allow_disallow_lock_.ExclusiveLock(art::Thread::Current());
@@ -105,12 +113,12 @@ bool JvmtiWeakTable<T>::RemoveLocked(art::ObjPtr<art::mirror::Object> obj, T* ta
 
 template <typename T>
 bool JvmtiWeakTable<T>::RemoveLocked(art::Thread* self, art::ObjPtr<art::mirror::Object> obj, T* tag) {
-  auto it = tagged_objects_.find(art::GcRoot<art::mirror::Object>(obj));
-  if (it != tagged_objects_.end()) {
+  size_t index = FindIndex(obj.Ptr());
+  if (index != kNotFound) {
     if (tag != nullptr) {
-      *tag = it->second;
+      *tag = entries_[index].tag;
     }
-    tagged_objects_.erase(it);
+    EraseAt(index);
     return true;
   }
 
@@ -150,9 +158,9 @@ bool JvmtiWeakTable<T>::SetLocked(art::ObjPtr<art::mirror::Object> obj, T new_ta
 
 template <typename T>
 bool JvmtiWeakTable<T>::SetLocked(art::Thread* self, art::ObjPtr<art::mirror::Object> obj, T new_tag) {
-  auto it = tagged_objects_.find(art::GcRoot<art::mirror::Object>(obj));
-  if (it != tagged_objects_.end()) {
-    it->second = new_tag;
+  size_t index = FindIndex(obj.Ptr());
+  if (index != kNotFound) {
+    entries_[index].tag = new_tag;
     return true;
   }
 
@@ -170,8 +178,7 @@ bool JvmtiWeakTable<T>::SetLocked(art::Thread* self, art::ObjPtr<art::mirror::Ob
   }
 
   // New element.
-  auto insert_it = tagged_objects_.emplace(art::GcRoot<art::mirror::Object>(obj), new_tag);
-  DCHECK(insert_it.second);
+  Insert(obj.Ptr(), new_tag);
   return false;
 }
 
@@ -210,38 +217,142 @@ void JvmtiWeakTable<T>::SweepImpl(art::IsMarkedVisitor* visitor) {
 template <typename T>
 template <typename Updater, typename JvmtiWeakTable<T>::TableUpdateNullTarget kTargetNull>
 ALWAYS_INLINE inline void JvmtiWeakTable<T>::UpdateTableWith(Updater& updater) {
-  // We optimistically hope that elements will still be well-distributed when re-inserting them.
-  // So play with the map mechanics, and postpone rehashing. This avoids the need of a side
-  // vector and two passes.
-  float original_max_load_factor = tagged_objects_.max_load_factor();
-  tagged_objects_.max_load_factor(std::numeric_limits<float>::max());
-  // For checking that a max load-factor actually does what we expect.
-  size_t original_bucket_count = tagged_objects_.bucket_count();
-
-  for (auto it = tagged_objects_.begin(); it != tagged_objects_.end();) {
-    DCHECK(!it->first.IsNull());
-    art::mirror::Object* original_obj = it->first.template Read<art::kWithoutReadBarrier>();
-    art::mirror::Object* target_obj = updater(it->first, original_obj);
+  // Update the references in place first. Removing or moving an entry would require shifting the
+  // entries after it, which may then be visited twice.
+  bool changed = false;
+  for (size_t i = 0; i != capacity_; ++i) {
+    Entry& entry = entries_[i];
+    if (entry.root.IsNull()) {
+      continue;
+    }
+    art::mirror::Object* original_obj = EntryObject(entry);
+    art::mirror::Object* target_obj = updater(entry.root, original_obj);
     if (original_obj != target_obj) {
       if (kTargetNull == kIgnoreNull && target_obj == nullptr) {
         // Ignore null target, don't do anything.
       } else {
-        T tag = it->second;
-        it = tagged_objects_.erase(it);
+        changed = true;
         if (target_obj != nullptr) {
-          tagged_objects_.emplace(art::GcRoot<art::mirror::Object>(target_obj), tag);
-          DCHECK_EQ(original_bucket_count, tagged_objects_.bucket_count());
-        } else if (kTargetNull == kCallHandleNull) {
-          HandleNullSweep(tag);
+          entry.root = art::GcRoot<art::mirror::Object>(target_obj);
+        } else {
+          T tag = entry.tag;
+          entry = Entry();
+          --size_;
+          if (kTargetNull == kCallHandleNull) {
+            HandleNullSweep(tag);
+          }
         }
-        continue;  // Iterator was implicitly updated by erase.
       }
     }
-    it++;
   }
 
-  tagged_objects_.max_load_factor(original_max_load_factor);
-  // TODO: consider rehash here.
+  // Then move the entries to the slots of their new addresses. Removed entries leave holes in the
+  // probe sequences of the entries after them, so all entries need to be placed again.
+  if (changed) {
+    RehashInPlace();
+  }
+}
+
+template <typename T>
+size_t JvmtiWeakTable<T>::FindIndex(art::mirror::Object* obj) const {
+  if (size_ == 0u) {
+    return kNotFound;
+  }
+  for (size_t i = HomeIndex(obj); !entries_[i].root.IsNull(); i = NextIndex(i)) {
+    if (EntryObject(entries_[i]) == obj) {
+      return i;
+    }
+  }
+  return kNotFound;
+}
+
+template <typename T>
+void JvmtiWeakTable<T>::Insert(art::mirror::Object* obj, T tag) {
+  DCHECK(obj != nullptr);
+  if ((size_ + 1u) * kMaxLoadDenominator > capacity_ * kMaxLoadNumerator) {
+    Resize(capacity_ == 0u ? kInitialCapacity : 2u * capacity_);
+  }
+  size_t i = HomeIndex(obj);
+  while (!entries_[i].root.IsNull()) {
+    DCHECK_NE(EntryObject(entries_[i]), obj);
+    i = NextIndex(i);
+  }
+  entries_[i].root = art::GcRoot<art::mirror::Object>(obj);
+  entries_[i].tag = tag;
+  ++size_;
+}
+
+template <typename T>
+void JvmtiWeakTable<T>::EraseAt(size_t index) {
+  // Backward shift deletion: move up the following entries of the cluster that would no longer
+  // be found from their home slot once `index` is empty.
+  size_t hole = index;
+  for (size_t i = NextIndex(index); !entries_[i].root.IsNull(); i = NextIndex(i)) {
+    size_t home = HomeIndex(EntryObject(entries_[i]));
+    // The entry stays if its home is cyclically in (hole, i].
+    bool stays = (hole <= i) ? (hole < home && home <= i) : (hole < home || home <= i);
+    if (!stays) {
+      entries_[hole] = entries_[i];
+      hole = i;
+    }
+  }
+  entries_[hole] = Entry();
+  --size_;
+}
+
+template <typename T>
+void JvmtiWeakTable<T>::Resize(size_t new_capacity) {
+  DCHECK(art::IsPowerOfTwo(new_capacity));
+  DCHECK_LE(size_ * kMaxLoadDenominator, new_capacity * kMaxLoadNumerator);
+  JvmtiAllocator<Entry> allocator;
+  Entry* old_entries = entries_;
+  size_t old_capacity = capacity_;
+  entries_ = allocator.allocate(new_capacity);
+  for (size_t i = 0; i != new_capacity; ++i) {
+    new (&entries_[i]) Entry();
+  }
+  capacity_ = new_capacity;
+  hash_shift_ = 64u - art::WhichPowerOf2(new_capacity);
+  for (size_t i = 0; i != old_capacity; ++i) {
+    if (!old_entries[i].root.IsNull()) {
+      size_t j = HomeIndex(EntryObject(old_entries[i]));
+      while (!entries_[j].root.IsNull()) {
+        j = NextIndex(j);
+      }
+      entries_[j] = old_entries[i];
+    }
+  }
+  if (old_entries != nullptr) {
+    allocator.deallocate(old_entries, old_capacity);
+  }
+}
+
+template <typename T>
+void JvmtiWeakTable<T>::RehashInPlace() {
+  for (size_t i = 0; i != capacity_; ++i) {
+    entries_[i].misplaced = !entries_[i].root.IsNull();
+  }
+  // Place the misplaced entries one by one. A placed entry only probes past other placed
+  // entries, so slots that become empty later never break its probe sequence.
+  for (size_t i = 0; i != capacity_; ++i) {
+    while (entries_[i].misplaced) {
+      size_t target = HomeIndex(EntryObject(entries_[i]));
+      while (!entries_[target].root.IsNull() && !entries_[target].misplaced) {
+        target = NextIndex(target);
+      }
+      if (target == i) {
+        entries_[i].misplaced = false;
+      } else if (entries_[target].root.IsNull()) {
+        entries_[target] = entries_[i];
+        entries_[target].misplaced = false;
+        entries_[i] = Entry();
+      } else {
+        // Swap with the misplaced entry in the target slot and place that one next.
+        std::swap(entries_[i], entries_[target]);
+        entries_[target].misplaced = false;
+      }
+    }
+  }
 }
 
 template <typename T>
@@ -336,8 +447,8 @@ jvmtiError JvmtiWeakTable<T>::GetTaggedObjects(jvmtiEnv* jvmti_env,
   size_t initial_object_size;
   size_t initial_tag_size;
   if (tag_count == 0) {
-    initial_object_size = (object_result_ptr != nullptr) ? tagged_objects_.size() : 0;
-    initial_tag_size = (tag_result_ptr != nullptr) ? tagged_objects_.size() : 0;
+    initial_object_size = (object_result_ptr != nullptr) ? size_ : 0;
+    initial_tag_size = (tag_result_ptr != nullptr) ? size_ : 0;
   } else {
     initial_object_size = initial_tag_size = kDefaultSize;
   }
@@ -347,12 +458,16 @@ jvmtiError JvmtiWeakTable<T>::GetTaggedObjects(jvmtiEnv* jvmti_env,
   ReleasableContainer<T, JvmtiAllocator<T>> selected_tags(allocator, initial_tag_size);
 
   size_t count = 0;
-  for (auto& pair : tagged_objects_) {
+  for (size_t index = 0; index != capacity_; ++index) {
+    const Entry& entry = entries_[index];
+    if (entry.root.IsNull()) {
+      continue;
+    }
     bool select;
     if (tag_count > 0) {
       select = false;
       for (size_t i = 0; i != static_cast<size_t>(tag_count); ++i) {
-        if (tags[i] == pair.second) {
+        if (tags[i] == entry.tag) {
           select = true;
           break;
         }
@@ -362,14 +477,14 @@ jvmtiError JvmtiWeakTable<T>::GetTaggedObjects(jvmtiEnv* jvmti_env,
     }
 
     if (select) {
-      art::ObjPtr<art::mirror::Object> obj = pair.first.template Read<art::kWithReadBarrier>();
+      art::ObjPtr<art::mirror::Object> obj = entry.root.template Read<art::kWithReadBarrier>();
       if (obj != nullptr) {
         count++;
         if (object_result_ptr != nullptr) {
           selected_objects.Pushback(jni_env->AddLocalReference<jobject>(obj));
         }
         if (tag_result_ptr != nullptr) {
-          selected_tags.Pushback(pair.second);
+          selected_tags.Pushback(entry.tag);
         }
       }
     }
@@ -391,9 +506,10 @@ art::ObjPtr<art::mirror::Object> JvmtiWeakTable<T>::Find(T tag) {
   art::MutexLock mu(self, allow_disallow_lock_);
   Wait(self);
 
-  for (auto& pair : tagged_objects_) {
-    if (tag == pair.second) {
-      art::ObjPtr<art::mirror::Object> obj = pair.first.template Read<art::kWithReadBarrier>();
+  for (size_t i = 0; i != capacity_; ++i) {
+    const Entry& entry = entries_[i];
+    if (!entry.root.IsNull() && tag == entry.tag) {
+      art::ObjPtr<art::mirror::Object> obj = entry.root.template Read<art::kWithReadBarrier>();
       if (obj != nullptr) {
         return obj;
       }
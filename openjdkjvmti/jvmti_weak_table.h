@@ -32,8 +32,6 @@
 #ifndef ART_OPENJDKJVMTI_JVMTI_WEAK_TABLE_H_
 #define ART_OPENJDKJVMTI_JVMTI_WEAK_TABLE_H_
 
-#include <unordered_map>
-
 #include "base/globals.h"
 #include "base/macros.h"
 #include "base/mutex.h"
@@ -50,14 +48,25 @@ class EventHandler;
 
 // A system-weak container mapping objects to elements of the template type. This corresponds
 // to a weak hash map. For historical reasons the stored value is called "tag."
+//
+// The mapping is an open-addressing hash table with linear probing, keyed by object address.
+// Each slot holds the object reference next to its tag, so that lookups and sweeps walk a single
+// array. Sweeping updates the references in place and then moves the entries of objects that
+// moved to the slots of their new addresses, without allocating.
 template <typename T>
 class JvmtiWeakTable : public art::gc::SystemWeakHolder {
  public:
   JvmtiWeakTable()
       : art::gc::SystemWeakHolder(art::kTaggingLockLevel),
+        entries_(nullptr),
+        capacity_(0u),
+        size_(0u),
+        hash_shift_(0u),
         update_since_last_sweep_(false) {
   }
 
+  ~JvmtiWeakTable() NO_THREAD_SAFETY_ANALYSIS;
+
   // Remove the mapping for the given object, returning whether such a mapping existed (and the old
   // value).
   ALWAYS_INLINE bool Remove(art::ObjPtr<art::mirror::Object> obj, /* out */ T* tag)
@@ -97,6 +106,19 @@ class JvmtiWeakTable : public art::gc::SystemWeakHolder {
     return GetTagLocked(self, obj, result);
   }
 
+  // Return the value associated with the given object, without taking the lock. Only for threads
+  // that read the table while another thread holds the lock and does not modify the table, like
+  // the workers of a parallel heap iteration.
+  bool GetTagWithoutLock(art::ObjPtr<art::mirror::Object> obj, /* out */ T* result)
+      NO_THREAD_SAFETY_ANALYSIS {
+    size_t index = FindIndex(obj.Ptr());
+    if (index != kNotFound) {
+      *result = entries_[index].tag;
+      return true;
+    }
+    return false;
+  }
+
   // Sweep the container. DO NOT CALL MANUALLY.
   ALWAYS_INLINE void Sweep(art::IsMarkedVisitor* visitor)
       REQUIRES_SHARED(art::Locks::mutator_lock_)
@@ -144,9 +166,9 @@ class JvmtiWeakTable : public art::gc::SystemWeakHolder {
   bool GetTagLocked(art::Thread* self, art::ObjPtr<art::mirror::Object> obj, /* out */ T* result)
       REQUIRES_SHARED(art::Locks::mutator_lock_)
       REQUIRES(allow_disallow_lock_) {
-    auto it = tagged_objects_.find(art::GcRoot<art::mirror::Object>(obj));
-    if (it != tagged_objects_.end()) {
-      *result = it->second;
+    size_t index = FindIndex(obj.Ptr());
+    if (index != kNotFound) {
+      *result = entries_[index].tag;
       return true;
     }
 
@@ -195,29 +217,70 @@ class JvmtiWeakTable : public art::gc::SystemWeakHolder {
   template <typename Storage, class Allocator = JvmtiAllocator<T>>
   struct ReleasableContainer;
 
-  struct HashGcRoot {
-    size_t operator()(const art::GcRoot<art::mirror::Object>& r) const
-        REQUIRES_SHARED(art::Locks::mutator_lock_) {
-      return reinterpret_cast<uintptr_t>(r.Read<art::kWithoutReadBarrier>());
-    }
+  struct Entry {
+    // Null for an empty slot.
+    art::GcRoot<art::mirror::Object> root;
+    // Set for the entries that may not be in the slot of their address while sweeping. Kept in
+    // the padding between the reference and the tag.
+    bool misplaced = false;
+    T tag;
   };
 
-  struct EqGcRoot {
-    bool operator()(const art::GcRoot<art::mirror::Object>& r1,
-                    const art::GcRoot<art::mirror::Object>& r2) const
-        REQUIRES_SHARED(art::Locks::mutator_lock_) {
-      return r1.Read<art::kWithoutReadBarrier>() == r2.Read<art::kWithoutReadBarrier>();
-    }
-  };
+  static constexpr size_t kNotFound = static_cast<size_t>(-1);
+  static constexpr size_t kInitialCapacity = 64u;
+  // The table grows when it is more than 3/4 full.
+  static constexpr size_t kMaxLoadNumerator = 3u;
+  static constexpr size_t kMaxLoadDenominator = 4u;
+
+  // Returns the preferred slot of the entry for `obj`.
+  size_t HomeIndex(art::mirror::Object* obj) const REQUIRES(allow_disallow_lock_) {
+    // Fibonacci hashing, objects are allocated next to each other so the low bits of their
+    // addresses do not spread well on their own.
+    return static_cast<size_t>(
+        (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(obj)) * UINT64_C(0x9e3779b97f4a7c15))
+            >> hash_shift_);
+  }
+
+  size_t NextIndex(size_t index) const REQUIRES(allow_disallow_lock_) {
+    return (index + 1u) & (capacity_ - 1u);
+  }
+
+  static art::mirror::Object* EntryObject(const Entry& entry)
+      REQUIRES_SHARED(art::Locks::mutator_lock_) {
+    return entry.root.template Read<art::kWithoutReadBarrier>();
+  }
+
+  // Returns the slot holding `obj`, or kNotFound.
+  size_t FindIndex(art::mirror::Object* obj) const
+      REQUIRES_SHARED(art::Locks::mutator_lock_)
+      REQUIRES(allow_disallow_lock_);
+
+  // Adds an entry for `obj`, which must not be in the table yet.
+  void Insert(art::mirror::Object* obj, T tag)
+      REQUIRES_SHARED(art::Locks::mutator_lock_)
+      REQUIRES(allow_disallow_lock_);
+
+  // Removes the entry in slot `index`, shifting back the entries that probed past it.
+  void EraseAt(size_t index)
+      REQUIRES_SHARED(art::Locks::mutator_lock_)
+      REQUIRES(allow_disallow_lock_);
+
+  void Resize(size_t new_capacity)
+      REQUIRES_SHARED(art::Locks::mutator_lock_)
+      REQUIRES(allow_disallow_lock_);
+
+  // Moves all entries into the slots of their current addresses, after UpdateTableWith()
+  // changed some of them in place.
+  void RehashInPlace()
+      REQUIRES_SHARED(art::Locks::mutator_lock_)
+      REQUIRES(allow_disallow_lock_);
 
-  using TagAllocator = JvmtiAllocator<std::pair<const art::GcRoot<art::mirror::Object>, T>>;
-  std::unordered_map<art::GcRoot<art::mirror::Object>,
-                     T,
-                     HashGcRoot,
-                     EqGcRoot,
-                     TagAllocator> tagged_objects_
-      GUARDED_BY(allow_disallow_lock_)
-      GUARDED_BY(art::Locks::mutator_lock_);
+  Entry* entries_ GUARDED_BY(allow_disallow_lock_) GUARDED_BY(art::Locks::mutator_lock_);
+  // A power of two, or zero before the first insertion.
+  size_t capacity_ GUARDED_BY(allow_disallow_lock_);
+  size_t size_ GUARDED_BY(allow_disallow_lock_);
+  // 64 - log2(capacity_).
+  uint32_t hash_shift_ GUARDED_BY(allow_disallow_lock_);
   // To avoid repeatedly scanning the whole table, remember if we did that since the last sweep.
   bool update_since_last_sweep_;
 };
@@ -0,0 +1,200 @@
+
+/* Copyright (C) 2020 The Android Open Source Project
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This file implements interfaces from the file jvmti.h. This implementation
+ * is licensed under the same terms as the file jvmti.h.  The
+ * copyright and license information for the file jvmti.h follows.
+ *
+ * Copyright (c) 2003, 2011, Oracle and/or its affiliates. All rights reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  Oracle designates this
+ * particular file as subject to the "Classpath" exception as provided
+ * by Oracle in the LICENSE file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Please contact Oracle, 500 Oracle Parkway, Redwood Shores, CA 94065 USA
+ * or visit www.oracle.com if you need additional information or have any
+ * questions.
+
+#include "jvmti_weak_table-inl.h"
+
+#include <map>
+#include <set>
+
+#include "class_linker.h"
+#include "class_root-inl.h"
+#include "common_runtime_test.h"
+#include "gc/scoped_gc_critical_section.h"
+#include "handle_scope-inl.h"
+#include "mirror/class-alloc-inl.h"
+#include "mirror/object_array-alloc-inl.h"
+#include "mirror/object_array-inl.h"
+#include "scoped_thread_state_change-inl.h"
+
+namespace openjdkjvmti {
+
+class JvmtiWeakTableTest : public art::CommonRuntimeTest {
+ protected:
+  static constexpr int32_t kNumObjects = 1000;
+
+  // Allocates `count` objects, held by the returned array.
+  art::ObjPtr<art::mirror::ObjectArray<art::mirror::Object>> AllocObjects(art::Thread* self,
+                                                                          int32_t count)
+      REQUIRES_SHARED(art::Locks::mutator_lock_) {
+    art::StackHandleScope<2> hs(self);
+    art::Handle<art::mirror::Class> klass =
+        hs.NewHandle(class_linker_->FindSystemClass(self, "Ljava/lang/Object;"));
+    CHECK(klass != nullptr);
+    art::Handle<art::mirror::ObjectArray<art::mirror::Object>> objects = hs.NewHandle(
+        art::mirror::ObjectArray<art::mirror::Object>::Alloc(
+            self,
+            art::GetClassRoot<art::mirror::ObjectArray<art::mirror::Object>>(class_linker_),
+            count));
+    CHECK(objects != nullptr);
+    for (int32_t i = 0; i != count; ++i) {
+      art::ObjPtr<art::mirror::Object> obj = klass->AllocObject(self);
+      CHECK(obj != nullptr);
+      objects->Set<false>(i, obj);
+    }
+    return objects.Get();
+  }
+};
+
+// Reports the objects of `dead` as dead and the keys of `moved` as moved to their values, like
+// a moving collection.
+class MovingIsMarkedVisitor : public art::IsMarkedVisitor {
+ public:
+  MovingIsMarkedVisitor(const std::set<art::mirror::Object*>& dead,
+                        const std::map<art::mirror::Object*, art::mirror::Object*>& moved)
+      : dead_(dead), moved_(moved) {}
+
+  art::mirror::Object* IsMarked(art::mirror::Object* obj) override {
+    if (dead_.find(obj) != dead_.end()) {
+      return nullptr;
+    }
+    auto it = moved_.find(obj);
+    return (it != moved_.end()) ? it->second : obj;
+  }
+
+ private:
+  const std::set<art::mirror::Object*>& dead_;
+  const std::map<art::mirror::Object*, art::mirror::Object*>& moved_;
+};
+
+TEST_F(JvmtiWeakTableTest, SetGetRemove) {
+  art::Thread* self = art::Thread::Current();
+  art::ScopedObjectAccess soa(self);
+  art::StackHandleScope<1> hs(self);
+  art::Handle<art::mirror::ObjectArray<art::mirror::Object>> objects =
+      hs.NewHandle(AllocObjects(self, kNumObjects));
+  // Keep the objects from moving while the test refers to them by address.
+  art::gc::ScopedGCCriticalSection gcs(
+      self, art::gc::kGcCauseDebugger, art::gc::kCollectorTypeDebugger);
+
+  JvmtiWeakTable<jlong> table;
+  // The table grows several times, and most slots end up in clusters.
+  for (int32_t i = 0; i != kNumObjects; ++i) {
+    EXPECT_FALSE(table.Set(objects->Get(i), i));
+  }
+  EXPECT_TRUE(table.Set(objects->Get(0), -1));
+  for (int32_t i = 0; i != kNumObjects; ++i) {
+    jlong tag;
+    ASSERT_TRUE(table.GetTag(objects->Get(i), &tag)) << i;
+    EXPECT_EQ((i == 0) ? -1 : i, tag);
+  }
+
+  // Removing every other entry shifts back the entries that probed past the removed ones. The
+  // remaining entries must still be found from their home slots.
+  for (int32_t i = 0; i < kNumObjects; i += 2) {
+    jlong tag;
+    ASSERT_TRUE(table.Remove(objects->Get(i), &tag)) << i;
+    EXPECT_EQ((i == 0) ? -1 : i, tag);
+  }
+  for (int32_t i = 0; i != kNumObjects; ++i) {
+    jlong tag;
+    if (i % 2 == 0) {
+      EXPECT_FALSE(table.GetTag(objects->Get(i), &tag)) << i;
+      EXPECT_FALSE(table.Remove(objects->Get(i), &tag)) << i;
+    } else {
+      ASSERT_TRUE(table.GetTag(objects->Get(i), &tag)) << i;
+      EXPECT_EQ(i, tag);
+    }
+  }
+  for (int32_t i = 1; i < kNumObjects; i += 2) {
+    ASSERT_TRUE(table.Remove(objects->Get(i), nullptr)) << i;
+  }
+  jlong tag;
+  EXPECT_FALSE(table.GetTag(objects->Get(1), &tag));
+  EXPECT_TRUE(table.Find(1) == nullptr);
+}
+
+TEST_F(JvmtiWeakTableTest, Sweep) {
+  art::Thread* self = art::Thread::Current();
+  art::ScopedObjectAccess soa(self);
+  art::StackHandleScope<2> hs(self);
+  art::Handle<art::mirror::ObjectArray<art::mirror::Object>> objects =
+      hs.NewHandle(AllocObjects(self, kNumObjects));
+  // Objects that tagged objects move to. They are not in the table before the sweep.
+  art::Handle<art::mirror::ObjectArray<art::mirror::Object>> targets =
+      hs.NewHandle(AllocObjects(self, kNumObjects));
+  art::gc::ScopedGCCriticalSection gcs(
+      self, art::gc::kGcCauseDebugger, art::gc::kCollectorTypeDebugger);
+
+  JvmtiWeakTable<jlong> table;
+  for (int32_t i = 0; i != kNumObjects; ++i) {
+    table.Set(objects->Get(i), i);
+  }
+  // A third of the objects die and a third move, the entries of the moved objects then need
+  // other slots, and the entries after dead ones may need to move up.
+  std::set<art::mirror::Object*> dead;
+  std::map<art::mirror::Object*, art::mirror::Object*> moved;
+  for (int32_t i = 0; i != kNumObjects; ++i) {
+    if (i % 3 == 1) {
+      dead.insert(objects->Get(i));
+    } else if (i % 3 == 2) {
+      moved.emplace(objects->Get(i), targets->Get(i));
+    }
+  }
+  MovingIsMarkedVisitor visitor(dead, moved);
+  table.Sweep(&visitor);
+
+  for (int32_t i = 0; i != kNumObjects; ++i) {
+    jlong tag;
+    if (i % 3 == 0) {
+      ASSERT_TRUE(table.GetTag(objects->Get(i), &tag)) << i;
+      EXPECT_EQ(i, tag);
+    } else if (i % 3 == 1) {
+      EXPECT_FALSE(table.GetTag(objects->Get(i), &tag)) << i;
+    } else {
+      EXPECT_FALSE(table.GetTag(objects->Get(i), &tag)) << i;
+      ASSERT_TRUE(table.GetTag(targets->Get(i), &tag)) << i;
+      EXPECT_EQ(i, tag);
+      EXPECT_OBJ_PTR_EQ(targets->Get(i), table.Find(i));
+    }
+  }
+
+  // The rehashed table still supports removal.
+  for (int32_t i = 0; i < kNumObjects; i += 3) {
+    ASSERT_TRUE(table.Remove(objects->Get(i), nullptr)) << i;
+  }
+  for (int32_t i = 2; i < kNumObjects; i += 3) {
+    jlong tag;
+    ASSERT_TRUE(table.GetTag(targets->Get(i), &tag)) << i;
+    EXPECT_EQ(i, tag);
+  }
+}
+
+}  // namespace openjdkjvmti
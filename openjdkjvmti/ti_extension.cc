@@ -46,6 +46,7 @@
 #include "ti_monitor.h"
 #include "ti_redefine.h"
 #include "ti_search.h"
+#include "ti_stack.h"
 #include "transform.h"
 
 #include "thread-inl.h"
@@ -200,6 +201,31 @@ jvmtiError ExtensionUtil::GetExtensionFunctions(jvmtiEnv* env,
     return error;
   }
 
+  error = add_extension(
+      reinterpret_cast<jvmtiExtensionFunction>(HeapExtensions::IterateThroughHeapParallel),
+      "com.android.art.heap.iterate_through_heap_parallel",
+      "Iterate through a heap with several threads. This is equivalent to the standard"
+      " IterateThroughHeap function, except that the callbacks are called concurrently from"
+      " thread_count threads and objects are reported in no particular order. thread_count must"
+      " be positive and is capped at the number of processors. Tags set by the callbacks are"
+      " visible to all threads. An abort stops the iteration on all threads.",
+      {
+          { "heap_filter", JVMTI_KIND_IN, JVMTI_TYPE_JINT, false},
+          { "klass", JVMTI_KIND_IN, JVMTI_TYPE_JCLASS, true},
+          { "callbacks", JVMTI_KIND_IN_PTR, JVMTI_TYPE_CVOID, false},
+          { "user_data", JVMTI_KIND_IN_PTR, JVMTI_TYPE_CVOID, true},
+          { "thread_count", JVMTI_KIND_IN, JVMTI_TYPE_JINT, false},
+      },
+      {
+          ERR(MUST_POSSESS_CAPABILITY),
+          ERR(INVALID_CLASS),
+          ERR(NULL_POINTER),
+          ERR(ILLEGAL_ARGUMENT),
+      });
+  if (error != ERR(NONE)) {
+    return error;
+  }
+
   error = add_extension(
       reinterpret_cast<jvmtiExtensionFunction>(AllocUtil::GetGlobalJvmtiAllocationState),
       "com.android.art.alloc.get_global_jvmti_allocation_state",
@@ -262,6 +288,34 @@ jvmtiError ExtensionUtil::GetExtensionFunctions(jvmtiEnv* env,
     return error;
   }
 
+  // Asynchronous GetAllStackTraces extension
+  error = add_extension(
+      reinterpret_cast<jvmtiExtensionFunction>(StackUtil::GetAllStackTracesAsync),
+      "com.android.art.stack.get_all_stack_traces_async",
+      "Get the stacks of all live threads without waiting for every thread to reach a suspend"
+      " point. Each thread records its stack the next time it reaches one. The stacks recorded"
+      " within timeout_ms milliseconds are returned in the format of GetAllStackTraces, threads"
+      " that take longer are left out and counted in missed_thread_count_ptr. The stacks are not"
+      " taken at the same point in time. The frames of all threads are preallocated, if"
+      " max_frame_count times the number of threads exceeds about four million frames,"
+      " ILLEGAL_ARGUMENT is returned. The stack_info_ptr buffer must be deallocated by the"
+      " caller.",
+      {
+        { "max_frame_count", JVMTI_KIND_IN, JVMTI_TYPE_JINT, false },
+        { "timeout_ms", JVMTI_KIND_IN, JVMTI_TYPE_JINT, false },
+        { "stack_info_ptr", JVMTI_KIND_ALLOC_BUF, JVMTI_TYPE_CVOID, false },
+        { "thread_count_ptr", JVMTI_KIND_OUT, JVMTI_TYPE_JINT, false },
+        { "missed_thread_count_ptr", JVMTI_KIND_OUT, JVMTI_TYPE_JINT, true },
+      },
+      {
+        ERR(ILLEGAL_ARGUMENT),
+        ERR(NULL_POINTER),
+        ERR(OUT_OF_MEMORY),
+      });
+  if (error != ERR(NONE)) {
+    return error;
+  }
+
   // Raw monitors no suspend
   error = add_extension(
       reinterpret_cast<jvmtiExtensionFunction>(MonitorUtil::RawMonitorEnterNoSuspend),
@@ -452,6 +506,37 @@ jvmtiError ExtensionUtil::GetExtensionFunctions(jvmtiEnv* env,
       return error;
     }
 
+    // StructurallyRedefineClassesBriefPause
+    error = add_extension(
+        reinterpret_cast<jvmtiExtensionFunction>(Redefiner::StructurallyRedefineClassesBriefPause),
+        "com.android.art.class.structurally_redefine_classes_brief_pause",
+        "Same as com.android.art.class.structurally_redefine_classes, but keeps all threads"
+        " suspended for a shorter time. The updates of the runtime state are computed before the"
+        " threads are suspended and the heap is updated by several threads. Returns the time all"
+        " threads were suspended, in nanoseconds.",
+        {
+            { "num_classes", JVMTI_KIND_IN, JVMTI_TYPE_JINT, false },
+            { "class_definitions", JVMTI_KIND_IN_BUF, JVMTI_TYPE_CVOID, false },
+            { "pause_time_ns", JVMTI_KIND_OUT, JVMTI_TYPE_JLONG, false },
+        },
+        {
+            ERR(CLASS_LOADER_UNSUPPORTED),
+            ERR(FAILS_VERIFICATION),
+            ERR(ILLEGAL_ARGUMENT),
+            ERR(INVALID_CLASS),
+            ERR(MUST_POSSESS_CAPABILITY),
+            ERR(NULL_POINTER),
+            ERR(OUT_OF_MEMORY),
+            ERR(UNMODIFIABLE_CLASS),
+            ERR(UNSUPPORTED_REDEFINITION_HIERARCHY_CHANGED),
+            ERR(UNSUPPORTED_REDEFINITION_METHOD_ADDED),
+            ERR(UNSUPPORTED_REDEFINITION_METHOD_DELETED),
+            ERR(UNSUPPORTED_REDEFINITION_SCHEMA_CHANGED),
+        });
+    if (error != ERR(NONE)) {
+      return error;
+    }
+
     // StructurallyRedefineClassDirect
     error = add_extension(
         reinterpret_cast<jvmtiExtensionFunction>(Redefiner::StructurallyRedefineClassDirect),
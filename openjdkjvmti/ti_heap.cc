@@ -16,7 +16,12 @@
 
 #include "ti_heap.h"
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
 #include <ios>
+#include <memory>
 #include <unordered_map>
 
 #include "android-base/logging.h"
@@ -63,6 +68,7 @@
 #include "stack.h"
 #include "thread-inl.h"
 #include "thread_list.h"
+#include "thread_pool.h"
 #include "ti_logging.h"
 #include "ti_stack.h"
 #include "ti_thread.h"
@@ -90,9 +96,10 @@ using IndexCachingTable = JvmtiWeakTable<IndexCache>;
 static IndexCachingTable gIndexCachingTable;
 
 // Report the contents of a string, if a callback is set.
+template <typename TagTable>
 jint ReportString(art::ObjPtr<art::mirror::Object> obj,
                   jvmtiEnv* env,
-                  ObjectTagTable* tag_table,
+                  TagTable* tag_table,
                   const jvmtiHeapCallbacks* cb,
                   const void* user_data) REQUIRES_SHARED(art::Locks::mutator_lock_) {
   if (UNLIKELY(cb->string_primitive_value_callback != nullptr) && obj->IsString()) {
@@ -142,9 +149,10 @@ jint ReportString(art::ObjPtr<art::mirror::Object> obj,
 }
 
 // Report the contents of a primitive array, if a callback is set.
+template <typename TagTable>
 jint ReportPrimitiveArray(art::ObjPtr<art::mirror::Object> obj,
                           jvmtiEnv* env,
-                          ObjectTagTable* tag_table,
+                          TagTable* tag_table,
                           const jvmtiHeapCallbacks* cb,
                           const void* user_data) REQUIRES_SHARED(art::Locks::mutator_lock_) {
   if (UNLIKELY(cb->array_primitive_value_callback != nullptr) &&
@@ -512,10 +520,11 @@ void DumpObjectFields(art::ObjPtr<art::mirror::Object> obj)
   }
 }
 
+template <typename TagTable>
 class ReportPrimitiveField {
  public:
   static bool Report(art::ObjPtr<art::mirror::Object> obj,
-                     ObjectTagTable* tag_table,
+                     TagTable* tag_table,
                      const jvmtiHeapCallbacks* cb,
                      const void* user_data)
       REQUIRES_SHARED(art::Locks::mutator_lock_) {
@@ -545,7 +554,7 @@ class ReportPrimitiveField {
 
 
  private:
-  ReportPrimitiveField(ObjectTagTable* tag_table,
+  ReportPrimitiveField(TagTable* tag_table,
                        jlong class_tag,
                        const jvmtiHeapCallbacks* cb,
                        const void* user_data)
@@ -631,7 +640,7 @@ class ReportPrimitiveField {
     return false;
   }
 
-  ObjectTagTable* tag_table_;
+  TagTable* tag_table_;
   jlong class_tag_;
   const jvmtiHeapCallbacks* cb_;
   const void* user_data_;
@@ -742,6 +751,66 @@ jvmtiError HeapUtil::IterateOverInstancesOfClass(jvmtiEnv* env,
   return OK;
 }
 
+// Reports one object of a heap iteration. Returns true if the iteration should be aborted.
+template <typename T, typename TagTable>
+static bool ReportHeapObject(T fn,
+                             art::mirror::Object* obj,
+                             jvmtiEnv* env,
+                             TagTable* tag_table,
+                             const HeapFilter& heap_filter,
+                             art::ObjPtr<art::mirror::Class> filter_klass,
+                             const jvmtiHeapCallbacks* callbacks,
+                             const void* user_data)
+    REQUIRES_SHARED(art::Locks::mutator_lock_) {
+  art::ScopedAssertNoThreadSuspension no_suspension("IterateThroughHeapCallback");
+
+  jlong tag = tag_table->GetTagOrZero(obj);
+
+  art::ObjPtr<art::mirror::Class> klass = obj->GetClass();
+  jlong class_tag = tag_table->GetTagOrZero(klass.Ptr());
+  // For simplicity, even if we find a tag = 0, assume 0 = not tagged.
+
+  if (!heap_filter.ShouldReportByHeapFilter(tag, class_tag)) {
+    return false;
+  }
+
+  if (filter_klass != nullptr) {
+    if (filter_klass != klass) {
+      return false;
+    }
+  }
+
+  jlong size = obj->SizeOf();
+
+  jint length = -1;
+  if (obj->IsArrayInstance()) {
+    length = obj->AsArray()->GetLength();
+  }
+
+  jlong saved_tag = tag;
+  jint ret = fn(obj, callbacks, class_tag, size, &tag, length, const_cast<void*>(user_data));
+
+  if (tag != saved_tag) {
+    tag_table->Set(obj, tag);
+  }
+
+  if ((ret & JVMTI_VISIT_ABORT) != 0) {
+    return true;
+  }
+
+  jint string_ret = ReportString(obj, env, tag_table, callbacks, user_data);
+  if ((string_ret & JVMTI_VISIT_ABORT) != 0) {
+    return true;
+  }
+
+  jint array_ret = ReportPrimitiveArray(obj, env, tag_table, callbacks, user_data);
+  if ((array_ret & JVMTI_VISIT_ABORT) != 0) {
+    return true;
+  }
+
+  return ReportPrimitiveField<TagTable>::Report(obj, tag_table, callbacks, user_data);
+}
+
 template <typename T>
 static jvmtiError DoIterateThroughHeap(T fn,
                                        jvmtiEnv* env,
@@ -765,58 +834,148 @@ static jvmtiError DoIterateThroughHeap(T fn,
     if (stop_reports) {
       return;
     }
+    stop_reports = ReportHeapObject(
+        fn, obj, env, tag_table, heap_filter, filter_klass, callbacks, user_data);
+  };
+  art::Runtime::Current()->GetHeap()->VisitObjects(visitor);
 
-    art::ScopedAssertNoThreadSuspension no_suspension("IterateThroughHeapCallback");
+  return ERR(NONE);
+}
 
+// Tags of a parallel heap iteration. The ObjectTagTable is locked by the thread running the
+// iteration and only read by the workers. Tags changed by the callbacks are kept in lock-striped
+// maps, which are consulted before the table, and are written back into the table at the end.
+class ParallelTagTable {
+ public:
+  explicit ParallelTagTable(ObjectTagTable* tag_table)
+      : tag_table_(tag_table), stripes_(new Stripe[kNumStripes]), num_updates_(0u) {}
+
+  jlong GetTagOrZero(art::ObjPtr<art::mirror::Object> obj) {
+    if (num_updates_.load(std::memory_order_acquire) != 0u) {
+      Stripe& stripe = GetStripe(obj);
+      art::MutexLock mu(art::Thread::Current(), stripe.lock);
+      auto it = stripe.updates.find(obj.Ptr());
+      if (it != stripe.updates.end()) {
+        return it->second;
+      }
+    }
     jlong tag = 0;
-    tag_table->GetTag(obj, &tag);
-
-    jlong class_tag = 0;
-    art::ObjPtr<art::mirror::Class> klass = obj->GetClass();
-    tag_table->GetTag(klass.Ptr(), &class_tag);
-    // For simplicity, even if we find a tag = 0, assume 0 = not tagged.
+    tag_table_->GetTagWithoutLock(obj, &tag);
+    return tag;
+  }
 
-    if (!heap_filter.ShouldReportByHeapFilter(tag, class_tag)) {
-      return;
+  void Set(art::ObjPtr<art::mirror::Object> obj, jlong tag) {
+    Stripe& stripe = GetStripe(obj);
+    art::MutexLock mu(art::Thread::Current(), stripe.lock);
+    if (stripe.updates.insert_or_assign(obj.Ptr(), tag).second) {
+      num_updates_.fetch_add(1u, std::memory_order_release);
     }
+  }
 
-    if (filter_klass != nullptr) {
-      if (filter_klass != klass) {
-        return;
+  // Writes the changed tags back into the table. Called once the workers are done.
+  void Flush() REQUIRES_SHARED(art::Locks::mutator_lock_)
+      REQUIRES(*tag_table_->GetAllowDisallowLock()) {
+    art::Thread* self = art::Thread::Current();
+    for (size_t i = 0; i != kNumStripes; ++i) {
+      art::MutexLock mu(self, stripes_[i].lock);
+      for (const auto& [obj, tag] : stripes_[i].updates) {
+        tag_table_->SetLocked(obj, tag);
       }
+      stripes_[i].updates.clear();
     }
+    num_updates_.store(0u, std::memory_order_relaxed);
+  }
 
-    jlong size = obj->SizeOf();
+ private:
+  static constexpr size_t kNumStripes = 64u;
 
-    jint length = -1;
-    if (obj->IsArrayInstance()) {
-      length = obj->AsArray()->GetLength();
-    }
+  struct Stripe {
+    Stripe() : lock("JVMTI parallel heap iteration tag lock", art::LockLevel::kGenericBottomLock) {}
 
-    jlong saved_tag = tag;
-    jint ret = fn(obj, callbacks, class_tag, size, &tag, length, const_cast<void*>(user_data));
+    art::Mutex lock;
+    std::unordered_map<art::mirror::Object*, jlong> updates GUARDED_BY(lock);
+  };
 
-    if (tag != saved_tag) {
-      tag_table->Set(obj, tag);
-    }
+  Stripe& GetStripe(art::ObjPtr<art::mirror::Object> obj) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(obj.Ptr());
+    return stripes_[(address >> art::kObjectAlignmentShift) % kNumStripes];
+  }
 
-    stop_reports = (ret & JVMTI_VISIT_ABORT) != 0;
+  ObjectTagTable* const tag_table_;
+  std::unique_ptr<Stripe[]> stripes_;
+  std::atomic<size_t> num_updates_;
+};
 
-    if (!stop_reports) {
-      jint string_ret = ReportString(obj, env, tag_table, callbacks, user_data);
-      stop_reports = (string_ret & JVMTI_VISIT_ABORT) != 0;
-    }
+// Like DoIterateThroughHeap, but the callbacks are called concurrently from `thread_count`
+// threads, one of which is the calling thread. The thread count is capped at the number of
+// processors. Objects are reported in no particular order.
+// An abort stops the other threads the next time they are about to report an object.
+template <typename T>
+static jvmtiError DoIterateThroughHeapParallel(T fn,
+                                               jvmtiEnv* env,
+                                               ObjectTagTable* tag_table,
+                                               jint heap_filter_int,
+                                               jclass klass,
+                                               const jvmtiHeapCallbacks* callbacks,
+                                               const void* user_data,
+                                               jint thread_count) {
+  if (callbacks == nullptr) {
+    return ERR(NULL_POINTER);
+  }
+  if (thread_count <= 0) {
+    return ERR(ILLEGAL_ARGUMENT);
+  }
+  // More threads than processors would only time-slice the same work and add workers to
+  // create and attach.
+  const jint num_processors = static_cast<jint>(sysconf(_SC_NPROCESSORS_CONF));
+  thread_count = std::min(thread_count, std::max(num_processors, 1));
+  if (thread_count == 1) {
+    return DoIterateThroughHeap(fn, env, tag_table, heap_filter_int, klass, callbacks, user_data);
+  }
 
-    if (!stop_reports) {
-      jint array_ret = ReportPrimitiveArray(obj, env, tag_table, callbacks, user_data);
-      stop_reports = (array_ret & JVMTI_VISIT_ABORT) != 0;
-    }
+  art::Thread* self = art::Thread::Current();
+  // Create the workers before taking the mutator lock, they need to attach to the runtime.
+  art::ThreadPool thread_pool("JVMTI heap iteration thread pool", thread_count - 1);
+  art::ScopedObjectAccess soa(self);
+  art::StackHandleScope<1> hs(self);
+  art::Handle<art::mirror::Class> filter_klass(
+      hs.NewHandle(soa.Decode<art::mirror::Class>(klass)));
+  const HeapFilter heap_filter(heap_filter_int);
+  std::atomic<bool> stop_reports(false);
 
-    if (!stop_reports) {
-      stop_reports = ReportPrimitiveField::Report(obj, tag_table, callbacks, user_data);
-    }
-  };
-  art::Runtime::Current()->GetHeap()->VisitObjects(visitor);
+  art::gc::Heap* heap = art::Runtime::Current()->GetHeap();
+  // As in Heap::VisitObjects, a concurrent moving GC must not run between the pauses.
+  bool disable_moving_gc = heap->IsGcConcurrentAndMoving();
+  if (disable_moving_gc) {
+    heap->IncrementDisableMovingGC(self);
+  }
+  {
+    art::ScopedThreadSuspension sts(self, art::kWaitingForVisitObjects);
+    art::ScopedSuspendAll ssa(__FUNCTION__);
+    tag_table->Lock();
+    ParallelTagTable parallel_tag_table(tag_table);
+    auto visitor = [&](art::mirror::Object* obj) NO_THREAD_SAFETY_ANALYSIS {
+      if (stop_reports.load(std::memory_order_relaxed)) {
+        return;
+      }
+      if (ReportHeapObject(fn,
+                           obj,
+                           env,
+                           &parallel_tag_table,
+                           heap_filter,
+                           filter_klass.Get(),
+                           callbacks,
+                           user_data)) {
+        stop_reports.store(true, std::memory_order_relaxed);
+      }
+    };
+    heap->VisitObjectsPausedParallel(&thread_pool, visitor);
+    parallel_tag_table.Flush();
+    tag_table->Unlock();
+  }
+  if (disable_moving_gc) {
+    heap->DecrementDisableMovingGC(self);
+  }
 
   return ERR(NONE);
 }
@@ -1150,7 +1309,8 @@ class FollowReferencesHelper final {
       return;
     }
 
-    stop_reports_ = ReportPrimitiveField::Report(obj, tag_table_, callbacks_, user_data_);
+    stop_reports_ =
+        ReportPrimitiveField<ObjectTagTable>::Report(obj, tag_table_, callbacks_, user_data_);
   }
 
   void VisitArray(art::mirror::Object* array)
@@ -1273,7 +1433,8 @@ class FollowReferencesHelper final {
       return;
     }
 
-    stop_reports_ = ReportPrimitiveField::Report(klass, tag_table_, callbacks_, user_data_);
+    stop_reports_ =
+        ReportPrimitiveField<ObjectTagTable>::Report(klass, tag_table_, callbacks_, user_data_);
   }
 
   void MaybeEnqueue(art::mirror::Object* obj) REQUIRES_SHARED(art::Locks::mutator_lock_) {
@@ -1611,86 +1772,126 @@ jvmtiError HeapExtensions::IterateThroughHeapExt(jvmtiEnv* env,
                               user_data);
 }
 
+jvmtiError HeapExtensions::IterateThroughHeapParallel(jvmtiEnv* env,
+                                                      jint heap_filter,
+                                                      jclass klass,
+                                                      const jvmtiHeapCallbacks* callbacks,
+                                                      const void* user_data,
+                                                      jint thread_count) {
+  if (ArtJvmTiEnv::AsArtJvmTiEnv(env)->capabilities.can_tag_objects != 1) {
+    return ERR(MUST_POSSESS_CAPABILITY);
+  }
+
+  auto JvmtiIterateHeap = [](art::mirror::Object* obj ATTRIBUTE_UNUSED,
+                             const jvmtiHeapCallbacks* cb_callbacks,
+                             jlong class_tag,
+                             jlong size,
+                             jlong* tag,
+                             jint length,
+                             void* cb_user_data)
+      REQUIRES_SHARED(art::Locks::mutator_lock_) {
+    return cb_callbacks->heap_iteration_callback(class_tag,
+                                                 size,
+                                                 tag,
+                                                 length,
+                                                 cb_user_data);
+  };
+  return DoIterateThroughHeapParallel(JvmtiIterateHeap,
+                                      env,
+                                      ArtJvmTiEnv::AsArtJvmTiEnv(env)->object_tag_table.get(),
+                                      heap_filter,
+                                      klass,
+                                      callbacks,
+                                      user_data,
+                                      thread_count);
+}
+
 namespace {
 
 using ObjectPtr = art::ObjPtr<art::mirror::Object>;
 using ObjectMap = std::unordered_map<ObjectPtr, ObjectPtr, art::HashObjPtr>;
 
-static void ReplaceObjectReferences(const ObjectMap& map)
+static void ReplaceObjectReferences(const ObjectMap& map, art::ThreadPool* thread_pool)
     REQUIRES(art::Locks::mutator_lock_,
              art::Roles::uninterruptible_) {
-  art::Runtime::Current()->GetHeap()->VisitObjectsPaused(
-      [&](art::mirror::Object* ref) REQUIRES_SHARED(art::Locks::mutator_lock_) {
-        // Rewrite all references in the object if needed.
-        class ResizeReferenceVisitor {
-         public:
-          using CompressedObj = art::mirror::CompressedReference<art::mirror::Object>;
-          explicit ResizeReferenceVisitor(const ObjectMap& map, ObjectPtr ref)
-              : map_(map), ref_(ref) {}
-
-          // Ignore class roots.
-          void VisitRootIfNonNull(CompressedObj* root) const
-              REQUIRES_SHARED(art::Locks::mutator_lock_) {
-            if (root != nullptr) {
-              VisitRoot(root);
-            }
-          }
-          void VisitRoot(CompressedObj* root) const REQUIRES_SHARED(art::Locks::mutator_lock_) {
-            auto it = map_.find(root->AsMirrorPtr());
-            if (it != map_.end()) {
-              root->Assign(it->second);
-              art::WriteBarrier::ForEveryFieldWrite(ref_);
-            }
-          }
+  // Each object only writes its own fields, so objects can be updated concurrently.
+  auto visitor = [&](art::mirror::Object* ref) REQUIRES_SHARED(art::Locks::mutator_lock_) {
+    // Rewrite all references in the object if needed.
+    class ResizeReferenceVisitor {
+     public:
+      using CompressedObj = art::mirror::CompressedReference<art::mirror::Object>;
+      explicit ResizeReferenceVisitor(const ObjectMap& map, ObjectPtr ref)
+          : map_(map), ref_(ref) {}
+
+      // Ignore class roots.
+      void VisitRootIfNonNull(CompressedObj* root) const
+          REQUIRES_SHARED(art::Locks::mutator_lock_) {
+        if (root != nullptr) {
+          VisitRoot(root);
+        }
+      }
+      void VisitRoot(CompressedObj* root) const REQUIRES_SHARED(art::Locks::mutator_lock_) {
+        auto it = map_.find(root->AsMirrorPtr());
+        if (it != map_.end()) {
+          root->Assign(it->second);
+          art::WriteBarrier::ForEveryFieldWrite(ref_);
+        }
+      }
 
-          void operator()(art::ObjPtr<art::mirror::Object> obj,
-                          art::MemberOffset off,
-                          bool is_static) const
-              REQUIRES_SHARED(art::Locks::mutator_lock_) {
-            auto it = map_.find(obj->GetFieldObject<art::mirror::Object>(off));
-            if (it != map_.end()) {
-              UNUSED(is_static);
-              if (UNLIKELY(!is_static && off == art::mirror::Object::ClassOffset())) {
-                // We don't want to update the declaring class of any objects. They will be replaced
-                // in the heap and we need the declaring class to know its size.
-                return;
-              } else if (UNLIKELY(!is_static && off == art::mirror::Class::SuperClassOffset() &&
-                                  obj->IsClass())) {
-                // We don't want to be messing with the class hierarcy either.
-                return;
-              }
-              VLOG(plugin) << "Updating field at offset " << off.Uint32Value() << " of type "
-                           << obj->GetClass()->PrettyClass();
-              obj->SetFieldObject</*transaction*/ false>(off, it->second);
-              art::WriteBarrier::ForEveryFieldWrite(obj);
-            }
+      void operator()(art::ObjPtr<art::mirror::Object> obj,
+                      art::MemberOffset off,
+                      bool is_static) const
+          REQUIRES_SHARED(art::Locks::mutator_lock_) {
+        auto it = map_.find(obj->GetFieldObject<art::mirror::Object>(off));
+        if (it != map_.end()) {
+          UNUSED(is_static);
+          if (UNLIKELY(!is_static && off == art::mirror::Object::ClassOffset())) {
+            // We don't want to update the declaring class of any objects. They will be replaced
+            // in the heap and we need the declaring class to know its size.
+            return;
+          } else if (UNLIKELY(!is_static && off == art::mirror::Class::SuperClassOffset() &&
+                              obj->IsClass())) {
+            // We don't want to be messing with the class hierarcy either.
+            return;
           }
+          VLOG(plugin) << "Updating field at offset " << off.Uint32Value() << " of type "
+                       << obj->GetClass()->PrettyClass();
+          obj->SetFieldObject</*transaction*/ false>(off, it->second);
+          art::WriteBarrier::ForEveryFieldWrite(obj);
+        }
+      }
 
-          // java.lang.ref.Reference visitor.
-          void operator()(art::ObjPtr<art::mirror::Class> klass ATTRIBUTE_UNUSED,
-                          art::ObjPtr<art::mirror::Reference> ref) const
-              REQUIRES_SHARED(art::Locks::mutator_lock_) {
-            operator()(ref, art::mirror::Reference::ReferentOffset(), /* is_static */ false);
-          }
+      // java.lang.ref.Reference visitor.
+      void operator()(art::ObjPtr<art::mirror::Class> klass ATTRIBUTE_UNUSED,
+                      art::ObjPtr<art::mirror::Reference> ref) const
+          REQUIRES_SHARED(art::Locks::mutator_lock_) {
+        operator()(ref, art::mirror::Reference::ReferentOffset(), /* is_static */ false);
+      }
 
-         private:
-          const ObjectMap& map_;
-          ObjectPtr ref_;
-        };
-
-        ResizeReferenceVisitor rrv(map, ref);
-        if (ref->IsClass()) {
-          // Class object native roots are the ArtField and ArtMethod 'declaring_class_' fields
-          // which we don't want to be messing with as it would break ref-visitor assumptions about
-          // what a class looks like. We want to keep the default behavior in other cases (such as
-          // dex-cache) though. Unfortunately there is no way to tell from the visitor where exactly
-          // the root came from.
-          // TODO It might be nice to have the visitors told where the reference came from.
-          ref->VisitReferences</*kVisitNativeRoots*/false>(rrv, rrv);
-        } else {
-          ref->VisitReferences</*kVisitNativeRoots*/true>(rrv, rrv);
-        }
-      });
+     private:
+      const ObjectMap& map_;
+      ObjectPtr ref_;
+    };
+
+    ResizeReferenceVisitor rrv(map, ref);
+    if (ref->IsClass()) {
+      // Class object native roots are the ArtField and ArtMethod 'declaring_class_' fields
+      // which we don't want to be messing with as it would break ref-visitor assumptions about
+      // what a class looks like. We want to keep the default behavior in other cases (such as
+      // dex-cache) though. Unfortunately there is no way to tell from the visitor where exactly
+      // the root came from.
+      // TODO It might be nice to have the visitors told where the reference came from.
+      ref->VisitReferences</*kVisitNativeRoots*/false>(rrv, rrv);
+    } else {
+      ref->VisitReferences</*kVisitNativeRoots*/true>(rrv, rrv);
+    }
+  };
+  art::gc::Heap* heap = art::Runtime::Current()->GetHeap();
+  if (thread_pool != nullptr) {
+    heap->VisitObjectsPausedParallel(thread_pool, visitor);
+  } else {
+    heap->VisitObjectsPaused(visitor);
+  }
 }
 
 static void ReplaceStrongRoots(art::Thread* self, const ObjectMap& map)
@@ -1878,8 +2079,10 @@ void HeapExtensions::ReplaceReference(art::Thread* self,
   ReplaceReferences(self, map);
 }
 
-void HeapExtensions::ReplaceReferences(art::Thread* self, const ObjectMap& map) {
-  ReplaceObjectReferences(map);
+void HeapExtensions::ReplaceReferences(art::Thread* self,
+                                       const ObjectMap& map,
+                                       art::ThreadPool* thread_pool) {
+  ReplaceObjectReferences(map, thread_pool);
   ReplaceStrongRoots(self, map);
   ReplaceWeakRoots(self, HeapExtensions::gEventHandler, map);
 }
@@ -25,6 +25,7 @@
 
 namespace art {
 class Thread;
+class ThreadPool;
 template<typename T> class ObjPtr;
 class HashObjPtr;
 namespace mirror {
@@ -89,13 +90,21 @@ class HeapExtensions {
                                                   const jvmtiHeapCallbacks* callbacks,
                                                   const void* user_data);
 
+  static jvmtiError JNICALL IterateThroughHeapParallel(jvmtiEnv* env,
+                                                       jint heap_filter,
+                                                       jclass klass,
+                                                       const jvmtiHeapCallbacks* callbacks,
+                                                       const void* user_data,
+                                                       jint thread_count);
+
   static jvmtiError JNICALL ChangeArraySize(jvmtiEnv* env, jobject arr, jsize new_size);
 
   static void ReplaceReferences(
       art::Thread* self,
       const std::unordered_map<art::ObjPtr<art::mirror::Object>,
                                art::ObjPtr<art::mirror::Object>,
-                               art::HashObjPtr>& refs)
+                               art::HashObjPtr>& refs,
+      art::ThreadPool* thread_pool = nullptr)
         REQUIRES(art::Locks::mutator_lock_, art::Roles::uninterruptible_);
 
   static void ReplaceReference(art::Thread* self,
@@ -58,6 +58,7 @@
 #include "base/length_prefixed_array.h"
 #include "base/locks.h"
 #include "base/stl_util.h"
+#include "base/time_utils.h"
 #include "base/utils.h"
 #include "class_linker-inl.h"
 #include "class_linker.h"
@@ -83,6 +84,7 @@
 #include "handle_scope.h"
 #include "instrumentation.h"
 #include "intern_table.h"
+#include "interpreter/method_interpreter_cache.h"
 #include "jit/jit.h"
 #include "jit/jit_code_cache.h"
 #include "jni/jni_env_ext-inl.h"
@@ -121,6 +123,7 @@
 #include "stack.h"
 #include "thread.h"
 #include "thread_list.h"
+#include "thread_pool.h"
 #include "ti_breakpoint.h"
 #include "ti_class_definition.h"
 #include "ti_class_loader.h"
@@ -547,10 +550,31 @@ Redefiner::ClassRedefinition::~ClassRedefinition() {
   }
 }
 
+Redefiner::Redefiner(ArtJvmTiEnv* env,
+                     art::Runtime* runtime,
+                     art::Thread* self,
+                     RedefinitionType type,
+                     std::string* error_msg,
+                     bool brief_pause)
+    : env_(env),
+      result_(ERR(INTERNAL)),
+      runtime_(runtime),
+      self_(self),
+      type_(type),
+      redefinitions_(),
+      error_msg_(error_msg),
+      brief_pause_(brief_pause),
+      heap_update_pool_(nullptr),
+      pause_time_ns_(0u) {}
+
+Redefiner::~Redefiner() {}
+
 template<RedefinitionType kType>
 jvmtiError Redefiner::RedefineClassesGeneric(jvmtiEnv* jenv,
                                              jint class_count,
-                                             const jvmtiClassDefinition* definitions) {
+                                             const jvmtiClassDefinition* definitions,
+                                             bool brief_pause,
+                                             jlong* pause_time_ns) {
   art::Runtime* runtime = art::Runtime::Current();
   art::Thread* self = art::Thread::Current();
   ArtJvmTiEnv* env = ArtJvmTiEnv::AsArtJvmTiEnv(jenv);
@@ -590,7 +614,8 @@ jvmtiError Redefiner::RedefineClassesGeneric(jvmtiEnv* jenv,
   if (kType == RedefinitionType::kStructural) {
     Transformer::RetransformClassesDirect<RedefinitionType::kNormal>(self, &def_vector);
   }
-  jvmtiError res = RedefineClassesDirect(env, runtime, self, def_vector, kType, &error_msg);
+  jvmtiError res = RedefineClassesDirect(
+      env, runtime, self, def_vector, kType, &error_msg, brief_pause, pause_time_ns);
   if (res != OK) {
     JVMTI_LOG(WARNING, env) << "FAILURE TO REDEFINE " << error_msg;
   }
@@ -609,6 +634,23 @@ jvmtiError Redefiner::StructurallyRedefineClasses(jvmtiEnv* jenv,
   return RedefineClassesGeneric<RedefinitionType::kStructural>(jenv, class_count, definitions);
 }
 
+jvmtiError Redefiner::StructurallyRedefineClassesBriefPause(jvmtiEnv* jenv,
+                                                            jint class_count,
+                                                            const jvmtiClassDefinition* definitions,
+                                                            jlong* pause_time_ns) {
+  ArtJvmTiEnv* art_env = ArtJvmTiEnv::AsArtJvmTiEnv(jenv);
+  if (art_env == nullptr) {
+    return ERR(INVALID_ENVIRONMENT);
+  } else if (art_env->capabilities.can_redefine_classes != 1) {
+    return ERR(MUST_POSSESS_CAPABILITY);
+  } else if (pause_time_ns == nullptr) {
+    return ERR(NULL_POINTER);
+  }
+  *pause_time_ns = 0;
+  return RedefineClassesGeneric<RedefinitionType::kStructural>(
+      jenv, class_count, definitions, /*brief_pause=*/ true, pause_time_ns);
+}
+
 jvmtiError Redefiner::RedefineClasses(jvmtiEnv* jenv,
                                       jint class_count,
                                       const jvmtiClassDefinition* definitions) {
@@ -652,7 +694,9 @@ jvmtiError Redefiner::RedefineClassesDirect(ArtJvmTiEnv* env,
                                             art::Thread* self,
                                             const std::vector<ArtClassDefinition>& definitions,
                                             RedefinitionType type,
-                                            std::string* error_msg) {
+                                            std::string* error_msg,
+                                            bool brief_pause,
+                                            jlong* pause_time_ns) {
   DCHECK(env != nullptr);
   if (definitions.size() == 0) {
     // We don't actually need to do anything. Just return OK.
@@ -669,7 +713,7 @@ jvmtiError Redefiner::RedefineClassesDirect(ArtJvmTiEnv* env,
   art::jit::ScopedJitSuspend suspend_jit;
   // Get shared mutator lock so we can lock all the classes.
   art::ScopedObjectAccess soa(self);
-  Redefiner r(env, runtime, self, type, error_msg);
+  Redefiner r(env, runtime, self, type, error_msg, brief_pause);
   for (const ArtClassDefinition& def : definitions) {
     // Only try to transform classes that have been modified.
     if (def.IsModified()) {
@@ -679,7 +723,11 @@ jvmtiError Redefiner::RedefineClassesDirect(ArtJvmTiEnv* env,
       }
     }
   }
-  return r.Run();
+  jvmtiError res = r.Run();
+  if (pause_time_ns != nullptr) {
+    *pause_time_ns = static_cast<jlong>(r.pause_time_ns_);
+  }
+  return res;
 }
 
 jvmtiError Redefiner::AddRedefinition(ArtJvmTiEnv* env, const ArtClassDefinition& def) {
@@ -2496,39 +2544,66 @@ jvmtiError Redefiner::Run() {
   }
   UnregisterAllBreakpoints();
 
+  size_t heap_update_threads = runtime_->GetHeap()->GetParallelGCThreadCount();
+  if (brief_pause_ && type_ == RedefinitionType::kStructural && heap_update_threads > 0u) {
+    // The workers have to be created before all threads are suspended.
+    heap_update_pool_.reset(
+        new art::ThreadPool("Redefinition heap update thread pool", heap_update_threads));
+  }
+
   {
     // Disable GC and wait for it to be done if we are a moving GC.  This is fine since we are done
     // allocating so no deadlocks.
     ScopedDisableConcurrentAndMovingGc sdcamgc(runtime_->GetHeap(), self_);
+    if (brief_pause_) {
+      // Objects no longer move, do as much of the structural updates as possible while the other
+      // threads are still running.
+      PrepareAllStructuralUpdates(holder);
+    }
 
     // Do transition to final suspension
     // TODO We might want to give this its own suspended state!
     // TODO This isn't right. We need to change state without any chance of suspend ideally!
     art::ScopedThreadSuspension sts(self_, art::ThreadState::kNative);
-    art::ScopedSuspendAll ssa("Final installation of redefined Classes!", /*long_suspend=*/true);
-    for (RedefinitionDataIter data = holder.begin(); data != holder.end(); ++data) {
-      art::ScopedAssertNoThreadSuspension nts("Updating runtime objects for redefinition");
-      ClassRedefinition& redef = data.GetRedefinition();
-      if (data.GetSourceClassLoader() != nullptr) {
-        ClassLoaderHelper::UpdateJavaDexFile(data.GetJavaDexFile(), data.GetNewDexFileCookie());
+    uint64_t pause_start = art::NanoTime();
+    {
+      art::ScopedSuspendAll ssa("Final installation of redefined Classes!", /*long_suspend=*/true);
+      for (RedefinitionDataIter data = holder.begin(); data != holder.end(); ++data) {
+        art::ScopedAssertNoThreadSuspension nts("Updating runtime objects for redefinition");
+        ClassRedefinition& redef = data.GetRedefinition();
+        if (data.GetSourceClassLoader() != nullptr) {
+          ClassLoaderHelper::UpdateJavaDexFile(data.GetJavaDexFile(), data.GetNewDexFileCookie());
+        }
+        redef.UpdateClass(data);
       }
-      redef.UpdateClass(data);
-    }
-    RestoreObsoleteMethodMapsIfUnneeded(holder);
-    // TODO We should check for if any of the redefined methods are intrinsic methods here and, if
-    // any are, force a full-world deoptimization before finishing redefinition. If we don't do this
-    // then methods that have been jitted prior to the current redefinition being applied might
-    // continue to use the old versions of the intrinsics!
-    // TODO Do the dex_file release at a more reasonable place. This works but it muddles who really
-    // owns the DexFile and when ownership is transferred.
-    ReleaseAllDexFiles();
-  }
+      RestoreObsoleteMethodMapsIfUnneeded(holder);
+      // TODO We should check for if any of the redefined methods are intrinsic methods here and,
+      // if any are, force a full-world deoptimization before finishing redefinition. If we don't do
+      // this then methods that have been jitted prior to the current redefinition being applied
+      // might continue to use the old versions of the intrinsics!
+      // TODO Do the dex_file release at a more reasonable place. This works but it muddles who
+      // really owns the DexFile and when ownership is transferred.
+      ReleaseAllDexFiles();
+    }
+    // Taken once the threads are resumed, so that the time to suspend and resume them is included.
+    pause_time_ns_ = art::NanoTime() - pause_start;
+  }
+  VLOG(plugin) << "Redefinition suspended all threads for " << art::PrettyDuration(pause_time_ns_);
+  heap_update_pool_.reset();
   // By now the class-linker knows about all the classes so we can safetly retry verification and
   // update method flags.
   ReverifyClasses(holder);
   return OK;
 }
 
+void Redefiner::PrepareAllStructuralUpdates(RedefinitionDataHolder& holder) {
+  for (RedefinitionDataIter data = holder.begin(); data != holder.end(); ++data) {
+    if (data.IsInitialStructural()) {
+      data.GetRedefinition().PrepareStructuralUpdate(data);
+    }
+  }
+}
+
 void Redefiner::ReverifyClasses(RedefinitionDataHolder& holder) {
   for (RedefinitionDataIter data = holder.begin(); data != holder.end(); ++data) {
     data.GetRedefinition().ReverifyClass(data);
@@ -2638,6 +2713,31 @@ void Redefiner::ClassRedefinition::CollectNewFieldAndMethodMappings(
   }
 }
 
+void Redefiner::ClassRedefinition::CollectStructuralUpdatePlan(const RedefinitionDataIter& data,
+                                                              StructuralUpdatePlan* plan) {
+  CollectNewFieldAndMethodMappings(data, &plan->method_map, &plan->field_map);
+  std::unordered_map<art::mirror::Object*, art::mirror::Object*> class_map;
+  for (auto [new_class, old_class] :
+       art::ZipLeft(data.GetNewClasses()->Iterate(), data.GetOldClasses()->Iterate())) {
+    plan->replacements.emplace_back(old_class.Ptr(), new_class.Ptr());
+    class_map.emplace(old_class.Ptr(), new_class.Ptr());
+  }
+  for (auto [new_instance, old_instance] : art::ZipLeft(data.GetNewInstanceObjects()->Iterate(),
+                                                        data.GetOldInstanceObjects()->Iterate())) {
+    plan->replacements.emplace_back(old_instance.Ptr(), new_instance.Ptr());
+    // Bare-bones check that the mapping is correct.
+    CHECK(new_instance->GetClass().Ptr() == class_map[old_instance->GetClass().Ptr()])
+        << new_instance->GetClass()->PrettyClass() << " vs "
+        << class_map[old_instance->GetClass().Ptr()]->AsClass()->PrettyClass();
+  }
+}
+
+void Redefiner::ClassRedefinition::PrepareStructuralUpdate(const RedefinitionDataIter& data) {
+  DCHECK(data.IsInitialStructural());
+  structural_plan_.reset(new StructuralUpdatePlan());
+  CollectStructuralUpdatePlan(data, structural_plan_.get());
+}
+
 static void CopyField(art::ObjPtr<art::mirror::Object> target,
                       art::ArtField* new_field,
                       art::ObjPtr<art::mirror::Object> source,
@@ -2763,10 +2863,15 @@ void Redefiner::ClassRedefinition::UpdateClassStructurally(const RedefinitionDat
   art::ScopedAssertNoThreadSuspension sants(__FUNCTION__);
   art::ObjPtr<art::mirror::ObjectArray<art::mirror::Class>> new_classes(holder.GetNewClasses());
   art::ObjPtr<art::mirror::ObjectArray<art::mirror::Class>> old_classes(holder.GetOldClasses());
-  // Collect mappings from old to new fields/methods
-  std::map<art::ArtMethod*, art::ArtMethod*> method_map;
-  std::map<art::ArtField*, art::ArtField*> field_map;
-  CollectNewFieldAndMethodMappings(holder, &method_map, &field_map);
+  // Collect mappings from old to new fields/methods and the objects to replace, unless it was
+  // done before all threads were suspended.
+  std::unique_ptr<StructuralUpdatePlan> plan(std::move(structural_plan_));
+  if (plan == nullptr) {
+    plan.reset(new StructuralUpdatePlan());
+    CollectStructuralUpdatePlan(holder, plan.get());
+  }
+  const std::map<art::ArtMethod*, art::ArtMethod*>& method_map = plan->method_map;
+  const std::map<art::ArtField*, art::ArtField*>& field_map = plan->field_map;
   art::ObjPtr<art::mirror::ObjectArray<art::mirror::Object>> new_instances(
       holder.GetNewInstanceObjects());
   art::ObjPtr<art::mirror::ObjectArray<art::mirror::Object>> old_instances(
@@ -2927,22 +3032,15 @@ void Redefiner::ClassRedefinition::UpdateClassStructurally(const RedefinitionDat
   std::unordered_map<art::ObjPtr<art::mirror::Object>,
                      art::ObjPtr<art::mirror::Object>,
                      art::HashObjPtr> map;
-  for (auto [new_class, old_class] : art::ZipLeft(new_classes->Iterate(), old_classes->Iterate())) {
-    map.emplace(old_class, new_class);
-  }
-  for (auto [new_instance, old_instance] :
-       art::ZipLeft(new_instances->Iterate(), old_instances->Iterate())) {
-    map.emplace(old_instance, new_instance);
-    // Bare-bones check that the mapping is correct.
-    CHECK(new_instance->GetClass() == map[old_instance->GetClass()]->AsClass())
-        << new_instance->GetClass()->PrettyClass() << " vs "
-        << map[old_instance->GetClass()]->AsClass()->PrettyClass();
+  map.reserve(plan->replacements.size());
+  for (const auto& [old_object, new_object] : plan->replacements) {
+    map.emplace(old_object, new_object);
   }
 
   // Actually perform the general replacement. This doesn't affect ArtMethod/ArtFields. It does
   // affect the declaring_class field of all the obsolete objects, which is unfortunate and needs to
   // be undone. This replaces the mirror::Class in 'holder' as well. It's magic!
-  HeapExtensions::ReplaceReferences(driver_->self_, map);
+  HeapExtensions::ReplaceReferences(driver_->self_, map, driver_->heap_update_pool_.get());
 
   // Save the old class so that the JIT gc doesn't get confused by it being collected before the
   // jit code. This is also needed to keep the dex-caches of any obsolete methods live.
@@ -2967,6 +3065,9 @@ void Redefiner::ClassRedefinition::UpdateClassStructurally(const RedefinitionDat
     driver_->runtime_->GetThreadList()->ForEach(
         [](art::Thread* t) { t->GetInterpreterCache()->Clear(t); });
   }
+  if (driver_->runtime_->GetMethodInterpreterCaches() != nullptr) {
+    driver_->runtime_->GetMethodInterpreterCaches()->ClearAllTables(driver_->self_);
+  }
 
   if (art::kIsDebugBuild) {
     // Just make sure we didn't screw up any of the now obsolete methods or fields. We need their
@@ -3025,6 +3126,18 @@ void Redefiner::ClassRedefinition::UpdateClassInPlace(const RedefinitionDataIter
   mclass->SetDexClassDefIndex(dex_file_->GetIndexForClassDef(class_def));
   mclass->SetDexTypeIndex(dex_file_->GetIndexForTypeId(*dex_file_->FindTypeId(class_sig_.c_str())));
 
+  // The methods keep their ArtMethod but get a new code item, so the interpreter tables indexed
+  // by the dex pcs of the old code must go.
+  art::interpreter::MethodInterpreterCaches* method_caches =
+      driver_->runtime_->GetMethodInterpreterCaches();
+  if (method_caches != nullptr) {
+    art::PointerSize image_pointer_size =
+        driver_->runtime_->GetClassLinker()->GetImagePointerSize();
+    for (art::ArtMethod& method : mclass->GetDeclaredMethods(image_pointer_size)) {
+      method_caches->RemoveTables(driver_->self_, &method);
+    }
+  }
+
   // Notify the jit that all the methods in this class were redefined. Need to do this last since
   // the jit relies on the dex_file_ being correct (for native methods at least) to find the method
   // meta-data.
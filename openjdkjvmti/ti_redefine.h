@@ -33,7 +33,11 @@
 #define ART_OPENJDKJVMTI_TI_REDEFINE_H_
 
 #include <functional>
+#include <map>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <jni.h>
 
@@ -53,6 +57,7 @@
 
 namespace art {
 class ClassAccessor;
+class ThreadPool;
 namespace dex {
 struct ClassDef;
 }  // namespace dex
@@ -76,12 +81,19 @@ class Redefiner {
   // of the dex_data pointers. It is not used after this call however and may be freed if desired.
   // The caller is responsible for freeing it. The runtime makes its own copy of the data. This
   // function does not call the transformation events.
+  //
+  // With brief_pause, structural redefinitions compute the updates of the runtime state before
+  // suspending all threads and rewrite the heap with several threads, which shortens the time all
+  // threads are suspended. If pause_time_ns is not null, the duration of the suspension is stored
+  // in it.
   static jvmtiError RedefineClassesDirect(ArtJvmTiEnv* env,
                                           art::Runtime* runtime,
                                           art::Thread* self,
                                           const std::vector<ArtClassDefinition>& definitions,
                                           RedefinitionType type,
-                                          /*out*/std::string* error_msg);
+                                          /*out*/std::string* error_msg,
+                                          bool brief_pause = false,
+                                          /*out*/jlong* pause_time_ns = nullptr);
 
   // Redefine the given classes with the given dex data. Note this function does not take ownership
   // of the dex_data pointers. It is not used after this call however and may be freed if desired.
@@ -92,6 +104,12 @@ class Redefiner {
   static jvmtiError StructurallyRedefineClasses(jvmtiEnv* env,
                                                 jint class_count,
                                                 const jvmtiClassDefinition* definitions);
+  // StructurallyRedefineClasses with a brief pause, see RedefineClassesDirect. Stores the time all
+  // threads were suspended in pause_time_ns.
+  static jvmtiError StructurallyRedefineClassesBriefPause(jvmtiEnv* env,
+                                                          jint class_count,
+                                                          const jvmtiClassDefinition* definitions,
+                                                          jlong* pause_time_ns);
 
   static jvmtiError IsModifiableClass(jvmtiEnv* env, jclass klass, jboolean* is_redefinable);
   static jvmtiError IsStructurallyModifiableClass(jvmtiEnv* env,
@@ -132,6 +150,7 @@ class Redefiner {
       dex_file_ = std::move(other.dex_file_);
       class_sig_ = std::move(other.class_sig_);
       original_dex_file_ = other.original_dex_file_;
+      structural_plan_ = std::move(other.structural_plan_);
       other.driver_ = nullptr;
       return *this;
     }
@@ -142,7 +161,8 @@ class Redefiner {
           klass_(other.klass_),
           dex_file_(std::move(other.dex_file_)),
           class_sig_(std::move(other.class_sig_)),
-          original_dex_file_(other.original_dex_file_) {
+          original_dex_file_(other.original_dex_file_),
+          structural_plan_(std::move(other.structural_plan_)) {
       other.driver_ = nullptr;
     }
 
@@ -249,7 +269,12 @@ class Redefiner {
     void CollectNewFieldAndMethodMappings(const RedefinitionDataIter& data,
                                           std::map<art::ArtMethod*, art::ArtMethod*>* method_map,
                                           std::map<art::ArtField*, art::ArtField*>* field_map)
-        REQUIRES(art::Locks::mutator_lock_);
+        REQUIRES_SHARED(art::Locks::mutator_lock_);
+
+    // Computes the structural update of the class before all threads are suspended. Moving GC
+    // must be disabled until the update is done.
+    void PrepareStructuralUpdate(const RedefinitionDataIter& data)
+        REQUIRES_SHARED(art::Locks::mutator_lock_);
 
     void RestoreObsoleteMethodMapsIfUnneeded(const RedefinitionDataIter* cur_data)
         REQUIRES(art::Locks::mutator_lock_);
@@ -277,6 +302,20 @@ class Redefiner {
     }
 
    private:
+    // The parts of a structural update that do not depend on other threads being suspended.
+    struct StructuralUpdatePlan {
+      std::map<art::ArtMethod*, art::ArtMethod*> method_map;
+      std::map<art::ArtField*, art::ArtField*> field_map;
+      // The objects to replace and their replacements. Raw pointers since the plan is kept across
+      // the suspension of the redefining thread, the objects do not move while moving GC is
+      // disabled.
+      std::vector<std::pair<art::mirror::Object*, art::mirror::Object*>> replacements;
+    };
+
+    void CollectStructuralUpdatePlan(const RedefinitionDataIter& data,
+                                     /*out*/StructuralUpdatePlan* plan)
+        REQUIRES_SHARED(art::Locks::mutator_lock_);
+
     void UpdateClassStructurally(const RedefinitionDataIter& cur_data)
         REQUIRES(art::Locks::mutator_lock_);
 
@@ -289,6 +328,9 @@ class Redefiner {
     std::string class_sig_;
     art::ArrayRef<const unsigned char> original_dex_file_;
 
+    // Set by PrepareStructuralUpdate() in brief pause mode.
+    std::unique_ptr<StructuralUpdatePlan> structural_plan_;
+
     bool added_fields_ = false;
     bool added_methods_ = false;
     bool has_virtuals_ = false;
@@ -307,19 +349,20 @@ class Redefiner {
   // Kept as a jclass since we have weird run-state changes that make keeping it around as a
   // mirror::Class difficult and confusing.
   std::string* error_msg_;
+  const bool brief_pause_;
+  // Workers for the heap update in brief pause mode, created before all threads are suspended.
+  std::unique_ptr<art::ThreadPool> heap_update_pool_;
+  // Duration of the suspension of all threads.
+  uint64_t pause_time_ns_;
 
   Redefiner(ArtJvmTiEnv* env,
             art::Runtime* runtime,
             art::Thread* self,
             RedefinitionType type,
-            std::string* error_msg)
-      : env_(env),
-        result_(ERR(INTERNAL)),
-        runtime_(runtime),
-        self_(self),
-        type_(type),
-        redefinitions_(),
-        error_msg_(error_msg) { }
+            std::string* error_msg,
+            bool brief_pause);
+
+  ~Redefiner();
 
   jvmtiError AddRedefinition(ArtJvmTiEnv* env, const ArtClassDefinition& def)
       REQUIRES_SHARED(art::Locks::mutator_lock_);
@@ -327,7 +370,9 @@ class Redefiner {
   template<RedefinitionType kType = RedefinitionType::kNormal>
   static jvmtiError RedefineClassesGeneric(jvmtiEnv* env,
                                            jint class_count,
-                                           const jvmtiClassDefinition* definitions);
+                                           const jvmtiClassDefinition* definitions,
+                                           bool brief_pause = false,
+                                           /*out*/jlong* pause_time_ns = nullptr);
 
   template<RedefinitionType kType = RedefinitionType::kNormal>
   static jvmtiError IsModifiableClassGeneric(jvmtiEnv* env, jclass klass, jboolean* is_redefinable);
@@ -352,6 +397,8 @@ class Redefiner {
       REQUIRES_SHARED(art::Locks::mutator_lock_);
   bool CollectAndCreateNewInstances(RedefinitionDataHolder& holder)
       REQUIRES_SHARED(art::Locks::mutator_lock_);
+  void PrepareAllStructuralUpdates(RedefinitionDataHolder& holder)
+      REQUIRES_SHARED(art::Locks::mutator_lock_);
   void ReleaseAllDexFiles() REQUIRES_SHARED(art::Locks::mutator_lock_);
   void ReverifyClasses(RedefinitionDataHolder& holder) REQUIRES_SHARED(art::Locks::mutator_lock_);
   void UnregisterAllBreakpoints() REQUIRES_SHARED(art::Locks::mutator_lock_);
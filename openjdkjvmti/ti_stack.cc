@@ -32,9 +32,12 @@
 #include "ti_stack.h"
 
 #include <algorithm>
+#include <atomic>
 #include <initializer_list>
 #include <list>
+#include <new>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "android-base/macros.h"
@@ -321,6 +324,52 @@ jvmtiError StackUtil::GetStackTrace(jvmtiEnv* jvmti_env,
   }
 }
 
+// Puts the stack infos of the given threads and their frames into one allocation, as the spec of
+// GetAllStackTraces requires. The peers are global references, they are returned as local
+// references.
+static jvmtiError PackStackInfos(
+    jvmtiEnv* env,
+    art::Thread* current,
+    const std::vector<jthread>& peers,
+    const std::vector<std::pair<const jvmtiFrameInfo*, size_t>>& frames,
+    /* out */ jvmtiStackInfo** stack_info_ptr) {
+  DCHECK_EQ(peers.size(), frames.size());
+  size_t sum_frames = 0;
+  for (const std::pair<const jvmtiFrameInfo*, size_t>& thread_frames : frames) {
+    sum_frames += thread_frames.second;
+  }
+  size_t rounded_stack_info_size = art::RoundUp(sizeof(jvmtiStackInfo) * frames.size(),
+                                                alignof(jvmtiFrameInfo));
+  size_t chunk_size = rounded_stack_info_size + sum_frames * sizeof(jvmtiFrameInfo);
+  unsigned char* chunk_data;
+  jvmtiError alloc_result = env->Allocate(chunk_size, &chunk_data);
+  if (alloc_result != ERR(NONE)) {
+    return alloc_result;
+  }
+
+  jvmtiStackInfo* stack_info = reinterpret_cast<jvmtiStackInfo*>(chunk_data);
+  jvmtiFrameInfo* frame_info = reinterpret_cast<jvmtiFrameInfo*>(
+      chunk_data + rounded_stack_info_size);
+  JNIEnv* jni_env = current->GetJniEnv();
+  for (size_t i = 0; i < frames.size(); ++i) {
+    jvmtiStackInfo& new_stack_info = stack_info[i];
+    memset(&new_stack_info, 0, sizeof(jvmtiStackInfo));
+    // Translate the global ref into a local ref.
+    new_stack_info.thread = jni_env->NewLocalRef(peers[i]);
+    new_stack_info.state = JVMTI_THREAD_STATE_SUSPENDED;
+    new_stack_info.frame_count = static_cast<jint>(frames[i].second);
+    if (frames[i].second > 0) {
+      // Only copy when there's data - leave the nullptr alone.
+      memcpy(frame_info, frames[i].first, frames[i].second * sizeof(jvmtiFrameInfo));
+      new_stack_info.frame_buffer = frame_info;
+      frame_info += frames[i].second;
+    }
+  }
+
+  *stack_info_ptr = stack_info;
+  return ERR(NONE);
+}
+
 template <typename Data>
 struct GetAllStackTracesVectorClosure : public art::Closure {
   GetAllStackTracesVectorClosure(size_t stop, Data* data_)
@@ -428,87 +477,239 @@ jvmtiError StackUtil::GetAllStackTraces(jvmtiEnv* env,
   }
 
   // Convert the data into our output format.
+  std::vector<std::pair<const jvmtiFrameInfo*, size_t>> frames;
+  frames.reserve(data.frames.size());
+  for (const std::unique_ptr<std::vector<jvmtiFrameInfo>>& thread_frames : data.frames) {
+    size_t collected_frames = (max_frame_count == 0) ? 0u : thread_frames->size();
+    DCHECK_LE(collected_frames, static_cast<size_t>(max_frame_count));
+    frames.emplace_back(thread_frames->data(), collected_frames);
+  }
+  jvmtiError result = PackStackInfos(env, current, data.thread_peers, frames, stack_info_ptr);
+  if (result != ERR(NONE)) {
+    return result;
+  }
+  *thread_count_ptr = static_cast<jint>(data.frames.size());
 
-  // Note: we use an array of jvmtiStackInfo for convenience. The spec says we need to
-  //       allocate one big chunk for this and the actual frames, which means we need
-  //       to either be conservative or rearrange things later (the latter is implemented).
-  std::unique_ptr<jvmtiStackInfo[]> stack_info_array(new jvmtiStackInfo[data.frames.size()]);
-  std::vector<std::unique_ptr<jvmtiFrameInfo[]>> frame_infos;
-  frame_infos.reserve(data.frames.size());
-
-  // Now run through and add data for each thread.
-  size_t sum_frames = 0;
-  for (size_t index = 0; index < data.frames.size(); ++index) {
-    jvmtiStackInfo& stack_info = stack_info_array.get()[index];
-    memset(&stack_info, 0, sizeof(jvmtiStackInfo));
+  return ERR(NONE);
+}
 
-    const std::vector<jvmtiFrameInfo>& thread_frames = *data.frames[index].get();
+// Slots allocated by GetAllStackTracesAsync in addition to one per registered thread.
+static constexpr size_t kAsyncStackTracesExtraSlots = 16u;
+// Maximum number of frames GetAllStackTracesAsync allocates for all slots together (64MB).
+static constexpr size_t kAsyncStackTracesMaxFrames = 4u * art::MB;
 
-    // For the time being, set the thread to null. We'll fix it up in the second stage.
-    stack_info.thread = nullptr;
-    stack_info.state = JVMTI_THREAD_STATE_SUSPENDED;
-
-    size_t collected_frames = thread_frames.size();
-    if (max_frame_count == 0 || collected_frames == 0) {
-      stack_info.frame_count = 0;
-      stack_info.frame_buffer = nullptr;
-      continue;
+// Checkpoint for GetAllStackTracesAsync. Each thread walks its own stack when it reaches its
+// next suspend point and publishes it into a slot preallocated by the requesting thread. The
+// requesting thread only waits until a deadline and then takes the published slots, so the
+// closure is reference counted: threads that run it late still use it after the request returned.
+class AsyncStackTracesClosure final : public art::Closure {
+ public:
+  // Returns null if the buffers for `num_slots` stacks of `max_frame_count` frames would exceed
+  // kAsyncStackTracesMaxFrames (ILLEGAL_ARGUMENT), or cannot be allocated (OUT_OF_MEMORY).
+  static AsyncStackTracesClosure* Create(size_t num_slots,
+                                         size_t max_frame_count,
+                                         /*out*/ jvmtiError* error) {
+    if (max_frame_count != 0u && num_slots > kAsyncStackTracesMaxFrames / max_frame_count) {
+      *error = ERR(ILLEGAL_ARGUMENT);
+      return nullptr;
     }
-    DCHECK_LE(collected_frames, static_cast<size_t>(max_frame_count));
+    std::unique_ptr<Slot[]> slots(new (std::nothrow) Slot[num_slots]);
+    std::unique_ptr<jvmtiFrameInfo[]> frames(
+        new (std::nothrow) jvmtiFrameInfo[num_slots * max_frame_count]);
+    AsyncStackTracesClosure* closure = nullptr;
+    if (slots != nullptr && frames != nullptr) {
+      closure = new (std::nothrow) AsyncStackTracesClosure(
+          num_slots, max_frame_count, std::move(slots), std::move(frames));
+    }
+    if (closure == nullptr) {
+      *error = ERR(OUT_OF_MEMORY);
+    }
+    return closure;
+  }
 
-    jvmtiFrameInfo* frame_info = new jvmtiFrameInfo[collected_frames];
-    frame_infos.emplace_back(frame_info);
+  void Run(art::Thread* thread) override REQUIRES_SHARED(art::Locks::mutator_lock_) {
+    art::Thread* self = art::Thread::Current();
+    if (thread->IsStillStarting()) {
+      num_starting_.fetch_add(1u, std::memory_order_relaxed);
+    } else if (!closed_.load(std::memory_order_acquire)) {
+      Publish(self, thread);
+    }
+    barrier_.Pass(self);
+    Release(self);
+  }
 
-    jint count;
-    jvmtiError translate_result = TranslateFrameVector(thread_frames,
-                                                       0,
-                                                       0,
-                                                       static_cast<jint>(collected_frames),
-                                                       frame_info,
-                                                       &count);
-    DCHECK(translate_result == JVMTI_ERROR_NONE);
-    stack_info.frame_count = static_cast<jint>(collected_frames);
-    stack_info.frame_buffer = frame_info;
-    sum_frames += static_cast<size_t>(count);
+  // Requests the checkpoint on all threads and waits up to `timeout_ms` for them to run it.
+  // Returns the number of threads that were asked to run it.
+  size_t RequestAndWait(art::Thread* self, uint32_t timeout_ms)
+      REQUIRES_SHARED(art::Locks::mutator_lock_) {
+    size_t barrier_count = art::Runtime::Current()->GetThreadList()->RunCheckpoint(this, nullptr);
+    // Keep one reference for the requesting thread and one for each thread that has yet to run
+    // the checkpoint. The bias kept the count positive for threads that already ran it.
+    references_.fetch_sub(kReferenceBias - barrier_count - 1u, std::memory_order_acq_rel);
+    if (barrier_count != 0u) {
+      art::ScopedThreadStateChange tsc(self, art::ThreadState::kWaitingForCheckPointsToRun);
+      barrier_.Increment(self, static_cast<int>(barrier_count), timeout_ms);
+    }
+    // Threads that run the checkpoint from now on do not walk their stacks anymore.
+    closed_.store(true, std::memory_order_release);
+    return barrier_count;
+  }
+
+  // Takes the stacks published before the deadline.
+  void TakeReadySlots(std::vector<jthread>* peers,
+                      std::vector<std::pair<const jvmtiFrameInfo*, size_t>>* frames) {
+    size_t num_claimed = std::min(next_slot_.load(std::memory_order_acquire), num_slots_);
+    for (size_t i = 0; i != num_claimed; ++i) {
+      SlotState expected = SlotState::kReady;
+      // A slot still being written when the deadline passed is left to its thread.
+      if (slots_[i].state.compare_exchange_strong(expected,
+                                                  SlotState::kTaken,
+                                                  std::memory_order_acquire)) {
+        peers->push_back(slots_[i].peer);
+        frames->emplace_back(&frames_[i * max_frame_count_], slots_[i].frame_count);
+      }
+    }
   }
 
-  // No errors, yet. Now put it all into an output buffer.
-  size_t rounded_stack_info_size = art::RoundUp(sizeof(jvmtiStackInfo) * data.frames.size(),
-                                                alignof(jvmtiFrameInfo));
-  size_t chunk_size = rounded_stack_info_size + sum_frames * sizeof(jvmtiFrameInfo);
-  unsigned char* chunk_data;
-  jvmtiError alloc_result = env->Allocate(chunk_size, &chunk_data);
-  if (alloc_result != ERR(NONE)) {
-    return alloc_result;
+  size_t GetNumStarting() const {
+    return num_starting_.load(std::memory_order_relaxed);
   }
 
-  jvmtiStackInfo* stack_info = reinterpret_cast<jvmtiStackInfo*>(chunk_data);
-  // First copy in all the basic data.
-  memcpy(stack_info, stack_info_array.get(), sizeof(jvmtiStackInfo) * data.frames.size());
+  void Release(art::Thread* self) {
+    if (references_.fetch_sub(1u, std::memory_order_acq_rel) == 1u) {
+      art::JavaVMExt* vm = art::Runtime::Current()->GetJavaVM();
+      for (size_t i = 0; i != num_slots_; ++i) {
+        if (slots_[i].peer != nullptr) {
+          vm->DeleteGlobalRef(self, slots_[i].peer);
+        }
+      }
+      delete this;
+    }
+  }
 
-  // Now copy the frames and fix up the pointers.
-  jvmtiFrameInfo* frame_info = reinterpret_cast<jvmtiFrameInfo*>(
-      chunk_data + rounded_stack_info_size);
-  for (size_t i = 0; i < data.frames.size(); ++i) {
-    jvmtiStackInfo& old_stack_info = stack_info_array.get()[i];
-    jvmtiStackInfo& new_stack_info = stack_info[i];
+ private:
+  enum class SlotState : uint32_t {
+    kFree,
+    kWriting,
+    kReady,
+    kTaken,
+  };
 
-    // Translate the global ref into a local ref.
-    new_stack_info.thread =
-        static_cast<JNIEnv*>(current->GetJniEnv())->NewLocalRef(data.thread_peers[i]);
+  struct Slot {
+    std::atomic<SlotState> state;
+    jthread peer;
+    size_t frame_count;
+  };
 
-    if (old_stack_info.frame_count > 0) {
-      // Only copy when there's data - leave the nullptr alone.
-      size_t frames_size = static_cast<size_t>(old_stack_info.frame_count) * sizeof(jvmtiFrameInfo);
-      memcpy(frame_info, old_stack_info.frame_buffer, frames_size);
-      new_stack_info.frame_buffer = frame_info;
-      frame_info += old_stack_info.frame_count;
+  // Larger than any number of threads.
+  static constexpr size_t kReferenceBias = static_cast<size_t>(1u) << 30;
+
+  AsyncStackTracesClosure(size_t num_slots,
+                          size_t max_frame_count,
+                          std::unique_ptr<Slot[]> slots,
+                          std::unique_ptr<jvmtiFrameInfo[]> frames)
+      : barrier_(0),
+        references_(kReferenceBias),
+        closed_(false),
+        next_slot_(0u),
+        num_starting_(0u),
+        num_slots_(num_slots),
+        max_frame_count_(max_frame_count),
+        slots_(std::move(slots)),
+        frames_(std::move(frames)) {
+    for (size_t i = 0; i != num_slots; ++i) {
+      slots_[i].state.store(SlotState::kFree, std::memory_order_relaxed);
+      slots_[i].peer = nullptr;
+      slots_[i].frame_count = 0u;
     }
   }
 
-  *stack_info_ptr = stack_info;
-  *thread_count_ptr = static_cast<jint>(data.frames.size());
+  void Publish(art::Thread* self, art::Thread* thread)
+      REQUIRES_SHARED(art::Locks::mutator_lock_) {
+    size_t index = next_slot_.fetch_add(1u, std::memory_order_relaxed);
+    if (index >= num_slots_) {
+      // The thread was created after the slots were allocated.
+      return;
+    }
+    Slot& slot = slots_[index];
+    slot.state.store(SlotState::kWriting, std::memory_order_relaxed);
+    jvmtiFrameInfo* thread_frames = &frames_[index * max_frame_count_];
+    size_t frame_count = 0u;
+    if (max_frame_count_ != 0u) {
+      auto frames_fn = [&](jvmtiFrameInfo info) {
+        thread_frames[frame_count++] = info;
+      };
+      auto visitor = MakeStackTraceVisitor(thread, 0u, max_frame_count_, frames_fn);
+      visitor.WalkStack(/* include_transitions= */ false);
+    }
+    slot.peer = art::Runtime::Current()->GetJavaVM()->AddGlobalRef(
+        self, thread->GetPeerFromOtherThread());
+    slot.frame_count = frame_count;
+    slot.state.store(SlotState::kReady, std::memory_order_release);
+  }
+
+  art::Barrier barrier_;
+  std::atomic<size_t> references_;
+  std::atomic<bool> closed_;
+  std::atomic<size_t> next_slot_;
+  std::atomic<size_t> num_starting_;
+  const size_t num_slots_;
+  const size_t max_frame_count_;
+  const std::unique_ptr<Slot[]> slots_;
+  const std::unique_ptr<jvmtiFrameInfo[]> frames_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncStackTracesClosure);
+};
+
+jvmtiError StackUtil::GetAllStackTracesAsync(jvmtiEnv* env,
+                                             jint max_frame_count,
+                                             jint timeout_ms,
+                                             jvmtiStackInfo** stack_info_ptr,
+                                             jint* thread_count_ptr,
+                                             jint* missed_thread_count_ptr) {
+  if (max_frame_count < 0 || timeout_ms < 0) {
+    return ERR(ILLEGAL_ARGUMENT);
+  }
+  if (stack_info_ptr == nullptr || thread_count_ptr == nullptr) {
+    return ERR(NULL_POINTER);
+  }
 
+  art::Thread* current = art::Thread::Current();
+  art::ThreadList* thread_list = art::Runtime::Current()->GetThreadList();
+  size_t num_slots;
+  {
+    art::MutexLock mu(current, *art::Locks::thread_list_lock_);
+    // Leave some room for threads that attach before the checkpoint is requested.
+    num_slots = thread_list->GetList().size() + kAsyncStackTracesExtraSlots;
+  }
+  // Allocate the buffers up front, so that the threads only walk their stacks in the checkpoint.
+  jvmtiError result = ERR(NONE);
+  AsyncStackTracesClosure* closure = AsyncStackTracesClosure::Create(
+      num_slots, static_cast<size_t>(max_frame_count), &result);
+  if (closure == nullptr) {
+    return result;
+  }
+  std::vector<jthread> peers;
+  std::vector<std::pair<const jvmtiFrameInfo*, size_t>> frames;
+  size_t num_missed;
+  {
+    art::ScopedObjectAccess soa(current);
+    size_t num_requested = closure->RequestAndWait(current, static_cast<uint32_t>(timeout_ms));
+    closure->TakeReadySlots(&peers, &frames);
+    result = PackStackInfos(env, current, peers, frames, stack_info_ptr);
+    // Threads that are still starting have no stack to report and are not counted as missed.
+    num_missed = num_requested - std::min(num_requested, peers.size() + closure->GetNumStarting());
+    // The stacks that were taken have been copied. Threads that run the checkpoint late may
+    // still publish into the other slots, the last one to finish frees the closure.
+    closure->Release(current);
+  }
+  if (result != ERR(NONE)) {
+    return result;
+  }
+  *thread_count_ptr = static_cast<jint>(peers.size());
+  if (missed_thread_count_ptr != nullptr) {
+    *missed_thread_count_ptr = static_cast<jint>(num_missed);
+  }
   return ERR(NONE);
 }
 
@@ -50,6 +50,18 @@ class StackUtil {
                                       jint* thread_count_ptr)
       REQUIRES(!art::Locks::thread_list_lock_);
 
+  // Extension version of GetAllStackTraces that does not wait for all threads. Each thread
+  // records its stack when it reaches its next suspend point. The stacks recorded within
+  // timeout_ms are returned, the number of threads that did not record their stack in time is
+  // stored in missed_thread_count_ptr, if not null.
+  static jvmtiError GetAllStackTracesAsync(jvmtiEnv* env,
+                                           jint max_frame_count,
+                                           jint timeout_ms,
+                                           jvmtiStackInfo** stack_info_ptr,
+                                           jint* thread_count_ptr,
+                                           jint* missed_thread_count_ptr)
+      REQUIRES(!art::Locks::thread_list_lock_);
+
   static jvmtiError GetFrameCount(jvmtiEnv* env, jthread thread, jint* count_ptr);
 
   static jvmtiError GetFrameLocation(jvmtiEnv* env,
@@ -286,9 +286,10 @@ class ArtMethod final {
   bool IsFastNative() const {
     // The presence of the annotation is checked by ClassLinker and recorded in access flags.
     // The kAccFastNative flag value is used with a different meaning for non-native methods,
-    // so we need to check the kAccNative flag as well.
-    constexpr uint32_t mask = kAccFastNative | kAccNative;
-    return (GetAccessFlags() & mask) == mask;
+    // so we need to check the kAccNative flag as well. It is also part of kAccPinnedArrayNative,
+    // so we need to check that kAccCriticalNative is clear.
+    constexpr uint32_t mask = kAccFastNative | kAccCriticalNative | kAccNative;
+    return (GetAccessFlags() & mask) == (kAccFastNative | kAccNative);
   }
 
   // Checks to see if the method was annotated with @dalvik.annotation.optimization.CriticalNative.
@@ -300,6 +301,13 @@ class ArtMethod final {
     return (GetAccessFlags() & mask) == mask;
   }
 
+  // Checks to see if the method was annotated with
+  // @dalvik.annotation.optimization.PinnedArrayNative. Such methods are also critical native.
+  bool IsPinnedArrayNative() const {
+    constexpr uint32_t mask = kAccPinnedArrayNative | kAccNative;
+    return (GetAccessFlags() & mask) == mask;
+  }
+
   bool IsAbstract() const {
     return (GetAccessFlags() & kAccAbstract) != 0;
   }
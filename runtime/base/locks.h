@@ -89,6 +89,7 @@ enum LockLevel : uint8_t {
   kBumpPointerSpaceBlockLock,
   kArenaPoolLock,
   kInternTableLock,
+  kStackTraceInternTableLock,
   kOatFileSecondaryLookupLock,
   kHostDlOpenHandlesLock,
   kVerifierDepsLock,
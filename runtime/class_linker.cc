@@ -88,6 +88,7 @@
 #include "imtable-inl.h"
 #include "intern_table-inl.h"
 #include "interpreter/interpreter.h"
+#include "interpreter/method_interpreter_cache.h"
 #include "interpreter/mterp/nterp.h"
 #include "jit/debugger_interface.h"
 #include "jit/jit.h"
@@ -135,6 +136,7 @@
 #include "oat_file_manager.h"
 #include "object_lock.h"
 #include "profile/profile_compilation_info.h"
+#include "reflective_invoke_stub.h"
 #include "runtime.h"
 #include "runtime_callbacks.h"
 #include "scoped_thread_state_change-inl.h"
@@ -2500,6 +2502,11 @@ void ClassLinker::DeleteClassLoader(Thread* self, const ClassLoaderData& data, b
     CHAOnDeleteUpdateClassVisitor visitor(data.allocator);
     data.class_table->Visit<CHAOnDeleteUpdateClassVisitor, kWithoutReadBarrier>(visitor);
   }
+  // The ArtMethods in the allocator may be reused for other methods.
+  ReflectiveInvokeStubCache::InvalidateAll();
+  if (runtime->GetMethodInterpreterCaches() != nullptr) {
+    runtime->GetMethodInterpreterCaches()->RemoveTablesIn(self, *data.allocator);
+  }
 
   delete data.allocator;
   delete data.class_table;
@@ -3931,7 +3938,8 @@ void ClassLinker::LoadMethod(const DexFile& dex_file,
     }
   }
   if (UNLIKELY((access_flags & kAccNative) != 0u)) {
-    // Check if the native method is annotated with @FastNative or @CriticalNative.
+    // Check if the native method is annotated with @FastNative, @CriticalNative or
+    // @PinnedArrayNative.
     access_flags |= annotations::GetNativeMethodAnnotationAccessFlags(
         dex_file, dst->GetClassDef(), dex_method_idx);
   }
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "code_info_cache.h"
+
+#include <ostream>
+
+#include "oat_quick_method_header.h"
+#include "thread-current-inl.h"
+
+namespace art {
+
+std::atomic<uint32_t> CodeInfoCache::generation_(0u);
+std::atomic<uint64_t> CodeInfoCache::global_counters_[CodeInfoCache::kNumCounters];
+
+CodeInfoCache::CodeInfoCache()
+    : seen_generation_(generation_.load(std::memory_order_acquire)),
+      pending_counts_(0u) {
+  local_counters_.fill(0u);
+}
+
+CodeInfoCache::~CodeInfoCache() {
+  FlushCounters();
+}
+
+CodeInfoCache* CodeInfoCache::GetCurrent() {
+  Thread* self = Thread::Current();
+  return (self != nullptr) ? self->GetCodeInfoCache() : nullptr;
+}
+
+void CodeInfoCache::ClearIfInvalidated() {
+  uint32_t generation = generation_.load(std::memory_order_acquire);
+  if (UNLIKELY(generation != seen_generation_)) {
+    code_infos_.fill(CodeInfoEntry());
+    stack_maps_.fill(StackMapEntry());
+    seen_generation_ = generation;
+  }
+}
+
+void CodeInfoCache::Count(Counter counter) {
+  ++local_counters_[counter];
+  if (UNLIKELY(++pending_counts_ == kCounterFlushInterval)) {
+    FlushCounters();
+  }
+}
+
+void CodeInfoCache::FlushCounters() {
+  for (size_t i = 0; i != kNumCounters; ++i) {
+    if (local_counters_[i] != 0u) {
+      global_counters_[i].fetch_add(local_counters_[i], std::memory_order_relaxed);
+      local_counters_[i] = 0u;
+    }
+  }
+  pending_counts_ = 0u;
+}
+
+CodeInfo CodeInfoCache::DecodeUncached(const OatQuickMethodHeader* header, DecodeMode mode) {
+  switch (mode) {
+    case DecodeMode::kAllTables:
+      return CodeInfo(header);
+    case DecodeMode::kGcMasksOnly:
+      return CodeInfo::DecodeGcMasksOnly(header);
+    case DecodeMode::kInlineInfoOnly:
+      return CodeInfo::DecodeInlineInfoOnly(header);
+  }
+  UNREACHABLE();
+}
+
+CodeInfo CodeInfoCache::Decode(const OatQuickMethodHeader* header, DecodeMode mode) {
+  DCHECK(header->IsOptimized());
+  CodeInfoCache* cache = GetCurrent();
+  if (cache == nullptr) {
+    return DecodeUncached(header, mode);
+  }
+  cache->ClearIfInvalidated();
+  CodeInfoEntry& entry = cache->code_infos_[CodeInfoIndexOf(header)];
+  if (entry.header == header && (entry.mode == mode || entry.mode == DecodeMode::kAllTables)) {
+    cache->Count(kCodeInfoHits);
+  } else {
+    cache->Count(kCodeInfoMisses);
+    entry.header = header;
+    entry.mode = mode;
+    entry.code_info = DecodeUncached(header, mode);
+  }
+  return entry.code_info;
+}
+
+StackMap CodeInfoCache::GetStackMapForNativePcOffset(const OatQuickMethodHeader* header,
+                                                     const CodeInfo& code_info,
+                                                     uint32_t native_pc_offset) {
+  CodeInfoCache* cache = GetCurrent();
+  if (cache == nullptr) {
+    return code_info.GetStackMapForNativePcOffset(native_pc_offset);
+  }
+  cache->ClearIfInvalidated();
+  StackMapEntry& entry = cache->stack_maps_[StackMapIndexOf(header, native_pc_offset)];
+  if (entry.header == header && entry.native_pc_offset == native_pc_offset) {
+    cache->Count(kStackMapHits);
+    StackMap stack_map = (entry.row != StackMap::kNoValue)
+        ? code_info.GetStackMapAt(entry.row)
+        : code_info.GetStackMaps().GetInvalidRow();
+    DCHECK(stack_map.Equals(code_info.GetStackMapForNativePcOffset(native_pc_offset)));
+    return stack_map;
+  }
+  cache->Count(kStackMapMisses);
+  StackMap stack_map = code_info.GetStackMapForNativePcOffset(native_pc_offset);
+  entry.header = header;
+  entry.native_pc_offset = native_pc_offset;
+  entry.row = stack_map.IsValid() ? stack_map.Row() : StackMap::kNoValue;
+  return stack_map;
+}
+
+void CodeInfoCache::DumpStats(std::ostream& os) {
+  auto hit_rate = [](uint64_t hits, uint64_t misses) {
+    return (hits + misses != 0u) ? 100.0 * hits / (hits + misses) : 0.0;
+  };
+  uint64_t code_info_hits = global_counters_[kCodeInfoHits].load(std::memory_order_relaxed);
+  uint64_t code_info_misses = global_counters_[kCodeInfoMisses].load(std::memory_order_relaxed);
+  uint64_t stack_map_hits = global_counters_[kStackMapHits].load(std::memory_order_relaxed);
+  uint64_t stack_map_misses = global_counters_[kStackMapMisses].load(std::memory_order_relaxed);
+  os << "CodeInfo cache: " << code_info_hits << " hits " << code_info_misses << " misses ("
+     << hit_rate(code_info_hits, code_info_misses) << "%), stack map cache: "
+     << stack_map_hits << " hits " << stack_map_misses << " misses ("
+     << hit_rate(stack_map_hits, stack_map_misses) << "%), invalidations: "
+     << generation_.load(std::memory_order_relaxed) << "\n";
+}
+
+}  // namespace art
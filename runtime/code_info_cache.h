@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_CODE_INFO_CACHE_H_
+#define ART_RUNTIME_CODE_INFO_CACHE_H_
+
+#include <array>
+#include <atomic>
+#include <iosfwd>
+
+#include "base/bit_utils.h"
+#include "base/macros.h"
+#include "stack_map.h"
+
+namespace art {
+
+class OatQuickMethodHeader;
+
+// Small thread-local cache of decoded CodeInfo and of native pc to stack map lookups.
+//
+// Stack walks for exception delivery, stack traces and GC root visiting decode the CodeInfo
+// of each optimized frame and binary search its stack maps for the frame's native pc. Code
+// that repeatedly throws or collects stack traces walks through the same methods again and
+// again, so we keep the recent results keyed by the method header and the native pc.
+//
+// The cache is keyed by pointers to compiled code, so InvalidateAll() must be called whenever
+// compiled code is freed, before different code can be placed at the same address.
+// All operations must be done from the owning thread.
+class CodeInfoCache {
+ public:
+  static constexpr size_t kNumCodeInfoEntries = 16;
+  static constexpr size_t kNumStackMapEntries = 64;
+
+  // Tables to decode, see CodeInfo::DecodeGcMasksOnly() and CodeInfo::DecodeInlineInfoOnly().
+  enum class DecodeMode : uint8_t {
+    kAllTables,
+    kGcMasksOnly,
+    kInlineInfoOnly,
+  };
+
+  CodeInfoCache();
+  ~CodeInfoCache();
+
+  // Returns the CodeInfo of the optimized method `header`, with at least the tables of `mode`.
+  // Uses the cache of the current thread if the current thread is attached to the runtime.
+  // An entry decoded with all tables also serves the partial modes.
+  static CodeInfo Decode(const OatQuickMethodHeader* header,
+                         DecodeMode mode = DecodeMode::kAllTables);
+
+  // Returns the stack map for the `native_pc_offset` in `code_info` decoded for `header`.
+  // The result is the same as `code_info.GetStackMapForNativePcOffset(native_pc_offset)`.
+  static StackMap GetStackMapForNativePcOffset(const OatQuickMethodHeader* header,
+                                               const CodeInfo& code_info,
+                                               uint32_t native_pc_offset);
+
+  // Invalidate the caches of all threads. Each cache is cleared on its next use.
+  static void InvalidateAll() {
+    generation_.fetch_add(1u, std::memory_order_release);
+  }
+
+  // Dump the hit rates of the caches, including those of threads that already exited.
+  static void DumpStats(std::ostream& os);
+
+ private:
+  struct CodeInfoEntry {
+    const OatQuickMethodHeader* header = nullptr;
+    DecodeMode mode = DecodeMode::kAllTables;
+    CodeInfo code_info;
+  };
+
+  struct StackMapEntry {
+    const OatQuickMethodHeader* header = nullptr;
+    uint32_t native_pc_offset = 0u;
+    uint32_t row = 0u;
+  };
+
+  // Counter indexes.
+  enum Counter {
+    kCodeInfoHits,
+    kCodeInfoMisses,
+    kStackMapHits,
+    kStackMapMisses,
+    kNumCounters,
+  };
+
+  static CodeInfoCache* GetCurrent();
+
+  static CodeInfo DecodeUncached(const OatQuickMethodHeader* header, DecodeMode mode);
+
+  void ClearIfInvalidated();
+  void Count(Counter counter);
+  void FlushCounters();
+
+  static ALWAYS_INLINE size_t CodeInfoIndexOf(const OatQuickMethodHeader* header) {
+    static_assert(IsPowerOfTwo(kNumCodeInfoEntries), "Size must be power of two");
+    return (reinterpret_cast<uintptr_t>(header) >> 4) & (kNumCodeInfoEntries - 1);
+  }
+
+  static ALWAYS_INLINE size_t StackMapIndexOf(const OatQuickMethodHeader* header,
+                                              uint32_t native_pc_offset) {
+    static_assert(IsPowerOfTwo(kNumStackMapEntries), "Size must be power of two");
+    return ((reinterpret_cast<uintptr_t>(header) >> 4) ^ (native_pc_offset >> 1)) &
+           (kNumStackMapEntries - 1);
+  }
+
+  // Local counters are added to the global counters in batches to avoid contention.
+  static constexpr uint32_t kCounterFlushInterval = 256u;
+
+  static std::atomic<uint32_t> generation_;
+  static std::atomic<uint64_t> global_counters_[kNumCounters];
+
+  uint32_t seen_generation_;
+  uint32_t pending_counts_;
+  std::array<uint32_t, kNumCounters> local_counters_;
+  std::array<CodeInfoEntry, kNumCodeInfoEntries> code_infos_;
+  std::array<StackMapEntry, kNumStackMapEntries> stack_maps_;
+
+  DISALLOW_COPY_AND_ASSIGN(CodeInfoCache);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_CODE_INFO_CACHE_H_
@@ -1313,6 +1313,15 @@ uint32_t GetNativeMethodAnnotationAccessFlags(const DexFile& dex_file,
     access_flags |= kAccCriticalNative;
   }
   CHECK_NE(access_flags, kAccFastNative | kAccCriticalNative);
+  // The annotation is not in the boot class path, so there is no well known class to check.
+  if (access_flags == 0u &&
+      IsMethodBuildAnnotationPresent(
+          dex_file,
+          *annotation_set,
+          "Ldalvik/annotation/optimization/PinnedArrayNative;",
+          /* annotation_class= */ nullptr)) {
+    access_flags |= kAccPinnedArrayNative;
+  }
   return access_flags;
 }
 
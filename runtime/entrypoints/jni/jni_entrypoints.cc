@@ -37,6 +37,17 @@ extern "C" const void* artFindNativeMethodRunnable(Thread* self)
   ArtMethod* method = self->GetCurrentMethod(nullptr);
   DCHECK(method != nullptr);
 
+  // The caller has already turned the array arguments of a @PinnedArrayNative method into
+  // pointers to the array data. The lookup below can suspend and let the GC move the arrays,
+  // so these methods must be registered with RegisterNatives() before the first call.
+  if (UNLIKELY(method->IsPinnedArrayNative())) {
+    self->ThrowNewExceptionF("Ljava/lang/UnsatisfiedLinkError;",
+                             "@PinnedArrayNative method %s was not registered with "
+                             "RegisterNatives()",
+                             method->PrettyMethod().c_str());
+    return nullptr;
+  }
+
   // Lookup symbol address for method, on failure we'll return null with an exception set,
   // otherwise we return the address of the method we found.
   JavaVMExt* vm = down_cast<JNIEnvExt*>(self->GetJniEnv())->GetVm();
@@ -120,6 +120,8 @@ extern "C" void art_quick_invoke_custom(uint32_t, void*);
 
 // Thread entrypoints.
 extern "C" void art_quick_test_suspend();
+extern "C" void art_quick_method_entry_hook();
+extern "C" void art_quick_method_exit_hook();
 
 // Throw entrypoints.
 extern "C" void art_quick_deliver_exception(art::mirror::Object*);
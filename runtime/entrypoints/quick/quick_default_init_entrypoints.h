@@ -111,6 +111,8 @@ static void DefaultInitEntryPoints(JniEntryPoints* jpoints, QuickEntryPoints* qp
 
   // Thread
   qpoints->pTestSuspend = art_quick_test_suspend;
+  qpoints->pMethodEntryHook = art_quick_method_entry_hook;
+  qpoints->pMethodExitHook = art_quick_method_exit_hook;
 
   // Throws
   qpoints->pDeliverException = art_quick_deliver_exception;
@@ -140,6 +140,8 @@
   V(InvokeCustom, void, uint32_t, void*) \
 \
   V(TestSuspend, void, void) \
+  V(MethodEntryHook, void, void) \
+  V(MethodExitHook, void, void) \
 \
   V(DeliverException, void, mirror::Object*) \
   V(ThrowArrayBounds, void, int32_t, int32_t) \
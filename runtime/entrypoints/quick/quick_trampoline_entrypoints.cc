@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include "arch/context.h"
 #include "art_method-inl.h"
 #include "base/callee_save_type.h"
 #include "base/enums.h"
@@ -41,6 +42,7 @@
 #include "jit/jit_code_cache.h"
 #include "linear_alloc.h"
 #include "method_handles.h"
+#include "mirror/array-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/dex_cache-inl.h"
 #include "mirror/method.h"
@@ -1115,6 +1117,86 @@ extern "C" TwoWordReturn artInstrumentationMethodExitFromCode(Thread* self,
   return return_or_deoptimize_pc;
 }
 
+// Finds the compiled method that called a method entry/exit hook, with its receiver and the
+// dex pc of the hook.
+static ArtMethod* GetEntryExitHookCaller(Thread* self,
+                                         ObjPtr<mirror::Object>* this_object,
+                                         uint32_t* dex_pc)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  ArtMethod* caller = nullptr;
+  // Reuse the long jump context of the thread rather than allocating one for each event.
+  Context* context = self->GetLongJumpContext();
+  StackVisitor::WalkStack(
+      [&](const art::StackVisitor* stack_visitor) REQUIRES_SHARED(Locks::mutator_lock_) {
+        ArtMethod* m = stack_visitor->GetMethod();
+        if (m == nullptr || m->IsRuntimeMethod()) {
+          // Skip the kSaveEverything frame of the hook.
+          return true;
+        }
+        caller = m;
+        *this_object = stack_visitor->GetThisObject();
+        *dex_pc = stack_visitor->GetDexPc();
+        return false;
+      },
+      self,
+      context,
+      StackVisitor::StackWalkKind::kSkipInlinedFrames);
+  self->ReleaseLongJumpContext(context);
+  DCHECK(caller != nullptr);
+  return caller;
+}
+
+extern "C" void artMethodEntryHook(Thread* self) REQUIRES_SHARED(Locks::mutator_lock_) {
+  ScopedQuickEntrypointChecks sqec(self);
+  instrumentation::Instrumentation* instrumentation = Runtime::Current()->GetInstrumentation();
+  if (instrumentation->HasMethodEntryListeners()) {
+    ObjPtr<mirror::Object> this_object = nullptr;
+    uint32_t dex_pc = 0u;
+    ArtMethod* method = GetEntryExitHookCaller(self, &this_object, &dex_pc);
+    {
+      StackHandleScope<1> hs(self);
+      Handle<mirror::Object> h_this = hs.NewHandle(this_object);
+      instrumentation->MethodEnterEvent(self, h_this.Get(), method, dex_pc);
+      if (UNLIKELY(self->IsExceptionPending())) {
+        // Like the interpreter, report the unwind of the method, and deliver the exception to
+        // the caller rather than to the catch blocks of the method.
+        instrumentation->MethodUnwindEvent(self, h_this.Get(), method, dex_pc);
+      }
+    }
+    if (UNLIKELY(self->IsExceptionPending())) {
+      self->QuickDeliverException(/* from_entry_exit_hook= */ true);
+    }
+  }
+}
+
+extern "C" void artMethodExitHook(Thread* self, uint64_t* gpr_result, uint64_t* fpr_result)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  ScopedQuickEntrypointChecks sqec(self);
+  DCHECK(!self->IsExceptionPending());
+  instrumentation::Instrumentation* instrumentation = Runtime::Current()->GetInstrumentation();
+  if (instrumentation->HasMethodExitListeners()) {
+    ObjPtr<mirror::Object> this_object = nullptr;
+    uint32_t dex_pc = 0u;
+    ArtMethod* method = GetEntryExitHookCaller(self, &this_object, &dex_pc);
+    // The compiled code moved the return value to the return registers before the hook.
+    char return_shorty = method->GetShorty()[0];
+    JValue return_value;
+    if (return_shorty == 'V') {
+      return_value.SetJ(0);
+    } else if (return_shorty == 'F' || return_shorty == 'D') {
+      return_value.SetJ(*fpr_result);
+    } else {
+      return_value.SetJ(*gpr_result);
+    }
+    instrumentation->MethodExitEvent(
+        self, this_object, method, dex_pc, instrumentation::OptionalFrame{}, return_value);
+    if (UNLIKELY(self->IsExceptionPending())) {
+      // The method has exited, deliver the exception to the caller without reporting an unwind.
+      self->QuickDeliverException(/* from_entry_exit_hook= */ true);
+    }
+  }
+}
+
 static std::string DumpInstruction(ArtMethod* method, uint32_t dex_pc)
     REQUIRES_SHARED(Locks::mutator_lock_) {
   if (dex_pc == static_cast<uint32_t>(-1)) {
@@ -1957,6 +2039,15 @@ class FillNativeCall {
     UNREACHABLE();
   }
 
+  // The slots that the next PushGpr() and PushStack() write to.
+  uintptr_t* NextGprSlot() const {
+    return cur_gpr_reg_;
+  }
+
+  uintptr_t* NextStackSlot() const {
+    return cur_stack_arg_;
+  }
+
  private:
   uintptr_t* cur_gpr_reg_;
   uint32_t* cur_fpr_reg_;
@@ -1976,7 +2067,9 @@ class BuildGenericJniFrameVisitor final : public QuickArgumentVisitor {
                               uintptr_t* reserved_area)
      : QuickArgumentVisitor(managed_sp, is_static, shorty, shorty_len),
        jni_call_(nullptr, nullptr, nullptr, nullptr, critical_native),
-       sm_(&jni_call_) {
+       sm_(&jni_call_),
+       pinned_array_native_((*managed_sp)->IsPinnedArrayNative()),
+       pinned_array_slots_() {
     DCHECK_ALIGNED(managed_sp, kStackAlignment);
     DCHECK_ALIGNED(reserved_area, sizeof(uintptr_t));
 
@@ -2015,6 +2108,11 @@ class BuildGenericJniFrameVisitor final : public QuickArgumentVisitor {
 
   void FinalizeHandleScope(Thread* self) REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Replace the array arguments of a @PinnedArrayNative method with pointers to the array data
+  // and remove the handle scope that kept the arrays reachable. The caller must not suspend
+  // between this call and the native call.
+  void FinalizePinnedArrays(Thread* self) REQUIRES_SHARED(Locks::mutator_lock_);
+
   StackReference<mirror::Object>* GetFirstHandleScopeEntry() {
     return handle_scope_->GetHandle(0).GetReference();
   }
@@ -2070,6 +2168,10 @@ class BuildGenericJniFrameVisitor final : public QuickArgumentVisitor {
 
   BuildNativeCallFrameStateMachine<FillJniCall> sm_;
 
+  // For @PinnedArrayNative, the native argument slots of the arrays, in handle scope order.
+  const bool pinned_array_native_;
+  std::vector<uintptr_t*> pinned_array_slots_;
+
   DISALLOW_COPY_AND_ASSIGN(BuildGenericJniFrameVisitor);
 };
 
@@ -2109,6 +2211,10 @@ void BuildGenericJniFrameVisitor::Visit() {
     case Primitive::kPrimNot: {
       StackReference<mirror::Object>* stack_ref =
           reinterpret_cast<StackReference<mirror::Object>*>(GetParamAddress());
+      if (UNLIKELY(pinned_array_native_)) {
+        pinned_array_slots_.push_back(
+            sm_.HaveHandleScopeGpr() ? jni_call_.NextGprSlot() : jni_call_.NextStackSlot());
+      }
       sm_.AdvanceHandleScope(stack_ref->AsMirrorPtr());
       break;
     }
@@ -2131,12 +2237,29 @@ void BuildGenericJniFrameVisitor::Visit() {
 void BuildGenericJniFrameVisitor::FinalizeHandleScope(Thread* self) {
   // Clear out rest of the scope.
   jni_call_.ResetRemainingScopeSlots();
-  if (!jni_call_.CriticalNative()) {
+  // @PinnedArrayNative methods need the HandleScope until FinalizePinnedArrays() because the
+  // arrays can move if the thread suspends for class initialization.
+  if (!jni_call_.CriticalNative() || pinned_array_native_) {
     // Install HandleScope.
     self->PushHandleScope(handle_scope_);
   }
 }
 
+void BuildGenericJniFrameVisitor::FinalizePinnedArrays(Thread* self) {
+  DCHECK(pinned_array_native_);
+  DCHECK_EQ(self->GetTopHandleScope(), handle_scope_);
+  for (size_t i = 0, size = pinned_array_slots_.size(); i != size; ++i) {
+    ObjPtr<mirror::Object> ref = handle_scope_->GetHandle(i).Get();
+    uintptr_t data = 0u;
+    if (ref != nullptr) {
+      size_t component_size = ref->GetClass()->GetComponentSize();
+      data = reinterpret_cast<uintptr_t>(ref->AsArray()->GetRawData(component_size, 0));
+    }
+    *pinned_array_slots_[i] = data;
+  }
+  self->PopHandleScope();
+}
+
 /*
  * Initializes the reserved area assumed to be directly below `managed_sp` for a native call:
  *
@@ -2210,6 +2333,12 @@ extern "C" const void* artQuickGenericJniTrampoline(Thread* self,
     }
   }
 
+  if (UNLIKELY(called->IsPinnedArrayNative())) {
+    // The thread stays runnable and does not suspend until the native method returns,
+    // so the GC cannot move the arrays after this point.
+    visitor.FinalizePinnedArrays(self);
+  }
+
   uint32_t cookie;
   uint32_t* sp32;
   // Skip calling JniMethodStart for @CriticalNative.
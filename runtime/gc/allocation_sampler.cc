@@ -0,0 +1,403 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "allocation_sampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <ostream>
+#include <string_view>
+
+#include "art_method-inl.h"
+#include "base/bit_utils.h"
+#include "base/casts.h"
+#include "base/os.h"
+#include "base/time_utils.h"
+#include "base/unix_file/fd_file.h"
+#include "dex/dex_file_types.h"
+#include "gc/heap.h"
+#include "gc_root-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/object-inl.h"
+#include "runtime.h"
+#include "runtime_globals.h"
+#include "stack.h"
+#include "thread-current-inl.h"
+#include "thread_list.h"
+
+namespace art {
+namespace gc {
+
+namespace {
+
+// Minimal encoder for the pprof Profile message, see
+// https://github.com/google/pprof/blob/master/proto/profile.proto.
+enum ProfileField : uint32_t {
+  kProfileSampleType = 1,
+  kProfileSample = 2,
+  kProfileLocation = 4,
+  kProfileFunction = 5,
+  kProfileStringTable = 6,
+  kProfilePeriodType = 11,
+  kProfilePeriod = 12,
+};
+
+constexpr uint32_t kWireTypeVarint = 0;
+constexpr uint32_t kWireTypeLengthDelimited = 2;
+
+void PutVarint(std::string* out, uint64_t value) {
+  while (value >= 0x80u) {
+    out->push_back(static_cast<char>((value & 0x7fu) | 0x80u));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+void PutVarintField(std::string* out, uint32_t field, uint64_t value) {
+  PutVarint(out, (field << 3) | kWireTypeVarint);
+  PutVarint(out, value);
+}
+
+void PutBytesField(std::string* out, uint32_t field, std::string_view bytes) {
+  PutVarint(out, (field << 3) | kWireTypeLengthDelimited);
+  PutVarint(out, bytes.size());
+  out->append(bytes.data(), bytes.size());
+}
+
+void PutPackedField(std::string* out, uint32_t field, const std::vector<uint64_t>& values) {
+  std::string packed;
+  for (uint64_t value : values) {
+    PutVarint(&packed, value);
+  }
+  PutBytesField(out, field, packed);
+}
+
+std::string EncodeValueType(uint64_t type, uint64_t unit) {
+  std::string value_type;
+  PutVarintField(&value_type, /* type */ 1, type);
+  PutVarintField(&value_type, /* unit */ 2, unit);
+  return value_type;
+}
+
+}  // namespace
+
+AllocationSampleBuffer::AllocationSampleBuffer(Thread* self, const AllocationSampler* sampler)
+    : bytes_until_sample_(0u),
+      sample_at_next_window_(false),
+      record_pending_(false),
+      random_state_((reinterpret_cast<uintptr_t>(self) ^ NanoTime()) | 1u),
+      num_samples_(0u),
+      num_frames_(0u) {
+  bytes_until_sample_ = sampler->NextSampleDistance(this);
+}
+
+void AllocationSampleBuffer::VisitRoots(RootVisitor* visitor, const RootInfo& root_info) {
+  for (size_t i = 0; i != num_samples_; ++i) {
+    samples_[i].klass.VisitRoot(visitor, root_info);
+  }
+  for (size_t i = 0; i != num_frames_; ++i) {
+    ArtMethod* method = frames_[i].method;
+    ObjPtr<mirror::Class> klass = method->GetDeclaringClassUnchecked<kWithoutReadBarrier>();
+    if (klass != nullptr) {
+      mirror::Object* new_ref = klass.Ptr();
+      visitor->VisitRoot(&new_ref, root_info);
+      if (new_ref != klass) {
+        method->CASDeclaringClass(klass.Ptr(), new_ref->AsClass());
+      }
+    }
+  }
+}
+
+AllocationSampler::AllocationSampler(size_t interval, const std::string& profile_file)
+    : interval_(interval),
+      profile_file_(profile_file),
+      lock_("allocation sampler lock"),
+      strings_(1u),
+      num_samples_(0u),
+      num_profiles_written_(0u) {
+  DCHECK_NE(interval, 0u);
+  string_ids_.emplace(std::string(), 0u);
+}
+
+size_t AllocationSampler::NextSampleDistance(AllocationSampleBuffer* buffer) const {
+  // xorshift64*.
+  uint64_t x = buffer->random_state_;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  buffer->random_state_ = x;
+  uint64_t random = x * UINT64_C(0x2545F4914F6CDD1D);
+  // Uniform in (0, 1].
+  double uniform = static_cast<double>((random >> 11) + 1u) * 0x1.0p-53;
+  double distance = -std::log(uniform) * static_cast<double>(interval_);
+  return std::max<size_t>(static_cast<size_t>(distance), 1u);
+}
+
+size_t AllocationSampler::AdjustTlabWindow(Thread* self, size_t min_bytes, size_t window) {
+  AllocationSampleBuffer* buffer = self->GetAllocationSampleBuffer();
+  if (buffer->sample_at_next_window_ || min_bytes >= buffer->bytes_until_sample_) {
+    // The allocation that refills the TLAB crosses the sample point.
+    buffer->record_pending_ = true;
+    buffer->sample_at_next_window_ = false;
+    buffer->bytes_until_sample_ = min_bytes + NextSampleDistance(buffer);
+  }
+  if (window >= buffer->bytes_until_sample_) {
+    // End the window at the sample point. The window is aligned, so this does not grow it.
+    window = std::max(min_bytes, RoundUp(buffer->bytes_until_sample_, kObjectAlignment));
+    buffer->sample_at_next_window_ = true;
+    buffer->bytes_until_sample_ = 0u;
+  } else {
+    buffer->bytes_until_sample_ -= window;
+  }
+  return window;
+}
+
+bool AllocationSampler::OnSlowPathAllocation(Thread* self,
+                                             ObjPtr<mirror::Object> obj,
+                                             size_t bytes) {
+  AllocationSampleBuffer* buffer = self->GetAllocationSampleBuffer();
+  uint8_t* address = reinterpret_cast<uint8_t*>(obj.Ptr());
+  bool in_tlab = address >= self->GetTlabStart() && address < self->GetTlabPos();
+  if (!in_tlab) {
+    // Not covered by a TLAB window, count the allocation itself.
+    if (bytes >= buffer->bytes_until_sample_) {
+      buffer->record_pending_ = true;
+      buffer->bytes_until_sample_ = NextSampleDistance(buffer);
+    } else {
+      buffer->bytes_until_sample_ -= bytes;
+    }
+  }
+  bool record = buffer->record_pending_;
+  buffer->record_pending_ = false;
+  return record;
+}
+
+void AllocationSampler::RecordSample(Thread* self, ObjPtr<mirror::Object> obj, size_t bytes) {
+  AllocationSampleBuffer* buffer = self->GetAllocationSampleBuffer();
+  if (buffer->num_samples_ == AllocationSampleBuffer::kMaxSamples ||
+      buffer->num_frames_ + AllocationSampleBuffer::kMaxFramesPerSample >
+          AllocationSampleBuffer::kMaxFrames) {
+    Flush(buffer);
+  }
+  size_t first_frame = buffer->num_frames_;
+  size_t num_frames = 0u;
+  StackVisitor::WalkStack(
+      [&](const art::StackVisitor* visitor) REQUIRES_SHARED(Locks::mutator_lock_) {
+        ArtMethod* method = visitor->GetMethod();
+        if (method->IsRuntimeMethod()) {
+          return true;
+        }
+        buffer->frames_[first_frame + num_frames] =
+            { method, visitor->GetDexPc(/*abort_on_failure=*/ false) };
+        ++num_frames;
+        return num_frames != AllocationSampleBuffer::kMaxFramesPerSample;
+      },
+      self,
+      /* context= */ nullptr,
+      StackVisitor::StackWalkKind::kIncludeInlinedFrames);
+  AllocationSampleBuffer::Sample& sample = buffer->samples_[buffer->num_samples_];
+  sample.klass = GcRoot<mirror::Class>(obj->GetClass());
+  sample.size = bytes;
+  sample.first_frame = dchecked_integral_cast<uint16_t>(first_frame);
+  sample.num_frames = dchecked_integral_cast<uint16_t>(num_frames);
+  ++buffer->num_samples_;
+  buffer->num_frames_ += num_frames;
+}
+
+uint64_t AllocationSampler::InternString(const std::string& str) {
+  auto it = string_ids_.find(str);
+  if (it != string_ids_.end()) {
+    return it->second;
+  }
+  uint64_t id = strings_.size();
+  strings_.push_back(str);
+  string_ids_.emplace(str, id);
+  return id;
+}
+
+uint64_t AllocationSampler::InternLocation(const std::string& method,
+                                           const char* file,
+                                           int32_t line) {
+  std::pair<uint64_t, uint64_t> function(InternString(method),
+                                         InternString(file != nullptr ? file : ""));
+  auto function_it = function_ids_.find(function);
+  if (function_it == function_ids_.end()) {
+    functions_.push_back(function);
+    function_it = function_ids_.emplace(function, functions_.size()).first;
+  }
+  // Negative line numbers mark native methods and methods without debug info.
+  std::pair<uint64_t, int64_t> location(function_it->second, std::max<int32_t>(line, 0));
+  auto location_it = location_ids_.find(location);
+  if (location_it == location_ids_.end()) {
+    locations_.push_back(location);
+    location_it = location_ids_.emplace(location, locations_.size()).first;
+  }
+  return location_it->second;
+}
+
+void AllocationSampler::Flush(AllocationSampleBuffer* buffer) {
+  if (buffer->num_samples_ == 0u) {
+    return;
+  }
+  // Resolve the names outside of the lock.
+  struct ResolvedFrame {
+    std::string method;
+    const char* file;
+    int32_t line;
+  };
+  std::vector<ResolvedFrame> frames;
+  frames.reserve(buffer->num_frames_);
+  for (size_t i = 0; i != buffer->num_frames_; ++i) {
+    const AllocationSampleBuffer::Frame& frame = buffer->frames_[i];
+    ArtMethod* method = frame.method->GetInterfaceMethodIfProxy(kRuntimePointerSize);
+    uint32_t dex_pc = frame.method->IsProxyMethod() ? dex::kDexNoIndex : frame.dex_pc;
+    frames.push_back({ method->PrettyMethod(),
+                       method->GetDeclaringClassSourceFile(),
+                       method->GetLineNumFromDexPC(dex_pc) });
+  }
+  std::vector<std::string> types;
+  types.reserve(buffer->num_samples_);
+  for (size_t i = 0; i != buffer->num_samples_; ++i) {
+    types.push_back(buffer->samples_[i].klass.Read()->PrettyDescriptor());
+  }
+
+  MutexLock mu(Thread::Current(), lock_);
+  std::vector<uint64_t> key;
+  for (size_t i = 0; i != buffer->num_samples_; ++i) {
+    const AllocationSampleBuffer::Sample& sample = buffer->samples_[i];
+    key.clear();
+    for (size_t j = 0; j != sample.num_frames; ++j) {
+      const ResolvedFrame& frame = frames[sample.first_frame + j];
+      key.push_back(InternLocation(frame.method, frame.file, frame.line));
+    }
+    key.push_back(InternString(types[i]));
+    // An allocation of `size` bytes is sampled with probability 1 - exp(-size / interval).
+    double scale = 1.0 / (1.0 - std::exp(-static_cast<double>(sample.size) / interval_));
+    Totals& totals = totals_[key];
+    totals.objects += scale;
+    totals.bytes += scale * sample.size;
+  }
+  num_samples_ += buffer->num_samples_;
+  buffer->num_samples_ = 0u;
+  buffer->num_frames_ = 0u;
+}
+
+std::string AllocationSampler::EncodeProfile() {
+  std::string profile;
+  PutBytesField(&profile,
+                kProfileSampleType,
+                EncodeValueType(InternString("alloc_objects"), InternString("count")));
+  PutBytesField(&profile,
+                kProfileSampleType,
+                EncodeValueType(InternString("alloc_space"), InternString("bytes")));
+  uint64_t type_label = InternString("class");
+  std::vector<uint64_t> location_ids;
+  for (const auto& entry : totals_) {
+    const std::vector<uint64_t>& key = entry.first;
+    const Totals& totals = entry.second;
+    std::string sample;
+    location_ids.assign(key.begin(), key.end() - 1);
+    PutPackedField(&sample, /* location_id */ 1, location_ids);
+    PutPackedField(&sample,
+                   /* value */ 2,
+                   { static_cast<uint64_t>(std::llround(totals.objects)),
+                     static_cast<uint64_t>(std::llround(totals.bytes)) });
+    std::string label;
+    PutVarintField(&label, /* key */ 1, type_label);
+    PutVarintField(&label, /* str */ 2, key.back());
+    PutBytesField(&sample, /* label */ 3, label);
+    PutBytesField(&profile, kProfileSample, sample);
+  }
+  for (size_t i = 0; i != locations_.size(); ++i) {
+    std::string line;
+    PutVarintField(&line, /* function_id */ 1, locations_[i].first);
+    PutVarintField(&line, /* line */ 2, static_cast<uint64_t>(locations_[i].second));
+    std::string location;
+    PutVarintField(&location, /* id */ 1, i + 1u);
+    PutBytesField(&location, /* line */ 4, line);
+    PutBytesField(&profile, kProfileLocation, location);
+  }
+  for (size_t i = 0; i != functions_.size(); ++i) {
+    std::string function;
+    PutVarintField(&function, /* id */ 1, i + 1u);
+    PutVarintField(&function, /* name */ 2, functions_[i].first);
+    PutVarintField(&function, /* system_name */ 3, functions_[i].first);
+    PutVarintField(&function, /* filename */ 4, functions_[i].second);
+    PutBytesField(&profile, kProfileFunction, function);
+  }
+  // Intern the period type strings before the string table is written.
+  std::string period_type = EncodeValueType(InternString("space"), InternString("bytes"));
+  for (const std::string& str : strings_) {
+    PutBytesField(&profile, kProfileStringTable, str);
+  }
+  PutBytesField(&profile, kProfilePeriodType, period_type);
+  PutVarintField(&profile, kProfilePeriod, interval_);
+  return profile;
+}
+
+void AllocationSampler::WriteProfile(Thread* self) {
+  {
+    // Flush with all threads suspended, so that the buffers of suspended threads can be read.
+    ScopedSuspendAll ssa(__FUNCTION__);
+    MutexLock mu(self, *Locks::thread_list_lock_);
+    for (Thread* thread : Runtime::Current()->GetThreadList()->GetList()) {
+      AllocationSampleBuffer* buffer = thread->PeekAllocationSampleBuffer();
+      if (buffer != nullptr) {
+        Flush(buffer);
+      }
+    }
+  }
+  if (profile_file_.empty()) {
+    return;
+  }
+  std::string profile;
+  {
+    MutexLock mu(self, lock_);
+    profile = EncodeProfile();
+  }
+  std::unique_ptr<File> file(OS::CreateEmptyFileWriteOnly(profile_file_.c_str()));
+  if (file == nullptr) {
+    PLOG(ERROR) << "Unable to open allocation profile file " << profile_file_;
+    return;
+  }
+  if (!file->WriteFully(profile.data(), profile.size())) {
+    PLOG(ERROR) << "Failed to write allocation profile file " << profile_file_;
+    file->Erase();
+    return;
+  }
+  if (file->FlushCloseOrErase() != 0) {
+    PLOG(ERROR) << "Failed to flush allocation profile file " << profile_file_;
+    return;
+  }
+  MutexLock mu(self, lock_);
+  ++num_profiles_written_;
+}
+
+void AllocationSampler::DumpForSigQuit(std::ostream& os) {
+  // Only report the counters: writing the profile suspends all threads, which the dump should
+  // not do. Send SIGUSR1 to write it.
+  MutexLock mu(Thread::Current(), lock_);
+  os << "Allocation sampler: interval " << interval_ << " bytes, " << num_samples_
+     << " samples, " << totals_.size() << " distinct stacks";
+  if (!profile_file_.empty()) {
+    os << ", " << num_profiles_written_ << " profiles written to " << profile_file_;
+  }
+  os << "\n";
+}
+
+}  // namespace gc
+}  // namespace art
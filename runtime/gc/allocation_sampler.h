@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_ALLOCATION_SAMPLER_H_
+#define ART_RUNTIME_GC_ALLOCATION_SAMPLER_H_
+
+#include <array>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "base/locks.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "gc_root.h"
+#include "obj_ptr.h"
+
+namespace art {
+
+class ArtMethod;
+class Thread;
+
+namespace mirror {
+class Class;
+class Object;
+}  // namespace mirror
+
+namespace gc {
+
+class AllocationSampler;
+
+// Per-thread buffer of sampled allocations and the state of the thread's sampling interval.
+// It is created on first use and owned by the Thread, see Thread::GetAllocationSampleBuffer().
+//
+// The buffer holds the classes of the sampled objects and the methods of the recorded frames
+// as roots, so that they are not unloaded before the samples are flushed to the sampler.
+class AllocationSampleBuffer {
+ public:
+  static constexpr size_t kMaxSamples = 32;
+  static constexpr size_t kMaxFrames = 512;
+  static constexpr size_t kMaxFramesPerSample = 64;
+
+  AllocationSampleBuffer(Thread* self, const AllocationSampler* sampler);
+
+  void VisitRoots(RootVisitor* visitor, const RootInfo& root_info)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+ private:
+  struct Sample {
+    GcRoot<mirror::Class> klass;
+    size_t size;
+    uint16_t first_frame;
+    uint16_t num_frames;
+  };
+
+  struct Frame {
+    ArtMethod* method;
+    uint32_t dex_pc;
+  };
+
+  // Bytes left until the next sample point.
+  size_t bytes_until_sample_;
+  // Whether the current TLAB window ends at the sample point, so that the allocation that
+  // refills the TLAB is the sampled one.
+  bool sample_at_next_window_;
+  // Whether the allocation in progress was selected for sampling.
+  bool record_pending_;
+  uint64_t random_state_;
+
+  size_t num_samples_;
+  size_t num_frames_;
+  std::array<Sample, kMaxSamples> samples_;
+  std::array<Frame, kMaxFrames> frames_;
+
+  friend class AllocationSampler;
+  friend class AllocationSamplerTest;
+
+  DISALLOW_COPY_AND_ASSIGN(AllocationSampleBuffer);
+};
+
+// Poisson-sampled allocation profiler.
+//
+// Each thread samples on average one allocation per `interval` allocated bytes. The sample
+// points are found without a check on the allocation fast paths: the TLAB handed to a thread
+// is cut short at its next sample point, so the allocation that crosses the sample point takes
+// the slow path and refills the TLAB. Allocations outside of TLABs are counted individually.
+//
+// A sampled allocation records its type and stack into the thread's AllocationSampleBuffer.
+// Full buffers are flushed into an aggregate profile that is written in the pprof format, with
+// each sample scaled by the inverse of its sampling probability.
+class AllocationSampler {
+ public:
+  AllocationSampler(size_t interval, const std::string& profile_file);
+
+  size_t GetInterval() const {
+    return interval_;
+  }
+
+  // Returns the number of bytes until the next sample point, drawn from an exponential
+  // distribution with a mean of the interval.
+  size_t NextSampleDistance(AllocationSampleBuffer* buffer) const;
+
+  // Returns the size of the TLAB window to use instead of `window` bytes, for an allocation
+  // that needs at least `min_bytes` of it. Called by the owning thread when refilling its TLAB.
+  size_t AdjustTlabWindow(Thread* self, size_t min_bytes, size_t window);
+
+  // Called for allocations that took the slow path. Counts the bytes of allocations outside
+  // of TLABs and returns whether the allocation should be recorded.
+  bool OnSlowPathAllocation(Thread* self, ObjPtr<mirror::Object> obj, size_t bytes)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Records the type and stack of a sampled allocation.
+  void RecordSample(Thread* self, ObjPtr<mirror::Object> obj, size_t bytes)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+
+  // Moves the samples of the buffer into the aggregate profile.
+  void Flush(AllocationSampleBuffer* buffer)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+
+  // Flushes the buffers of all threads and writes the profile to the profile file, if any.
+  // Suspends all threads. Called on SIGUSR1 and at shutdown.
+  void WriteProfile(Thread* self)
+      REQUIRES(!Locks::mutator_lock_, !Locks::thread_list_lock_, !lock_);
+
+  // Prints the sample counts of the aggregate profile. Samples still in the buffers of the
+  // threads are not counted.
+  void DumpForSigQuit(std::ostream& os) REQUIRES(!lock_);
+
+ private:
+  struct Totals {
+    double objects = 0.0;
+    double bytes = 0.0;
+  };
+
+  uint64_t InternString(const std::string& str) REQUIRES(lock_);
+  uint64_t InternLocation(const std::string& method, const char* file, int32_t line)
+      REQUIRES(lock_);
+
+  // Encodes the aggregate profile as a pprof Profile protocol buffer.
+  std::string EncodeProfile() REQUIRES(lock_);
+
+  const size_t interval_;
+  const std::string profile_file_;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+
+  // The string table of the profile. The first string is always empty.
+  std::vector<std::string> strings_ GUARDED_BY(lock_);
+  std::unordered_map<std::string, uint64_t> string_ids_ GUARDED_BY(lock_);
+  // Functions as (name, file name) string ids. The function id is the index plus one.
+  std::vector<std::pair<uint64_t, uint64_t>> functions_ GUARDED_BY(lock_);
+  std::map<std::pair<uint64_t, uint64_t>, uint64_t> function_ids_ GUARDED_BY(lock_);
+  // Locations as (function id, line). The location id is the index plus one.
+  std::vector<std::pair<uint64_t, int64_t>> locations_ GUARDED_BY(lock_);
+  std::map<std::pair<uint64_t, int64_t>, uint64_t> location_ids_ GUARDED_BY(lock_);
+  // Totals by stack, keyed by the location ids from the innermost frame followed by the string
+  // id of the allocated type.
+  std::map<std::vector<uint64_t>, Totals> totals_ GUARDED_BY(lock_);
+
+  uint64_t num_samples_ GUARDED_BY(lock_);
+  uint64_t num_profiles_written_ GUARDED_BY(lock_);
+
+  friend class AllocationSamplerTest;
+
+  DISALLOW_COPY_AND_ASSIGN(AllocationSampler);
+};
+
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_ALLOCATION_SAMPLER_H_
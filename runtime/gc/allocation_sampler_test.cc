@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "allocation_sampler.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "art_method-inl.h"
+#include "base/casts.h"
+#include "class_linker.h"
+#include "common_runtime_test.h"
+#include "gc_root-inl.h"
+#include "handle_scope-inl.h"
+#include "mirror/class-inl.h"
+#include "scoped_thread_state_change-inl.h"
+
+namespace art {
+namespace gc {
+
+class AllocationSamplerTest : public CommonRuntimeTest {
+ protected:
+  static constexpr size_t kInterval = 1024;
+
+  // A field of a protocol buffer message, with either a varint or a length-delimited value.
+  struct Field {
+    uint32_t number;
+    uint64_t value;
+    std::string bytes;
+  };
+
+  static uint64_t ReadVarint(const std::string& data, size_t* pos) {
+    uint64_t value = 0u;
+    for (uint32_t shift = 0u; ; shift += 7u) {
+      CHECK_LT(*pos, data.size());
+      uint8_t byte = static_cast<uint8_t>(data[*pos]);
+      ++*pos;
+      value |= static_cast<uint64_t>(byte & 0x7fu) << shift;
+      if ((byte & 0x80u) == 0u) {
+        return value;
+      }
+    }
+  }
+
+  static std::vector<Field> Decode(const std::string& data) {
+    std::vector<Field> fields;
+    size_t pos = 0u;
+    while (pos != data.size()) {
+      uint64_t key = ReadVarint(data, &pos);
+      Field field = { static_cast<uint32_t>(key >> 3), 0u, std::string() };
+      if ((key & 7u) == 0u) {
+        field.value = ReadVarint(data, &pos);
+      } else {
+        CHECK_EQ(key & 7u, 2u);
+        size_t size = ReadVarint(data, &pos);
+        CHECK_LE(pos + size, data.size());
+        field.bytes = data.substr(pos, size);
+        pos += size;
+      }
+      fields.push_back(field);
+    }
+    return fields;
+  }
+
+  static std::vector<Field> GetFields(const std::vector<Field>& fields, uint32_t number) {
+    std::vector<Field> result;
+    for (const Field& field : fields) {
+      if (field.number == number) {
+        result.push_back(field);
+      }
+    }
+    return result;
+  }
+
+  static std::vector<uint64_t> DecodePacked(const std::string& data) {
+    std::vector<uint64_t> values;
+    size_t pos = 0u;
+    while (pos != data.size()) {
+      values.push_back(ReadVarint(data, &pos));
+    }
+    return values;
+  }
+
+  static size_t NextSampleDistance(AllocationSampler* sampler, AllocationSampleBuffer* buffer) {
+    return sampler->NextSampleDistance(buffer);
+  }
+
+  // Adds a sample of `size` bytes allocated by `method` to the buffer.
+  static void AddSample(AllocationSampleBuffer* buffer,
+                        ObjPtr<mirror::Class> klass,
+                        size_t size,
+                        ArtMethod* method) REQUIRES_SHARED(Locks::mutator_lock_) {
+    buffer->frames_[buffer->num_frames_] = { method, /* dex_pc= */ 0u };
+    AllocationSampleBuffer::Sample& sample = buffer->samples_[buffer->num_samples_];
+    sample.klass = GcRoot<mirror::Class>(klass);
+    sample.size = size;
+    sample.first_frame = dchecked_integral_cast<uint16_t>(buffer->num_frames_);
+    sample.num_frames = 1u;
+    ++buffer->num_samples_;
+    ++buffer->num_frames_;
+  }
+
+  static std::string EncodeProfile(AllocationSampler* sampler) {
+    MutexLock mu(Thread::Current(), sampler->lock_);
+    return sampler->EncodeProfile();
+  }
+};
+
+TEST_F(AllocationSamplerTest, NextSampleDistance) {
+  AllocationSampler sampler(kInterval, /* profile_file= */ "");
+  AllocationSampleBuffer buffer(Thread::Current(), &sampler);
+  // The distances are exponentially distributed with a mean of the interval, so that a
+  // fraction exp(-1) of them exceeds the interval. Both are checked well outside of the
+  // statistical error for this many draws.
+  constexpr size_t kNumDraws = 100000;
+  double sum = 0.0;
+  size_t num_above_interval = 0u;
+  for (size_t i = 0; i != kNumDraws; ++i) {
+    size_t distance = NextSampleDistance(&sampler, &buffer);
+    ASSERT_GE(distance, 1u);
+    sum += distance;
+    if (distance > kInterval) {
+      ++num_above_interval;
+    }
+  }
+  EXPECT_NEAR(sum / kNumDraws, kInterval, 0.03 * kInterval);
+  EXPECT_NEAR(static_cast<double>(num_above_interval) / kNumDraws, std::exp(-1.0), 0.02);
+}
+
+TEST_F(AllocationSamplerTest, EncodeProfile) {
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  AllocationSampler sampler(kInterval, /* profile_file= */ "");
+  AllocationSampleBuffer buffer(self, &sampler);
+
+  StackHandleScope<1> hs(self);
+  Handle<mirror::Class> klass =
+      hs.NewHandle(class_linker_->FindSystemClass(self, "Ljava/lang/Object;"));
+  ASSERT_TRUE(klass != nullptr);
+  ArtMethod* method =
+      klass->FindClassMethod("toString", "()Ljava/lang/String;", kRuntimePointerSize);
+  ASSERT_TRUE(method != nullptr);
+  // Two samples with the same stack and type are aggregated.
+  AddSample(&buffer, klass.Get(), kInterval, method);
+  AddSample(&buffer, klass.Get(), kInterval, method);
+  sampler.Flush(&buffer);
+  EXPECT_EQ(0u, buffer.num_samples_);
+
+  std::vector<Field> profile = Decode(EncodeProfile(&sampler));
+  std::vector<std::string> strings;
+  for (const Field& field : GetFields(profile, /* string_table */ 6)) {
+    strings.push_back(field.bytes);
+  }
+  ASSERT_FALSE(strings.empty());
+  EXPECT_EQ("", strings[0]);
+
+  // Each sample of `kInterval` bytes is scaled by 1 / (1 - exp(-1)).
+  std::vector<Field> samples = GetFields(profile, /* sample */ 2);
+  ASSERT_EQ(1u, samples.size());
+  std::vector<Field> sample = Decode(samples[0].bytes);
+  std::vector<Field> location_ids = GetFields(sample, /* location_id */ 1);
+  ASSERT_EQ(1u, location_ids.size());
+  EXPECT_EQ(std::vector<uint64_t>({ 1u }), DecodePacked(location_ids[0].bytes));
+  std::vector<Field> values = GetFields(sample, /* value */ 2);
+  ASSERT_EQ(1u, values.size());
+  const double scale = 2.0 / (1.0 - std::exp(-1.0));
+  EXPECT_EQ(std::vector<uint64_t>({ static_cast<uint64_t>(std::llround(scale)),
+                                    static_cast<uint64_t>(std::llround(scale * kInterval)) }),
+            DecodePacked(values[0].bytes));
+  std::vector<Field> labels = GetFields(sample, /* label */ 3);
+  ASSERT_EQ(1u, labels.size());
+  std::vector<Field> label = Decode(labels[0].bytes);
+  ASSERT_EQ(2u, label.size());
+  ASSERT_LT(label[0].value, strings.size());
+  ASSERT_LT(label[1].value, strings.size());
+  EXPECT_EQ("class", strings[label[0].value]);
+  EXPECT_EQ("java.lang.Object", strings[label[1].value]);
+
+  // The location refers to the function of the allocating method.
+  std::vector<Field> locations = GetFields(profile, /* location */ 4);
+  ASSERT_EQ(1u, locations.size());
+  std::vector<Field> location = Decode(locations[0].bytes);
+  EXPECT_EQ(1u, GetFields(location, /* id */ 1)[0].value);
+  std::vector<Field> line = Decode(GetFields(location, /* line */ 4)[0].bytes);
+  EXPECT_EQ(1u, GetFields(line, /* function_id */ 1)[0].value);
+  std::vector<Field> functions = GetFields(profile, /* function */ 5);
+  ASSERT_EQ(1u, functions.size());
+  std::vector<Field> function = Decode(functions[0].bytes);
+  EXPECT_EQ(1u, GetFields(function, /* id */ 1)[0].value);
+  uint64_t name = GetFields(function, /* name */ 2)[0].value;
+  uint64_t file_name = GetFields(function, /* filename */ 4)[0].value;
+  ASSERT_LT(name, strings.size());
+  ASSERT_LT(file_name, strings.size());
+  EXPECT_EQ(method->PrettyMethod(), strings[name]);
+  EXPECT_EQ("Object.java", strings[file_name]);
+
+  // Two value types, and the sampling interval as the period.
+  EXPECT_EQ(2u, GetFields(profile, /* sample_type */ 1).size());
+  std::vector<Field> period = GetFields(profile, /* period */ 12);
+  ASSERT_EQ(1u, period.size());
+  EXPECT_EQ(kInterval, period[0].value);
+}
+
+}  // namespace gc
+}  // namespace art
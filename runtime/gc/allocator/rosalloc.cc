@@ -62,7 +62,8 @@ RosAlloc::RosAlloc(void* base, size_t capacity, size_t max_capacity,
       bulk_free_lock_("rosalloc bulk free lock", kRosAllocBulkFreeLock),
       page_release_mode_(page_release_mode),
       page_release_size_threshold_(page_release_size_threshold),
-      is_running_on_memory_tool_(running_on_memory_tool) {
+      is_running_on_memory_tool_(running_on_memory_tool),
+      release_pages_cursor_(base_) {
   DCHECK_ALIGNED(base, kPageSize);
   DCHECK_EQ(RoundUp(capacity, kPageSize), capacity);
   DCHECK_EQ(RoundUp(max_capacity, kPageSize), max_capacity);
@@ -2035,6 +2036,54 @@ size_t RosAlloc::ReleasePages() {
   return reclaimed_bytes;
 }
 
+size_t RosAlloc::ReleasePagesIncrementally(size_t max_bytes) {
+  DCHECK(!DoesReleaseAllPages());
+  Thread* self = Thread::Current();
+  size_t reclaimed_bytes = 0;
+  while (reclaimed_bytes < max_bytes) {
+    MutexLock mu(self, lock_);
+    auto it = free_page_runs_.lower_bound(reinterpret_cast<FreePageRun*>(release_pages_cursor_));
+    if (it == free_page_runs_.end()) {
+      // Start over from the beginning of the space in the next call.
+      release_pages_cursor_ = base_;
+      break;
+    }
+    uint8_t* start = reinterpret_cast<uint8_t*>(*it);
+    uint8_t* end = start + (*it)->ByteSize(this);
+    release_pages_cursor_ = end;
+    // Avoid the madvise() call for runs that were already released.
+    if (CountPageBytes(start, end, kPageMapEmpty) != 0u) {
+      reclaimed_bytes += ReleasePageRange(start, end);
+    }
+  }
+  VLOG(heap) << "RosAlloc::ReleasePagesIncrementally() reclaimed " << reclaimed_bytes;
+  return reclaimed_bytes;
+}
+
+size_t RosAlloc::CommittedBytes() {
+  MutexLock mu(Thread::Current(), lock_);
+  size_t released_bytes = 0;
+  for (FreePageRun* fpr : free_page_runs_) {
+    uint8_t* start = reinterpret_cast<uint8_t*>(fpr);
+    released_bytes += CountPageBytes(start, start + fpr->ByteSize(this), kPageMapReleased);
+  }
+  DCHECK_LE(released_bytes, footprint_);
+  return footprint_ - released_bytes;
+}
+
+size_t RosAlloc::CountPageBytes(uint8_t* start, uint8_t* end, uint8_t kind) {
+  DCHECK_LT(start, end);
+  size_t bytes = 0;
+  const size_t start_idx = ToPageMapIndex(start);
+  const size_t end_idx = start_idx + (end - start) / kPageSize;
+  for (size_t i = start_idx; i < end_idx; ++i) {
+    if (page_map_[i] == kind) {
+      bytes += kPageSize;
+    }
+  }
+  return bytes;
+}
+
 size_t RosAlloc::ReleasePageRange(uint8_t* start, uint8_t* end) {
   DCHECK_ALIGNED(start, kPageSize);
   DCHECK_ALIGNED(end, kPageSize);
@@ -771,6 +771,9 @@ class RosAlloc {
   // Whether this allocator is running on a memory tool.
   bool is_running_on_memory_tool_;
 
+  // Where ReleasePagesIncrementally() continues from.
+  uint8_t* release_pages_cursor_ GUARDED_BY(lock_);
+
   // The base address of the memory region that's managed by this allocator.
   uint8_t* Begin() { return base_; }
   // The end address of the memory region that's managed by this allocator.
@@ -820,6 +823,8 @@ class RosAlloc {
 
   // Release a range of pages.
   size_t ReleasePageRange(uint8_t* start, uint8_t* end) REQUIRES(lock_);
+  // Count the bytes of the pages in [start, end) that have the given page map kind.
+  size_t CountPageBytes(uint8_t* start, uint8_t* end, uint8_t kind) REQUIRES(lock_);
 
   // Dumps the page map for debugging.
   std::string DumpPageMap() REQUIRES(lock_);
@@ -887,6 +892,12 @@ class RosAlloc {
 
   // Release empty pages.
   size_t ReleasePages() REQUIRES(!lock_);
+  // Release the empty pages of free page runs until about `max_bytes` were released, starting
+  // after the run released by the previous call. Unlike ReleasePages(), the lock is only held
+  // for one run at a time.
+  size_t ReleasePagesIncrementally(size_t max_bytes) REQUIRES(!lock_);
+  // Returns the footprint minus the free pages that were released to the OS.
+  size_t CommittedBytes() REQUIRES(!lock_);
   // Returns the current footprint.
   size_t Footprint() REQUIRES(!lock_);
   // Returns the current capacity, maximum footprint.
@@ -3411,8 +3411,13 @@ mirror::Object* ConcurrentCopying::Copy(Thread* const self,
   size_t bytes_allocated = 0U;
   size_t dummy;
   bool fall_back_to_non_moving = false;
+  // Keep the object on the NUMA node it was allocated on, if the region space is NUMA aware.
   mirror::Object* to_ref = region_space_->AllocNonvirtual</*kForEvac=*/ true>(
-      region_space_alloc_size, &region_space_bytes_allocated, nullptr, &dummy);
+      region_space_alloc_size,
+      &region_space_bytes_allocated,
+      nullptr,
+      &dummy,
+      region_space_->GetNumaNodeForRef(from_ref));
   bytes_allocated = region_space_bytes_allocated;
   if (LIKELY(to_ref != nullptr)) {
     DCHECK_EQ(region_space_alloc_size, region_space_bytes_allocated);
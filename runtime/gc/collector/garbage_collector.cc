@@ -85,6 +85,8 @@ void GarbageCollector::ResetCumulativeStatistics() {
   total_time_ns_ = 0u;
   total_freed_objects_ = 0u;
   total_freed_bytes_ = 0;
+  total_reference_processing_time_ns_ = 0u;
+  total_cleared_references_ = 0u;
   rss_histogram_.Reset();
   freed_bytes_histogram_.Reset();
   MutexLock mu(Thread::Current(), pause_histogram_lock_);
@@ -223,6 +225,8 @@ void GarbageCollector::ResetMeasurements() {
   total_time_ns_ = 0u;
   total_freed_objects_ = 0u;
   total_freed_bytes_ = 0;
+  total_reference_processing_time_ns_ = 0u;
+  total_cleared_references_ = 0u;
 }
 
 GarbageCollector::ScopedPause::ScopedPause(GarbageCollector* collector, bool with_reporting)
@@ -266,6 +270,11 @@ void GarbageCollector::RecordFreeLOS(const ObjectBytePair& freed) {
   heap_->RecordFree(freed.objects, freed.bytes);
 }
 
+void GarbageCollector::RecordReferenceProcessing(uint64_t duration_ns, size_t cleared_references) {
+  total_reference_processing_time_ns_ += duration_ns;
+  total_cleared_references_ += cleared_references;
+}
+
 uint64_t GarbageCollector::GetTotalPausedTimeNs() {
   MutexLock mu(Thread::Current(), pause_histogram_lock_);
   return pause_histogram_.AdjustedSum();
@@ -320,6 +329,12 @@ void GarbageCollector::DumpPerformanceInfo(std::ostream& os) {
      << "  per cpu-time: "
      << static_cast<uint64_t>(freed_bytes / cpu_seconds) << "/s / "
      << PrettySize(freed_bytes / cpu_seconds) << "/s\n";
+  if (total_reference_processing_time_ns_ != 0u) {
+    os << GetName() << " reference processing total time: "
+       << PrettyDuration(total_reference_processing_time_ns_)
+       << " mean time: " << PrettyDuration(total_reference_processing_time_ns_ / iterations)
+       << " cleared references: " << total_cleared_references_ << "\n";
+  }
 }
 
 }  // namespace collector
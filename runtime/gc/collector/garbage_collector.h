@@ -109,6 +109,9 @@ class GarbageCollector : public RootVisitor, public IsMarkedVisitor, public Mark
   void RecordFree(const ObjectBytePair& freed);
   // Record a free of large objects.
   void RecordFreeLOS(const ObjectBytePair& freed);
+  // Record the time spent in the reference processor and the number of references it cleared,
+  // including finalizer references enqueued for finalization.
+  void RecordReferenceProcessing(uint64_t duration_ns, size_t cleared_references);
   virtual void DumpPerformanceInfo(std::ostream& os) REQUIRES(!pause_histogram_lock_);
 
   // Extract RSS for GC-specific memory ranges using mincore().
@@ -160,6 +163,8 @@ class GarbageCollector : public RootVisitor, public IsMarkedVisitor, public Mark
   uint64_t total_time_ns_;
   uint64_t total_freed_objects_;
   int64_t total_freed_bytes_;
+  uint64_t total_reference_processing_time_ns_;
+  uint64_t total_cleared_references_;
   CumulativeLogger cumulative_timings_;
   mutable Mutex pause_histogram_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   bool is_transaction_active_;
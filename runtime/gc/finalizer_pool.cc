@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "finalizer_pool.h"
+
+#include <algorithm>
+#include <ostream>
+
+#include "base/logging.h"
+#include "base/time_utils.h"
+#include "gc_root-inl.h"
+#include "handle_scope-inl.h"
+#include "jni/jni_env_ext.h"
+#include "mirror/object-inl.h"
+#include "mirror/reference-inl.h"
+#include "mirror/throwable.h"
+#include "nativehelper/scoped_local_ref.h"
+#include "reflection.h"
+#include "runtime.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread.h"
+#include "thread_pool.h"
+#include "well_known_classes.h"
+
+namespace art {
+namespace gc {
+
+class FinalizerPool::FinalizeTask : public SelfDeletingTask {
+ public:
+  explicit FinalizeTask(FinalizerPool* pool) : pool_(pool) {}
+
+  void Run(Thread* self) override {
+    pool_->FinalizeBatch(self);
+  }
+
+ private:
+  FinalizerPool* const pool_;
+};
+
+FinalizerPool::FinalizerPool(size_t thread_count, size_t backpressure_threshold)
+    : thread_count_(thread_count),
+      backpressure_threshold_(backpressure_threshold),
+      started_(false),
+      lock_("finalizer pool lock"),
+      cond_("finalizer pool condition", lock_),
+      pending_(0u),
+      peak_pending_(0u),
+      total_enqueued_(0u),
+      total_finalized_(0u),
+      slow_finalizers_(0u),
+      backpressure_waits_(0u),
+      backpressure_wait_ns_(0u),
+      has_stuck_threads_(false) {}
+
+FinalizerPool::~FinalizerPool() {}
+
+void FinalizerPool::Start(Thread* self) {
+  DCHECK(thread_pool_ == nullptr);
+  thread_pool_.reset(
+      new ThreadPool("Finalizer thread pool", thread_count_, /*create_peers=*/ true));
+  thread_pool_->StartWorkers(self);
+  started_.store(true, std::memory_order_release);
+}
+
+void FinalizerPool::Stop(Thread* self) {
+  if (!IsStarted()) {
+    return;
+  }
+  started_.store(false, std::memory_order_release);
+  thread_pool_->WaitForWorkersToBeCreated();
+  thread_pool_->StopWorkers(self);
+  // Tasks that start from now on return without finalizing, wait for the running ones.
+  const uint64_t timeout_ms = Runtime::Current()->GetFinalizerTimeoutMs();
+  const uint64_t end_time = NanoTime() + MsToNs(timeout_ms);
+  {
+    MutexLock mu(self, lock_);
+    while (!running_threads_.empty()) {
+      const uint64_t now = NanoTime();
+      if (now >= end_time) {
+        LOG(WARNING) << running_threads_.size() << " finalizer pool threads still running after "
+                     << timeout_ms << "ms, not waiting for them";
+        has_stuck_threads_.store(true, std::memory_order_relaxed);
+        return;
+      }
+      const uint64_t remaining_ns = end_time - now;
+      cond_.TimedWait(self, NsToMs(remaining_ns), remaining_ns % MsToNs(1));
+    }
+  }
+  // Keep the pool itself, a GC that found the pool started may still add tasks to it.
+  thread_pool_->DeleteThreads();
+}
+
+void FinalizerPool::AddReferences(Thread* self, ObjPtr<mirror::Reference> list) {
+  DCHECK(list != nullptr);
+  // Cut the list into circular batches, each held by its last reference like the list itself.
+  size_t num_batches = 0u;
+  size_t num_references = 0u;
+  {
+    MutexLock mu(self, lock_);
+    ObjPtr<mirror::Reference> ref = list->GetPendingNext();
+    while (true) {
+      ObjPtr<mirror::Reference> first = ref;
+      ObjPtr<mirror::Reference> last = ref;
+      size_t count = 1u;
+      while (last != list && count != kReferencesPerTask) {
+        last = last->GetPendingNext();
+        ++count;
+      }
+      ref = last->GetPendingNext();
+      last->SetPendingNext(first);
+      batches_.push_back(GcRoot<mirror::Reference>(last));
+      ++num_batches;
+      num_references += count;
+      if (last == list) {
+        break;
+      }
+    }
+  }
+  total_enqueued_.fetch_add(num_references, std::memory_order_relaxed);
+  size_t pending = pending_.fetch_add(num_references, std::memory_order_relaxed) + num_references;
+  size_t peak = peak_pending_.load(std::memory_order_relaxed);
+  while (pending > peak &&
+         !peak_pending_.compare_exchange_weak(peak, pending, std::memory_order_relaxed)) {
+  }
+  for (size_t i = 0; i != num_batches; ++i) {
+    thread_pool_->AddTask(self, new FinalizeTask(this));
+  }
+}
+
+void FinalizerPool::FinalizeBatch(Thread* self) {
+  {
+    // Checked under the lock, so that Stop() either sees the thread running or the thread sees
+    // the pool stopped and leaves the batch alone.
+    MutexLock mu(self, lock_);
+    if (!IsStarted()) {
+      return;
+    }
+    running_threads_.push_back(self);
+  }
+  size_t num_finalized = 0u;
+  {
+    ScopedObjectAccess soa(self);
+    JNIEnv* env = soa.Env();
+    StackHandleScope<1> hs(self);
+    MutableHandle<mirror::Reference> batch = hs.NewHandle<mirror::Reference>(nullptr);
+    {
+      MutexLock mu(self, lock_);
+      DCHECK(!batches_.empty());
+      batch.Assign(batches_.front().Read());
+      batches_.pop_front();
+    }
+    bool done = false;
+    while (!done) {
+      ScopedLocalRef<jobject> reference(env, nullptr);
+      ScopedLocalRef<jobject> zombie(env, nullptr);
+      {
+        // Unlink the first reference, the rest of the batch stays reachable from the handle.
+        ObjPtr<mirror::Reference> head = batch.Get();
+        ObjPtr<mirror::Reference> ref = head->GetPendingNext();
+        done = (ref == head);
+        if (!done) {
+          head->SetPendingNext(ref->GetPendingNext());
+        }
+        // Mark the reference as enqueued, like java.lang.ref.ReferenceQueue does.
+        ref->SetPendingNext(ref);
+        ObjPtr<mirror::FinalizerReference> finalizer_ref = ref->AsFinalizerReference();
+        reference.reset(soa.AddLocalReference<jobject>(finalizer_ref));
+        zombie.reset(soa.AddLocalReference<jobject>(finalizer_ref->GetZombie()));
+        // Same as FinalizerReference.clear().
+        finalizer_ref->SetZombie<false>(nullptr);
+      }
+      FinalizeReference(soa, reference.get(), zombie.get());
+      ++num_finalized;
+    }
+  }
+  total_finalized_.fetch_add(num_finalized, std::memory_order_relaxed);
+  pending_.fetch_sub(num_finalized, std::memory_order_release);
+  MutexLock mu(self, lock_);
+  running_threads_.erase(std::find(running_threads_.begin(), running_threads_.end(), self));
+  cond_.Broadcast(self);
+}
+
+void FinalizerPool::FinalizeReference(const ScopedObjectAccess& soa,
+                                      jobject reference,
+                                      jobject zombie) {
+  Thread* self = soa.Self();
+  jvalue args[1];
+  args[0].l = reference;
+  InvokeWithJValues(soa, nullptr, WellKnownClasses::java_lang_ref_FinalizerReference_remove, args);
+  if (zombie != nullptr && !self->IsExceptionPending()) {
+    const uint64_t start_time = NanoTime();
+    InvokeVirtualOrInterfaceWithJValues(
+        soa, zombie, WellKnownClasses::java_lang_Object_finalize, nullptr);
+    const uint64_t duration_ms = NsToMs(NanoTime() - start_time);
+    if (duration_ms > Runtime::Current()->GetFinalizerTimeoutMs()) {
+      slow_finalizers_.fetch_add(1u, std::memory_order_relaxed);
+      LOG(WARNING) << soa.Decode<mirror::Object>(zombie)->PrettyTypeOf()
+                   << ".finalize() took " << duration_ms << "ms";
+    }
+  }
+  if (self->IsExceptionPending()) {
+    LOG(WARNING) << "Uncaught exception thrown by finalizer: " << self->GetException()->Dump();
+    self->ClearException();
+  }
+}
+
+bool FinalizerPool::IsWorker(Thread* self) {
+  MutexLock mu(self, lock_);
+  return std::find(running_threads_.begin(), running_threads_.end(), self) !=
+         running_threads_.end();
+}
+
+uint64_t FinalizerPool::WaitForPending(Thread* self, size_t max_pending, uint64_t timeout_ms) {
+  const uint64_t start_time = NanoTime();
+  const uint64_t end_time = start_time + MsToNs(timeout_ms);
+  MutexLock mu(self, lock_);
+  while (pending_.load(std::memory_order_acquire) > max_pending) {
+    if (timeout_ms == 0u) {
+      cond_.Wait(self);
+      continue;
+    }
+    const uint64_t now = NanoTime();
+    if (now >= end_time) {
+      break;
+    }
+    const uint64_t remaining_ns = end_time - now;
+    cond_.TimedWait(self, NsToMs(remaining_ns), remaining_ns % MsToNs(1));
+  }
+  return NanoTime() - start_time;
+}
+
+void FinalizerPool::WaitForBackpressure(Thread* self) {
+  if (LIKELY(pending_.load(std::memory_order_relaxed) <= backpressure_threshold_) ||
+      !IsStarted() ||
+      IsWorker(self)) {
+    return;
+  }
+  const uint64_t wait_ns = WaitForPending(self, backpressure_threshold_, kMaxBackpressureWaitMs);
+  backpressure_waits_.fetch_add(1u, std::memory_order_relaxed);
+  backpressure_wait_ns_.fetch_add(wait_ns, std::memory_order_relaxed);
+}
+
+void FinalizerPool::WaitForCompletion(Thread* self, uint64_t timeout_ms) {
+  if (IsStarted() && !IsWorker(self)) {
+    WaitForPending(self, /*max_pending=*/ 0u, timeout_ms);
+  }
+}
+
+void FinalizerPool::VisitRoots(RootVisitor* visitor) {
+  MutexLock mu(Thread::Current(), lock_);
+  BufferedRootVisitor<kDefaultBufferedRootCount> buffered_visitor(
+      visitor, RootInfo(kRootVMInternal));
+  for (GcRoot<mirror::Reference>& root : batches_) {
+    buffered_visitor.VisitRoot(root);
+  }
+}
+
+void FinalizerPool::DumpForSigQuit(std::ostream& os) {
+  os << "Finalizer pool: " << thread_count_ << " threads, pending references: "
+     << pending_.load(std::memory_order_relaxed) << " (peak "
+     << peak_pending_.load(std::memory_order_relaxed) << ", backpressure threshold "
+     << backpressure_threshold_ << ")\n";
+  os << "Finalized references: " << total_finalized_.load(std::memory_order_relaxed) << " of "
+     << total_enqueued_.load(std::memory_order_relaxed) << ", slow finalizers: "
+     << slow_finalizers_.load(std::memory_order_relaxed) << "\n";
+  os << "Native allocations waiting for finalizers: "
+     << backpressure_waits_.load(std::memory_order_relaxed) << ", total wait time: "
+     << PrettyDuration(backpressure_wait_ns_.load(std::memory_order_relaxed)) << "\n";
+}
+
+}  // namespace gc
+}  // namespace art
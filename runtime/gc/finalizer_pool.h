@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_FINALIZER_POOL_H_
+#define ART_RUNTIME_GC_FINALIZER_POOL_H_
+
+#include <atomic>
+#include <deque>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+#include "base/locks.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "gc_root.h"
+#include "jni.h"
+#include "obj_ptr.h"
+
+namespace art {
+
+class RootVisitor;
+class ScopedObjectAccess;
+class Thread;
+class ThreadPool;
+
+namespace mirror {
+class Reference;
+}  // namespace mirror
+
+namespace gc {
+
+// Runs the finalizers of the references cleared by the GC on a pool of threads, instead of
+// handing them to the single FinalizerDaemon through java.lang.ref.ReferenceQueue. Enabled with
+// -XX:FinalizerThreadCount.
+//
+// References are finalized in batches, the same way as the FinalizerDaemon does: the reference
+// is removed from the FinalizerReference list, its zombie is cleared and finalize() is called.
+// Batches waiting for a thread are held in a native queue whose roots are visited by the GC,
+// rather than by JNI global references, so that a large backlog cannot exhaust the global
+// reference table.
+// A finalizer running longer than the finalizer timeout only holds back one thread of the pool,
+// so it is logged instead of aborting the runtime like the FinalizerWatchdogDaemon does.
+//
+// Threads registering native allocations wait for the pool while more references than the
+// backpressure threshold are pending, so that native memory released by finalizers is not
+// outpaced by new allocations.
+class FinalizerPool {
+ public:
+  // Number of references finalized by each task.
+  static constexpr size_t kReferencesPerTask = 128;
+  // Longest time a native allocation waits for the pending references to drain.
+  static constexpr uint64_t kMaxBackpressureWaitMs = 100;
+
+  FinalizerPool(size_t thread_count, size_t backpressure_threshold);
+  ~FinalizerPool();
+
+  // Creates the threads of the pool. The threads have peers, so this is called once the runtime
+  // is started, and never in the zygote.
+  void Start(Thread* self) REQUIRES(!Locks::mutator_lock_);
+
+  // Deletes the threads. References still pending are not finalized. If a thread is still
+  // running a finalizer after the finalizer timeout, the threads are left running instead so that
+  // a stuck finalizer does not hang the shutdown, and the pool must then be leaked.
+  void Stop(Thread* self) REQUIRES(!Locks::mutator_lock_, !lock_);
+
+  bool IsStarted() const {
+    return started_.load(std::memory_order_acquire);
+  }
+
+  // Returns whether Stop() left threads running. They still refer to the pool.
+  bool HasStuckThreads() const {
+    return has_stuck_threads_.load(std::memory_order_relaxed);
+  }
+
+  // Schedules the finalization of a circular list of cleared finalizer references, linked through
+  // their pendingNext field.
+  void AddReferences(Thread* self, ObjPtr<mirror::Reference> list)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+
+  // Blocks while more references than the backpressure threshold are pending, for at most
+  // kMaxBackpressureWaitMs. Does nothing on the threads of the pool.
+  void WaitForBackpressure(Thread* self) REQUIRES(!Locks::mutator_lock_, !lock_);
+
+  // Waits until the pending references are finalized, for at most `timeout_ms` unless zero.
+  void WaitForCompletion(Thread* self, uint64_t timeout_ms)
+      REQUIRES(!Locks::mutator_lock_, !lock_);
+
+  // Visits the batches that are not taken by a thread yet.
+  void VisitRoots(RootVisitor* visitor) REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!lock_);
+
+  // Prints the queue depth and the backpressure counts.
+  void DumpForSigQuit(std::ostream& os);
+
+ private:
+  class FinalizeTask;
+
+  // Takes the oldest batch from the queue and finalizes its references, in list order.
+  void FinalizeBatch(Thread* self) REQUIRES(!Locks::mutator_lock_, !lock_);
+
+  void FinalizeReference(const ScopedObjectAccess& soa, jobject reference, jobject zombie)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Returns whether `self` is running a task of the pool.
+  bool IsWorker(Thread* self) REQUIRES(!lock_);
+
+  // Waits until at most `max_pending` references are pending or `timeout_ms` elapsed.
+  // Returns the time waited in nanoseconds.
+  uint64_t WaitForPending(Thread* self, size_t max_pending, uint64_t timeout_ms)
+      REQUIRES(!Locks::mutator_lock_, !lock_);
+
+  const size_t thread_count_;
+  const size_t backpressure_threshold_;
+
+  std::unique_ptr<ThreadPool> thread_pool_;
+  std::atomic<bool> started_;
+
+  // Guards the queue of batches, and used to wait for the pending references to drain.
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  ConditionVariable cond_ GUARDED_BY(lock_);
+
+  // Batches waiting for a thread, each a circular list held by its last reference. There is one
+  // task in the thread pool for each batch.
+  std::deque<GcRoot<mirror::Reference>> batches_ GUARDED_BY(lock_);
+  // Threads currently running a task. Unlike the workers of the thread pool, this does not
+  // change under the feet of readers while the pool is stopped.
+  std::vector<Thread*> running_threads_ GUARDED_BY(lock_);
+  std::atomic<bool> has_stuck_threads_;
+
+  std::atomic<size_t> pending_;
+  std::atomic<size_t> peak_pending_;
+  std::atomic<uint64_t> total_enqueued_;
+  std::atomic<uint64_t> total_finalized_;
+  std::atomic<uint64_t> slow_finalizers_;
+  std::atomic<uint64_t> backpressure_waits_;
+  std::atomic<uint64_t> backpressure_wait_ns_;
+
+  friend class FinalizerPoolTest;
+
+  DISALLOW_COPY_AND_ASSIGN(FinalizerPool);
+};
+
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_FINALIZER_POOL_H_
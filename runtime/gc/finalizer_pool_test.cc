@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "finalizer_pool.h"
+
+#include <vector>
+
+#include "base/time_utils.h"
+#include "common_runtime_test.h"
+#include "gc_root-inl.h"
+#include "mirror/object-inl.h"
+#include "mirror/reference-inl.h"
+#include "nativehelper/scoped_local_ref.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread_pool.h"
+#include "well_known_classes.h"
+
+namespace art {
+namespace gc {
+
+class FinalizerPoolTest : public CommonRuntimeTest {
+ protected:
+  void SetUp() override {
+    CommonRuntimeTest::SetUp();
+    // To create the peers of the pool threads, the runtime needs to be started.
+    Thread::Current()->TransitionFromSuspendedToRunnable();
+    bool started = runtime_->Start();
+    ASSERT_TRUE(started);
+  }
+
+  // Registers `count` objects for finalization and links their references through pendingNext,
+  // like the GC does once the objects are unreachable. Returns global references to them in list
+  // order, the last one holding the circular list.
+  std::vector<jobject> CreateFinalizerReferences(JNIEnv* env, size_t count) {
+    ScopedLocalRef<jclass> object_class(env, env->FindClass("java/lang/Object"));
+    ScopedLocalRef<jclass> finalizer_reference_class(
+        env, env->FindClass("java/lang/ref/FinalizerReference"));
+    jfieldID head_field = env->GetStaticFieldID(
+        finalizer_reference_class.get(), "head", "Ljava/lang/ref/FinalizerReference;");
+    CHECK(head_field != nullptr);
+    std::vector<jobject> references;
+    for (size_t i = 0; i != count; ++i) {
+      ScopedLocalRef<jobject> object(env, env->AllocObject(object_class.get()));
+      env->CallStaticVoidMethod(finalizer_reference_class.get(),
+                                WellKnownClasses::java_lang_ref_FinalizerReference_add,
+                                object.get());
+      ScopedLocalRef<jobject> reference(
+          env, env->GetStaticObjectField(finalizer_reference_class.get(), head_field));
+      references.push_back(env->NewGlobalRef(reference.get()));
+    }
+    ScopedObjectAccess soa(env);
+    for (size_t i = 0; i != count; ++i) {
+      ObjPtr<mirror::FinalizerReference> finalizer_ref =
+          soa.Decode<mirror::FinalizerReference>(references[i]);
+      finalizer_ref->SetZombie<false>(finalizer_ref->GetReferent());
+      finalizer_ref->ClearReferent<false>();
+      finalizer_ref->SetPendingNext(soa.Decode<mirror::Reference>(references[(i + 1) % count]));
+    }
+    return references;
+  }
+
+  static void DeleteReferences(JNIEnv* env, const std::vector<jobject>& references) {
+    for (jobject reference : references) {
+      env->DeleteGlobalRef(reference);
+    }
+  }
+
+  static ThreadPool* GetThreadPool(FinalizerPool* pool) {
+    return pool->thread_pool_.get();
+  }
+
+  // Returns the number of references in each queued batch.
+  static std::vector<size_t> GetBatchSizes(FinalizerPool* pool)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    MutexLock mu(Thread::Current(), pool->lock_);
+    std::vector<size_t> sizes;
+    for (GcRoot<mirror::Reference>& root : pool->batches_) {
+      ObjPtr<mirror::Reference> last = root.Read();
+      size_t size = 1u;
+      for (ObjPtr<mirror::Reference> ref = last->GetPendingNext(); ref != last;
+           ref = ref->GetPendingNext()) {
+        ++size;
+      }
+      sizes.push_back(size);
+    }
+    return sizes;
+  }
+
+  static size_t GetPending(FinalizerPool* pool) {
+    return pool->pending_.load();
+  }
+
+  static void SetPending(FinalizerPool* pool, size_t pending) {
+    pool->pending_.store(pending);
+  }
+
+  static uint64_t GetTotalFinalized(FinalizerPool* pool) {
+    return pool->total_finalized_.load();
+  }
+
+  static uint64_t GetBackpressureWaits(FinalizerPool* pool) {
+    return pool->backpressure_waits_.load();
+  }
+};
+
+TEST_F(FinalizerPoolTest, Batching) {
+  Thread* self = Thread::Current();
+  JNIEnv* env = self->GetJniEnv();
+  constexpr size_t kNumReferences = 2u * FinalizerPool::kReferencesPerTask + 1u;
+  std::vector<jobject> references = CreateFinalizerReferences(env, kNumReferences);
+
+  FinalizerPool pool(/*thread_count=*/ 2u, /*backpressure_threshold=*/ kNumReferences);
+  pool.Start(self);
+  // Keep the tasks from running while the batches are checked.
+  GetThreadPool(&pool)->StopWorkers(self);
+  {
+    ScopedObjectAccess soa(self);
+    pool.AddReferences(self, soa.Decode<mirror::Reference>(references.back()));
+    std::vector<size_t> expected_sizes = {
+        FinalizerPool::kReferencesPerTask, FinalizerPool::kReferencesPerTask, 1u };
+    EXPECT_EQ(expected_sizes, GetBatchSizes(&pool));
+  }
+  EXPECT_EQ(kNumReferences, GetPending(&pool));
+
+  GetThreadPool(&pool)->StartWorkers(self);
+  pool.WaitForCompletion(self, /*timeout_ms=*/ 0u);
+  EXPECT_EQ(0u, GetPending(&pool));
+  EXPECT_EQ(kNumReferences, GetTotalFinalized(&pool));
+  {
+    ScopedObjectAccess soa(self);
+    EXPECT_TRUE(GetBatchSizes(&pool).empty());
+    for (jobject reference : references) {
+      // Enqueued and cleared, like the FinalizerDaemon leaves them.
+      ObjPtr<mirror::FinalizerReference> finalizer_ref =
+          soa.Decode<mirror::FinalizerReference>(reference);
+      EXPECT_EQ(finalizer_ref, finalizer_ref->GetPendingNext());
+      EXPECT_EQ(nullptr, finalizer_ref->GetZombie());
+    }
+  }
+
+  pool.Stop(self);
+  EXPECT_FALSE(pool.HasStuckThreads());
+  DeleteReferences(env, references);
+}
+
+TEST_F(FinalizerPoolTest, Backpressure) {
+  Thread* self = Thread::Current();
+  constexpr size_t kThreshold = 4u;
+  FinalizerPool pool(/*thread_count=*/ 1u, kThreshold);
+
+  // Allocations do not wait for a pool that is not started.
+  SetPending(&pool, kThreshold + 1u);
+  pool.WaitForBackpressure(self);
+  EXPECT_EQ(0u, GetBackpressureWaits(&pool));
+
+  pool.Start(self);
+  SetPending(&pool, kThreshold);
+  pool.WaitForBackpressure(self);
+  EXPECT_EQ(0u, GetBackpressureWaits(&pool));
+
+  // Nothing finalizes these references, so the wait is cut short by the maximum wait time.
+  SetPending(&pool, kThreshold + 1u);
+  const uint64_t start_time = NanoTime();
+  pool.WaitForBackpressure(self);
+  EXPECT_GE(NanoTime() - start_time, MsToNs(FinalizerPool::kMaxBackpressureWaitMs));
+  EXPECT_EQ(1u, GetBackpressureWaits(&pool));
+
+  SetPending(&pool, 0u);
+  pool.Stop(self);
+}
+
+}  // namespace gc
+}  // namespace art
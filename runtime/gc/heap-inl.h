@@ -25,6 +25,7 @@
 #include "gc/accounting/atomic_stack.h"
 #include "gc/accounting/card_table-inl.h"
 #include "gc/allocation_record.h"
+#include "gc/allocation_sampler.h"
 #include "gc/collector/semi_space.h"
 #include "gc/space/bump_pointer_space-inl.h"
 #include "gc/space/dlmalloc_space-inl.h"
@@ -82,6 +83,8 @@ inline mirror::Object* Heap::AllocObjectWithAllocator(Thread* self,
   size_t usable_size;
   size_t new_num_bytes_allocated = 0;
   bool need_gc = false;
+  // Whether the allocation was selected by the allocation sampler.
+  bool sample_allocation = false;
   uint32_t starting_gc_num;  // o.w. GC number at which we observed need for GC.
   {
     // Bytes allocated that includes bulk thread-local buffer allocations in addition to direct
@@ -182,6 +185,10 @@ inline mirror::Object* Heap::AllocObjectWithAllocator(Thread* self,
       }
       no_suspend_pre_fence_visitor(obj, usable_size);
       QuasiAtomic::ThreadFenceForConstructor();
+      // Sample points are only crossed on the slow path, see AllocationSampler.
+      if (UNLIKELY(allocation_sampler_ != nullptr)) {
+        sample_allocation = allocation_sampler_->OnSlowPathAllocation(self, obj, bytes_allocated);
+      }
     }
     if (bytes_tl_bulk_allocated > 0) {
       starting_gc_num = GetCurrentGcNum();
@@ -242,6 +249,9 @@ inline mirror::Object* Heap::AllocObjectWithAllocator(Thread* self,
   } else {
     DCHECK(!IsAllocTrackingEnabled());
   }
+  if (UNLIKELY(sample_allocation)) {
+    allocation_sampler_->RecordSample(self, obj, bytes_allocated);
+  }
   if (AllocatorHasAllocationStack(allocator)) {
     PushOnAllocationStack(self, &obj);
   }
@@ -28,6 +28,7 @@
 #include "scoped_thread_state_change-inl.h"
 #include "thread-current-inl.h"
 #include "thread_list.h"
+#include "thread_pool.h"
 
 namespace art {
 namespace gc {
@@ -108,8 +109,18 @@ inline void Heap::VisitObjectsInternal(Visitor&& visitor) {
     // Visit objects in bump pointer space.
     bump_pointer_space_->Walk(visitor);
   }
-  // TODO: Switch to standard begin and end to use ranged a based loop.
-  for (auto* it = allocation_stack_->Begin(), *end = allocation_stack_->End(); it < end; ++it) {
+  VisitAllocationStackRange(allocation_stack_->Begin(), allocation_stack_->End(), visitor);
+  {
+    ReaderMutexLock mu(Thread::Current(), *Locks::heap_bitmap_lock_);
+    GetLiveBitmap()->Visit<Visitor>(visitor);
+  }
+}
+
+template <typename Visitor>
+inline void Heap::VisitAllocationStackRange(StackReference<mirror::Object>* begin,
+                                            StackReference<mirror::Object>* end,
+                                            Visitor&& visitor) {
+  for (auto* it = begin; it < end; ++it) {
     mirror::Object* const obj = it->AsMirrorPtr();
 
     mirror::Class* kls = nullptr;
@@ -157,10 +168,61 @@ inline void Heap::VisitObjectsInternal(Visitor&& visitor) {
       visitor(obj);
     }
   }
-  {
-    ReaderMutexLock mu(Thread::Current(), *Locks::heap_bitmap_lock_);
-    GetLiveBitmap()->Visit<Visitor>(visitor);
+}
+
+template <typename Visitor>
+void Heap::VisitObjectsPausedParallel(ThreadPool* thread_pool, Visitor&& visitor) {
+  // Each task covers at most this many regions, bytes of a bitmap, or allocation stack entries.
+  static constexpr size_t kRegionsPerTask = 64u;
+  static constexpr size_t kBitmapBytesPerTask = 32 * MB;
+  static constexpr size_t kAllocationStackEntriesPerTask = 64 * KB;
+
+  Thread* self = Thread::Current();
+  Locks::mutator_lock_->AssertExclusiveHeld(self);
+  auto add_task = [&](std::function<void(Thread*)>&& fn) {
+    thread_pool->AddTask(self, new FunctionTask(std::move(fn)));
+  };
+  if (region_space_ != nullptr) {
+    DCHECK(IsGcConcurrentAndMoving());
+    for (size_t begin = 0; begin < region_space_->GetNumRegions(); begin += kRegionsPerTask) {
+      size_t end = std::min(begin + kRegionsPerTask, region_space_->GetNumRegions());
+      add_task([this, begin, end, &visitor](Thread*) {
+        region_space_->WalkRegions(begin, end, visitor);
+      });
+    }
+  }
+  if (bump_pointer_space_ != nullptr) {
+    add_task([this, &visitor](Thread*) NO_THREAD_SAFETY_ANALYSIS {
+      bump_pointer_space_->Walk(visitor);
+    });
+  }
+  for (auto* it = allocation_stack_->Begin(), *end = allocation_stack_->End(); it < end; ) {
+    auto* chunk_end = it + std::min<size_t>(end - it, kAllocationStackEntriesPerTask);
+    add_task([this, it, chunk_end, &visitor](Thread*) {
+      VisitAllocationStackRange(it, chunk_end, visitor);
+    });
+    it = chunk_end;
+  }
+  // The bitmaps do not change while threads are suspended, the lock is held for the
+  // whole walk on behalf of the workers.
+  ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
+  for (accounting::ContinuousSpaceBitmap* bitmap : GetLiveBitmap()->continuous_space_bitmaps_) {
+    for (uintptr_t begin = bitmap->HeapBegin(); begin < bitmap->HeapLimit(); ) {
+      uintptr_t end = std::min<uint64_t>(begin + kBitmapBytesPerTask, bitmap->HeapLimit());
+      add_task([bitmap, begin, end, &visitor](Thread*) NO_THREAD_SAFETY_ANALYSIS {
+        bitmap->VisitMarkedRange(begin, end, visitor);
+      });
+      begin = end;
+    }
+  }
+  for (accounting::LargeObjectBitmap* bitmap : GetLiveBitmap()->large_object_bitmaps_) {
+    add_task([bitmap, &visitor](Thread*) NO_THREAD_SAFETY_ANALYSIS {
+      bitmap->VisitMarkedRange(bitmap->HeapBegin(), bitmap->HeapLimit(), visitor);
+    });
   }
+  thread_pool->StartWorkers(self);
+  thread_pool->Wait(self, /* do_work= */ true, /* may_hold_locks= */ true);
+  thread_pool->StopWorkers(self);
 }
 
 }  // namespace gc
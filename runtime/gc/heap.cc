@@ -56,11 +56,13 @@
 #include "gc/accounting/read_barrier_table.h"
 #include "gc/accounting/remembered_set.h"
 #include "gc/accounting/space_bitmap-inl.h"
+#include "gc/allocation_sampler.h"
 #include "gc/collector/concurrent_copying.h"
 #include "gc/collector/mark_sweep.h"
 #include "gc/collector/partial_mark_sweep.h"
 #include "gc/collector/semi_space.h"
 #include "gc/collector/sticky_mark_sweep.h"
+#include "gc/finalizer_pool.h"
 #include "gc/racing_check.h"
 #include "gc/reference_processor.h"
 #include "gc/scoped_gc_critical_section.h"
@@ -247,7 +249,8 @@ Heap::Heap(size_t initial_size,
            uint64_t min_interval_homogeneous_space_compaction_by_oom,
            bool dump_region_info_before_gc,
            bool dump_region_info_after_gc,
-           space::ImageSpaceLoadingOrder image_space_loading_order)
+           space::ImageSpaceLoadingOrder image_space_loading_order,
+           bool numa_aware_regions)
     : non_moving_space_(nullptr),
       rosalloc_space_(nullptr),
       dlmalloc_space_(nullptr),
@@ -340,6 +343,12 @@ Heap::Heap(size_t initial_size,
       max_gc_requested_(0u),
       pending_collector_transition_(nullptr),
       pending_heap_trim_(nullptr),
+      pending_heap_uncommit_(nullptr),
+      elastic_heap_idle_time_ns_(0u),
+      elastic_heap_idle_start_ns_(0u),
+      elastic_heap_last_bytes_allocated_ever_(0u),
+      elastic_heap_released_bytes_(0u),
+      elastic_heap_release_steps_(0u),
       use_homogeneous_space_compaction_for_oom_(use_homogeneous_space_compaction_for_oom),
       use_generational_cc_(use_generational_cc),
       running_collection_is_blocking_(false),
@@ -561,8 +570,10 @@ Heap::Heap(size_t initial_size,
     MemMap region_space_mem_map =
         space::RegionSpace::CreateMemMap(kRegionSpaceName, capacity_ * 2, request_begin);
     CHECK(region_space_mem_map.IsValid()) << "No region space mem map";
-    region_space_ = space::RegionSpace::Create(
-        kRegionSpaceName, std::move(region_space_mem_map), use_generational_cc_);
+    region_space_ = space::RegionSpace::Create(kRegionSpaceName,
+                                               std::move(region_space_mem_map),
+                                               use_generational_cc_,
+                                               numa_aware_regions);
     AddSpace(region_space_);
   } else if (IsMovingGc(foreground_collector_type_)) {
     // Create bump pointer spaces.
@@ -904,20 +915,31 @@ void Heap::IncrementDisableThreadFlip(Thread* self) {
     // counter. The global counter is incremented only once for a thread for the outermost enter.
     return;
   }
+  // Fast path without the lock. The sequentially consistent increment and load pair with the
+  // store and load in ThreadFlipBegin(), so that either we see the flip running or the GC sees
+  // our increment and waits for us.
+  disable_thread_flip_count_.fetch_add(1u, std::memory_order_seq_cst);
+  if (LIKELY(!thread_flip_running_.load(std::memory_order_seq_cst))) {
+    return;
+  }
+  // A thread flip is starting. Back off, so that the GC does not wait for us, and wait for the
+  // flip to end.
+  DecrementDisableThreadFlipCountAndNotify(self);
   ScopedThreadStateChange tsc(self, kWaitingForGcThreadFlip);
   MutexLock mu(self, *thread_flip_lock_);
   thread_flip_cond_->CheckSafeToWait(self);
   bool has_waited = false;
   uint64_t wait_start = 0;
-  if (thread_flip_running_) {
+  if (thread_flip_running_.load(std::memory_order_relaxed)) {
     wait_start = NanoTime();
     ScopedTrace trace("IncrementDisableThreadFlip");
-    while (thread_flip_running_) {
+    while (thread_flip_running_.load(std::memory_order_relaxed)) {
       has_waited = true;
       thread_flip_cond_->Wait(self);
     }
   }
-  ++disable_thread_flip_count_;
+  // Holding the lock keeps the next ThreadFlipBegin() from starting before this increment.
+  disable_thread_flip_count_.fetch_add(1u, std::memory_order_seq_cst);
   if (has_waited) {
     uint64_t wait_time = NanoTime() - wait_start;
     total_wait_time_ += wait_time;
@@ -938,11 +960,16 @@ void Heap::DecrementDisableThreadFlip(Thread* self) {
     // The global counter is decremented only once for a thread for the outermost exit.
     return;
   }
-  MutexLock mu(self, *thread_flip_lock_);
-  CHECK_GT(disable_thread_flip_count_, 0U);
-  --disable_thread_flip_count_;
-  if (disable_thread_flip_count_ == 0) {
-    // Potentially notify the GC thread blocking to begin a thread flip.
+  DecrementDisableThreadFlipCountAndNotify(self);
+}
+
+void Heap::DecrementDisableThreadFlipCountAndNotify(Thread* self) {
+  size_t old_count = disable_thread_flip_count_.fetch_sub(1u, std::memory_order_seq_cst);
+  CHECK_GT(old_count, 0U);
+  if (old_count == 1u && thread_flip_running_.load(std::memory_order_seq_cst)) {
+    // Potentially notify the GC thread blocking to begin a thread flip. Taking the lock ensures
+    // that the GC is either waiting or has not checked the counter yet.
+    MutexLock mu(self, *thread_flip_lock_);
     thread_flip_cond_->Broadcast(self);
   }
 }
@@ -956,11 +983,11 @@ void Heap::ThreadFlipBegin(Thread* self) {
   thread_flip_cond_->CheckSafeToWait(self);
   bool has_waited = false;
   uint64_t wait_start = NanoTime();
-  CHECK(!thread_flip_running_);
+  CHECK(!thread_flip_running_.load(std::memory_order_relaxed));
   // Set this to true before waiting so that frequent JNI critical enter/exits won't starve
   // GC. This like a writer preference of a reader-writer lock.
-  thread_flip_running_ = true;
-  while (disable_thread_flip_count_ > 0) {
+  thread_flip_running_.store(true, std::memory_order_seq_cst);
+  while (disable_thread_flip_count_.load(std::memory_order_seq_cst) > 0) {
     has_waited = true;
     thread_flip_cond_->Wait(self);
   }
@@ -978,8 +1005,8 @@ void Heap::ThreadFlipEnd(Thread* self) {
   // waiting before doing a JNI critical.
   CHECK(kUseReadBarrier);
   MutexLock mu(self, *thread_flip_lock_);
-  CHECK(thread_flip_running_);
-  thread_flip_running_ = false;
+  CHECK(thread_flip_running_.load(std::memory_order_relaxed));
+  thread_flip_running_.store(false, std::memory_order_seq_cst);
   // Potentially notify mutator threads blocking to enter a JNI critical section.
   thread_flip_cond_->Broadcast(self);
 }
@@ -1175,6 +1202,15 @@ void Heap::DumpGcPerformanceInfo(std::ostream& os) {
   os << "Free memory until OOME " << PrettySize(GetFreeMemoryUntilOOME()) << "\n";
   os << "Total memory " << PrettySize(GetTotalMemory()) << "\n";
   os << "Max memory " << PrettySize(GetMaxMemory()) << "\n";
+  uint64_t committed_bytes;
+  uint64_t allocated_bytes;
+  GetCommittedAndAllocatedBytes(&committed_bytes, &allocated_bytes);
+  os << "Committed memory " << PrettySize(committed_bytes) << " for "
+     << PrettySize(allocated_bytes) << " allocated\n";
+  if (elastic_heap_idle_time_ns_ != 0u) {
+    os << "Elastic heap released " << PrettySize(elastic_heap_released_bytes_.load())
+       << " in " << elastic_heap_release_steps_.load() << " steps\n";
+  }
   if (HasZygoteSpace()) {
     os << "Zygote space size " << PrettySize(zygote_space_->Size()) << "\n";
   }
@@ -1204,6 +1240,8 @@ void Heap::DumpGcPerformanceInfo(std::ostream& os) {
     rosalloc_space_->DumpStats(os);
   }
 
+  task_processor_->DumpStats(os);
+
   os << "Native bytes total: " << GetNativeBytes()
      << " registered: " << native_bytes_registered_.load(std::memory_order_relaxed) << "\n";
 
@@ -1240,6 +1278,7 @@ void Heap::ResetGcPerformanceInfo() {
     gc_count_rate_histogram_.Reset();
     blocking_gc_count_rate_histogram_.Reset();
   }
+  task_processor_->ResetStats(Thread::Current());
 }
 
 uint64_t Heap::GetGcCount() const {
@@ -1301,6 +1340,10 @@ Heap::~Heap() {
   delete thread_flip_lock_;
   delete pending_task_lock_;
   delete backtrace_lock_;
+  if (finalizer_pool_ != nullptr && finalizer_pool_->HasStuckThreads()) {
+    // Deleting the pool would join the threads, which may also still use it.
+    finalizer_pool_.release();  // NOLINT
+  }
   uint64_t unique_count = unique_backtrace_count_.load();
   uint64_t seen_count = seen_backtrace_count_.load();
   if (unique_count != 0 || seen_count != 0) {
@@ -2730,6 +2773,13 @@ collector::GcType Heap::CollectGarbageInternal(collector::GcType gc_type,
   collector->Run(gc_cause, clear_soft_references || runtime->IsZygote());
   IncrementFreedEver();
   RequestTrim(self);
+  if (elastic_heap_idle_time_ns_ != 0u) {
+    // The collection starts a new idle period, the next step runs when it may be over.
+    elastic_heap_idle_start_ns_.store(NanoTime(), std::memory_order_relaxed);
+    elastic_heap_last_bytes_allocated_ever_.store(GetBytesAllocatedEver(),
+                                                  std::memory_order_relaxed);
+    RequestUncommit(self, elastic_heap_idle_time_ns_);
+  }
   // Collect cleared references.
   SelfDeletingTask* clear = reference_processor_->CollectClearedReferences(self);
   // Grow the heap so that we know when to perform the next GC.
@@ -3532,6 +3582,15 @@ void Heap::DumpForSigQuit(std::ostream& os) {
   os << "Heap: " << GetPercentFree() << "% free, " << PrettySize(GetBytesAllocated()) << "/"
      << PrettySize(GetTotalMemory()) << "; " << GetObjectsAllocated() << " objects\n";
   DumpGcPerformanceInfo(os);
+  if (region_space_ != nullptr) {
+    region_space_->DumpNumaInfo(os);
+  }
+  if (allocation_sampler_ != nullptr) {
+    allocation_sampler_->DumpForSigQuit(os);
+  }
+  if (finalizer_pool_ != nullptr) {
+    finalizer_pool_->DumpForSigQuit(os);
+  }
 }
 
 size_t Heap::GetPercentFree() {
@@ -3752,7 +3811,14 @@ void Heap::RequestConcurrentGCAndSaveObject(Thread* self,
 class Heap::ConcurrentGCTask : public HeapTask {
  public:
   ConcurrentGCTask(uint64_t target_time, GcCause cause, bool force_full, uint32_t gc_num)
-      : HeapTask(target_time), cause_(cause), force_full_(force_full), my_gc_num_(gc_num) {}
+      : HeapTask(target_time, HeapTaskKind::kConcurrentGc),
+        cause_(cause),
+        force_full_(force_full),
+        my_gc_num_(gc_num) {}
+  // Another GC already brought the GC number up to my_gc_num_.
+  bool IsObsolete() override {
+    return !GCNumberLt(Runtime::Current()->GetHeap()->GetCurrentGcNum(), my_gc_num_);
+  }
   void Run(Thread* self) override {
     Runtime* runtime = Runtime::Current();
     gc::Heap* heap = runtime->GetHeap();
@@ -3835,7 +3901,8 @@ void Heap::ConcurrentGC(Thread* self, GcCause cause, bool force_full, uint32_t r
 
 class Heap::CollectorTransitionTask : public HeapTask {
  public:
-  explicit CollectorTransitionTask(uint64_t target_time) : HeapTask(target_time) {}
+  explicit CollectorTransitionTask(uint64_t target_time)
+      : HeapTask(target_time, HeapTaskKind::kCollectorTransition) {}
 
   void Run(Thread* self) override {
     gc::Heap* heap = Runtime::Current()->GetHeap();
@@ -3878,7 +3945,8 @@ void Heap::RequestCollectorTransition(CollectorType desired_collector_type, uint
 
 class Heap::HeapTrimTask : public HeapTask {
  public:
-  explicit HeapTrimTask(uint64_t delta_time) : HeapTask(NanoTime() + delta_time) { }
+  explicit HeapTrimTask(uint64_t delta_time)
+      : HeapTask(NanoTime() + delta_time, HeapTaskKind::kHeapTrim) { }
   void Run(Thread* self) override {
     gc::Heap* heap = Runtime::Current()->GetHeap();
     heap->Trim(self);
@@ -3920,6 +3988,140 @@ void Heap::RequestTrim(Thread* self) {
   task_processor_->AddTask(self, added_task);
 }
 
+class Heap::HeapUncommitTask : public HeapTask {
+ public:
+  explicit HeapUncommitTask(uint64_t target_time)
+      : HeapTask(target_time, HeapTaskKind::kHeapUncommit) { }
+  void Run(Thread* self) override {
+    gc::Heap* heap = Runtime::Current()->GetHeap();
+    heap->ClearPendingUncommit(self);
+    heap->UncommitStep(self);
+  }
+};
+
+void Heap::ClearPendingUncommit(Thread* self) {
+  MutexLock mu(self, *pending_task_lock_);
+  pending_heap_uncommit_ = nullptr;
+}
+
+void Heap::RequestUncommit(Thread* self, uint64_t delta_time) {
+  if (!CanAddHeapTask(self)) {
+    return;
+  }
+  HeapUncommitTask* added_task = nullptr;
+  const uint64_t target_time = NanoTime() + delta_time;
+  {
+    MutexLock mu(self, *pending_task_lock_);
+    // A collection postpones the pending step to the end of the new idle time.
+    if (pending_heap_uncommit_ != nullptr) {
+      task_processor_->UpdateTargetRunTime(self, pending_heap_uncommit_, target_time);
+      return;
+    }
+    added_task = new HeapUncommitTask(target_time);
+    pending_heap_uncommit_ = added_task;
+  }
+  task_processor_->AddTask(self, added_task);
+}
+
+void Heap::EnableElasticHeap(uint64_t idle_time_ns) {
+  DCHECK_NE(idle_time_ns, 0u);
+  elastic_heap_idle_time_ns_ = idle_time_ns;
+}
+
+void Heap::GetCommittedAndAllocatedBytes(uint64_t* committed, uint64_t* allocated) {
+  *committed = 0u;
+  *allocated = 0u;
+  if (region_space_ != nullptr) {
+    uint64_t region_space_committed;
+    uint64_t region_space_live;
+    region_space_->GetCommittedAndLiveBytes(&region_space_committed, &region_space_live);
+    *committed += region_space_committed;
+    *allocated += region_space_live;
+  }
+  if (bump_pointer_space_ != nullptr) {
+    *committed += bump_pointer_space_->Size();
+    *allocated += bump_pointer_space_->GetBytesAllocated();
+  }
+  space::MallocSpace* malloc_spaces[] = {
+      main_space_, (non_moving_space_ != main_space_) ? non_moving_space_ : nullptr };
+  for (space::MallocSpace* space : malloc_spaces) {
+    if (space == nullptr) {
+      continue;
+    }
+    // Released dlmalloc pages are not tracked, count its whole footprint.
+    *committed += space->IsRosAllocSpace()
+        ? space->AsRosAllocSpace()->GetCommittedBytes()
+        : space->GetFootprint();
+    *allocated += space->GetBytesAllocated();
+  }
+  if (large_object_space_ != nullptr) {
+    // Large objects are mapped and released individually.
+    *committed += large_object_space_->GetBytesAllocated();
+    *allocated += large_object_space_->GetBytesAllocated();
+  }
+}
+
+void Heap::UncommitStep(Thread* self) {
+  const uint64_t now = NanoTime();
+  // Allocations above the threshold end the idle period. Collections end it when they finish,
+  // see CollectGarbageInternal().
+  const uint64_t bytes_allocated_ever = GetBytesAllocatedEver();
+  if (bytes_allocated_ever -
+          elastic_heap_last_bytes_allocated_ever_.load(std::memory_order_relaxed) >
+      kElasticHeapIdleAllocationBytes) {
+    elastic_heap_idle_start_ns_.store(now, std::memory_order_relaxed);
+  }
+  elastic_heap_last_bytes_allocated_ever_.store(bytes_allocated_ever, std::memory_order_relaxed);
+  const uint64_t idle_time = now - elastic_heap_idle_start_ns_.load(std::memory_order_relaxed);
+  if (idle_time < elastic_heap_idle_time_ns_) {
+    RequestUncommit(self, elastic_heap_idle_time_ns_ - idle_time);
+    return;
+  }
+  const double ramp = std::min(
+      1.0,
+      static_cast<double>(idle_time - elastic_heap_idle_time_ns_) /
+          static_cast<double>(kElasticHeapRampIdleTimes * elastic_heap_idle_time_ns_));
+  const double utilization = target_utilization_ + (1.0 - target_utilization_) * ramp;
+  uint64_t committed;
+  uint64_t allocated;
+  GetCommittedAndAllocatedBytes(&committed, &allocated);
+  const uint64_t target_committed = static_cast<uint64_t>(allocated / utilization);
+  size_t released = 0;
+  if (committed > target_committed) {
+    const size_t max_bytes = std::max(
+        static_cast<size_t>((committed - target_committed) / kElasticHeapStepFraction),
+        kElasticHeapMinStepBytes);
+    // Pretend we are doing a GC, the dead objects of the region space must not become live
+    // again and the spaces must not be deleted by a background compaction.
+    StartGC(self, kGcCauseTrim, kCollectorTypeHeapTrim);
+    ScopedTrace trace(__PRETTY_FUNCTION__);
+    // Neither part calls madvise() with the mutator lock held, so that releasing the pages does
+    // not hold back a suspend-all of the mutators.
+    if (region_space_ != nullptr) {
+      released += region_space_->ReleaseDeadObjectPages(max_bytes);
+    }
+    space::MallocSpace* malloc_spaces[] = {
+        main_space_, (non_moving_space_ != main_space_) ? non_moving_space_ : nullptr };
+    for (space::MallocSpace* space : malloc_spaces) {
+      if (released < max_bytes && space != nullptr && space->IsRosAllocSpace()) {
+        released += space->AsRosAllocSpace()->ReleasePagesIncrementally(max_bytes - released);
+      }
+    }
+    FinishGC(self, collector::kGcTypeNone);
+    if (released != 0) {
+      elastic_heap_released_bytes_.fetch_add(released);
+      elastic_heap_release_steps_.fetch_add(1u);
+    }
+    VLOG(heap) << "Elastic heap released " << PrettySize(released) << " of "
+               << PrettySize(committed - target_committed) << " above the target utilization "
+               << utilization;
+  }
+  // Keep stepping while the target utilization rises or there may be more to release.
+  if (ramp < 1.0 || released != 0) {
+    RequestUncommit(self, kElasticHeapStepInterval);
+  }
+}
+
 void Heap::IncrementNumberOfBytesFreedRevoke(size_t freed_bytes_revoke) {
   size_t previous_num_bytes_freed_revoke =
       num_bytes_freed_revoke_.fetch_add(freed_bytes_revoke, std::memory_order_relaxed);
@@ -3973,6 +4175,9 @@ void Heap::RunFinalization(JNIEnv* env, uint64_t timeout) {
   env->CallStaticVoidMethod(WellKnownClasses::dalvik_system_VMRuntime,
                             WellKnownClasses::dalvik_system_VMRuntime_runFinalization,
                             static_cast<jlong>(timeout));
+  if (finalizer_pool_ != nullptr) {
+    finalizer_pool_->WaitForCompletion(ThreadForEnv(env), timeout);
+  }
 }
 
 // For GC triggering purposes, we count old (pre-last-GC) and new native allocations as
@@ -4055,6 +4260,10 @@ inline void Heap::CheckGCForNative(Thread* self) {
       CollectGarbageInternal(NonStickyGcType(), kGcCauseForNativeAlloc, false, starting_gc_num + 1);
     }
   }
+  if (UNLIKELY(finalizer_pool_ != nullptr)) {
+    // Native memory released by finalizers must not fall too far behind new native allocations.
+    finalizer_pool_->WaitForBackpressure(self);
+  }
 }
 
 // About kNotifyNativeInterval allocations have occurred. Check whether we should garbage collect.
@@ -4152,6 +4361,16 @@ void Heap::SetAllocationRecords(AllocRecordObjectMap* records) {
   allocation_records_.reset(records);
 }
 
+void Heap::EnableAllocationSampling(size_t interval, const std::string& profile_file) {
+  DCHECK(allocation_sampler_ == nullptr);
+  allocation_sampler_.reset(new AllocationSampler(interval, profile_file));
+}
+
+void Heap::EnableFinalizerPool(size_t thread_count, size_t backpressure_threshold) {
+  DCHECK(finalizer_pool_ == nullptr);
+  finalizer_pool_.reset(new FinalizerPool(thread_count, backpressure_threshold));
+}
+
 void Heap::VisitAllocationRecords(RootVisitor* visitor) const {
   if (IsAllocTrackingEnabled()) {
     MutexLock mu(Thread::Current(), *Locks::alloc_tracker_lock_);
@@ -4290,9 +4509,12 @@ mirror::Object* Heap::AllocWithNewTLAB(Thread* self,
     // There is enough space if we grow the TLAB. Lets do that. This increases the
     // TLAB bytes.
     const size_t min_expand_size = alloc_size - self->TlabSize();
-    const size_t expand_bytes = std::max(
+    size_t expand_bytes = std::max(
         min_expand_size,
         std::min(self->TlabRemainingCapacity() - self->TlabSize(), kPartialTlabSize));
+    if (UNLIKELY(allocation_sampler_ != nullptr)) {
+      expand_bytes = allocation_sampler_->AdjustTlabWindow(self, min_expand_size, expand_bytes);
+    }
     if (UNLIKELY(IsOutOfMemoryOnAllocation(allocator_type, expand_bytes, grow))) {
       return nullptr;
     }
@@ -4301,7 +4523,10 @@ mirror::Object* Heap::AllocWithNewTLAB(Thread* self,
     DCHECK_LE(alloc_size, self->TlabSize());
   } else if (allocator_type == kAllocatorTypeTLAB) {
     DCHECK(bump_pointer_space_ != nullptr);
-    const size_t new_tlab_size = alloc_size + kDefaultTLABSize;
+    size_t new_tlab_size = alloc_size + kDefaultTLABSize;
+    if (UNLIKELY(allocation_sampler_ != nullptr)) {
+      new_tlab_size = allocation_sampler_->AdjustTlabWindow(self, alloc_size, new_tlab_size);
+    }
     if (UNLIKELY(IsOutOfMemoryOnAllocation(allocator_type, new_tlab_size, grow))) {
       return nullptr;
     }
@@ -4319,9 +4544,13 @@ mirror::Object* Heap::AllocWithNewTLAB(Thread* self,
       if (LIKELY(!IsOutOfMemoryOnAllocation(allocator_type,
                                             space::RegionSpace::kRegionSize,
                                             grow))) {
-        const size_t new_tlab_size = kUsePartialTlabs
+        size_t new_tlab_size = kUsePartialTlabs
             ? std::max(alloc_size, kPartialTlabSize)
             : gc::space::RegionSpace::kRegionSize;
+        // Without partial TLABs the rest of the region would be wasted, so keep whole regions.
+        if (kUsePartialTlabs && UNLIKELY(allocation_sampler_ != nullptr)) {
+          new_tlab_size = allocation_sampler_->AdjustTlabWindow(self, alloc_size, new_tlab_size);
+        }
         // Try to allocate a tlab.
         if (!region_space_->AllocNewTlab(self, new_tlab_size, bytes_tl_bulk_allocated)) {
           // Failed to allocate a tlab. Try non-tlab.
@@ -4378,6 +4607,9 @@ class Heap::TriggerPostForkCCGcTask : public HeapTask {
  public:
   explicit TriggerPostForkCCGcTask(uint64_t target_time, uint32_t initial_gc_num) :
       HeapTask(target_time), initial_gc_num_(initial_gc_num) {}
+  bool IsObsolete() override {
+    return Runtime::Current()->GetHeap()->GetCurrentGcNum() != initial_gc_num_;
+  }
   void Run(Thread* self) override {
     gc::Heap* heap = Runtime::Current()->GetHeap();
     if (heap->GetCurrentGcNum() == initial_gc_num_) {
@@ -4398,6 +4630,9 @@ class Heap::ReduceTargetFootprintTask : public HeapTask {
   explicit ReduceTargetFootprintTask(uint64_t target_time, size_t new_target_sz,
                                      uint32_t initial_gc_num) :
       HeapTask(target_time), new_target_sz_(new_target_sz), initial_gc_num_(initial_gc_num) {}
+  bool IsObsolete() override {
+    return Runtime::Current()->GetHeap()->GetCurrentGcNum() != initial_gc_num_;
+  }
   void Run(Thread* self) override {
     gc::Heap* heap = Runtime::Current()->GetHeap();
     MutexLock mu(self, *(heap->gc_complete_lock_));
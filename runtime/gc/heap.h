@@ -67,7 +67,9 @@ class Object;
 namespace gc {
 
 class AllocationListener;
+class AllocationSampler;
 class AllocRecordObjectMap;
+class FinalizerPool;
 class GcPauseListener;
 class HeapTask;
 class ReferenceProcessor;
@@ -178,6 +180,16 @@ class Heap {
 
   // How often we allow heap trimming to happen (nanoseconds).
   static constexpr uint64_t kHeapTrimWait = MsToNs(5000);
+  // Interval between the steps of the elastic heap once the heap is idle (nanoseconds).
+  static constexpr uint64_t kElasticHeapStepInterval = MsToNs(200);
+  // The number of idle times over which the elastic heap raises its target utilization to 1.
+  static constexpr uint64_t kElasticHeapRampIdleTimes = 4;
+  // Allocations below this many bytes between two elastic heap steps do not end an idle period.
+  static constexpr size_t kElasticHeapIdleAllocationBytes = 256 * KB;
+  // Each elastic heap step releases this fraction of the excess committed memory, but at least
+  // kElasticHeapMinStepBytes.
+  static constexpr size_t kElasticHeapStepFraction = 4;
+  static constexpr size_t kElasticHeapMinStepBytes = 256 * KB;
   // How long we wait after a transition request to perform a collector transition (nanoseconds).
   static constexpr uint64_t kCollectorTransitionWait = MsToNs(5000);
   // Whether the transition-wait applies or not. Zero wait will stress the
@@ -224,7 +236,8 @@ class Heap {
        uint64_t min_interval_homogeneous_space_compaction_by_oom,
        bool dump_region_info_before_gc,
        bool dump_region_info_after_gc,
-       space::ImageSpaceLoadingOrder image_space_loading_order);
+       space::ImageSpaceLoadingOrder image_space_loading_order,
+       bool numa_aware_regions);
 
   ~Heap();
 
@@ -294,6 +307,12 @@ class Heap {
   template <typename Visitor>
   ALWAYS_INLINE void VisitObjectsPaused(Visitor&& visitor)
       REQUIRES(Locks::mutator_lock_, !Locks::heap_bitmap_lock_, !*gc_complete_lock_);
+  // Visit all of the live objects in the heap with the workers of `thread_pool` and the calling
+  // thread, one task per group of regions or chunk of a space. The visitor is called concurrently
+  // from several threads. Like VisitObjectsPaused(), this requires threads to be suspended.
+  template <typename Visitor>
+  void VisitObjectsPausedParallel(ThreadPool* thread_pool, Visitor&& visitor)
+      REQUIRES(Locks::mutator_lock_, !Locks::heap_bitmap_lock_, !*gc_complete_lock_);
 
   void VisitReflectiveTargets(ReflectiveValueVisitor* visitor)
       REQUIRES(Locks::mutator_lock_, !Locks::heap_bitmap_lock_, !*gc_complete_lock_);
@@ -907,6 +926,31 @@ class Heap {
   void BroadcastForNewAllocationRecords() const
       REQUIRES(!Locks::alloc_tracker_lock_);
 
+  // Enables sampled allocation tracking, see AllocationSampler. Must be called before other
+  // threads allocate.
+  void EnableAllocationSampling(size_t interval, const std::string& profile_file);
+
+  AllocationSampler* GetAllocationSampler() const {
+    return allocation_sampler_.get();
+  }
+
+  // Runs finalizers on a pool of `thread_count` threads instead of the FinalizerDaemon, see
+  // FinalizerPool. The threads are created by Runtime::InitNonZygoteOrPostFork.
+  void EnableFinalizerPool(size_t thread_count, size_t backpressure_threshold);
+
+  FinalizerPool* GetFinalizerPool() const {
+    return finalizer_pool_.get();
+  }
+
+  // Enables the elastic heap: once no collection ran and the mutators allocated little for
+  // `idle_time_ns`, the memory of dead objects and free pages is released to the OS gradually,
+  // see UncommitStep(). Must be called before the heap task daemon starts.
+  void EnableElasticHeap(uint64_t idle_time_ns);
+
+  // Returns the memory of the allocation spaces that is backed by pages and the bytes allocated
+  // in these spaces. Image and zygote spaces are not counted.
+  void GetCommittedAndAllocatedBytes(/* out */ uint64_t* committed, /* out */ uint64_t* allocated);
+
   void DisableGCForShutdown() REQUIRES(!*gc_complete_lock_);
 
   // Create a new alloc space and compact default alloc space to it.
@@ -942,6 +986,7 @@ class Heap {
   class ConcurrentGCTask;
   class CollectorTransitionTask;
   class HeapTrimTask;
+  class HeapUncommitTask;
   class TriggerPostForkCCGcTask;
   class ReduceTargetFootprintTask;
 
@@ -956,6 +1001,9 @@ class Heap {
       REQUIRES(!*gc_complete_lock_);
   void FinishGC(Thread* self, collector::GcType gc_type) REQUIRES(!*gc_complete_lock_);
 
+  // Leave a JNI critical section and wake up a thread flip that waits for it.
+  void DecrementDisableThreadFlipCountAndNotify(Thread* self) REQUIRES(!*thread_flip_lock_);
+
   double CalculateGcWeightedAllocatedBytes(uint64_t gc_last_process_cpu_time_ns,
                                            uint64_t current_process_cpu_time) const;
 
@@ -1181,6 +1229,15 @@ class Heap {
       REQUIRES(!*gc_complete_lock_, !*pending_task_lock_, !process_state_update_lock_);
 
   void ClearPendingTrim(Thread* self) REQUIRES(!*pending_task_lock_);
+  void ClearPendingUncommit(Thread* self) REQUIRES(!*pending_task_lock_);
+  void RequestUncommit(Thread* self, uint64_t delta_time) REQUIRES(!*pending_task_lock_);
+  // One step of the elastic heap. While the heap is idle, its target utilization rises from
+  // target_utilization_ to 1 over kElasticHeapRampIdleTimes idle times. Each step releases a
+  // fraction of the committed memory exceeding the allocated bytes divided by that utilization,
+  // first the pages of dead objects in region space regions that were not evacuated, then empty
+  // rosalloc pages.
+  void UncommitStep(Thread* self)
+      REQUIRES(!*gc_complete_lock_, !*pending_task_lock_, !Locks::mutator_lock_);
   void ClearPendingCollectorTransition(Thread* self) REQUIRES(!*pending_task_lock_);
 
   // What kind of concurrency behavior is the runtime after? Currently true for concurrent mark
@@ -1204,6 +1261,11 @@ class Heap {
   template <typename Visitor>
   ALWAYS_INLINE void VisitObjectsInternalRegionSpace(Visitor&& visitor)
       REQUIRES(Locks::mutator_lock_, !Locks::heap_bitmap_lock_, !*gc_complete_lock_);
+  template <typename Visitor>
+  ALWAYS_INLINE void VisitAllocationStackRange(StackReference<mirror::Object>* begin,
+                                               StackReference<mirror::Object>* end,
+                                               Visitor&& visitor)
+      NO_THREAD_SAFETY_ANALYSIS;
 
   void UpdateGcCountRateHistograms() REQUIRES(gc_complete_lock_);
 
@@ -1347,12 +1409,14 @@ class Heap {
   std::unique_ptr<ConditionVariable> gc_complete_cond_ GUARDED_BY(gc_complete_lock_);
 
   // Used to synchronize between JNI critical calls and the thread flip of the CC collector.
+  // JNI critical sections only take the lock when they race with a thread flip.
   Mutex* thread_flip_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   std::unique_ptr<ConditionVariable> thread_flip_cond_ GUARDED_BY(thread_flip_lock_);
   // This counter keeps track of how many threads are currently in a JNI critical section. This is
   // incremented once per thread even with nested enters.
-  size_t disable_thread_flip_count_ GUARDED_BY(thread_flip_lock_);
-  bool thread_flip_running_ GUARDED_BY(thread_flip_lock_);
+  Atomic<size_t> disable_thread_flip_count_;
+  // Only written with the thread_flip_lock_ held.
+  Atomic<bool> thread_flip_running_;
 
   // Reference processor;
   std::unique_ptr<ReferenceProcessor> reference_processor_;
@@ -1591,6 +1655,17 @@ class Heap {
   // Active tasks which we can modify (change target time, desired collector type, etc..).
   CollectorTransitionTask* pending_collector_transition_ GUARDED_BY(pending_task_lock_);
   HeapTrimTask* pending_heap_trim_ GUARDED_BY(pending_task_lock_);
+  HeapUncommitTask* pending_heap_uncommit_ GUARDED_BY(pending_task_lock_);
+
+  // How long the heap must be idle before the elastic heap releases memory, 0 if disabled.
+  uint64_t elastic_heap_idle_time_ns_;
+  // Start of the current idle period and the bytes allocated ever at the last check. Reset by
+  // each collection and updated by the elastic heap steps.
+  Atomic<uint64_t> elastic_heap_idle_start_ns_;
+  Atomic<uint64_t> elastic_heap_last_bytes_allocated_ever_;
+  // Bytes released by the elastic heap and the number of steps that released memory.
+  Atomic<uint64_t> elastic_heap_released_bytes_;
+  Atomic<uint64_t> elastic_heap_release_steps_;
 
   // Whether or not we use homogeneous space compaction to avoid OOM errors.
   bool use_homogeneous_space_compaction_for_oom_;
@@ -1629,6 +1704,12 @@ class Heap {
   std::unique_ptr<AllocRecordObjectMap> allocation_records_;
   size_t alloc_record_depth_;
 
+  // Sampled allocation tracking, null unless enabled.
+  std::unique_ptr<AllocationSampler> allocation_sampler_;
+
+  // Native finalizer threads, null unless enabled.
+  std::unique_ptr<FinalizerPool> finalizer_pool_;
+
   // GC stress related data structures.
   Mutex* backtrace_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   // Debugging variables, seen backtraces vs unique backtraces.
@@ -22,6 +22,8 @@
 #include "base/utils.h"
 #include "class_root-inl.h"
 #include "collector/garbage_collector.h"
+#include "finalizer_pool.h"
+#include "heap.h"
 #include "jni/java_vm_ext.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
@@ -29,6 +31,7 @@
 #include "nativehelper/scoped_local_ref.h"
 #include "object_callbacks.h"
 #include "reflection.h"
+#include "runtime.h"
 #include "scoped_thread_state_change-inl.h"
 #include "task_processor.h"
 #include "thread_pool.h"
@@ -47,7 +50,8 @@ ReferenceProcessor::ReferenceProcessor()
       weak_reference_queue_(Locks::reference_queue_weak_references_lock_),
       finalizer_reference_queue_(Locks::reference_queue_finalizer_references_lock_),
       phantom_reference_queue_(Locks::reference_queue_phantom_references_lock_),
-      cleared_references_(Locks::reference_queue_cleared_references_lock_) {
+      cleared_references_(Locks::reference_queue_cleared_references_lock_),
+      pool_finalizer_references_(Locks::reference_queue_cleared_references_lock_) {
 }
 
 static inline MemberOffset GetSlowPathFlagOffset(ObjPtr<mirror::Class> reference_class)
@@ -99,6 +103,22 @@ ObjPtr<mirror::Object> ReferenceProcessor::GetReferent(Thread* self,
       return referent;
     }
   }
+  // Try to return an already marked referent without taking the lock, which every mutator that
+  // reads a reference during reference processing would otherwise contend on.
+  collector::GarbageCollector* collector = collector_.load(std::memory_order_seq_cst);
+  if (collector != nullptr) {
+    ObjPtr<mirror::Object> referent = reference->GetReferent<kWithoutReadBarrier>();
+    if (referent == nullptr) {
+      return nullptr;
+    }
+    ObjPtr<mirror::Object> forwarded_ref = GetMarkedReferent(reference, referent);
+    // The result is only valid if reference processing did not end in the meantime, as the GC
+    // may start sweeping afterwards. This thread holds the mutator lock and does not suspend, so
+    // the collector cannot start processing references again in between.
+    if (forwarded_ref != nullptr && collector_.load(std::memory_order_seq_cst) == collector) {
+      return forwarded_ref;
+    }
+  }
   MutexLock mu(self, *Locks::reference_processor_lock_);
   while ((!kUseReadBarrier && SlowPathEnabled()) ||
          (kUseReadBarrier && !self->GetWeakRefAccessEnabled())) {
@@ -110,24 +130,9 @@ ObjPtr<mirror::Object> ReferenceProcessor::GetReferent(Thread* self,
     }
     // Try to see if the referent is already marked by using the is_marked_callback. We can return
     // it to the mutator as long as the GC is not preserving references.
-    if (LIKELY(collector_ != nullptr)) {
-      // If it's null it means not marked, but it could become marked if the referent is reachable
-      // by finalizer referents. So we cannot return in this case and must block. Otherwise, we
-      // can return it to the mutator as long as the GC is not preserving references, in which
-      // case only black nodes can be safely returned. If the GC is preserving references, the
-      // mutator could take a white field from a grey or white node and move it somewhere else
-      // in the heap causing corruption since this field would get swept.
-      // Use the cached referent instead of calling GetReferent since other threads could call
-      // Reference.clear() after we did the null check resulting in a null pointer being
-      // incorrectly passed to IsMarked. b/33569625
-      ObjPtr<mirror::Object> forwarded_ref = collector_->IsMarked(referent.Ptr());
-      if (forwarded_ref != nullptr) {
-        // Non null means that it is marked.
-        if (!preserving_references_ ||
-           (LIKELY(!reference->IsFinalizerReferenceInstance()) && reference->IsUnprocessed())) {
-          return forwarded_ref;
-        }
-      }
+    ObjPtr<mirror::Object> forwarded_ref = GetMarkedReferent(reference, referent);
+    if (forwarded_ref != nullptr) {
+      return forwarded_ref;
     }
     // Check and run the empty checkpoint before blocking so the empty checkpoint will work in the
     // presence of threads blocking for weak ref access.
@@ -137,14 +142,42 @@ ObjPtr<mirror::Object> ReferenceProcessor::GetReferent(Thread* self,
   return reference->GetReferent();
 }
 
+ObjPtr<mirror::Object> ReferenceProcessor::GetMarkedReferent(ObjPtr<mirror::Reference> reference,
+                                                             ObjPtr<mirror::Object> referent) {
+  collector::GarbageCollector* collector = collector_.load(std::memory_order_seq_cst);
+  if (UNLIKELY(collector == nullptr)) {
+    return nullptr;
+  }
+  // If it's null it means not marked, but it could become marked if the referent is reachable
+  // by finalizer referents. So we cannot return in this case and must block. Otherwise, we
+  // can return it to the mutator as long as the GC is not preserving references, in which
+  // case only black nodes can be safely returned. If the GC is preserving references, the
+  // mutator could take a white field from a grey or white node and move it somewhere else
+  // in the heap causing corruption since this field would get swept.
+  // Use the cached referent instead of calling GetReferent since other threads could call
+  // Reference.clear() after we did the null check resulting in a null pointer being
+  // incorrectly passed to IsMarked. b/33569625
+  ObjPtr<mirror::Object> forwarded_ref = collector->IsMarked(referent.Ptr());
+  if (forwarded_ref == nullptr) {
+    return nullptr;
+  }
+  // Non null means that it is marked. Check for preserving after the mark check, so that the
+  // referent was marked before preserving started when the check is done without the lock.
+  if (!preserving_references_.load(std::memory_order_seq_cst) ||
+      (LIKELY(!reference->IsFinalizerReferenceInstance()) && reference->IsUnprocessed())) {
+    return forwarded_ref;
+  }
+  return nullptr;
+}
+
 void ReferenceProcessor::StartPreservingReferences(Thread* self) {
   MutexLock mu(self, *Locks::reference_processor_lock_);
-  preserving_references_ = true;
+  preserving_references_.store(true, std::memory_order_seq_cst);
 }
 
 void ReferenceProcessor::StopPreservingReferences(Thread* self) {
   MutexLock mu(self, *Locks::reference_processor_lock_);
-  preserving_references_ = false;
+  preserving_references_.store(false, std::memory_order_seq_cst);
   // We are done preserving references, some people who are blocked may see a marked referent.
   condition_.Broadcast(self);
 }
@@ -155,10 +188,15 @@ void ReferenceProcessor::ProcessReferences(bool concurrent,
                                            bool clear_soft_references,
                                            collector::GarbageCollector* collector) {
   TimingLogger::ScopedTiming t(concurrent ? __FUNCTION__ : "(Paused)ProcessReferences", timings);
+  const uint64_t start_time = NanoTime();
   Thread* self = Thread::Current();
+  Heap* heap = collector->GetHeap();
+  ThreadPool* thread_pool = heap->GetThreadPool();
+  const size_t thread_count = GetThreadCount(heap);
+  size_t num_cleared = 0u;
   {
     MutexLock mu(self, *Locks::reference_processor_lock_);
-    collector_ = collector;
+    collector_.store(collector, std::memory_order_seq_cst);
     if (!kUseReadBarrier) {
       CHECK_EQ(SlowPathEnabled(), concurrent) << "Slow path must be enabled iff concurrent";
     } else {
@@ -189,9 +227,15 @@ void ReferenceProcessor::ProcessReferences(bool concurrent,
       StopPreservingReferences(self);
     }
   }
-  // Clear all remaining soft and weak references with white referents.
-  soft_reference_queue_.ClearWhiteReferences(&cleared_references_, collector);
-  weak_reference_queue_.ClearWhiteReferences(&cleared_references_, collector);
+  {
+    TimingLogger::ScopedTiming t2(concurrent ? "ClearWhiteReferences" :
+        "(Paused)ClearWhiteReferences", timings);
+    // Clear all remaining soft and weak references with white referents.
+    num_cleared += soft_reference_queue_.ClearWhiteReferences(
+        &cleared_references_, collector, thread_pool, thread_count);
+    num_cleared += weak_reference_queue_.ClearWhiteReferences(
+        &cleared_references_, collector, thread_pool, thread_count);
+  }
   {
     TimingLogger::ScopedTiming t2(concurrent ? "EnqueueFinalizerReferences" :
         "(Paused)EnqueueFinalizerReferences", timings);
@@ -199,17 +243,29 @@ void ReferenceProcessor::ProcessReferences(bool concurrent,
       StartPreservingReferences(self);
     }
     // Preserve all white objects with finalize methods and schedule them for finalization.
-    finalizer_reference_queue_.EnqueueFinalizerReferences(&cleared_references_, collector);
+    FinalizerPool* finalizer_pool = heap->GetFinalizerPool();
+    ReferenceQueue* finalizer_references =
+        (finalizer_pool != nullptr && finalizer_pool->IsStarted()) ? &pool_finalizer_references_
+                                                                   : &cleared_references_;
+    num_cleared +=
+        finalizer_reference_queue_.EnqueueFinalizerReferences(finalizer_references, collector);
     collector->ProcessMarkStack();
     if (concurrent) {
       StopPreservingReferences(self);
     }
   }
-  // Clear all finalizer referent reachable soft and weak references with white referents.
-  soft_reference_queue_.ClearWhiteReferences(&cleared_references_, collector);
-  weak_reference_queue_.ClearWhiteReferences(&cleared_references_, collector);
-  // Clear all phantom references with white referents.
-  phantom_reference_queue_.ClearWhiteReferences(&cleared_references_, collector);
+  {
+    TimingLogger::ScopedTiming t2(concurrent ? "ClearFinalizerReachableReferences" :
+        "(Paused)ClearFinalizerReachableReferences", timings);
+    // Clear all finalizer referent reachable soft and weak references with white referents.
+    num_cleared += soft_reference_queue_.ClearWhiteReferences(
+        &cleared_references_, collector, thread_pool, thread_count);
+    num_cleared += weak_reference_queue_.ClearWhiteReferences(
+        &cleared_references_, collector, thread_pool, thread_count);
+    // Clear all phantom references with white referents.
+    num_cleared += phantom_reference_queue_.ClearWhiteReferences(
+        &cleared_references_, collector, thread_pool, thread_count);
+  }
   // At this point all reference queues other than the cleared references should be empty.
   DCHECK(soft_reference_queue_.IsEmpty());
   DCHECK(weak_reference_queue_.IsEmpty());
@@ -221,12 +277,22 @@ void ReferenceProcessor::ProcessReferences(bool concurrent,
     // could result in a stale is_marked_callback_ being called before the reference processing
     // starts since there is a small window of time where slow_path_enabled_ is enabled but the
     // callback isn't yet set.
-    collector_ = nullptr;
+    collector_.store(nullptr, std::memory_order_seq_cst);
     if (!kUseReadBarrier && concurrent) {
       // Done processing, disable the slow path and broadcast to the waiters.
       DisableSlowPath(self);
     }
   }
+  collector->RecordReferenceProcessing(NanoTime() - start_time, num_cleared);
+}
+
+size_t ReferenceProcessor::GetThreadCount(Heap* heap) const {
+  // Use only the GC thread in the background, like the marking. Mutators reading references wait
+  // for the processing to end, so the parallel GC threads are used even when concurrent.
+  if (heap->GetThreadPool() == nullptr || !Runtime::Current()->InJankPerceptibleProcessState()) {
+    return 1u;
+  }
+  return heap->GetParallelGCThreadCount() + 1u;
 }
 
 // Process the "referent" field in a java.lang.ref.Reference.  If the referent has not yet been
@@ -271,12 +337,14 @@ void ReferenceProcessor::DelayReferenceReferent(ObjPtr<mirror::Class> klass,
 
 void ReferenceProcessor::UpdateRoots(IsMarkedVisitor* visitor) {
   cleared_references_.UpdateRoots(visitor);
+  pool_finalizer_references_.UpdateRoots(visitor);
 }
 
 class ClearedReferenceTask : public HeapTask {
  public:
   explicit ClearedReferenceTask(jobject cleared_references)
-      : HeapTask(NanoTime()), cleared_references_(cleared_references) {
+      : HeapTask(NanoTime(), HeapTaskKind::kClearedReferences),
+        cleared_references_(cleared_references) {
   }
   void Run(Thread* thread) override {
     ScopedObjectAccess soa(thread);
@@ -295,6 +363,17 @@ SelfDeletingTask* ReferenceProcessor::CollectClearedReferences(Thread* self) {
   // By default we don't actually need to do anything. Just return this no-op task to avoid having
   // to put in ifs.
   std::unique_ptr<SelfDeletingTask> result(new FunctionTask([](Thread*) {}));
+  if (!pool_finalizer_references_.IsEmpty()) {
+    FinalizerPool* finalizer_pool = Runtime::Current()->GetHeap()->GetFinalizerPool();
+    ReaderMutexLock mu(self, *Locks::mutator_lock_);
+    if (LIKELY(finalizer_pool->IsStarted())) {
+      finalizer_pool->AddReferences(self, pool_finalizer_references_.GetList());
+      pool_finalizer_references_.Clear();
+    } else {
+      // The pool was stopped during the GC, leave the references to the FinalizerDaemon.
+      cleared_references_.Splice(&pool_finalizer_references_);
+    }
+  }
   // When a runtime isn't started there are no reference queues to care about so ignore.
   if (!cleared_references_.IsEmpty()) {
     if (LIKELY(Runtime::Current()->IsStarted())) {
@@ -17,6 +17,7 @@
 #ifndef ART_RUNTIME_GC_REFERENCE_PROCESSOR_H_
 #define ART_RUNTIME_GC_REFERENCE_PROCESSOR_H_
 
+#include "base/atomic.h"
 #include "base/locks.h"
 #include "jni.h"
 #include "reference_queue.h"
@@ -58,11 +59,12 @@ class ReferenceProcessor {
   // GetReferent fast path as an optimization.
   void EnableSlowPath() REQUIRES_SHARED(Locks::mutator_lock_);
   void BroadcastForSlowPath(Thread* self);
-  // Decode the referent, may block if references are being processed.
+  // Decode the referent, may block if references are being processed. Referents that the GC has
+  // already marked are returned without taking the reference processor lock.
   ObjPtr<mirror::Object> GetReferent(Thread* self, ObjPtr<mirror::Reference> reference)
       REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!Locks::reference_processor_lock_);
   // Collects the cleared references and returns a task, to be executed after FinishGC, that will
-  // enqueue all of them.
+  // enqueue all of them. Finalizer references are scheduled on the FinalizerPool, if it is started.
   SelfDeletingTask* CollectClearedReferences(Thread* self) REQUIRES(!Locks::mutator_lock_);
   void DelayReferenceReferent(ObjPtr<mirror::Class> klass,
                               ObjPtr<mirror::Reference> ref,
@@ -81,6 +83,13 @@ class ReferenceProcessor {
 
  private:
   bool SlowPathEnabled() REQUIRES_SHARED(Locks::mutator_lock_);
+  // Returns the marked referent of `reference` if it can be returned to the mutator while
+  // references are being processed, null otherwise.
+  ObjPtr<mirror::Object> GetMarkedReferent(ObjPtr<mirror::Reference> reference,
+                                           ObjPtr<mirror::Object> referent)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+  // Number of threads used to clear references, including the GC thread.
+  size_t GetThreadCount(Heap* heap) const;
   // Called by ProcessReferences.
   void DisableSlowPath(Thread* self) REQUIRES(Locks::reference_processor_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
@@ -94,11 +103,13 @@ class ReferenceProcessor {
       REQUIRES_SHARED(Locks::mutator_lock_)
       REQUIRES(Locks::reference_processor_lock_);
   // Collector which is clearing references, used by the GetReferent to return referents which are
-  // already marked.
-  collector::GarbageCollector* collector_ GUARDED_BY(Locks::reference_processor_lock_);
+  // already marked. Only written with the reference processor lock held, GetReferent also reads it
+  // without the lock.
+  Atomic<collector::GarbageCollector*> collector_;
   // Boolean for whether or not we are preserving references (either soft references or finalizers).
-  // If this is true, then we cannot return a referent (see comment in GetReferent).
-  bool preserving_references_ GUARDED_BY(Locks::reference_processor_lock_);
+  // If this is true, then we cannot return a referent (see comment in GetReferent). Only written
+  // with the reference processor lock held.
+  Atomic<bool> preserving_references_;
   // Condition that people wait on if they attempt to get the referent of a reference while
   // processing is in progress.
   ConditionVariable condition_ GUARDED_BY(Locks::reference_processor_lock_);
@@ -108,6 +119,9 @@ class ReferenceProcessor {
   ReferenceQueue finalizer_reference_queue_;
   ReferenceQueue phantom_reference_queue_;
   ReferenceQueue cleared_references_;
+  // Cleared finalizer references handed to the FinalizerPool instead of the
+  // java.lang.ref.ReferenceQueue, when the pool is started.
+  ReferenceQueue pool_finalizer_references_;
 
   DISALLOW_COPY_AND_ASSIGN(ReferenceProcessor);
 };
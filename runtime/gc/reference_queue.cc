@@ -16,7 +16,11 @@
 
 #include "reference_queue.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "accounting/card_table-inl.h"
+#include "base/bit_utils.h"
 #include "base/mutex.h"
 #include "collector/concurrent_copying.h"
 #include "heap.h"
@@ -56,6 +60,21 @@ void ReferenceQueue::EnqueueReference(ObjPtr<mirror::Reference> ref) {
   list_->SetPendingNext(ref);
 }
 
+void ReferenceQueue::Splice(ReferenceQueue* other) {
+  if (other->IsEmpty()) {
+    return;
+  }
+  if (IsEmpty()) {
+    list_ = other->list_;
+  } else {
+    // Exchanging the successors of the two heads joins the two cycles.
+    ObjPtr<mirror::Reference> head = list_->GetPendingNext<kWithoutReadBarrier>();
+    list_->SetPendingNext(other->list_->GetPendingNext<kWithoutReadBarrier>());
+    other->list_->SetPendingNext(head);
+  }
+  other->Clear();
+}
+
 ObjPtr<mirror::Reference> ReferenceQueue::DequeuePendingReference() {
   DCHECK(!IsEmpty());
   ObjPtr<mirror::Reference> ref = list_->GetPendingNext<kWithoutReadBarrier>();
@@ -130,30 +149,104 @@ size_t ReferenceQueue::GetLength() const {
   return count;
 }
 
-void ReferenceQueue::ClearWhiteReferences(ReferenceQueue* cleared_references,
-                                          collector::GarbageCollector* collector) {
+// Clears the referent of `ref` if it is white. Returns whether it was cleared.
+static bool ClearReferentIfWhite(ObjPtr<mirror::Reference> ref,
+                                 collector::GarbageCollector* collector)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  mirror::HeapReference<mirror::Object>* referent_addr = ref->GetReferentReferenceAddr();
+  // do_atomic_update is false because this happens during the reference processing phase where
+  // Reference.clear() would block.
+  if (collector->IsNullOrMarkedHeapReference(referent_addr, /*do_atomic_update=*/false)) {
+    return false;
+  }
+  // Referent is white, clear it.
+  if (Runtime::Current()->IsActiveTransaction()) {
+    ref->ClearReferent<true>();
+  } else {
+    ref->ClearReferent<false>();
+  }
+  return true;
+}
+
+size_t ReferenceQueue::ClearWhiteReferences(ReferenceQueue* cleared_references,
+                                            collector::GarbageCollector* collector,
+                                            ThreadPool* thread_pool,
+                                            size_t thread_count) {
+  // Transactions record the cleared referents, which is not thread safe.
+  if (thread_pool != nullptr && thread_count > 1u && !Runtime::Current()->IsActiveTransaction()) {
+    return ClearWhiteReferencesParallel(cleared_references, collector, thread_pool, thread_count);
+  }
+  size_t num_cleared = 0u;
   while (!IsEmpty()) {
     ObjPtr<mirror::Reference> ref = DequeuePendingReference();
-    mirror::HeapReference<mirror::Object>* referent_addr = ref->GetReferentReferenceAddr();
-    // do_atomic_update is false because this happens during the reference processing phase where
-    // Reference.clear() would block.
-    if (!collector->IsNullOrMarkedHeapReference(referent_addr, /*do_atomic_update=*/false)) {
-      // Referent is white, clear it.
-      if (Runtime::Current()->IsActiveTransaction()) {
-        ref->ClearReferent<true>();
-      } else {
-        ref->ClearReferent<false>();
-      }
+    if (ClearReferentIfWhite(ref, collector)) {
       cleared_references->EnqueueReference(ref);
+      ++num_cleared;
     }
     // Delay disabling the read barrier until here so that the ClearReferent call above in
     // transaction mode will trigger the read barrier.
     DisableReadBarrierForReference(ref);
   }
+  return num_cleared;
+}
+
+size_t ReferenceQueue::ClearWhiteReferencesParallel(ReferenceQueue* cleared_references,
+                                                    collector::GarbageCollector* collector,
+                                                    ThreadPool* thread_pool,
+                                                    size_t thread_count) {
+  // Unlinking is cheap compared to checking the referents, do it on this thread. Raw pointers
+  // since the references are used by the workers.
+  std::vector<mirror::Reference*> refs;
+  while (!IsEmpty()) {
+    refs.push_back(DequeuePendingReference().Ptr());
+  }
+  size_t num_tasks = 1u;
+  size_t refs_per_task = refs.size();
+  if (refs.size() >= kMinParallelReferences) {
+    num_tasks = RoundUp(refs.size(), kReferencesPerTask) / kReferencesPerTask;
+    refs_per_task = kReferencesPerTask;
+  }
+  // The cleared references of each task, enqueued by this thread since the cleared references
+  // queue is not thread safe.
+  std::vector<std::vector<mirror::Reference*>> cleared(num_tasks);
+  auto clear_range = [&](size_t task) NO_THREAD_SAFETY_ANALYSIS {
+    const size_t begin = task * refs_per_task;
+    const size_t end = std::min(begin + refs_per_task, refs.size());
+    for (size_t i = begin; i < end; ++i) {
+      ObjPtr<mirror::Reference> ref = refs[i];
+      if (ClearReferentIfWhite(ref, collector)) {
+        cleared[task].push_back(refs[i]);
+      }
+      DisableReadBarrierForReference(ref);
+    }
+  };
+  if (num_tasks == 1u) {
+    clear_range(0u);
+  } else {
+    Thread* self = Thread::Current();
+    for (size_t task = 0; task != num_tasks; ++task) {
+      thread_pool->AddTask(self, new FunctionTask([&clear_range, task](Thread*) {
+        clear_range(task);
+      }));
+    }
+    thread_pool->SetMaxActiveWorkers(thread_count - 1);
+    thread_pool->StartWorkers(self);
+    thread_pool->Wait(self, /* do_work= */ true, /* may_hold_locks= */ true);
+    thread_pool->StopWorkers(self);
+  }
+  size_t num_cleared = 0u;
+  for (const std::vector<mirror::Reference*>& task_cleared : cleared) {
+    for (mirror::Reference* ref : task_cleared) {
+      cleared_references->EnqueueReference(ref);
+    }
+    num_cleared += task_cleared.size();
+  }
+  return num_cleared;
 }
 
-void ReferenceQueue::EnqueueFinalizerReferences(ReferenceQueue* cleared_references,
-                                                collector::GarbageCollector* collector) {
+size_t ReferenceQueue::EnqueueFinalizerReferences(ReferenceQueue* cleared_references,
+                                                  collector::GarbageCollector* collector) {
+  size_t num_enqueued = 0u;
   while (!IsEmpty()) {
     ObjPtr<mirror::FinalizerReference> ref = DequeuePendingReference()->AsFinalizerReference();
     mirror::HeapReference<mirror::Object>* referent_addr = ref->GetReferentReferenceAddr();
@@ -170,11 +263,13 @@ void ReferenceQueue::EnqueueFinalizerReferences(ReferenceQueue* cleared_referenc
         ref->ClearReferent<false>();
       }
       cleared_references->EnqueueReference(ref);
+      ++num_enqueued;
     }
     // Delay disabling the read barrier until here so that the ClearReferent call above in
     // transaction mode will trigger the read barrier.
     DisableReadBarrierForReference(ref->AsReference());
   }
+  return num_enqueued;
 }
 
 void ReferenceQueue::ForwardSoftReferences(MarkObjectVisitor* visitor) {
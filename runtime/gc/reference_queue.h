@@ -67,6 +67,10 @@ class ReferenceQueue {
   // Not thread safe, used when mutators are paused to minimize lock overhead.
   void EnqueueReference(ObjPtr<mirror::Reference> ref) REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Moves the references of `other` to this queue.
+  // Not thread safe, used when the GC owns both queues.
+  void Splice(ReferenceQueue* other) REQUIRES_SHARED(Locks::mutator_lock_);
+
   // Dequeue a reference from the queue and return that dequeued reference.
   // Call DisableReadBarrierForReference for the reference that's returned from this function.
   ObjPtr<mirror::Reference> DequeuePendingReference() REQUIRES_SHARED(Locks::mutator_lock_);
@@ -78,9 +82,9 @@ class ReferenceQueue {
       REQUIRES_SHARED(Locks::mutator_lock_);
 
   // Enqueues finalizer references with white referents.  White referents are blackened, moved to
-  // the zombie field, and the referent field is cleared.
-  void EnqueueFinalizerReferences(ReferenceQueue* cleared_references,
-                                  collector::GarbageCollector* collector)
+  // the zombie field, and the referent field is cleared. Returns the number of enqueued references.
+  size_t EnqueueFinalizerReferences(ReferenceQueue* cleared_references,
+                                    collector::GarbageCollector* collector)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
   // Walks the reference list marking any references subject to the reference clearing policy.
@@ -91,8 +95,12 @@ class ReferenceQueue {
 
   // Unlink the reference list clearing references objects with white referents. Cleared references
   // registered to a reference queue are scheduled for appending by the heap worker thread.
-  void ClearWhiteReferences(ReferenceQueue* cleared_references,
-                            collector::GarbageCollector* collector)
+  // Long lists are checked and cleared with up to `thread_count` threads, using the workers of
+  // `thread_pool`. Returns the number of cleared references.
+  size_t ClearWhiteReferences(ReferenceQueue* cleared_references,
+                              collector::GarbageCollector* collector,
+                              ThreadPool* thread_pool = nullptr,
+                              size_t thread_count = 1u)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
   void Dump(std::ostream& os) const REQUIRES_SHARED(Locks::mutator_lock_);
@@ -113,6 +121,17 @@ class ReferenceQueue {
       REQUIRES_SHARED(Locks::mutator_lock_);
 
  private:
+  // Lists shorter than this are cleared by the calling thread only.
+  static constexpr size_t kMinParallelReferences = 8 * 1024;
+  // Number of references checked by each task when clearing in parallel.
+  static constexpr size_t kReferencesPerTask = 2 * 1024;
+
+  size_t ClearWhiteReferencesParallel(ReferenceQueue* cleared_references,
+                                      collector::GarbageCollector* collector,
+                                      ThreadPool* thread_pool,
+                                      size_t thread_count)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
   // Lock, used for parallel GC reference enqueuing. It allows for multiple threads simultaneously
   // calling AtomicEnqueueIfNotEnqueued.
   Mutex* const lock_;
@@ -16,11 +16,14 @@
 
 #include "image_space.h"
 
+#include <pthread.h>
 #include <sys/statvfs.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <random>
+#include <thread>
 
 #include "android-base/stringprintf.h"
 #include "android-base/strings.h"
@@ -351,6 +354,82 @@ void ImageSpace::VerifyImageAllocations() {
   }
 }
 
+// Visit the objects marked in the `bitmap` in the range [begin, end). If the range is big enough,
+// split it into page-aligned chunks and visit them on native worker threads as well as on the
+// calling thread. Since a page spans whole bitmap words, threads never share a bitmap word and
+// the visitor may set the bit for the visited object in another bitmap with the same layout.
+//
+// The workers do not attach to the runtime, so this also works while the boot image is loaded
+// from the Heap constructor, before any thread pool exists, but the visitor must not need a
+// Thread. The calling thread stays runnable and does not check for suspension until it has
+// joined the workers, so the workers run under its share of the mutator lock.
+template <typename Visitor>
+static void VisitMarkedRangeInParallel(const accounting::ContinuousSpaceBitmap* bitmap,
+                                       uintptr_t begin,
+                                       uintptr_t end,
+                                       const char* what,
+                                       const Visitor& visitor)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  static constexpr size_t kMinParallelRangeSize = 256 * KB;
+  static constexpr size_t kMaxThreads = 4u;
+  static constexpr size_t kChunksPerThread = 4u;
+  static_assert(IsAligned<kObjectAlignment * kBitsPerIntPtrT>(kPageSize),
+                "Page must span whole bitmap words");
+  const uint64_t start = NanoTime();
+  const size_t max_threads =
+      std::min(std::max(static_cast<size_t>(std::thread::hardware_concurrency()), size_t{1u}),
+               kMaxThreads);
+  if (max_threads == 1u || end - begin < kMinParallelRangeSize) {
+    bitmap->VisitMarkedRange(begin, end, visitor);
+    VLOG(image) << what << " took " << PrettyDuration(NanoTime() - start);
+    return;
+  }
+
+  const uintptr_t chunks_begin = RoundDown(begin, kPageSize);
+  const size_t chunk_size =
+      RoundUp(DivideRoundUp(end - chunks_begin, max_threads * kChunksPerThread), kPageSize);
+  const size_t num_chunks = DivideRoundUp(end - chunks_begin, chunk_size);
+  std::atomic<size_t> next_chunk(0u);
+  std::atomic<uint64_t> busy_time(0u);
+  auto work = [&]() NO_THREAD_SAFETY_ANALYSIS {
+    const uint64_t work_start = NanoTime();
+    for (size_t i = next_chunk.fetch_add(1u, std::memory_order_relaxed);
+         i < num_chunks;
+         i = next_chunk.fetch_add(1u, std::memory_order_relaxed)) {
+      uintptr_t chunk_begin = std::max(chunks_begin + i * chunk_size, begin);
+      uintptr_t chunk_end = std::min(chunks_begin + (i + 1u) * chunk_size, end);
+      bitmap->VisitMarkedRange(chunk_begin, chunk_end, visitor);
+    }
+    busy_time.fetch_add(NanoTime() - work_start, std::memory_order_relaxed);
+  };
+  using Work = decltype(work);
+  auto run_work = [](void* arg) -> void* {
+    (*reinterpret_cast<Work*>(arg))();
+    return nullptr;
+  };
+  pthread_t workers[kMaxThreads - 1u];
+  size_t num_workers = 0u;
+  for (; num_workers != max_threads - 1u; ++num_workers) {
+    // If a thread cannot be created, the remaining chunks are visited by the others.
+    int rc = pthread_create(&workers[num_workers], nullptr, run_work, &work);
+    if (rc != 0) {
+      errno = rc;
+      PLOG(WARNING) << "Failed to create a worker thread for " << what;
+      break;
+    }
+  }
+  work();
+  for (size_t i = 0; i != num_workers; ++i) {
+    CHECK_PTHREAD_CALL(pthread_join, (workers[i], nullptr), what);
+  }
+  const uint64_t time = NanoTime() - start;
+  // Add one 1 ns to prevent possible divide by 0.
+  VLOG(image) << what << " took " << PrettyDuration(time) << " in " << num_chunks
+              << " chunks on " << num_workers + 1u << " threads (speedup "
+              << StringPrintf("%.2f", static_cast<double>(busy_time.load()) / (time + 1))
+              << "x)";
+}
+
 // Helper class for relocating from one range of memory to another.
 class RelocationRange {
  public:
@@ -1221,15 +1300,18 @@ class ImageSpace::Loader {
         Thread* const self = Thread::Current();
         static constexpr size_t kMinBlocks = 2u;
         const bool use_parallel = pool != nullptr && image_header.GetBlockCount() >= kMinBlocks;
+        std::atomic<bool> decompression_failed(false);
         for (const ImageHeader::Block& block : image_header.GetBlocks(temp_map.Begin())) {
           auto function = [&](Thread*) {
             const uint64_t start2 = NanoTime();
-            ScopedTrace trace("LZ4 decompress block");
+            ScopedTrace trace("Decompress image block");
+            std::string block_error_msg;
             bool result = block.Decompress(/*out_ptr=*/map.Begin(),
                                            /*in_ptr=*/temp_map.Begin(),
-                                           error_msg);
-            if (!result && error_msg != nullptr) {
-              *error_msg = "Failed to decompress image block " + *error_msg;
+                                           &block_error_msg);
+            // Report only the first failure, other blocks may be decompressed concurrently.
+            if (!result && !decompression_failed.exchange(true) && error_msg != nullptr) {
+              *error_msg = "Failed to decompress image block " + block_error_msg;
             }
             VLOG(image) << "Decompress block " << block.GetDataSize() << " -> "
                         << block.GetImageSize() << " in " << PrettyDuration(NanoTime() - start2);
@@ -1246,6 +1328,9 @@ class ImageSpace::Loader {
           ScopedThreadSuspension sts(Thread::Current(), kNative);
           pool->Wait(self, true, false);
         }
+        if (decompression_failed.load()) {
+          return MemMap::Invalid();
+        }
         const uint64_t time = NanoTime() - start;
         // Add one 1 ns to prevent possible divide by 0.
         VLOG(image) << "Decompressing image took " << PrettyDuration(time) << " ("
@@ -1521,7 +1606,8 @@ class ImageSpace::Loader {
       uintptr_t objects_begin = reinterpret_cast<uintptr_t>(target_base + objects_section.Offset());
       uintptr_t objects_end = reinterpret_cast<uintptr_t>(target_base + objects_section.End());
       FixupObjectVisitor<ForwardObject> fixup_object_visitor(&visited_bitmap, forward_object);
-      bitmap->VisitMarkedRange(objects_begin, objects_end, fixup_object_visitor);
+      VisitMarkedRangeInParallel(
+          bitmap, objects_begin, objects_end, "Fixing up app image objects", fixup_object_visitor);
       // Fixup image roots.
       CHECK(app_image_objects.InSource(reinterpret_cast<uintptr_t>(
           image_header->GetImageRoots<kWithoutReadBarrier>().Ptr())));
@@ -2958,8 +3044,9 @@ class ImageSpace::BootImageLoader {
       static_assert(IsAligned<kObjectAlignment>(sizeof(ImageHeader)), "Header alignment check");
       uint32_t objects_end = image_header.GetObjectsSection().Size();
       DCHECK_ALIGNED(objects_end, kObjectAlignment);
-      for (uint32_t pos = sizeof(ImageHeader); pos != objects_end; ) {
-        mirror::Object* object = reinterpret_cast<mirror::Object*>(space->Begin() + pos);
+      // The objects in different pages are independent in this last pass, so we can use
+      // the live bitmap to split the work between threads.
+      auto visit_object = [&](mirror::Object* object) NO_THREAD_SAFETY_ANALYSIS {
         // Note: use Test() rather than Set() as this is the last time we're checking this object.
         if (!patched_objects->Test(object)) {
           // This is the last pass over objects, so we do not need to Set().
@@ -2981,8 +3068,12 @@ class ImageSpace::BootImageLoader {
                                         kVerifyNone>(patched_method);
           }
         }
-        pos += RoundUp(object->SizeOf<kVerifyNone>(), kObjectAlignment);
-      }
+      };
+      VisitMarkedRangeInParallel(space->GetLiveBitmap(),
+                                 reinterpret_cast<uintptr_t>(space->Begin() + sizeof(ImageHeader)),
+                                 reinterpret_cast<uintptr_t>(space->Begin() + objects_end),
+                                 "Relocating boot image objects",
+                                 visit_object);
     }
     if (kIsDebugBuild && !kExtension) {
       // We used just Test() instead of Set() above but we need to use Set()
@@ -51,39 +51,32 @@ template<bool kForEvac>
 inline mirror::Object* RegionSpace::AllocNonvirtual(size_t num_bytes,
                                                     /* out */ size_t* bytes_allocated,
                                                     /* out */ size_t* usable_size,
-                                                    /* out */ size_t* bytes_tl_bulk_allocated) {
+                                                    /* out */ size_t* bytes_tl_bulk_allocated,
+                                                    size_t numa_node) {
   DCHECK_ALIGNED(num_bytes, kAlignment);
+  DCHECK(numa_node == kAnyNumaNode || (kForEvac && numa_node < num_numa_nodes_));
   mirror::Object* obj;
   if (LIKELY(num_bytes <= kRegionSize)) {
     // Non-large object.
-    obj = (kForEvac ? evac_region_ : current_region_)->Alloc(num_bytes,
-                                                             bytes_allocated,
-                                                             usable_size,
-                                                             bytes_tl_bulk_allocated);
+    Region** region_slot = kForEvac ? EvacRegionSlot(numa_node) : &current_region_;
+    obj = (*region_slot)->Alloc(num_bytes, bytes_allocated, usable_size, bytes_tl_bulk_allocated);
     if (LIKELY(obj != nullptr)) {
       return obj;
     }
     MutexLock mu(Thread::Current(), region_lock_);
     // Retry with current region since another thread may have updated
     // current_region_ or evac_region_.  TODO: fix race.
-    obj = (kForEvac ? evac_region_ : current_region_)->Alloc(num_bytes,
-                                                             bytes_allocated,
-                                                             usable_size,
-                                                             bytes_tl_bulk_allocated);
+    obj = (*region_slot)->Alloc(num_bytes, bytes_allocated, usable_size, bytes_tl_bulk_allocated);
     if (LIKELY(obj != nullptr)) {
       return obj;
     }
-    Region* r = AllocateRegion(kForEvac);
+    Region* r = AllocateRegion(kForEvac, numa_node);
     if (LIKELY(r != nullptr)) {
       obj = r->Alloc(num_bytes, bytes_allocated, usable_size, bytes_tl_bulk_allocated);
       CHECK(obj != nullptr);
       // Do our allocation before setting the region, this makes sure no threads race ahead
       // and fill in the region before we allocate the object. b/63153464
-      if (kForEvac) {
-        evac_region_ = r;
-      } else {
-        current_region_ = r;
-      }
+      *region_slot = r;
       return obj;
     }
   } else {
@@ -233,7 +226,13 @@ inline void RegionSpace::WalkInternal(Visitor&& visitor) {
   // issues (the classloader classes lock and the monitor lock). We
   // call this with threads suspended.
   Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
-  for (size_t i = 0; i < num_regions_; ++i) {
+  WalkRegionRange<kToSpaceOnly>(0u, num_regions_, visitor);
+}
+
+template<bool kToSpaceOnly, typename Visitor>
+inline void RegionSpace::WalkRegionRange(size_t begin, size_t end, Visitor&& visitor) {
+  DCHECK_LE(end, num_regions_);
+  for (size_t i = begin; i < end; ++i) {
     Region* r = &regions_[i];
     if (r->IsFree() || (kToSpaceOnly && !r->IsInToSpace())) {
       continue;
@@ -304,6 +303,11 @@ inline void RegionSpace::WalkToSpace(Visitor&& visitor) {
   WalkInternal</* kToSpaceOnly= */ true>(visitor);
 }
 
+template <typename Visitor>
+inline void RegionSpace::WalkRegions(size_t begin, size_t end, Visitor&& visitor) {
+  WalkRegionRange</* kToSpaceOnly= */ false>(begin, end, visitor);
+}
+
 inline mirror::Object* RegionSpace::GetNextObject(mirror::Object* obj) {
   const uintptr_t position = reinterpret_cast<uintptr_t>(obj) + obj->SizeOf();
   return reinterpret_cast<mirror::Object*>(RoundUp(position, kAlignment));
@@ -15,6 +15,16 @@
  */
 #include <deque>
 
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "android-base/file.h"
+#include "android-base/parseint.h"
+#include "android-base/strings.h"
+
 #include "bump_pointer_space-inl.h"
 #include "bump_pointer_space.h"
 #include "base/dumpable.h"
@@ -22,6 +32,7 @@
 #include "gc/accounting/read_barrier_table.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
+#include "scoped_thread_state_change-inl.h"
 #include "thread_list.h"
 
 namespace art {
@@ -47,6 +58,73 @@ static constexpr uint32_t kPoisonDeadObject = 0xBADDB01D;  // "BADDROID"
 // Whether we check a region's live bytes count against the region bitmap.
 static constexpr bool kCheckLiveBytesAgainstRegionBitmap = kIsDebugBuild;
 
+// Return the number of NUMA nodes the kernel may bring online, 1 if it cannot be determined.
+static size_t GetNumNumaNodes() {
+#if defined(__linux__)
+  // The file holds a list of node ranges, such as "0" or "0-3".
+  std::string possible;
+  if (android::base::ReadFileToString("/sys/devices/system/node/possible", &possible)) {
+    possible = android::base::Trim(possible);
+    size_t separator = possible.find_last_of("-,");
+    size_t last_node;
+    if (android::base::ParseUint(
+            possible.substr(separator == std::string::npos ? 0u : separator + 1u), &last_node)) {
+      return last_node + 1u;
+    }
+  }
+#endif
+  return 1u;
+}
+
+// Return the NUMA node of the CPU the calling thread runs on.
+static size_t GetCurrentNumaNode() {
+#if defined(__linux__)
+  unsigned cpu;
+  unsigned node;
+  if (syscall(__NR_getcpu, &cpu, &node, nullptr) == 0) {
+    return node;
+  }
+#endif
+  return 0u;
+}
+
+// Set the memory policy of [begin, begin + size) to prefer pages of `node`. The policy also
+// applies to pages faulted in again after being released with madvise().
+static void PreferNumaNode(uint8_t* begin, size_t size, size_t node) {
+#if defined(__linux__)
+  unsigned long node_mask = 1UL << node;
+  if (syscall(__NR_mbind,
+              begin,
+              size,
+              MPOL_PREFERRED,
+              &node_mask,
+              sizeof(node_mask) * kBitsPerByte,
+              /*flags=*/ 0) != 0) {
+    PLOG(WARNING) << "Failed to bind region space memory to NUMA node " << node;
+  }
+#else
+  UNUSED(begin, size, node);
+#endif
+}
+
+// Query the NUMA node of each page in `pages`. The status of a page is its node, or a negative
+// errno value for example if the page is not resident.
+static bool QueryNumaNodes(const std::vector<void*>& pages, /* out */ std::vector<int>* status) {
+  status->resize(pages.size());
+#if defined(__linux__)
+  return pages.empty() ||
+      syscall(__NR_move_pages,
+              /*pid=*/ 0,
+              pages.size(),
+              const_cast<void**>(pages.data()),
+              /*nodes=*/ nullptr,
+              status->data(),
+              /*flags=*/ 0) == 0;
+#else
+  return false;
+#endif
+}
+
 MemMap RegionSpace::CreateMemMap(const std::string& name,
                                  size_t capacity,
                                  uint8_t* requested_begin) {
@@ -94,12 +172,17 @@ MemMap RegionSpace::CreateMemMap(const std::string& name,
   return mem_map;
 }
 
-RegionSpace* RegionSpace::Create(
-    const std::string& name, MemMap&& mem_map, bool use_generational_cc) {
-  return new RegionSpace(name, std::move(mem_map), use_generational_cc);
+RegionSpace* RegionSpace::Create(const std::string& name,
+                                 MemMap&& mem_map,
+                                 bool use_generational_cc,
+                                 bool numa_aware) {
+  return new RegionSpace(name, std::move(mem_map), use_generational_cc, numa_aware);
 }
 
-RegionSpace::RegionSpace(const std::string& name, MemMap&& mem_map, bool use_generational_cc)
+RegionSpace::RegionSpace(const std::string& name,
+                         MemMap&& mem_map,
+                         bool use_generational_cc,
+                         bool numa_aware)
     : ContinuousMemMapAllocSpace(name,
                                  std::move(mem_map),
                                  mem_map.Begin(),
@@ -116,7 +199,10 @@ RegionSpace::RegionSpace(const std::string& name, MemMap&& mem_map, bool use_gen
       non_free_region_index_limit_(0U),
       current_region_(&full_region_),
       evac_region_(nullptr),
-      cyclic_alloc_region_index_(0U) {
+      num_numa_nodes_(1U),
+      regions_per_numa_node_(0U),
+      cyclic_alloc_region_index_(0U),
+      release_dead_object_pages_index_(0U) {
   CHECK_ALIGNED(mem_map_.Size(), kRegionSize);
   CHECK_ALIGNED(mem_map_.Begin(), kRegionSize);
   DCHECK_GT(num_regions_, 0U);
@@ -142,10 +228,32 @@ RegionSpace::RegionSpace(const std::string& name, MemMap&& mem_map, bool use_gen
   DCHECK(full_region_.IsAllocated());
   size_t ignored;
   DCHECK(full_region_.Alloc(kAlignment, &ignored, nullptr, &ignored) == nullptr);
+  if (numa_aware) {
+    size_t num_nodes = std::min({GetNumNumaNodes(), kMaxNumaNodes, num_regions_});
+    if (num_nodes > 1u) {
+      SetUpNumaNodes(num_nodes);
+    } else {
+      VLOG(heap) << "Ignoring NUMA aware region allocation on a single node";
+    }
+  }
   // Protect the whole region space from the start.
   Protect();
 }
 
+void RegionSpace::SetUpNumaNodes(size_t num_nodes) {
+  DCHECK_GT(num_nodes, 1u);
+  num_numa_nodes_ = num_nodes;
+  regions_per_numa_node_ = num_regions_ / num_nodes;
+  numa_evac_regions_.reset(new Region*[num_nodes]);
+  for (size_t node = 0; node < num_nodes; ++node) {
+    numa_evac_regions_[node] = evac_region_;
+    size_t first = node * regions_per_numa_node_;
+    size_t last = (node + 1u == num_nodes) ? num_regions_ : first + regions_per_numa_node_;
+    PreferNumaNode(regions_[first].Begin(), (last - first) * kRegionSize, node);
+  }
+  VLOG(heap) << "Partitioned " << num_regions_ << " regions into " << num_nodes << " NUMA nodes";
+}
+
 size_t RegionSpace::FromSpaceSize() {
   uint64_t num_regions = 0;
   MutexLock mu(Thread::Current(), region_lock_);
@@ -408,7 +516,7 @@ void RegionSpace::SetFromSpace(accounting::ReadBarrierTable* rb_table,
   }
   DCHECK_EQ(num_expected_large_tails, 0U);
   current_region_ = &full_region_;
-  evac_region_ = &full_region_;
+  SetEvacRegions(&full_region_);
 }
 
 static void ZeroAndProtectRegion(uint8_t* begin, uint8_t* end) {
@@ -625,9 +733,10 @@ void RegionSpace::ClearFromSpace(/* out */ uint64_t* cleared_bytes,
   }
   // Update non_free_region_index_limit_.
   SetNonFreeRegionLimit(new_non_free_region_index_limit);
-  evac_region_ = nullptr;
+  SetEvacRegions(nullptr);
   num_non_free_regions_ += num_evac_regions_;
   num_evac_regions_ = 0;
+  release_dead_object_pages_index_ = 0;
 }
 
 void RegionSpace::CheckLiveBytesAgainstRegionBitmap(Region* r) {
@@ -706,6 +815,9 @@ void RegionSpace::PoisonDeadObjectsInUnevacuatedRegion(Region* r) {
     prev_obj_end = reinterpret_cast<uint8_t*>(GetNextObject(obj));
   };
 
+  // Poisoning writes to the pages of dead objects, they are no longer released.
+  r->released_bytes_ = 0;
+
   // Visit live objects in `r` and poison gaps (dead objects) between them.
   GetLiveBitmap()->VisitMarkedRange(reinterpret_cast<uintptr_t>(r->Begin()),
                                     reinterpret_cast<uintptr_t>(r->Top()),
@@ -716,6 +828,84 @@ void RegionSpace::PoisonDeadObjectsInUnevacuatedRegion(Region* r) {
   }
 }
 
+size_t RegionSpace::ReleaseDeadObjectPages(size_t max_bytes) {
+  Thread* self = Thread::Current();
+  size_t released_bytes = 0;
+  std::vector<std::pair<uint8_t*, uint8_t*>> ranges;
+  while (released_bytes < max_bytes) {
+    // Find the next region whose live objects are known from the region space bitmap, the same
+    // condition as in RegionSpace::WalkNonLargeRegion. Nothing allocates into it until the next
+    // collection.
+    Region* r = nullptr;
+    {
+      MutexLock mu(self, region_lock_);
+      while (r == nullptr && release_dead_object_pages_index_ < non_free_region_index_limit_) {
+        Region* candidate = &regions_[release_dead_object_pages_index_];
+        ++release_dead_object_pages_index_;
+        if (candidate->IsInToSpace() &&
+            !candidate->IsLarge() &&
+            !candidate->IsLargeTail() &&
+            !candidate->IsTlab() &&
+            !candidate->IsNewlyAllocated() &&
+            candidate->LiveBytes() != static_cast<size_t>(-1) &&
+            candidate->LiveBytes() < candidate->BytesAllocated()) {
+          r = candidate;
+        }
+      }
+    }
+    if (r == nullptr) {
+      break;
+    }
+    ranges.clear();
+    size_t dead_object_page_bytes;
+    {
+      ScopedObjectAccess soa(self);
+      dead_object_page_bytes = FindDeadObjectPagesInRegion(r, &ranges);
+    }
+    // Do not call madvise while holding region_lock_, see ClearFromSpace, nor the mutator lock.
+    for (const std::pair<uint8_t*, uint8_t*>& range : ranges) {
+      CheckedCall(madvise,
+                  "RegionSpace::ReleaseDeadObjectPages",
+                  range.first,
+                  range.second - range.first,
+                  MADV_DONTNEED);
+    }
+    // Pages released by a previous step are released again, only count the new ones.
+    MutexLock mu(self, region_lock_);
+    if (dead_object_page_bytes > r->released_bytes_) {
+      released_bytes += dead_object_page_bytes - r->released_bytes_;
+      r->released_bytes_ = dead_object_page_bytes;
+    }
+  }
+  return released_bytes;
+}
+
+size_t RegionSpace::FindDeadObjectPagesInRegion(
+    Region* r, /* out */ std::vector<std::pair<uint8_t*, uint8_t*>>* ranges) {
+  size_t bytes = 0;
+  auto add_range = [&bytes, ranges](uint8_t* begin, uint8_t* end) {
+    uint8_t* page_begin = AlignUp(begin, kPageSize);
+    uint8_t* page_end = AlignDown(end, kPageSize);
+    if (page_begin < page_end) {
+      ranges->emplace_back(page_begin, page_end);
+      bytes += page_end - page_begin;
+    }
+  };
+  // Find the whole pages between live objects, as PoisonDeadObjectsInUnevacuatedRegion finds
+  // the gaps to poison.
+  uint8_t* prev_obj_end = r->Begin();
+  auto maybe_add = [&prev_obj_end, &add_range](mirror::Object* obj)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    add_range(prev_obj_end, reinterpret_cast<uint8_t*>(obj));
+    prev_obj_end = reinterpret_cast<uint8_t*>(GetNextObject(obj));
+  };
+  GetLiveBitmap()->VisitMarkedRange(reinterpret_cast<uintptr_t>(r->Begin()),
+                                    reinterpret_cast<uintptr_t>(r->Top()),
+                                    maybe_add);
+  add_range(prev_obj_end, r->Top());
+  return bytes;
+}
+
 void RegionSpace::LogFragmentationAllocFailure(std::ostream& os,
                                                size_t /* failed_alloc_bytes */) {
   size_t max_contiguous_allocation = 0;
@@ -768,7 +958,7 @@ void RegionSpace::Clear() {
   SetNonFreeRegionLimit(0);
   DCHECK_EQ(num_non_free_regions_, 0u);
   current_region_ = &full_region_;
-  evac_region_ = &full_region_;
+  SetEvacRegions(&full_region_);
 }
 
 void RegionSpace::Protect() {
@@ -831,6 +1021,78 @@ void RegionSpace::DumpNonFreeRegions(std::ostream& os) {
   }
 }
 
+void RegionSpace::GetCommittedAndLiveBytes(uint64_t* committed, uint64_t* live) {
+  *committed = 0u;
+  *live = 0u;
+  MutexLock mu(Thread::Current(), region_lock_);
+  for (size_t i = 0; i < num_regions_; ++i) {
+    Region* r = &regions_[i];
+    if (r->IsFree()) {
+      continue;
+    }
+    if (r->IsLarge() || r->IsLargeTail()) {
+      *committed += kRegionSize;
+    } else {
+      *committed += RoundUp(static_cast<size_t>(r->Top() - r->Begin()), kPageSize) -
+                    r->released_bytes_;
+    }
+    size_t bytes_allocated = r->BytesAllocated();
+    size_t live_bytes = r->LiveBytes();
+    *live += (live_bytes != static_cast<size_t>(-1) && live_bytes < bytes_allocated)
+        ? live_bytes
+        : bytes_allocated;
+  }
+}
+
+void RegionSpace::DumpNumaInfo(std::ostream& os) {
+  if (!IsNumaAware()) {
+    return;
+  }
+  std::vector<size_t> num_regions(num_numa_nodes_, 0u);
+  std::vector<size_t> num_local_pages(num_numa_nodes_, 0u);
+  std::vector<size_t> num_remote_pages(num_numa_nodes_, 0u);
+  std::vector<void*> pages;
+  std::vector<size_t> page_nodes;
+  {
+    MutexLock mu(Thread::Current(), region_lock_);
+    for (size_t i = 0; i < non_free_region_index_limit_; ++i) {
+      Region* r = &regions_[i];
+      if (r->IsFree()) {
+        continue;
+      }
+      size_t node = NumaNodeOfRegionIdx(i);
+      ++num_regions[node];
+      // The top of a large region is past its end, large tails only have the top at their begin.
+      uint8_t* end = std::min(r->Top(), r->End());
+      for (uint8_t* page = r->Begin(); page < end; page += kPageSize) {
+        pages.push_back(page);
+        page_nodes.push_back(node);
+      }
+    }
+  }
+  std::vector<int> status;
+  if (!QueryNumaNodes(pages, &status)) {
+    PLOG(WARNING) << "Failed to query the NUMA nodes of region space pages";
+    return;
+  }
+  for (size_t i = 0; i < pages.size(); ++i) {
+    if (status[i] < 0) {
+      continue;  // Not resident.
+    }
+    if (static_cast<size_t>(status[i]) == page_nodes[i]) {
+      ++num_local_pages[page_nodes[i]];
+    } else {
+      ++num_remote_pages[page_nodes[i]];
+    }
+  }
+  os << "Region space NUMA nodes:\n";
+  for (size_t node = 0; node < num_numa_nodes_; ++node) {
+    os << "  node " << node << ": " << num_regions[node] << " regions, "
+       << num_local_pages[node] << " pages on node, "
+       << num_remote_pages[node] << " pages on other nodes\n";
+  }
+}
+
 void RegionSpace::RecordAlloc(mirror::Object* ref) {
   CHECK(ref != nullptr);
   Region* r = RefToRegion(ref);
@@ -845,11 +1107,26 @@ bool RegionSpace::AllocNewTlab(Thread* self,
   Region* r = nullptr;
   uint8_t* pos = nullptr;
   *bytes_tl_bulk_allocated = tlab_size;
+  size_t numa_node = kAnyNumaNode;
+  if (IsNumaAware()) {
+    numa_node = std::min(GetCurrentNumaNode(), num_numa_nodes_ - 1u);
+  }
   // First attempt to get a partially used TLAB, if available.
   if (tlab_size < kRegionSize) {
     // Fetch the largest partial TLAB. The multimap is ordered in decreasing
     // size.
     auto largest_partial_tlab = partial_tlabs_.begin();
+    if (numa_node != kAnyNumaNode) {
+      // Prefer the largest partial TLAB on the node of the thread.
+      for (auto it = partial_tlabs_.begin();
+           it != partial_tlabs_.end() && it->first >= tlab_size;
+           ++it) {
+        if (NumaNodeOfRegionIdx(it->second->Idx()) == numa_node) {
+          largest_partial_tlab = it;
+          break;
+        }
+      }
+    }
     if (largest_partial_tlab != partial_tlabs_.end() && largest_partial_tlab->first >= tlab_size) {
       r = largest_partial_tlab->second;
       pos = r->End() - largest_partial_tlab->first;
@@ -862,7 +1139,7 @@ bool RegionSpace::AllocNewTlab(Thread* self,
   }
   if (r == nullptr) {
     // Fallback to allocating an entire region as TLAB.
-    r = AllocateRegion(/*for_evac=*/ false);
+    r = AllocateRegion(/*for_evac=*/ false, numa_node);
   }
   if (r != nullptr) {
     uint8_t* start = pos != nullptr ? pos : r->Begin();
@@ -1007,6 +1284,7 @@ void RegionSpace::Region::Clear(bool zero_and_release_pages) {
   objects_allocated_.store(0, std::memory_order_relaxed);
   alloc_time_ = 0;
   live_bytes_ = static_cast<size_t>(-1);
+  released_bytes_ = 0;
   if (zero_and_release_pages) {
     ZeroAndProtectRegion(begin_, end_);
   }
@@ -1020,10 +1298,23 @@ void RegionSpace::TraceHeapSize() {
   heap->TraceHeapSize(heap->GetBytesAllocated() + EvacBytes());
 }
 
-RegionSpace::Region* RegionSpace::AllocateRegion(bool for_evac) {
+RegionSpace::Region* RegionSpace::AllocateRegion(bool for_evac, size_t numa_node) {
   if (!for_evac && (num_non_free_regions_ + 1) * 2 > num_regions_) {
     return nullptr;
   }
+  if (numa_node != kAnyNumaNode) {
+    // Look for a free region in the range of the node first.
+    DCHECK_LT(numa_node, num_numa_nodes_);
+    size_t first = numa_node * regions_per_numa_node_;
+    size_t last =
+        (numa_node + 1u == num_numa_nodes_) ? num_regions_ : first + regions_per_numa_node_;
+    for (size_t i = first; i < last; ++i) {
+      Region* r = &regions_[i];
+      if (r->IsFree()) {
+        return ClaimFreeRegion(r, for_evac);
+      }
+    }
+  }
   for (size_t i = 0; i < num_regions_; ++i) {
     // When using the cyclic region allocation strategy, try to
     // allocate a region starting from the last cyclic allocated
@@ -1034,30 +1325,35 @@ RegionSpace::Region* RegionSpace::AllocateRegion(bool for_evac) {
         : i;
     Region* r = &regions_[region_index];
     if (r->IsFree()) {
-      r->Unfree(this, time_);
-      if (use_generational_cc_) {
-        // TODO: Add an explanation for this assertion.
-        DCHECK(!for_evac || !r->is_newly_allocated_);
-      }
-      if (for_evac) {
-        ++num_evac_regions_;
-        TraceHeapSize();
-        // Evac doesn't count as newly allocated.
-      } else {
-        r->SetNewlyAllocated();
-        ++num_non_free_regions_;
-      }
-      if (kCyclicRegionAllocation) {
-        // Move the cyclic allocation region marker to the region
-        // following the one that was just allocated.
-        cyclic_alloc_region_index_ = (region_index + 1) % num_regions_;
-      }
-      return r;
+      return ClaimFreeRegion(r, for_evac);
     }
   }
   return nullptr;
 }
 
+RegionSpace::Region* RegionSpace::ClaimFreeRegion(Region* r, bool for_evac) {
+  DCHECK(r->IsFree());
+  r->Unfree(this, time_);
+  if (use_generational_cc_) {
+    // TODO: Add an explanation for this assertion.
+    DCHECK(!for_evac || !r->is_newly_allocated_);
+  }
+  if (for_evac) {
+    ++num_evac_regions_;
+    TraceHeapSize();
+    // Evac doesn't count as newly allocated.
+  } else {
+    r->SetNewlyAllocated();
+    ++num_non_free_regions_;
+  }
+  if (kCyclicRegionAllocation) {
+    // Move the cyclic allocation region marker to the region
+    // following the one that was just allocated.
+    cyclic_alloc_region_index_ = (r->Idx() + 1) % num_regions_;
+  }
+  return r;
+}
+
 void RegionSpace::Region::MarkAsAllocated(RegionSpace* region_space, uint32_t alloc_time) {
   DCHECK(IsFree());
   alloc_time_ = alloc_time;
@@ -24,6 +24,8 @@
 
 #include <functional>
 #include <map>
+#include <utility>
+#include <vector>
 
 namespace art {
 namespace gc {
@@ -62,7 +64,12 @@ class RegionSpace final : public ContinuousMemMapAllocSpace {
   // guaranteed to be granted, if it is required, the caller should call Begin on the returned
   // space to confirm the request was granted.
   static MemMap CreateMemMap(const std::string& name, size_t capacity, uint8_t* requested_begin);
-  static RegionSpace* Create(const std::string& name, MemMap&& mem_map, bool use_generational_cc);
+  // If `numa_aware` is true and the machine has several NUMA nodes, the regions are partitioned
+  // into one contiguous range per node, whose memory is preferably placed on that node.
+  static RegionSpace* Create(const std::string& name,
+                             MemMap&& mem_map,
+                             bool use_generational_cc,
+                             bool numa_aware);
 
   // Allocate `num_bytes`, returns null if the space is full.
   mirror::Object* Alloc(Thread* self,
@@ -78,12 +85,14 @@ class RegionSpace final : public ContinuousMemMapAllocSpace {
                                     /* out */ size_t* usable_size,
                                     /* out */ size_t* bytes_tl_bulk_allocated)
       override REQUIRES(Locks::mutator_lock_) REQUIRES(!region_lock_);
-  // The main allocation routine.
+  // The main allocation routine. Evacuation allocates from a region on `numa_node`
+  // when possible, see GetNumaNodeForRef().
   template<bool kForEvac>
   ALWAYS_INLINE mirror::Object* AllocNonvirtual(size_t num_bytes,
                                                 /* out */ size_t* bytes_allocated,
                                                 /* out */ size_t* usable_size,
-                                                /* out */ size_t* bytes_tl_bulk_allocated)
+                                                /* out */ size_t* bytes_tl_bulk_allocated,
+                                                size_t numa_node = kAnyNumaNode)
       REQUIRES(!region_lock_);
   // Allocate/free large objects (objects that are larger than the region size).
   template<bool kForEvac>
@@ -142,6 +151,9 @@ class RegionSpace final : public ContinuousMemMapAllocSpace {
   // Dump region containing object `obj`. Precondition: `obj` is in the region space.
   void DumpRegionForObject(std::ostream& os, mirror::Object* obj) REQUIRES(!region_lock_);
   void DumpNonFreeRegions(std::ostream& os) REQUIRES(!region_lock_);
+  // Dump the number of allocated regions of each NUMA node and how many of their pages reside
+  // on that node according to the kernel.
+  void DumpNumaInfo(std::ostream& os) REQUIRES(!region_lock_);
 
   size_t RevokeThreadLocalBuffers(Thread* thread) override REQUIRES(!region_lock_);
   size_t RevokeThreadLocalBuffers(Thread* thread, const bool reuse) REQUIRES(!region_lock_);
@@ -186,6 +198,20 @@ class RegionSpace final : public ContinuousMemMapAllocSpace {
   uint64_t GetObjectsAllocatedInUnevacFromSpace() REQUIRES(!region_lock_) {
     return GetObjectsAllocatedInternal<RegionType::kRegionTypeUnevacFromSpace>();
   }
+  // Compute an upper bound of the memory of the space that is backed by pages, and the allocated
+  // bytes minus the dead objects found by the last collection in regions it did not evacuate.
+  // Free regions are released to the OS when they are reclaimed, so only the allocated regions
+  // up to their top are counted as committed, including the unused part of thread-local buffers,
+  // minus the pages released by ReleaseDeadObjectPages().
+  void GetCommittedAndLiveBytes(/* out */ uint64_t* committed, /* out */ uint64_t* live)
+      REQUIRES(!region_lock_);
+  // Release the pages of dead objects in the regions that were not evacuated by the last
+  // collection until about `max_bytes` were released, continuing after the region released by
+  // the previous call. Each such region is only visited once after each collection. The caller
+  // must prevent collections from running. The mutator lock is only held to find the dead
+  // objects of a region, not while the pages are released.
+  size_t ReleaseDeadObjectPages(size_t max_bytes)
+      REQUIRES(!region_lock_, !Locks::mutator_lock_);
   size_t GetMaxPeakNumNonFreeRegions() const {
     return max_peak_num_non_free_regions_;
   }
@@ -214,6 +240,12 @@ class RegionSpace final : public ContinuousMemMapAllocSpace {
   ALWAYS_INLINE void Walk(Visitor&& visitor) REQUIRES(Locks::mutator_lock_);
   template <typename Visitor>
   ALWAYS_INLINE void WalkToSpace(Visitor&& visitor) REQUIRES(Locks::mutator_lock_);
+  // Visit the objects of the regions with an index in [begin, end). Like Walk(), this must be
+  // called with threads suspended, but the thread suspending them may hand out disjoint ranges
+  // to worker threads.
+  template <typename Visitor>
+  ALWAYS_INLINE void WalkRegions(size_t begin, size_t end, Visitor&& visitor)
+      NO_THREAD_SAFETY_ANALYSIS;
 
   // Scans regions and calls visitor for objects in unevac-space corresponding
   // to the bits set in 'bitmap'.
@@ -234,6 +266,23 @@ class RegionSpace final : public ContinuousMemMapAllocSpace {
   static constexpr size_t kAlignment = kObjectAlignment;
   // The region size.
   static constexpr size_t kRegionSize = 256 * KB;
+  // NUMA node value for allocations that do not prefer any node.
+  static constexpr size_t kAnyNumaNode = static_cast<size_t>(-1);
+  // The maximum number of NUMA nodes the regions are partitioned into.
+  static constexpr size_t kMaxNumaNodes = 64;
+
+  bool IsNumaAware() const {
+    return num_numa_nodes_ > 1u;
+  }
+
+  // Return the NUMA node of the region range containing `ref`, or `kAnyNumaNode` if the space
+  // is not NUMA aware. The evacuation of `ref` should allocate on this node.
+  size_t GetNumaNodeForRef(mirror::Object* ref) const {
+    if (!IsNumaAware()) {
+      return kAnyNumaNode;
+    }
+    return NumaNodeOfRegionIdx(RegionIdxForRefUnchecked(ref));
+  }
 
   bool IsInFromSpace(mirror::Object* ref) {
     if (HasAddress(ref)) {
@@ -381,7 +430,10 @@ class RegionSpace final : public ContinuousMemMapAllocSpace {
   }
 
  private:
-  RegionSpace(const std::string& name, MemMap&& mem_map, bool use_generational_cc);
+  RegionSpace(const std::string& name,
+              MemMap&& mem_map,
+              bool use_generational_cc,
+              bool numa_aware);
 
   class Region {
    public:
@@ -394,6 +446,7 @@ class RegionSpace final : public ContinuousMemMapAllocSpace {
           end_(nullptr),
           objects_allocated_(0),
           alloc_time_(0),
+          released_bytes_(0),
           is_newly_allocated_(false),
           is_a_tlab_(false),
           state_(RegionState::kRegionStateAllocated),
@@ -409,6 +462,7 @@ class RegionSpace final : public ContinuousMemMapAllocSpace {
       objects_allocated_.store(0, std::memory_order_relaxed);
       alloc_time_ = 0;
       live_bytes_ = static_cast<size_t>(-1);
+      released_bytes_ = 0;
       is_newly_allocated_ = false;
       is_a_tlab_ = false;
       thread_ = nullptr;
@@ -622,6 +676,9 @@ class RegionSpace final : public ContinuousMemMapAllocSpace {
     // are concurrent updates.
     Atomic<size_t> objects_allocated_;  // The number of objects allocated.
     uint32_t alloc_time_;               // The allocation time of the region.
+    // The bytes of dead object pages released by ReleaseDeadObjectPages() since the dead objects
+    // were last written to. Guarded by the region space's region_lock_.
+    size_t released_bytes_;
     // Note that newly allocated and evacuated regions use -1 as
     // special value for `live_bytes_`.
     bool is_newly_allocated_;           // True if it's allocated after the last collection.
@@ -635,6 +692,10 @@ class RegionSpace final : public ContinuousMemMapAllocSpace {
   template<bool kToSpaceOnly, typename Visitor>
   ALWAYS_INLINE void WalkInternal(Visitor&& visitor) NO_THREAD_SAFETY_ANALYSIS;
 
+  template<bool kToSpaceOnly, typename Visitor>
+  ALWAYS_INLINE void WalkRegionRange(size_t begin, size_t end, Visitor&& visitor)
+      NO_THREAD_SAFETY_ANALYSIS;
+
   // Visitor will be iterating on objects in increasing address order.
   template<typename Visitor>
   ALWAYS_INLINE void WalkNonLargeRegion(Visitor&& visitor, const Region* r)
@@ -702,9 +763,33 @@ class RegionSpace final : public ContinuousMemMapAllocSpace {
     }
   }
 
-  Region* AllocateRegion(bool for_evac) REQUIRES(region_lock_);
+  // Allocate a free region, preferably on `numa_node`.
+  Region* AllocateRegion(bool for_evac, size_t numa_node = kAnyNumaNode) REQUIRES(region_lock_);
+  // Declare the free region `r` allocated and update the region counts.
+  Region* ClaimFreeRegion(Region* r, bool for_evac) REQUIRES(region_lock_);
   void RevokeThreadLocalBuffersLocked(Thread* thread, bool reuse) REQUIRES(region_lock_);
 
+  // Partition the regions into `num_nodes` ranges and bind the memory of each range to its node.
+  void SetUpNumaNodes(size_t num_nodes);
+
+  size_t NumaNodeOfRegionIdx(size_t idx) const {
+    DCHECK(IsNumaAware());
+    return std::min(idx / regions_per_numa_node_, num_numa_nodes_ - 1u);
+  }
+
+  // Return the evacuation region to use for `numa_node`.
+  Region** EvacRegionSlot(size_t numa_node) {
+    return (numa_node == kAnyNumaNode) ? &evac_region_ : &numa_evac_regions_[numa_node];
+  }
+
+  // Set the evacuation regions of all nodes to `r`.
+  void SetEvacRegions(Region* r) {
+    evac_region_ = r;
+    for (size_t i = 0; i < (IsNumaAware() ? num_numa_nodes_ : 0u); ++i) {
+      numa_evac_regions_[i] = r;
+    }
+  }
+
   // Scan region range [`begin`, `end`) in increasing order to try to
   // allocate a large region having a size of `num_regs_in_large_region`
   // regions. If there is no space in the region space to allocate this
@@ -731,6 +816,11 @@ class RegionSpace final : public ContinuousMemMapAllocSpace {
   // region `r`. This is meant to detect dangling references to dead
   // objects earlier in debug mode.
   void PoisonDeadObjectsInUnevacuatedRegion(Region* r);
+  // Adds the whole pages between the live objects of region `r` to `ranges`, and returns their
+  // size.
+  size_t FindDeadObjectPagesInRegion(Region* r,
+                                     /* out */ std::vector<std::pair<uint8_t*, uint8_t*>>* ranges)
+      REQUIRES_SHARED(Locks::mutator_lock_);
 
   Mutex region_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
 
@@ -766,11 +856,22 @@ class RegionSpace final : public ContinuousMemMapAllocSpace {
   Region* evac_region_;            // The region currently used for evacuation.
   Region full_region_;             // The dummy/sentinel region that looks full.
 
+  // The number of NUMA nodes the regions are partitioned into, 1 if the space is not NUMA aware.
+  // Node `i` holds the regions [i * regions_per_numa_node_, (i + 1) * regions_per_numa_node_),
+  // the last node also holds the remaining regions.
+  size_t num_numa_nodes_;
+  size_t regions_per_numa_node_;
+  // The regions currently used for evacuation into each node.
+  std::unique_ptr<Region*[]> numa_evac_regions_;
+
   // Index into the region array pointing to the starting region when
   // trying to allocate a new region. Only used when
   // `kCyclicRegionAllocation` is true.
   size_t cyclic_alloc_region_index_ GUARDED_BY(region_lock_);
 
+  // Index of the region ReleaseDeadObjectPages() continues from. Reset by each collection.
+  size_t release_dead_object_pages_index_ GUARDED_BY(region_lock_);
+
   // Mark bitmap used by the GC.
   accounting::ContinuousSpaceBitmap mark_bitmap_;
 
@@ -332,6 +332,17 @@ void RosAllocSpace::Walk(void(*callback)(void *start, void *end, size_t num_byte
   InspectAllRosAlloc(callback, arg, true);
 }
 
+size_t RosAllocSpace::ReleasePagesIncrementally(size_t max_bytes) {
+  if (rosalloc_->DoesReleaseAllPages()) {
+    return 0;
+  }
+  return rosalloc_->ReleasePagesIncrementally(max_bytes);
+}
+
+size_t RosAllocSpace::GetCommittedBytes() {
+  return rosalloc_->CommittedBytes();
+}
+
 size_t RosAllocSpace::GetFootprint() {
   MutexLock mu(Thread::Current(), lock_);
   return rosalloc_->Footprint();
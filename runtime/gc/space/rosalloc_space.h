@@ -111,6 +111,10 @@ class RosAllocSpace : public MallocSpace {
   }
 
   size_t Trim() override;
+  // Release about `max_bytes` of empty pages, see RosAlloc::ReleasePagesIncrementally().
+  size_t ReleasePagesIncrementally(size_t max_bytes);
+  // Returns the footprint minus the empty pages released to the OS.
+  size_t GetCommittedBytes();
   void Walk(WalkCallback callback, void* arg) override REQUIRES(!lock_);
   size_t GetFootprint() override;
   size_t GetFootprintLimit() override;
@@ -16,12 +16,46 @@
 
 #include "task_processor.h"
 
+#include <algorithm>
+#include <ostream>
+
 #include "base/time_utils.h"
 #include "scoped_thread_state_change-inl.h"
 
 namespace art {
 namespace gc {
 
+// How long a ready task may be held back by ready tasks of higher priorities.
+static constexpr uint64_t kNormalPrioritySlackNs = MsToNs(50);
+static constexpr uint64_t kBackgroundPrioritySlackNs = MsToNs(1000);
+
+HeapTaskPriority HeapTask::GetPriority() const {
+  switch (kind_) {
+    case HeapTaskKind::kConcurrentGc:
+    case HeapTaskKind::kClearedReferences:
+      return HeapTaskPriority::kHigh;
+    case HeapTaskKind::kCollectorTransition:
+    case HeapTaskKind::kHeapTrim:
+    case HeapTaskKind::kHeapUncommit:
+      return HeapTaskPriority::kBackground;
+    case HeapTaskKind::kOther:
+      return HeapTaskPriority::kNormal;
+  }
+  UNREACHABLE();
+}
+
+uint64_t HeapTask::GetDeadline() const {
+  switch (GetPriority()) {
+    case HeapTaskPriority::kHigh:
+      return target_run_time_;
+    case HeapTaskPriority::kNormal:
+      return target_run_time_ + kNormalPrioritySlackNs;
+    case HeapTaskPriority::kBackground:
+      return target_run_time_ + kBackgroundPrioritySlackNs;
+  }
+  UNREACHABLE();
+}
+
 TaskProcessor::TaskProcessor()
     : lock_("Task processor lock", kReferenceProcessorLock),
       cond_("Task processor condition", lock_),
@@ -49,24 +83,37 @@ HeapTask* TaskProcessor::GetTask(Thread* self) {
   ScopedThreadStateChange tsc(self, kWaitingForTaskProcessor);
   MutexLock mu(self, lock_);
   while (true) {
+    RemoveObsoleteTasks();
     if (tasks_.empty()) {
       if (!is_running_) {
         return nullptr;
       }
       cond_.Wait(self);  // Empty queue, wait until we are signalled.
     } else {
-      // Non empty queue, look at the top element and see if we are ready to run it.
+      // Non empty queue, pick the ready task with the earliest deadline. If we are shutting down,
+      // all tasks are ready.
       const uint64_t current_time = NanoTime();
-      HeapTask* task = *tasks_.begin();
-      // If we are shutting down, return the task right away without waiting. Otherwise return the
-      // task if it is late enough.
-      uint64_t target_time = task->GetTargetRunTime();
-      if (!is_running_ || target_time <= current_time) {
-        tasks_.erase(tasks_.begin());
+      auto best = tasks_.end();
+      for (auto it = tasks_.begin();
+           it != tasks_.end() && (!is_running_ || (*it)->GetTargetRunTime() <= current_time);
+           ++it) {
+        if (best == tasks_.end() || (*it)->GetDeadline() < (*best)->GetDeadline()) {
+          best = it;
+        }
+      }
+      if (best != tasks_.end()) {
+        HeapTask* task = *best;
+        tasks_.erase(best);
+        KindStats& stats = stats_[static_cast<size_t>(task->GetKind())];
+        const uint64_t delay = current_time - std::min(current_time, task->GetTargetRunTime());
+        ++stats.run_count;
+        stats.total_delay_ns += delay;
+        stats.max_delay_ns = std::max(stats.max_delay_ns, delay);
         return task;
       }
+      // Wait until we hit the target run time of the first task.
+      const uint64_t target_time = (*tasks_.begin())->GetTargetRunTime();
       DCHECK_GT(target_time, current_time);
-      // Wait until we hit the target run time.
       const uint64_t delta_time = target_time - current_time;
       const uint64_t ms_delta = NsToMs(delta_time);
       const uint64_t ns_delta = delta_time - MsToNs(ms_delta);
@@ -76,6 +123,19 @@ HeapTask* TaskProcessor::GetTask(Thread* self) {
   UNREACHABLE();
 }
 
+void TaskProcessor::RemoveObsoleteTasks() {
+  for (auto it = tasks_.begin(); it != tasks_.end();) {
+    HeapTask* task = *it;
+    if (task->IsObsolete()) {
+      it = tasks_.erase(it);
+      ++stats_[static_cast<size_t>(task->GetKind())].cancelled_count;
+      task->Finalize();
+    } else {
+      ++it;
+    }
+  }
+}
+
 void TaskProcessor::UpdateTargetRunTime(Thread* self, HeapTask* task, uint64_t new_target_time) {
   MutexLock mu(self, lock_);
   // Find the task.
@@ -121,6 +181,29 @@ void TaskProcessor::Start(Thread* self) {
   running_thread_ = self;
 }
 
+void TaskProcessor::DumpStats(std::ostream& os) {
+  MutexLock mu(Thread::Current(), lock_);
+  os << "Heap task queue delays:";
+  for (size_t i = 0; i != kNumHeapTaskKinds; ++i) {
+    const KindStats& stats = stats_[i];
+    if (stats.run_count == 0u && stats.cancelled_count == 0u) {
+      continue;
+    }
+    os << "\n  " << static_cast<HeapTaskKind>(i) << ": run: " << stats.run_count;
+    if (stats.run_count != 0u) {
+      os << " mean delay: " << PrettyDuration(stats.total_delay_ns / stats.run_count)
+         << " max delay: " << PrettyDuration(stats.max_delay_ns);
+    }
+    os << " cancelled: " << stats.cancelled_count;
+  }
+  os << "\n";
+}
+
+void TaskProcessor::ResetStats(Thread* self) {
+  MutexLock mu(self, lock_);
+  stats_.fill(KindStats());
+}
+
 void TaskProcessor::RunAllTasks(Thread* self) {
   while (true) {
     // Wait and get a task, may be interrupted.
@@ -17,6 +17,8 @@
 #ifndef ART_RUNTIME_GC_TASK_PROCESSOR_H_
 #define ART_RUNTIME_GC_TASK_PROCESSOR_H_
 
+#include <array>
+#include <iosfwd>
 #include <memory>
 #include <set>
 
@@ -27,13 +29,54 @@
 namespace art {
 namespace gc {
 
+// Kinds of heap tasks, used to schedule them and to account their queue delay.
+enum class HeapTaskKind : uint8_t {
+  kConcurrentGc,
+  kClearedReferences,
+  kCollectorTransition,
+  kHeapTrim,
+  kHeapUncommit,
+  kOther,
+  kLast = kOther,
+};
+static constexpr size_t kNumHeapTaskKinds = static_cast<size_t>(HeapTaskKind::kLast) + 1u;
+
+std::ostream& operator<<(std::ostream& os, HeapTaskKind kind);
+
+// Priority classes of heap tasks. The priority decides how long a ready task may be held back
+// by tasks of higher priorities, see HeapTask::GetDeadline().
+enum class HeapTaskPriority : uint8_t {
+  kHigh,        // Concurrent GCs and reference enqueuing, which mutators may be waiting for.
+  kNormal,
+  kBackground,  // Trims, uncommits and background compaction.
+};
+
+std::ostream& operator<<(std::ostream& os, HeapTaskPriority priority);
+
 class HeapTask : public SelfDeletingTask {
  public:
-  explicit HeapTask(uint64_t target_run_time) : target_run_time_(target_run_time) {
+  explicit HeapTask(uint64_t target_run_time, HeapTaskKind kind = HeapTaskKind::kOther)
+      : target_run_time_(target_run_time), kind_(kind) {
   }
   uint64_t GetTargetRunTime() const {
     return target_run_time_;
   }
+  HeapTaskKind GetKind() const {
+    return kind_;
+  }
+  HeapTaskPriority GetPriority() const;
+
+  // Ready tasks run in the order of their deadlines, which are their target run times plus a
+  // slack depending on their priority. A concurrent GC is therefore never queued behind a trim or
+  // a compaction, unless these already waited for their whole slack.
+  uint64_t GetDeadline() const;
+
+  // Returns true if running the task would have no effect anymore. Obsolete tasks are removed
+  // from the queue and finalized without running. Called with the task processor lock held, so
+  // it must not block.
+  virtual bool IsObsolete() {
+    return false;
+  }
 
  private:
   // Update the updated_target_run_time_, the task processor will re-insert the task when it is
@@ -44,6 +87,7 @@ class HeapTask : public SelfDeletingTask {
 
   // Time in ns at which we want the task to run.
   uint64_t target_run_time_;
+  const HeapTaskKind kind_;
 
   friend class TaskProcessor;
   DISALLOW_IMPLICIT_CONSTRUCTORS(HeapTask);
@@ -66,7 +110,22 @@ class TaskProcessor {
       REQUIRES(!lock_);
   Thread* GetRunningThread() const REQUIRES(!lock_);
 
+  // Prints the number of tasks run and cancelled and their queue delay, by kind of task.
+  void DumpStats(std::ostream& os) REQUIRES(!lock_);
+  void ResetStats(Thread* self) REQUIRES(!lock_);
+
  private:
+  struct KindStats {
+    uint64_t run_count = 0u;
+    uint64_t cancelled_count = 0u;
+    // Time from the target run time of the tasks to the time they were picked.
+    uint64_t total_delay_ns = 0u;
+    uint64_t max_delay_ns = 0u;
+  };
+
+  // Finalizes the tasks that became obsolete.
+  void RemoveObsoleteTasks() REQUIRES(lock_);
+
   class CompareByTargetRunTime {
    public:
     bool operator()(const HeapTask* a, const HeapTask* b) const {
@@ -79,6 +138,7 @@ class TaskProcessor {
   bool is_running_ GUARDED_BY(lock_);
   std::multiset<HeapTask*, CompareByTargetRunTime> tasks_ GUARDED_BY(lock_);
   Thread* running_thread_ GUARDED_BY(lock_);
+  std::array<KindStats, kNumHeapTaskKinds> stats_ GUARDED_BY(lock_);
 
   DISALLOW_COPY_AND_ASSIGN(TaskProcessor);
 };
@@ -15,6 +15,9 @@
  */
 
 #include "task_processor.h"
+
+#include <sstream>
+
 #include "base/time_utils.h"
 #include "common_runtime_test.h"
 #include "thread-current-inl.h"
@@ -144,5 +147,108 @@ TEST_F(TaskProcessorTest, Ordering) {
   ASSERT_EQ(counter, kNumTasks);
 }
 
+class TestPriorityTask : public HeapTask {
+ public:
+  TestPriorityTask(uint64_t target_time,
+                   HeapTaskKind kind,
+                   size_t expected_counter,
+                   Atomic<size_t>* counter)
+     : HeapTask(target_time, kind), expected_counter_(expected_counter), counter_(counter) {
+  }
+  void Run(Thread* thread ATTRIBUTE_UNUSED) override {
+    // A running processor must not start a task before its target run time.
+    EXPECT_GE(NanoTime(), GetTargetRunTime());
+    EXPECT_EQ(counter_->load(std::memory_order_seq_cst), expected_counter_);
+    counter_->fetch_add(1U, std::memory_order_seq_cst);
+  }
+
+ private:
+  const size_t expected_counter_;
+  Atomic<size_t>* const counter_;
+};
+
+TEST_F(TaskProcessorTest, Priorities) {
+  const uint64_t current_time = NanoTime();
+  Thread* const self = Thread::Current();
+  TaskProcessor task_processor;
+  task_processor.Start(self);
+  Atomic<size_t> counter(0);
+  // A task in the future waits for its target run time even though its deadline is earlier than
+  // the trim's. It is a background task, so a slow worker that picks it up late still runs it
+  // after the late tasks below.
+  task_processor.AddTask(self, new TestPriorityTask(current_time + MsToNs(100U),
+                                                    HeapTaskKind::kHeapTrim,
+                                                    /*expected_counter=*/ 4U,
+                                                    &counter));
+  // The other tasks are late, so they run by deadline rather than by target time.
+  task_processor.AddTask(self, new TestPriorityTask(current_time - MsToNs(20U),
+                                                    HeapTaskKind::kHeapTrim,
+                                                    /*expected_counter=*/ 3U,
+                                                    &counter));
+  task_processor.AddTask(self, new TestPriorityTask(current_time - MsToNs(10U),
+                                                    HeapTaskKind::kOther,
+                                                    /*expected_counter=*/ 2U,
+                                                    &counter));
+  task_processor.AddTask(self, new TestPriorityTask(current_time,
+                                                    HeapTaskKind::kConcurrentGc,
+                                                    /*expected_counter=*/ 1U,
+                                                    &counter));
+  // A background task that waited for longer than its slack runs before the concurrent GC.
+  task_processor.AddTask(self, new TestPriorityTask(current_time - MsToNs(5000U),
+                                                    HeapTaskKind::kHeapUncommit,
+                                                    /*expected_counter=*/ 0U,
+                                                    &counter));
+  ThreadPool thread_pool("task processor test", 1U);
+  Atomic<bool> done_running(false);
+  thread_pool.AddTask(self, new WorkUntilDoneTask(&task_processor, &done_running));
+  thread_pool.StartWorkers(self);
+  // Wait for the tasks while the processor is still running, so that the future task is only
+  // picked once it is ready.
+  while (counter.load(std::memory_order_seq_cst) != 5U) {
+    usleep(10);
+  }
+  ASSERT_FALSE(done_running.load(std::memory_order_seq_cst));
+  task_processor.Stop(self);
+  thread_pool.Wait(self, true, false);
+  ASSERT_TRUE(done_running.load(std::memory_order_seq_cst));
+  EXPECT_EQ(counter.load(std::memory_order_seq_cst), 5U);
+}
+
+class ObsoleteTask : public HeapTask {
+ public:
+  ObsoleteTask(uint64_t target_time, bool* ran)
+      : HeapTask(target_time, HeapTaskKind::kConcurrentGc), ran_(ran) {
+  }
+  bool IsObsolete() override {
+    return true;
+  }
+  void Run(Thread* thread ATTRIBUTE_UNUSED) override {
+    *ran_ = true;
+  }
+
+ private:
+  bool* const ran_;
+};
+
+TEST_F(TaskProcessorTest, Obsolete) {
+  Thread* const self = Thread::Current();
+  TaskProcessor task_processor;
+  task_processor.Stop(self);
+  bool ran = false;
+  size_t counter = 0;
+  task_processor.AddTask(self, new ObsoleteTask(NanoTime(), &ran));
+  task_processor.AddTask(self, new TestOrderTask(NanoTime(), /*expected_counter=*/ 0U, &counter));
+  HeapTask* task = task_processor.GetTask(self);
+  ASSERT_TRUE(task != nullptr);
+  task->Run(self);
+  task->Finalize();
+  EXPECT_TRUE(task_processor.GetTask(self) == nullptr);
+  EXPECT_FALSE(ran);
+  EXPECT_EQ(counter, 1U);
+  std::ostringstream oss;
+  task_processor.DumpStats(oss);
+  EXPECT_NE(oss.str().find("ConcurrentGc: run: 0 cancelled: 1"), std::string::npos) << oss.str();
+}
+
 }  // namespace gc
 }  // namespace art
@@ -17,6 +17,7 @@
 #include "image.h"
 
 #include <lz4.h>
+#include <zstd.h>
 #include <sstream>
 
 #include "base/bit_utils.h"
@@ -29,7 +30,7 @@
 namespace art {
 
 const uint8_t ImageHeader::kImageMagic[] = { 'a', 'r', 't', '\n' };
-const uint8_t ImageHeader::kImageVersion[] = { '0', '8', '6', '\0' };  // FP16 Min and Max intrinsic
+const uint8_t ImageHeader::kImageVersion[] = { '0', '8', '7', '\0' };  // Zstd storage mode
 
 ImageHeader::ImageHeader(uint32_t image_reservation_size,
                          uint32_t component_count,
@@ -189,6 +190,22 @@ bool ImageHeader::Block::Decompress(uint8_t* out_ptr,
       CHECK_EQ(decompressed_size, image_size_);
       break;
     }
+    case kStorageModeZstd: {
+      const size_t decompressed_size = ZSTD_decompress(out_ptr + image_offset_,
+                                                       image_size_,
+                                                       in_ptr + data_offset_,
+                                                       data_size_);
+      if (ZSTD_isError(decompressed_size) || decompressed_size != image_size_) {
+        if (error_msg != nullptr) {
+          *error_msg = ZSTD_isError(decompressed_size)
+              ? std::string(ZSTD_getErrorName(decompressed_size))
+              : (std::ostringstream() << "Decompressed size " << decompressed_size
+                                      << " does not match image size " << image_size_).str();
+        }
+        return false;
+      }
+      break;
+    }
     default: {
       if (error_msg != nullptr) {
         *error_msg = (std::ostringstream() << "Invalid image format " << storage_mode_).str();
@@ -78,6 +78,7 @@ class PACKED(8) ImageHeader {
     kStorageModeUncompressed,
     kStorageModeLZ4,
     kStorageModeLZ4HC,
+    kStorageModeZstd,
     kStorageModeCount,  // Number of elements in enum.
   };
   static constexpr StorageMode kDefaultStorageMode = kStorageModeUncompressed;
@@ -119,6 +119,48 @@ inline void IrtEntry::SetReference(ObjPtr<mirror::Object> obj) {
   references_[serial_] = GcRoot<mirror::Object>(obj);
 }
 
+inline Atomic<uint32_t>* IrtEntry::AsAtomic(GcRoot<mirror::Object>* root) {
+  static_assert(sizeof(GcRoot<mirror::Object>) == sizeof(uint32_t), "Unexpected GcRoot size");
+  return reinterpret_cast<Atomic<uint32_t>*>(root->AddressWithoutBarrier());
+}
+
+inline bool IrtEntry::TryAddShared(ObjPtr<mirror::Object> obj) {
+  // The owner of an entry writes the next reference before publishing the new serial, and the
+  // references of previous serials stay non-null. So a claimer with an outdated serial can only
+  // succeed if the entry went through all serials and became free again.
+  uint32_t serial = AsAtomic(&serial_)->load(std::memory_order_acquire);
+  DCHECK_LT(serial, kIRTPrevCount);
+  uint32_t new_value =
+      mirror::CompressedReference<mirror::Object>::FromMirrorPtr(obj.Ptr()).AsVRegValue();
+  DCHECK_NE(new_value, 0u);
+  if (!AsAtomic(&references_[serial])->CompareAndSetStrongSequentiallyConsistent(0u, new_value)) {
+    return false;
+  }
+  uint32_t new_serial = (serial + 1u == kIRTPrevCount) ? 0u : serial + 1u;
+  references_[new_serial] = GcRoot<mirror::Object>(obj);
+  AsAtomic(&serial_)->store(new_serial, std::memory_order_release);
+  return true;
+}
+
+inline bool IrtEntry::TryRemoveShared() {
+  uint32_t serial = AsAtomic(&serial_)->load(std::memory_order_acquire);
+  DCHECK_LT(serial, kIRTPrevCount);
+  Atomic<uint32_t>* reference = AsAtomic(&references_[serial]);
+  uint32_t old_value = reference->load(std::memory_order_relaxed);
+  while (old_value != 0u) {
+    if (reference->CompareAndSetStrongSequentiallyConsistent(old_value, 0u)) {
+      return true;
+    }
+    // The read barrier of a concurrent Get() may have replaced the reference with the moved
+    // object. Retry with the new value, unless the entry was freed and claimed again meanwhile.
+    if (AsAtomic(&serial_)->load(std::memory_order_acquire) != serial) {
+      return false;
+    }
+    old_value = reference->load(std::memory_order_relaxed);
+  }
+  return false;
+}
+
 }  // namespace art
 
 #endif  // ART_RUNTIME_INDIRECT_REFERENCE_TABLE_INL_H_
@@ -16,6 +16,7 @@
 
 #include "indirect_reference_table-inl.h"
 
+#include "base/bit_utils_iterator.h"
 #include "base/mutator_locked_dumpable.h"
 #include "base/systrace.h"
 #include "base/utils.h"
@@ -28,6 +29,7 @@
 #include "scoped_thread_state_change-inl.h"
 #include "thread.h"
 
+#include <algorithm>
 #include <cstdlib>
 
 namespace art {
@@ -71,7 +73,9 @@ IndirectReferenceTable::IndirectReferenceTable(size_t max_count,
       kind_(desired_kind),
       max_entries_(max_count),
       current_num_holes_(0),
-      resizable_(resizable) {
+      resizable_(resizable),
+      num_free_slot_hints_(0),
+      free_slot_hint_cursor_(0u) {
   CHECK(error_msg != nullptr);
   CHECK_NE(desired_kind, kHandleScopeOrInvalid);
 
@@ -323,6 +327,195 @@ IndirectRef IndirectReferenceTable::Add(IRTSegmentState previous_state,
   return result;
 }
 
+// Shared access:
+//
+// The JNI global reference table is used by all threads. Instead of serializing Add and Remove,
+// tables with shared access let threads claim and release individual entries with a CAS on the
+// entry's current reference (see IrtEntry::TryAddShared). As there is a single segment, there
+// is no hole tracking. Free entries are found, in this order, in the calling thread's free slot
+// cache, in the bitmap of free slot hints, and by appending at the top. A thread returns the
+// slots left in its cache when its JNIEnvExt is deleted, and a scan of the table recovers free
+// entries that are in no cache once the table is otherwise full.
+//
+// The top index only grows while the table is shared. TrimSharedTopIndex() lowers it past the
+// free entries at the top whenever the owner of the table has exclusive access, for example to
+// visit the roots. Cached slots may then lie above the top index, so a thread that claims an
+// entry raises the top index to cover it before the reference is handed out.
+
+void IndirectReferenceTable::EnableSharedAccess() {
+  CHECK(resizable_ == ResizableCapacity::kNo);
+  CHECK_EQ(segment_state_.top_index, 0u);
+  free_slot_hints_.reset(new Atomic<uint32_t>[NumFreeSlotHintWords()]);
+}
+
+bool IndirectReferenceTable::RefillFreeSlotCache(IrtFreeSlotCache* cache) {
+  DCHECK_EQ(cache->size_, 0u);
+  if (num_free_slot_hints_.load(std::memory_order_relaxed) <= 0) {
+    return false;
+  }
+  const size_t num_words = NumFreeSlotHintWords();
+  const size_t start = free_slot_hint_cursor_.load(std::memory_order_relaxed);
+  static_assert(IrtFreeSlotCache::kCapacity >= kBitsPerFreeSlotHintWord, "Cache too small");
+  for (size_t i = 0; i != num_words; ++i) {
+    const size_t word_index = (start + i) % num_words;
+    if (free_slot_hints_[word_index].load(std::memory_order_relaxed) == 0u) {
+      continue;
+    }
+    uint32_t word = free_slot_hints_[word_index].exchange(0u, std::memory_order_relaxed);
+    if (word == 0u) {
+      continue;
+    }
+    num_free_slot_hints_.fetch_sub(POPCOUNT(word), std::memory_order_relaxed);
+    free_slot_hint_cursor_.store(word_index, std::memory_order_relaxed);
+    for (uint32_t bit : LowToHighBits(word)) {
+      cache->slots_[cache->size_] = word_index * kBitsPerFreeSlotHintWord + bit;
+      ++cache->size_;
+    }
+    return true;
+  }
+  return false;
+}
+
+bool IndirectReferenceTable::ScanForFreeSlots(IrtFreeSlotCache* cache) {
+  DCHECK_EQ(cache->size_, 0u);
+  const size_t top_index = SharedTopIndex()->load(std::memory_order_relaxed);
+  for (size_t i = 0; i != top_index && cache->size_ != IrtFreeSlotCache::kCapacity; ++i) {
+    if (table_[i].GetReference()->IsNull()) {
+      cache->slots_[cache->size_] = i;
+      ++cache->size_;
+    }
+  }
+  return cache->size_ != 0u;
+}
+
+void IndirectReferenceTable::EnsureSharedTopIndex(uint32_t top_index) {
+  Atomic<uint32_t>* shared_top_index = SharedTopIndex();
+  uint32_t old_top_index = shared_top_index->load(std::memory_order_relaxed);
+  while (old_top_index < top_index &&
+         !shared_top_index->CompareAndSetWeakRelaxed(old_top_index, top_index)) {
+  }
+}
+
+void IndirectReferenceTable::TrimSharedTopIndex() {
+  DCHECK(free_slot_hints_ != nullptr);
+  uint32_t top_index = segment_state_.top_index;
+  while (top_index != 0u && table_[top_index - 1u].GetReference()->IsNull()) {
+    --top_index;
+  }
+  segment_state_.top_index = top_index;
+}
+
+bool IndirectReferenceTable::TakeFreeSlot(IrtFreeSlotCache* cache, /*out*/ uint32_t* index) {
+  if (cache->size_ == 0u && !RefillFreeSlotCache(cache)) {
+    Atomic<uint32_t>* top_index = SharedTopIndex();
+    uint32_t old_top_index = top_index->load(std::memory_order_relaxed);
+    while (old_top_index != max_entries_) {
+      if (top_index->CompareAndSetWeakRelaxed(old_top_index, old_top_index + 1u)) {
+        *index = old_top_index;
+        return true;
+      }
+      old_top_index = top_index->load(std::memory_order_relaxed);
+    }
+    if (!ScanForFreeSlots(cache)) {
+      return false;
+    }
+  }
+  --cache->size_;
+  *index = cache->slots_[cache->size_];
+  return true;
+}
+
+IndirectRef IndirectReferenceTable::AddShared(IrtFreeSlotCache* cache,
+                                              ObjPtr<mirror::Object> obj,
+                                              std::string* error_msg) {
+  DCHECK(free_slot_hints_ != nullptr);
+  CHECK(obj != nullptr);
+  VerifyObject(obj);
+  DCHECK(table_ != nullptr);
+
+  IrtFreeSlotCache local_cache;
+  IrtFreeSlotCache* used_cache = (cache != nullptr) ? cache : &local_cache;
+  uint32_t index;
+  do {
+    if (!TakeFreeSlot(used_cache, &index)) {
+      std::ostringstream oss;
+      oss << "JNI ERROR (app bug): " << kind_ << " table overflow "
+          << "(max=" << max_entries_ << ")"
+          << MutatorLockedDumpable<IndirectReferenceTable>(*this);
+      *error_msg = oss.str();
+      return nullptr;
+    }
+  } while (!table_[index].TryAddShared(obj));
+  // The slot may come from a cache and be above the top index lowered by TrimSharedTopIndex().
+  EnsureSharedTopIndex(index + 1u);
+  if (cache == nullptr) {
+    ReleaseFreeSlotCache(&local_cache);
+  }
+  if (kDebugIRT) {
+    LOG(INFO) << "+++ added shared at " << index;
+  }
+  return ToIndirectRef(index);
+}
+
+bool IndirectReferenceTable::RemoveShared(IrtFreeSlotCache* cache, IndirectRef iref) {
+  DCHECK(free_slot_hints_ != nullptr);
+  DCHECK(table_ != nullptr);
+
+  const uint32_t top_index = SharedTopIndex()->load(std::memory_order_relaxed);
+  const uint32_t idx = ExtractIndex(iref);
+  if (idx >= top_index) {
+    // Bad --- stale reference?
+    LOG(WARNING) << "Attempt to remove invalid index " << idx << " (top=" << top_index << ")";
+    return false;
+  }
+  if (table_[idx].GetReference()->IsNull()) {
+    LOG(INFO) << "--- WEIRD: removing null entry " << idx;
+    return false;
+  }
+  if (!CheckEntry("remove", iref, idx)) {
+    return false;
+  }
+  // A racing remove of the same reference is an app bug, but must not let two threads reuse
+  // the entry. Only the thread that clears the entry releases the slot.
+  if (!table_[idx].TryRemoveShared()) {
+    LOG(INFO) << "--- WEIRD: removing null entry " << idx;
+    return false;
+  }
+  IrtFreeSlotCache local_cache;
+  IrtFreeSlotCache* used_cache = (cache != nullptr) ? cache : &local_cache;
+  if (used_cache->size_ == IrtFreeSlotCache::kCapacity) {
+    // Keep the most recently freed half in the cache, the other half may be used by other threads.
+    IrtFreeSlotCache spill;
+    spill.size_ = IrtFreeSlotCache::kCapacity / 2;
+    std::copy(used_cache->slots_, used_cache->slots_ + spill.size_, spill.slots_);
+    std::copy(used_cache->slots_ + spill.size_,
+              used_cache->slots_ + used_cache->size_,
+              used_cache->slots_);
+    used_cache->size_ -= spill.size_;
+    ReleaseFreeSlotCache(&spill);
+  }
+  used_cache->slots_[used_cache->size_] = idx;
+  ++used_cache->size_;
+  if (cache == nullptr) {
+    ReleaseFreeSlotCache(&local_cache);
+  }
+  if (kDebugIRT) {
+    LOG(INFO) << "+++ removed shared at " << idx;
+  }
+  return true;
+}
+
+void IndirectReferenceTable::ReleaseFreeSlotCache(IrtFreeSlotCache* cache) {
+  DCHECK(free_slot_hints_ != nullptr);
+  for (size_t i = 0; i != cache->size_; ++i) {
+    uint32_t idx = cache->slots_[i];
+    free_slot_hints_[idx / kBitsPerFreeSlotHintWord].fetch_or(
+        1u << (idx % kBitsPerFreeSlotHintWord), std::memory_order_relaxed);
+  }
+  num_free_slot_hints_.fetch_add(cache->size_, std::memory_order_relaxed);
+  cache->size_ = 0u;
+}
+
 void IndirectReferenceTable::AssertEmpty() {
   for (size_t i = 0; i < Capacity(); ++i) {
     if (!table_[i].GetReference()->IsNull()) {
@@ -21,10 +21,12 @@
 
 #include <iosfwd>
 #include <limits>
+#include <memory>
 #include <string>
 
 #include <android-base/logging.h>
 
+#include "base/atomic.h"
 #include "base/bit_utils.h"
 #include "base/locks.h"
 #include "base/macros.h"
@@ -174,7 +176,19 @@ class IrtEntry {
 
   void SetReference(ObjPtr<mirror::Object> obj) REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Add and remove for tables with shared access, see IndirectReferenceTable::AddShared().
+  // An entry is free if its current reference is null. TryAddShared() claims a free entry with
+  // a CAS and returns false if another thread claimed it first. TryRemoveShared() returns false
+  // if the entry was already free.
+  bool TryAddShared(ObjPtr<mirror::Object> obj) REQUIRES_SHARED(Locks::mutator_lock_);
+  bool TryRemoveShared();
+
  private:
+  static Atomic<uint32_t>* AsAtomic(uint32_t* value) {
+    return reinterpret_cast<Atomic<uint32_t>*>(value);
+  }
+  static Atomic<uint32_t>* AsAtomic(GcRoot<mirror::Object>* root);
+
   uint32_t serial_;
   GcRoot<mirror::Object> references_[kIRTPrevCount];
 };
@@ -210,6 +224,26 @@ class IrtIterator {
   const size_t capacity_;
 };
 
+// Per-thread cache of the free slots of a table with shared access. The slots in the cache are
+// only hints; a slot is claimed by IrtEntry::TryAddShared() when it is used.
+class IrtFreeSlotCache {
+ public:
+  static constexpr size_t kCapacity = 32;
+
+  IrtFreeSlotCache() : size_(0u) {}
+
+  bool IsEmpty() const {
+    return size_ == 0u;
+  }
+
+ private:
+  uint32_t size_;
+  uint32_t slots_[kCapacity];
+
+  friend class IndirectReferenceTable;
+  DISALLOW_COPY_AND_ASSIGN(IrtFreeSlotCache);
+};
+
 bool inline operator==(const IrtIterator& lhs, const IrtIterator& rhs) {
   return lhs.equals(rhs);
 }
@@ -279,6 +313,28 @@ class IndirectReferenceTable {
   // Returns "false" if nothing was removed.
   bool Remove(IRTSegmentState previous_state, IndirectRef iref);
 
+  // Allow AddShared() and RemoveShared(). Must be called before any entry is added. Only valid
+  // for tables with a single segment and a fixed capacity, i.e. the JNI global references.
+  void EnableSharedAccess();
+
+  // Add and remove entries of a table with shared access. These may run concurrently with each
+  // other and with Get(), but the caller must ensure that they do not run concurrently with any
+  // other operation. Removed entries are reused through the free slot caches of the threads and
+  // a bitmap of freed slots that did not fit into a cache.
+  // `cache` is the free slot cache of the calling thread, or null.
+  IndirectRef AddShared(IrtFreeSlotCache* cache,
+                        ObjPtr<mirror::Object> obj,
+                        std::string* error_msg)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+  bool RemoveShared(IrtFreeSlotCache* cache, IndirectRef iref);
+
+  // Return the slots in `cache` to the table.
+  void ReleaseFreeSlotCache(IrtFreeSlotCache* cache);
+
+  // Lowers the top index of a table with shared access past the free entries at its top. Unlike
+  // AddShared() and RemoveShared(), this requires exclusive access to the table.
+  void TrimSharedTopIndex();
+
   void AssertEmpty() REQUIRES_SHARED(Locks::mutator_lock_);
 
   void Dump(std::ostream& os) const
@@ -386,6 +442,20 @@ class IndirectReferenceTable {
 
   void RecoverHoles(IRTSegmentState from);
 
+  // Helpers for shared access.
+  Atomic<uint32_t>* SharedTopIndex() {
+    static_assert(sizeof(Atomic<uint32_t>) == sizeof(segment_state_.top_index), "Size mismatch");
+    return reinterpret_cast<Atomic<uint32_t>*>(&segment_state_.top_index);
+  }
+  size_t NumFreeSlotHintWords() const {
+    return RoundUp(max_entries_, kBitsPerFreeSlotHintWord) / kBitsPerFreeSlotHintWord;
+  }
+  // Raises the top index to at least `top_index`.
+  void EnsureSharedTopIndex(uint32_t top_index);
+  bool TakeFreeSlot(IrtFreeSlotCache* cache, /*out*/ uint32_t* index);
+  bool RefillFreeSlotCache(IrtFreeSlotCache* cache);
+  bool ScanForFreeSlots(IrtFreeSlotCache* cache);
+
   // Abort if check_jni is not enabled. Otherwise, just log as an error.
   static void AbortIfNoCheckJNI(const std::string& msg);
 
@@ -416,6 +486,13 @@ class IndirectReferenceTable {
   // Whether the table's capacity may be resized. As there are no locks used, it is the caller's
   // responsibility to ensure thread-safety.
   ResizableCapacity resizable_;
+
+  // For tables with shared access, a bitmap of the slots released by threads whose free slot
+  // cache was full, the approximate number of bits set, and the word to start searching from.
+  static constexpr size_t kBitsPerFreeSlotHintWord = BitSizeOf<uint32_t>();
+  std::unique_ptr<Atomic<uint32_t>[]> free_slot_hints_;
+  Atomic<int32_t> num_free_slot_hints_;
+  Atomic<uint32_t> free_slot_hint_cursor_;
 };
 
 }  // namespace art
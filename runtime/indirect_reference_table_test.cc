@@ -514,4 +514,121 @@ TEST_F(IndirectReferenceTableTest, Resize) {
   EXPECT_EQ(irt.Capacity(), kTableMax + 1);
 }
 
+TEST_F(IndirectReferenceTableTest, SharedAccess) {
+  // This will lead to error messages in the log.
+  ScopedLogSeverity sls(LogSeverity::FATAL);
+
+  ScopedObjectAccess soa(Thread::Current());
+  static const size_t kTableMax = IrtFreeSlotCache::kCapacity + 8;
+  std::string error_msg;
+  IndirectReferenceTable irt(kTableMax,
+                             kGlobal,
+                             IndirectReferenceTable::ResizableCapacity::kNo,
+                             &error_msg);
+  ASSERT_TRUE(irt.IsValid()) << error_msg;
+  irt.EnableSharedAccess();
+
+  StackHandleScope<3> hs(soa.Self());
+  Handle<mirror::Class> c =
+      hs.NewHandle(class_linker_->FindSystemClass(soa.Self(), "Ljava/lang/Object;"));
+  ASSERT_TRUE(c != nullptr);
+  Handle<mirror::Object> obj0 = hs.NewHandle(c->AllocObject(soa.Self()));
+  ASSERT_TRUE(obj0 != nullptr);
+  Handle<mirror::Object> obj1 = hs.NewHandle(c->AllocObject(soa.Self()));
+  ASSERT_TRUE(obj1 != nullptr);
+
+  // Removed slots are reused from the cache, and stale references are detected.
+  IrtFreeSlotCache cache;
+  IndirectRef iref0 = irt.AddShared(&cache, obj0.Get(), &error_msg);
+  EXPECT_TRUE(iref0 != nullptr);
+  IndirectRef iref1 = irt.AddShared(&cache, obj1.Get(), &error_msg);
+  EXPECT_TRUE(iref1 != nullptr);
+  CheckDump(&irt, 2, 2);
+  EXPECT_TRUE(irt.RemoveShared(&cache, iref0));
+  EXPECT_FALSE(irt.RemoveShared(&cache, iref0)) << "unexpectedly successful removal";
+  CheckDump(&irt, 1, 1);
+  IndirectRef iref2 = irt.AddShared(&cache, obj1.Get(), &error_msg);
+  EXPECT_TRUE(iref2 != nullptr);
+  EXPECT_NE(iref0, iref2);
+  EXPECT_EQ(2U, irt.Capacity());
+  EXPECT_TRUE(irt.Get(iref0) == nullptr);
+  EXPECT_OBJ_PTR_EQ(obj1.Get(), irt.Get(iref1));
+  EXPECT_OBJ_PTR_EQ(obj1.Get(), irt.Get(iref2));
+  EXPECT_TRUE(irt.RemoveShared(/*cache=*/ nullptr, iref1));
+  EXPECT_TRUE(irt.RemoveShared(/*cache=*/ nullptr, iref2));
+  CheckDump(&irt, 0, 0);
+
+  // Fill the table, then free all slots into a cache that is dropped. The slots that did not
+  // fit into the cache are found through the free slot hints, the others by scanning.
+  std::vector<IndirectRef> irefs;
+  for (size_t i = 0; i != kTableMax; ++i) {
+    IndirectRef iref = irt.AddShared(&cache, obj0.Get(), &error_msg);
+    ASSERT_TRUE(iref != nullptr) << error_msg;
+    irefs.push_back(iref);
+  }
+  EXPECT_EQ(kTableMax, irt.Capacity());
+  EXPECT_TRUE(irt.AddShared(&cache, obj0.Get(), &error_msg) == nullptr);
+  {
+    IrtFreeSlotCache dropped_cache;
+    for (IndirectRef iref : irefs) {
+      EXPECT_TRUE(irt.RemoveShared(&dropped_cache, iref));
+    }
+  }
+  CheckDump(&irt, 0, 0);
+  irefs.clear();
+  IrtFreeSlotCache new_cache;
+  for (size_t i = 0; i != kTableMax; ++i) {
+    IndirectRef iref = irt.AddShared(&new_cache, obj1.Get(), &error_msg);
+    ASSERT_TRUE(iref != nullptr) << error_msg;
+    irefs.push_back(iref);
+  }
+  EXPECT_EQ(kTableMax, irt.Capacity());
+  CheckDump(&irt, kTableMax, 1);
+  for (IndirectRef iref : irefs) {
+    EXPECT_OBJ_PTR_EQ(obj1.Get(), irt.Get(iref));
+    EXPECT_TRUE(irt.RemoveShared(&new_cache, iref));
+  }
+  CheckDump(&irt, 0, 0);
+
+  // Trimming lowers the top index past the free entries at the top, and a slot taken from the
+  // cache above the top index raises it again.
+  IndirectReferenceTable trim_irt(kTableMax,
+                                  kGlobal,
+                                  IndirectReferenceTable::ResizableCapacity::kNo,
+                                  &error_msg);
+  ASSERT_TRUE(trim_irt.IsValid()) << error_msg;
+  trim_irt.EnableSharedAccess();
+  IrtFreeSlotCache trim_cache;
+  IndirectRef trim_iref0 = trim_irt.AddShared(&trim_cache, obj0.Get(), &error_msg);
+  EXPECT_TRUE(trim_iref0 != nullptr);
+  IndirectRef trim_iref1 = trim_irt.AddShared(&trim_cache, obj0.Get(), &error_msg);
+  EXPECT_TRUE(trim_iref1 != nullptr);
+  IndirectRef trim_iref2 = trim_irt.AddShared(&trim_cache, obj0.Get(), &error_msg);
+  EXPECT_TRUE(trim_iref2 != nullptr);
+  EXPECT_TRUE(trim_irt.RemoveShared(&trim_cache, trim_iref2));
+  trim_irt.TrimSharedTopIndex();
+  EXPECT_EQ(2U, trim_irt.Capacity());
+  EXPECT_TRUE(trim_irt.RemoveShared(&trim_cache, trim_iref1));
+  EXPECT_EQ(2U, trim_irt.Capacity());
+  trim_irt.TrimSharedTopIndex();
+  EXPECT_EQ(1U, trim_irt.Capacity());
+  EXPECT_FALSE(trim_irt.RemoveShared(&trim_cache, trim_iref2)) << "unexpectedly successful removal";
+  // The cache hands out the freed slots in reverse order, both above the trimmed top index.
+  IndirectRef trim_iref3 = trim_irt.AddShared(&trim_cache, obj1.Get(), &error_msg);
+  EXPECT_TRUE(trim_iref3 != nullptr);
+  EXPECT_EQ(2U, trim_irt.Capacity());
+  IndirectRef trim_iref4 = trim_irt.AddShared(&trim_cache, obj1.Get(), &error_msg);
+  EXPECT_TRUE(trim_iref4 != nullptr);
+  EXPECT_EQ(3U, trim_irt.Capacity());
+  EXPECT_NE(trim_iref2, trim_iref4);
+  EXPECT_OBJ_PTR_EQ(obj1.Get(), trim_irt.Get(trim_iref3));
+  EXPECT_OBJ_PTR_EQ(obj1.Get(), trim_irt.Get(trim_iref4));
+  EXPECT_FALSE(trim_irt.RemoveShared(&trim_cache, trim_iref2)) << "unexpectedly successful removal";
+  EXPECT_TRUE(trim_irt.RemoveShared(&trim_cache, trim_iref0));
+  EXPECT_TRUE(trim_irt.RemoveShared(&trim_cache, trim_iref3));
+  EXPECT_TRUE(trim_irt.RemoveShared(&trim_cache, trim_iref4));
+  trim_irt.TrimSharedTopIndex();
+  EXPECT_EQ(0U, trim_irt.Capacity());
+}
+
 }  // namespace art
@@ -174,6 +174,8 @@ Instrumentation::Instrumentation()
       interpreter_stubs_installed_(false),
       interpret_only_(false),
       forced_interpret_only_(false),
+      jit_code_has_entry_exit_hooks_(false),
+      entry_exit_hooks_enabled_(false),
       have_method_entry_listeners_(false),
       have_method_exit_listeners_(false),
       have_method_unwind_listeners_(false),
@@ -271,7 +273,10 @@ void Instrumentation::InstallStubsForMethod(ArtMethod* method) {
       // class, all its static methods code will be set to the instrumentation entry point.
       // For more details, see ClassLinker::FixupStaticTrampolines.
       if (is_class_initialized || !method->IsStatic() || method->IsConstructor()) {
-        if (entry_exit_stubs_installed_) {
+        if (entry_exit_hooks_enabled_ && !method->IsNative()) {
+          // Code with hooks reports the events itself, everything else runs in the interpreter.
+          new_quick_code = GetCodeWithEntryExitHooks(method);
+        } else if (entry_exit_stubs_installed_) {
           // This needs to be checked first since the instrumentation entrypoint will be able to
           // find the actual JIT compiled code that corresponds to this method.
           new_quick_code = GetQuickInstrumentationEntryPoint();
@@ -451,6 +456,44 @@ void InstrumentationInstallStack(Thread* thread, void* arg)
   thread->VerifyStack();
 }
 
+// At the kInstrumentWithEntryExitHooks level, reports the entry of the methods on the stack of
+// `thread` that will report their exit: interpreted methods and compiled code with hooks. Other
+// compiled frames, and methods inlined in compiled code, report neither.
+static void InstrumentationReportExistingFrames(Thread* thread, void* arg)
+    REQUIRES(Locks::mutator_lock_) {
+  Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
+  Instrumentation* instrumentation = reinterpret_cast<Instrumentation*>(arg);
+  struct ExistingFrame {
+    mirror::Object* this_object;
+    ArtMethod* method;
+    uint32_t dex_pc;
+  };
+  std::vector<ExistingFrame> frames;
+  std::unique_ptr<Context> context(Context::Create());
+  StackVisitor::WalkStack(
+      [&](const art::StackVisitor* stack_visitor) REQUIRES_SHARED(Locks::mutator_lock_) {
+        ArtMethod* m = stack_visitor->GetMethod();
+        if (m == nullptr || m->IsRuntimeMethod() || m->IsNative() ||
+            stack_visitor->IsInInlinedFrame()) {
+          return true;
+        }
+        if (stack_visitor->GetCurrentQuickFrame() == nullptr ||
+            instrumentation->CodeHasEntryExitHooks(
+                m, stack_visitor->GetCurrentOatQuickMethodHeader()->GetEntryPoint())) {
+          frames.push_back(
+              {stack_visitor->GetThisObject().Ptr(), m, stack_visitor->GetDexPc()});
+        }
+        return true;
+      },
+      thread,
+      context.get(),
+      StackVisitor::StackWalkKind::kIncludeInlinedFrames);
+  // Report the outermost frames first.
+  for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+    instrumentation->MethodEnterEvent(thread, it->this_object, it->method, it->dex_pc);
+  }
+}
+
 void Instrumentation::InstrumentThreadStack(Thread* thread) {
   instrumentation_stubs_installed_ = true;
   InstrumentationInstallStack(thread, this);
@@ -720,6 +763,8 @@ void Instrumentation::RemoveListener(InstrumentationListener* listener, uint32_t
 Instrumentation::InstrumentationLevel Instrumentation::GetCurrentInstrumentationLevel() const {
   if (interpreter_stubs_installed_) {
     return InstrumentationLevel::kInstrumentWithInterpreter;
+  } else if (entry_exit_hooks_enabled_) {
+    return InstrumentationLevel::kInstrumentWithEntryExitHooks;
   } else if (entry_exit_stubs_installed_) {
     return InstrumentationLevel::kInstrumentWithInstrumentationStubs;
   } else {
@@ -738,7 +783,9 @@ void Instrumentation::UpdateInstrumentationLevels(InstrumentationLevel level) {
   }
   if (UNLIKELY(!can_use_instrumentation_trampolines_)) {
     for (auto& p : requested_instrumentation_levels_) {
-      if (p.second == InstrumentationLevel::kInstrumentWithInstrumentationStubs) {
+      // The entry/exit hooks level uses the trampolines for native methods.
+      if (p.second == InstrumentationLevel::kInstrumentWithInstrumentationStubs ||
+          p.second == InstrumentationLevel::kInstrumentWithEntryExitHooks) {
         p.second = InstrumentationLevel::kInstrumentWithInterpreter;
       }
     }
@@ -794,18 +841,29 @@ void Instrumentation::UpdateStubs() {
       interpreter_stubs_installed_ = true;
       entry_exit_stubs_installed_ = true;
     } else {
-      CHECK_EQ(requested_level, InstrumentationLevel::kInstrumentWithInstrumentationStubs);
+      // At the entry/exit hooks level, native methods still go through the stubs.
+      DCHECK(requested_level == InstrumentationLevel::kInstrumentWithInstrumentationStubs ||
+             requested_level == InstrumentationLevel::kInstrumentWithEntryExitHooks);
       entry_exit_stubs_installed_ = true;
       interpreter_stubs_installed_ = false;
     }
+    entry_exit_hooks_enabled_ =
+        (requested_level == InstrumentationLevel::kInstrumentWithEntryExitHooks);
     InstallStubsClassVisitor visitor(this);
     runtime->GetClassLinker()->VisitClasses(&visitor);
     instrumentation_stubs_installed_ = true;
+    // Frames already on the stack keep running their code. Compiled code with hooks and the
+    // interpreter report the exits of their frames, so report their entries now.
     MutexLock mu(self, *Locks::thread_list_lock_);
-    runtime->GetThreadList()->ForEach(InstrumentationInstallStack, this);
+    if (!entry_exit_hooks_enabled_) {
+      runtime->GetThreadList()->ForEach(InstrumentationInstallStack, this);
+    } else if (ShouldNotifyMethodEnterExitEvents()) {
+      runtime->GetThreadList()->ForEach(InstrumentationReportExistingFrames, this);
+    }
   } else {
     interpreter_stubs_installed_ = false;
     entry_exit_stubs_installed_ = false;
+    entry_exit_hooks_enabled_ = false;
     InstallStubsClassVisitor visitor(this);
     runtime->GetClassLinker()->VisitClasses(&visitor);
     // Restore stack only if there is no method currently deoptimized.
@@ -920,6 +978,10 @@ void Instrumentation::UpdateMethodsCodeImpl(ArtMethod* method, const void* quick
       if (class_linker->IsQuickResolutionStub(quick_code) ||
           class_linker->IsQuickToInterpreterBridge(quick_code)) {
         new_quick_code = quick_code;
+      } else if (entry_exit_hooks_enabled_ && !method->IsNative()) {
+        new_quick_code = CanRunWithEntryExitHooks(method, quick_code)
+            ? quick_code
+            : GetQuickToInterpreterBridge();
       } else if (entry_exit_stubs_installed_ &&
                  // We need to make sure not to replace anything that InstallStubsForMethod
                  // wouldn't. Specifically we cannot stub out Proxy.<init> since subtypes copy the
@@ -1126,9 +1188,44 @@ void Instrumentation::UndeoptimizeEverything(const char* key) {
   ConfigureStubs(key, InstrumentationLevel::kInstrumentNothing);
 }
 
+bool Instrumentation::CodeHasEntryExitHooks(ArtMethod* method, const void* code) const {
+  if (!jit_code_has_entry_exit_hooks_ || method->IsNative()) {
+    // JNI stubs compiled by the JIT have no hooks.
+    return false;
+  }
+  jit::Jit* jit = Runtime::Current()->GetJit();
+  return jit != nullptr && jit->GetCodeCache()->ContainsPc(code);
+}
+
+bool Instrumentation::CanRunWithEntryExitHooks(ArtMethod* method, const void* code) const {
+  if (!CodeHasEntryExitHooks(method, code)) {
+    return false;
+  }
+  const OatQuickMethodHeader* header = OatQuickMethodHeader::FromEntryPoint(code);
+  return header->IsOptimized() && !CodeInfo::HasInlineInfo(header->GetOptimizedCodeInfoPtr());
+}
+
+const void* Instrumentation::GetCodeWithEntryExitHooks(ArtMethod* method) const {
+  const void* code = method->GetEntryPointFromQuickCompiledCodePtrSize(kRuntimePointerSize);
+  if (code == GetQuickInstrumentationEntryPoint()) {
+    // Switching from the stubs level. Method tracing keeps the JIT code alive while the method
+    // has the stub, see JitCodeCache::FindCompiledCodeForInstrumentation().
+    jit::Jit* jit = Runtime::Current()->GetJit();
+    code = (jit != nullptr) ? jit->GetCodeCache()->FindCompiledCodeForInstrumentation(method)
+                            : nullptr;
+  }
+  return CanRunWithEntryExitHooks(method, code) ? code : GetQuickToInterpreterBridge();
+}
+
 void Instrumentation::EnableMethodTracing(const char* key, bool needs_interpreter) {
   InstrumentationLevel level;
-  if (needs_interpreter) {
+  if (jit_code_has_entry_exit_hooks_ &&
+      can_use_instrumentation_trampolines_ &&
+      Runtime::Current()->GetJit() != nullptr) {
+    // The events reported by the hooks are accurate, so the compiled code does not need to be
+    // replaced by the interpreter.
+    level = InstrumentationLevel::kInstrumentWithEntryExitHooks;
+  } else if (needs_interpreter) {
     level = InstrumentationLevel::kInstrumentWithInterpreter;
   } else {
     level = InstrumentationLevel::kInstrumentWithInstrumentationStubs;
@@ -203,6 +203,7 @@ class Instrumentation {
 
   enum class InstrumentationLevel {
     kInstrumentNothing,                   // execute without instrumentation
+    kInstrumentWithEntryExitHooks,        // execute compiled code with entry/exit hooks
     kInstrumentWithInstrumentationStubs,  // execute with instrumentation entry/exit stubs
     kInstrumentWithInterpreter            // execute with interpreter
   };
@@ -269,7 +270,9 @@ class Instrumentation {
   bool IsDeoptimized(ArtMethod* method)
       REQUIRES(!GetDeoptimizedMethodsLock()) REQUIRES_SHARED(Locks::mutator_lock_);
 
-  // Enable method tracing by installing instrumentation entry/exit stubs or interpreter.
+  // Enable method tracing by installing instrumentation entry/exit stubs or interpreter. If JIT
+  // code has method entry/exit hooks, they are used instead and only the methods without such code
+  // run in the interpreter.
   void EnableMethodTracing(const char* key,
                            bool needs_interpreter = kDeoptimizeForAccurateMethodEntryExitListeners)
       REQUIRES(Locks::mutator_lock_, Roles::uninterruptible_)
@@ -325,6 +328,36 @@ class Instrumentation {
   const void* GetQuickCodeFor(ArtMethod* method, PointerSize pointer_size) const
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Make the JIT compile method entry and exit hooks into all code, so that method tracing can
+  // keep running that code instead of deoptimizing it. Must be called before the JIT starts.
+  void EnableEntryExitHooksInJitCode() {
+    jit_code_has_entry_exit_hooks_ = true;
+  }
+
+  bool JitCodeHasEntryExitHooks() const {
+    return jit_code_has_entry_exit_hooks_;
+  }
+
+  // Returns whether `code` is code of `method` that reports its entry and exit events itself.
+  bool CodeHasEntryExitHooks(ArtMethod* method, const void* code) const
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Returns whether `code` of `method` can keep running at the kInstrumentWithEntryExitHooks
+  // level: it has hooks and no inlined method, as those would not report their events. The JIT
+  // only inlines while the hooks are disabled.
+  bool CanRunWithEntryExitHooks(ArtMethod* method, const void* code) const
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Whether the method entry/exit hooks in compiled code call into the runtime.
+  bool AreEntryExitHooksEnabled() const {
+    return entry_exit_hooks_enabled_;
+  }
+
+  // The address of the flag checked by the method entry/exit hooks in compiled code.
+  const bool* GetEntryExitHooksEnabledAddress() const {
+    return &entry_exit_hooks_enabled_;
+  }
+
   void ForceInterpretOnly() {
     interpret_only_ = true;
     forced_interpret_only_ = true;
@@ -647,6 +680,10 @@ class Instrumentation {
   void UpdateMethodsCodeImpl(ArtMethod* method, const void* quick_code)
       REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!GetDeoptimizedMethodsLock());
 
+  // Returns the code with entry/exit hooks for `method`, or the interpreter bridge if it has none.
+  const void* GetCodeWithEntryExitHooks(ArtMethod* method) const
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
   ReaderWriterMutex* GetDeoptimizedMethodsLock() const {
     return deoptimized_methods_lock_.get();
   }
@@ -671,6 +708,14 @@ class Instrumentation {
   // Did the runtime request we only run in the interpreter? ie -Xint mode.
   bool forced_interpret_only_;
 
+  // Does JIT code have method entry/exit hooks? Set once at startup.
+  bool jit_code_has_entry_exit_hooks_;
+
+  // Do the method entry/exit hooks call into the runtime? Only true at the
+  // kInstrumentWithEntryExitHooks level, so that events are never reported by both the hooks and
+  // the instrumentation stubs or the interpreter. Read by compiled code.
+  bool entry_exit_hooks_enabled_;
+
   // Do we have any listeners for method entry events? Short-cut to avoid taking the
   // instrumentation_lock_.
   bool have_method_entry_listeners_ GUARDED_BY(Locks::mutator_lock_);
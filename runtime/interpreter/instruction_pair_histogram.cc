@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "instruction_pair_histogram.h"
+
+#include <algorithm>
+#include <functional>
+#include <ostream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/os.h"
+#include "base/unix_file/fd_file.h"
+#include "dex/dex_instruction.h"
+
+namespace art {
+namespace interpreter {
+
+static constexpr size_t kNumPairsForSigQuit = 16u;
+
+InstructionPairHistogram::InstructionPairHistogram(const std::string& output_file)
+    : output_file_(output_file),
+      counts_(new std::atomic<uint64_t>[kNumOpcodes * kNumOpcodes]) {
+  for (size_t i = 0; i != kNumOpcodes * kNumOpcodes; ++i) {
+    counts_[i].store(0u, std::memory_order_relaxed);
+  }
+}
+
+void InstructionPairHistogram::Dump(std::ostream& os, size_t max_pairs) const {
+  std::vector<std::pair<uint64_t, size_t>> pairs;
+  uint64_t total = 0u;
+  for (size_t i = 0; i != kNumOpcodes * kNumOpcodes; ++i) {
+    uint64_t count = counts_[i].load(std::memory_order_relaxed);
+    if (count != 0u) {
+      pairs.emplace_back(count, i);
+      total += count;
+    }
+  }
+  std::sort(pairs.begin(), pairs.end(), std::greater<std::pair<uint64_t, size_t>>());
+  if (pairs.size() > max_pairs) {
+    pairs.resize(max_pairs);
+  }
+  for (const std::pair<uint64_t, size_t>& pair : pairs) {
+    Instruction::Code first = static_cast<Instruction::Code>(pair.second / kNumOpcodes);
+    Instruction::Code second = static_cast<Instruction::Code>(pair.second % kNumOpcodes);
+    os << pair.first << " " << (100.0 * pair.first / total) << "% "
+       << Instruction::Name(first) << " " << Instruction::Name(second) << "\n";
+  }
+}
+
+void InstructionPairHistogram::WriteToFile() const {
+  if (output_file_.empty()) {
+    return;
+  }
+  std::ostringstream oss;
+  Dump(oss, kNumOpcodes * kNumOpcodes);
+  std::string histogram = oss.str();
+  std::unique_ptr<File> file(OS::CreateEmptyFileWriteOnly(output_file_.c_str()));
+  if (file == nullptr) {
+    PLOG(ERROR) << "Unable to open instruction pair histogram file " << output_file_;
+    return;
+  }
+  if (!file->WriteFully(histogram.data(), histogram.size())) {
+    PLOG(ERROR) << "Failed to write instruction pair histogram file " << output_file_;
+    file->Erase();
+    return;
+  }
+  if (file->FlushCloseOrErase() != 0) {
+    PLOG(ERROR) << "Failed to flush instruction pair histogram file " << output_file_;
+  }
+}
+
+void InstructionPairHistogram::DumpForSigQuit(std::ostream& os) const {
+  WriteToFile();
+  os << "Most frequent interpreted instruction pairs:\n";
+  Dump(os, kNumPairsForSigQuit);
+}
+
+}  // namespace interpreter
+}  // namespace art
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_INTERPRETER_INSTRUCTION_PAIR_HISTOGRAM_H_
+#define ART_RUNTIME_INTERPRETER_INSTRUCTION_PAIR_HISTOGRAM_H_
+
+#include <atomic>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+#include "base/macros.h"
+
+namespace art {
+namespace interpreter {
+
+// Counts how often each pair of dex instructions is executed in sequence by the
+// interpreter. Used to pick the pairs that nterp handles as superinstructions.
+//
+// Nterp and mterp do not record pairs, so all methods run in the switch interpreter while
+// the histogram is enabled, see CanUseMterp().
+class InstructionPairHistogram {
+ public:
+  static constexpr size_t kNumOpcodes = 256u;
+
+  explicit InstructionPairHistogram(const std::string& output_file);
+
+  ALWAYS_INLINE void Record(uint8_t previous_opcode, uint8_t opcode) {
+    counts_[previous_opcode * kNumOpcodes + opcode].fetch_add(1u, std::memory_order_relaxed);
+  }
+
+  // Prints at most `max_pairs` pairs, by decreasing count.
+  void Dump(std::ostream& os, size_t max_pairs) const;
+
+  // Writes all recorded pairs to the output file, if any.
+  void WriteToFile() const;
+
+  void DumpForSigQuit(std::ostream& os) const;
+
+ private:
+  const std::string output_file_;
+  std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+
+  DISALLOW_COPY_AND_ASSIGN(InstructionPairHistogram);
+};
+
+}  // namespace interpreter
+}  // namespace art
+
+#endif  // ART_RUNTIME_INTERPRETER_INSTRUCTION_PAIR_HISTOGRAM_H_
@@ -21,6 +21,7 @@
 #include "instrumentation.h"
 #include "interpreter.h"
 #include "interpreter_intrinsics.h"
+#include "method_interpreter_cache.h"
 #include "transaction.h"
 
 #include <math.h>
@@ -226,6 +227,33 @@ static inline ALWAYS_INLINE WARN_UNUSED bool PerformNonStandardReturn(
   return false;
 }
 
+// Looks up the value of `inst` in the table of `method` shared by all threads, if
+// -XX:InterpreterMethodCaches is enabled. Called after a miss in the thread-local cache.
+static inline bool GetFromMethodInterpreterCache(Thread* self,
+                                                 ArtMethod* method,
+                                                 const Instruction* inst,
+                                                 /* out */ size_t* value)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  MethodInterpreterCaches* method_caches = Runtime::Current()->GetMethodInterpreterCaches();
+  if (LIKELY(method_caches == nullptr)) {
+    return false;
+  }
+  uint32_t dex_pc = inst->GetDexPc(method->DexInstructions().Insns());
+  return method_caches->Get(self, method, dex_pc, value);
+}
+
+// Records the value of `inst` in the table of `method`. Only for values that are not GC roots,
+// as the tables are not visited by the GC.
+static inline void SetInMethodInterpreterCache(ArtMethod* method,
+                                               const Instruction* inst,
+                                               size_t value)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  MethodInterpreterCaches* method_caches = Runtime::Current()->GetMethodInterpreterCaches();
+  if (UNLIKELY(method_caches != nullptr)) {
+    method_caches->Set(method, inst->GetDexPc(method->DexInstructions().Insns()), value);
+  }
+}
+
 // Handles all invoke-XXX/range instructions except for invoke-polymorphic[/range].
 // Returns true on success, otherwise throws an exception and returns false.
 template<InvokeType type, bool is_range, bool do_access_check, bool is_mterp, bool is_quick = false>
@@ -254,6 +282,10 @@ static ALWAYS_INLINE bool DoInvoke(Thread* self,
     resolved_method = nullptr;  // We don't know/care what the original method was.
   } else if (!IsNterpSupported() && LIKELY(tls_cache->Get(inst, &tls_value))) {
     resolved_method = reinterpret_cast<ArtMethod*>(tls_value);
+  } else if (!IsNterpSupported() &&
+             GetFromMethodInterpreterCache(self, sf_method, inst, &tls_value)) {
+    tls_cache->Set(inst, tls_value);
+    resolved_method = reinterpret_cast<ArtMethod*>(tls_value);
   } else {
     ClassLinker* const class_linker = Runtime::Current()->GetClassLinker();
     constexpr ClassLinker::ResolveMode resolve_mode =
@@ -267,6 +299,7 @@ static ALWAYS_INLINE bool DoInvoke(Thread* self,
     }
     if (!IsNterpSupported()) {
       tls_cache->Set(inst, reinterpret_cast<size_t>(resolved_method));
+      SetInMethodInterpreterCache(sf_method, inst, reinterpret_cast<size_t>(resolved_method));
     }
   }
 
@@ -27,6 +27,7 @@
 #include "dex/dex_instruction_list.h"
 #include "experimental_flags.h"
 #include "handle_scope.h"
+#include "instruction_pair_histogram.h"
 #include "interpreter_common.h"
 #include "interpreter/shadow_frame.h"
 #include "jit/jit-inl.h"
@@ -1950,12 +1951,22 @@ void ExecuteSwitchImplCpp(SwitchImplContext* ctx) {
       << "Entered interpreter from invoke without retry instruction being handled!";
 
   bool const interpret_one_instruction = ctx->interpret_one_instruction;
+  InstructionPairHistogram* const pair_histogram =
+      Runtime::Current()->GetInstructionPairHistogram();
+  size_t previous_opcode = InstructionPairHistogram::kNumOpcodes;  // None yet.
   while (true) {
     const Instruction* const inst = next;
     dex_pc = inst->GetDexPc(insns);
     shadow_frame.SetDexPC(dex_pc);
     TraceExecution(shadow_frame, inst, dex_pc);
     uint16_t inst_data = inst->Fetch16(0);
+    if (UNLIKELY(pair_histogram != nullptr)) {
+      uint8_t opcode = static_cast<uint8_t>(inst->Opcode(inst_data));
+      if (previous_opcode != InstructionPairHistogram::kNumOpcodes) {
+        pair_histogram->Record(static_cast<uint8_t>(previous_opcode), opcode);
+      }
+      previous_opcode = opcode;
+    }
     bool exit = false;
     if (InstructionHandler<do_access_check, transaction_active, Instruction::kInvalidFormat>(
             ctx, instrumentation, self, shadow_frame, dex_pc, inst, inst_data, next, exit).
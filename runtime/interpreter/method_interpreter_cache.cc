@@ -0,0 +1,348 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "method_interpreter_cache.h"
+
+#include <algorithm>
+#include <array>
+#include <ostream>
+
+#include "art_method-inl.h"
+#include "base/bit_utils.h"
+#include "dex/code_item_accessors-inl.h"
+#include "dex/dex_instruction_utils.h"
+#include "linear_alloc.h"
+#include "thread-current-inl.h"
+
+namespace art {
+namespace interpreter {
+
+// Instructions whose resolved field or method the interpreter keeps in the InterpreterCache.
+static bool UsesCache(Instruction::Code opcode) {
+  return IsInstructionIGetOrIPut(opcode) ||
+      IsInstructionSGetOrSPut(opcode) ||
+      (IsInstructionInvoke(opcode) && !IsInstructionQuickInvoke(opcode));
+}
+
+MethodInterpreterCache::MethodInterpreterCache(ArtMethod* method, uint32_t num_entries)
+    : method_(method), num_entries_(num_entries), hits_(0u), misses_(0u) {
+  std::atomic<size_t>* values = GetValues();
+  for (uint32_t i = 0; i != num_entries; ++i) {
+    new (&values[i]) std::atomic<size_t>(0u);
+  }
+}
+
+size_t MethodInterpreterCache::ComputeSize(uint32_t num_entries) {
+  return RoundUp(sizeof(MethodInterpreterCache), sizeof(size_t)) +
+      num_entries * (sizeof(std::atomic<size_t>) + sizeof(uint32_t));
+}
+
+std::atomic<size_t>* MethodInterpreterCache::GetValues() {
+  return reinterpret_cast<std::atomic<size_t>*>(
+      reinterpret_cast<uint8_t*>(this) + RoundUp(sizeof(MethodInterpreterCache), sizeof(size_t)));
+}
+
+uint32_t* MethodInterpreterCache::GetDexPcs() {
+  return reinterpret_cast<uint32_t*>(GetValues() + num_entries_);
+}
+
+MethodInterpreterCache* MethodInterpreterCache::Create(ArtMethod* method) {
+  CodeItemInstructionAccessor accessor = method->DexInstructions();
+  uint32_t num_entries = 0u;
+  for (const DexInstructionPcPair& pair : accessor) {
+    if (UsesCache(pair->Opcode())) {
+      ++num_entries;
+    }
+  }
+  if (num_entries == 0u) {
+    return nullptr;
+  }
+  uint8_t* storage = new uint8_t[ComputeSize(num_entries)];
+  MethodInterpreterCache* table = new (storage) MethodInterpreterCache(method, num_entries);
+  // The dex pcs are visited in increasing order, so the array is sorted.
+  uint32_t* dex_pcs = table->GetDexPcs();
+  for (const DexInstructionPcPair& pair : accessor) {
+    if (UsesCache(pair->Opcode())) {
+      *dex_pcs++ = pair.DexPc();
+    }
+  }
+  return table;
+}
+
+void MethodInterpreterCache::Delete(MethodInterpreterCache* table) {
+  table->~MethodInterpreterCache();
+  delete[] reinterpret_cast<uint8_t*>(table);
+}
+
+int32_t MethodInterpreterCache::FindEntry(uint32_t dex_pc) {
+  uint32_t* begin = GetDexPcs();
+  uint32_t* end = begin + num_entries_;
+  uint32_t* it = std::lower_bound(begin, end, dex_pc);
+  return (it != end && *it == dex_pc) ? static_cast<int32_t>(it - begin) : -1;
+}
+
+bool MethodInterpreterCache::Get(uint32_t dex_pc, /* out */ size_t* value) {
+  int32_t index = FindEntry(dex_pc);
+  size_t stored = (index >= 0) ? GetValues()[index].load(std::memory_order_acquire) : 0u;
+  if (stored == 0u) {
+    misses_.fetch_add(1u, std::memory_order_relaxed);
+    return false;
+  }
+  hits_.fetch_add(1u, std::memory_order_relaxed);
+  *value = stored - 1u;
+  return true;
+}
+
+void MethodInterpreterCache::Set(uint32_t dex_pc, size_t value) {
+  int32_t index = FindEntry(dex_pc);
+  if (index >= 0) {
+    GetValues()[index].store(value + 1u, std::memory_order_release);
+  }
+}
+
+void MethodInterpreterCache::Clear() {
+  std::atomic<size_t>* values = GetValues();
+  for (uint32_t i = 0; i != num_entries_; ++i) {
+    values[i].store(0u, std::memory_order_relaxed);
+  }
+}
+
+MethodInterpreterCaches::MethodInterpreterCaches()
+    : lock_("method interpreter caches lock", kGenericBottomLock),
+      slots_(new Slot[kNumSlots]),
+      num_tables_(0u),
+      table_bytes_(0u),
+      evictions_(0u),
+      untabled_lookups_(0u),
+      overflow_lookups_(0u) {
+  for (size_t i = 0; i != kNumSlots; ++i) {
+    slots_[i].method.store(nullptr, std::memory_order_relaxed);
+    slots_[i].table.store(nullptr, std::memory_order_relaxed);
+    slots_[i].lookups.store(0u, std::memory_order_relaxed);
+  }
+}
+
+MethodInterpreterCaches::~MethodInterpreterCaches() {
+  for (size_t i = 0; i != kNumSlots; ++i) {
+    MethodInterpreterCache* table = slots_[i].table.load(std::memory_order_relaxed);
+    if (table != nullptr) {
+      MethodInterpreterCache::Delete(table);
+    }
+  }
+}
+
+size_t MethodInterpreterCaches::GetFirstProbe(ArtMethod* method) const {
+  static_assert(IsPowerOfTwo(kNumSlots), "Size must be power of two");
+  // ArtMethods are at least 4-byte aligned and often allocated next to each other.
+  return (reinterpret_cast<uintptr_t>(method) >> 2) * 0x9e3779b1u;
+}
+
+MethodInterpreterCaches::Slot* MethodInterpreterCaches::FindSlot(ArtMethod* method) {
+  size_t index = GetFirstProbe(method);
+  for (size_t probe = 0; probe != kMaxProbes; ++probe) {
+    Slot* slot = &slots_[(index + probe) & (kNumSlots - 1u)];
+    ArtMethod* key = slot->method.load(std::memory_order_acquire);
+    if (key == method) {
+      return slot;
+    }
+    if (key == nullptr) {
+      return nullptr;
+    }
+  }
+  return nullptr;
+}
+
+MethodInterpreterCaches::Slot* MethodInterpreterCaches::ClaimSlot(ArtMethod* method) {
+  size_t index = GetFirstProbe(method);
+  Slot* free_slot = nullptr;
+  Slot* coldest_slot = nullptr;
+  for (size_t probe = 0; probe != kMaxProbes; ++probe) {
+    Slot* slot = &slots_[(index + probe) & (kNumSlots - 1u)];
+    ArtMethod* key = slot->method.load(std::memory_order_relaxed);
+    if (key == method) {
+      return slot;
+    }
+    if (key == nullptr || key == RemovedMethod()) {
+      if (free_slot == nullptr) {
+        free_slot = slot;
+      }
+      if (key == nullptr) {
+        break;
+      }
+    } else if (slot->table.load(std::memory_order_relaxed) == nullptr &&
+               (coldest_slot == nullptr ||
+                slot->lookups.load(std::memory_order_relaxed) <
+                    coldest_slot->lookups.load(std::memory_order_relaxed))) {
+      coldest_slot = slot;
+    }
+  }
+  Slot* slot = free_slot;
+  if (slot == nullptr) {
+    slot = coldest_slot;
+    if (slot == nullptr) {
+      return nullptr;
+    }
+    evictions_.fetch_add(1u, std::memory_order_relaxed);
+  }
+  slot->lookups.store(0u, std::memory_order_relaxed);
+  slot->method.store(method, std::memory_order_release);
+  return slot;
+}
+
+void MethodInterpreterCaches::CreateTable(Slot* slot, ArtMethod* method) {
+  // The slot may have been given to another method since the lookup counted it.
+  if (slot->method.load(std::memory_order_relaxed) != method ||
+      slot->table.load(std::memory_order_relaxed) != nullptr) {
+    return;
+  }
+  MethodInterpreterCache* table = MethodInterpreterCache::Create(method);
+  if (table != nullptr) {
+    slot->table.store(table, std::memory_order_release);
+    num_tables_.fetch_add(1u, std::memory_order_relaxed);
+    table_bytes_.fetch_add(MethodInterpreterCache::ComputeSize(table->GetNumEntries()),
+                           std::memory_order_relaxed);
+  }
+}
+
+void MethodInterpreterCaches::RemoveSlot(Slot* slot) {
+  MethodInterpreterCache* table = slot->table.load(std::memory_order_relaxed);
+  if (table != nullptr) {
+    slot->table.store(nullptr, std::memory_order_release);
+    table_bytes_.fetch_sub(MethodInterpreterCache::ComputeSize(table->GetNumEntries()),
+                           std::memory_order_relaxed);
+    MethodInterpreterCache::Delete(table);
+  }
+  slot->lookups.store(0u, std::memory_order_relaxed);
+  slot->method.store(RemovedMethod(), std::memory_order_release);
+}
+
+bool MethodInterpreterCaches::Get(Thread* self,
+                                  ArtMethod* method,
+                                  uint32_t dex_pc,
+                                  /* out */ size_t* value) {
+  Slot* slot = FindSlot(method);
+  if (slot == nullptr) {
+    MutexLock mu(self, lock_);
+    slot = ClaimSlot(method);
+    if (slot == nullptr) {
+      overflow_lookups_.fetch_add(1u, std::memory_order_relaxed);
+      return false;
+    }
+  }
+  MethodInterpreterCache* table = slot->table.load(std::memory_order_acquire);
+  if (table != nullptr && table->GetMethod() == method) {
+    return table->Get(dex_pc, value);
+  }
+  untabled_lookups_.fetch_add(1u, std::memory_order_relaxed);
+  if (table == nullptr &&
+      slot->lookups.fetch_add(1u, std::memory_order_relaxed) + 1u == kWarmLookups) {
+    MutexLock mu(self, lock_);
+    CreateTable(slot, method);
+  }
+  return false;
+}
+
+void MethodInterpreterCaches::Set(ArtMethod* method, uint32_t dex_pc, size_t value) {
+  Slot* slot = FindSlot(method);
+  if (slot != nullptr) {
+    MethodInterpreterCache* table = slot->table.load(std::memory_order_acquire);
+    if (table != nullptr && table->GetMethod() == method) {
+      table->Set(dex_pc, value);
+    }
+  }
+}
+
+void MethodInterpreterCaches::RemoveTables(Thread* self, ArtMethod* method) {
+  MutexLock mu(self, lock_);
+  Slot* slot = FindSlot(method);
+  if (slot != nullptr) {
+    RemoveSlot(slot);
+  }
+}
+
+void MethodInterpreterCaches::RemoveTablesIn(Thread* self, const LinearAlloc& allocator) {
+  // No thread can be reading these tables: the methods cannot be executing anymore, and a
+  // lookup of another method that raced with the slot changing owner finished long ago, as
+  // unloading the class loader took a GC, which waited for all threads to pass a checkpoint.
+  MutexLock mu(self, lock_);
+  for (size_t i = 0; i != kNumSlots; ++i) {
+    Slot* slot = &slots_[i];
+    ArtMethod* method = slot->method.load(std::memory_order_relaxed);
+    if (method != nullptr && method != RemovedMethod() && allocator.ContainsUnsafe(method)) {
+      RemoveSlot(slot);
+    }
+  }
+}
+
+void MethodInterpreterCaches::ClearAllTables(Thread* self) {
+  MutexLock mu(self, lock_);
+  for (size_t i = 0; i != kNumSlots; ++i) {
+    MethodInterpreterCache* table = slots_[i].table.load(std::memory_order_relaxed);
+    if (table != nullptr) {
+      table->Clear();
+    }
+  }
+}
+
+void MethodInterpreterCaches::DumpForSigQuit(std::ostream& os) {
+  constexpr size_t kNumBuckets = 10u;
+  std::array<size_t, kNumBuckets> histogram = {};
+  size_t num_methods = 0u;
+  size_t num_live_tables = 0u;
+  uint64_t hits = 0u;
+  uint64_t misses = 0u;
+  MutexLock mu(Thread::Current(), lock_);
+  for (size_t i = 0; i != kNumSlots; ++i) {
+    ArtMethod* method = slots_[i].method.load(std::memory_order_relaxed);
+    if (method == nullptr || method == RemovedMethod()) {
+      continue;
+    }
+    ++num_methods;
+    MethodInterpreterCache* table = slots_[i].table.load(std::memory_order_acquire);
+    if (table == nullptr) {
+      continue;
+    }
+    ++num_live_tables;
+    uint64_t table_hits = table->GetHits();
+    uint64_t table_lookups = table_hits + table->GetMisses();
+    hits += table_hits;
+    misses += table_lookups - table_hits;
+    if (table_lookups != 0u) {
+      ++histogram[std::min<size_t>(table_hits * kNumBuckets / table_lookups, kNumBuckets - 1u)];
+    }
+  }
+  uint64_t untabled = untabled_lookups_.load(std::memory_order_relaxed);
+  uint64_t overflow = overflow_lookups_.load(std::memory_order_relaxed);
+  uint64_t lookups = hits + misses + untabled + overflow;
+  os << "Interpreter method caches: " << num_live_tables << " tables for " << num_methods
+     << " methods, " << num_tables_.load(std::memory_order_relaxed) << " tables created, "
+     << table_bytes_.load(std::memory_order_relaxed) << " bytes in use, "
+     << evictions_.load(std::memory_order_relaxed) << " methods evicted\n";
+  os << "Thread cache misses: " << lookups << ", served by method tables: " << hits;
+  if (lookups != 0u) {
+    os << " (" << (hits * 100u / lookups) << "%)";
+  }
+  os << ", method table misses: " << misses << ", without table: " << untabled
+     << ", map full: " << overflow << "\n";
+  os << "Method table hit rate histogram:";
+  for (size_t i = 0; i != kNumBuckets; ++i) {
+    os << " " << (i * 100u / kNumBuckets) << "%:" << histogram[i];
+  }
+  os << "\n";
+}
+
+}  // namespace interpreter
+}  // namespace art
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_INTERPRETER_METHOD_INTERPRETER_CACHE_H_
+#define ART_RUNTIME_INTERPRETER_METHOD_INTERPRETER_CACHE_H_
+
+#include <atomic>
+#include <iosfwd>
+#include <memory>
+
+#include "base/locks.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+
+namespace art {
+
+class ArtMethod;
+class LinearAlloc;
+class Thread;
+
+namespace interpreter {
+
+// Side table of one method holding the values the interpreter keeps in the thread-local
+// InterpreterCache for the field and invoke instructions of the method, indexed by dex pc.
+// The values have the same opcode-specific meaning as in the InterpreterCache.
+//
+// The table is allocated on the native heap and is shared by all threads. Entries are written
+// once by whichever thread resolves them first.
+class MethodInterpreterCache {
+ public:
+  // Returns null if the method has no instruction that uses the cache.
+  static MethodInterpreterCache* Create(ArtMethod* method) REQUIRES_SHARED(Locks::mutator_lock_);
+
+  static void Delete(MethodInterpreterCache* table);
+
+  bool Get(uint32_t dex_pc, /* out */ size_t* value);
+
+  void Set(uint32_t dex_pc, size_t value);
+
+  // Empties all entries. Readers racing with the clear see either the old value or no value.
+  void Clear();
+
+  // The method the table was created for. Checked by the readers, as a slot of the map may be
+  // given to another method while they look at it.
+  ArtMethod* GetMethod() const {
+    return method_;
+  }
+
+  uint32_t GetNumEntries() const {
+    return num_entries_;
+  }
+
+  uint32_t GetHits() const {
+    return hits_.load(std::memory_order_relaxed);
+  }
+
+  uint32_t GetMisses() const {
+    return misses_.load(std::memory_order_relaxed);
+  }
+
+  static size_t ComputeSize(uint32_t num_entries);
+
+ private:
+  MethodInterpreterCache(ArtMethod* method, uint32_t num_entries);
+
+  // Values are stored plus one, so that zero marks an empty entry.
+  std::atomic<size_t>* GetValues();
+  uint32_t* GetDexPcs();
+
+  // Returns the index of the entry for `dex_pc`, or -1 if the instruction does not use the cache.
+  int32_t FindEntry(uint32_t dex_pc);
+
+  ArtMethod* const method_;
+  const uint32_t num_entries_;
+  std::atomic<uint32_t> hits_;
+  std::atomic<uint32_t> misses_;
+  // Followed by the values, then by the sorted dex pcs of the entries.
+
+  DISALLOW_COPY_AND_ASSIGN(MethodInterpreterCache);
+};
+
+// Maps methods to their MethodInterpreterCache. Enabled with -XX:InterpreterMethodCaches.
+//
+// The interpreters consult the method tables when the thread-local InterpreterCache misses,
+// before resolving the field or method, and refill the thread-local cache from them. A table
+// is created once the interpreter had to resolve kWarmLookups entries of the method.
+//
+// The map is a fixed-size open-addressing table keyed by ArtMethod*. The methods of an unloaded
+// class loader and methods redefined in place lose their slot and table, so that a method
+// allocated at the same address, or the new code of the method, starts without a table. When
+// all the slots a method can use are taken, the slot of the method with the fewest lookups and
+// no table is given to it. Slots are claimed, tables installed and freed under `lock_`, the
+// lookups do not lock.
+class MethodInterpreterCaches {
+ public:
+  static constexpr size_t kNumSlots = 16 * 1024;
+  static constexpr uint32_t kWarmLookups = 16u;
+  // Number of slots a method can use, from the one its address hashes to.
+  static constexpr size_t kMaxProbes = 32u;
+
+  MethodInterpreterCaches();
+  ~MethodInterpreterCaches();
+
+  // Looks up the value for the instruction at `dex_pc` of `method`. Called after a miss in the
+  // thread-local cache.
+  bool Get(Thread* self, ArtMethod* method, uint32_t dex_pc, /* out */ size_t* value)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+
+  // Records the value resolved for the instruction at `dex_pc` of `method`.
+  void Set(ArtMethod* method, uint32_t dex_pc, size_t value);
+
+  // Frees the table and the slot of `method`, whose code item changes. The other threads are
+  // suspended, so none of them can be reading the table.
+  void RemoveTables(Thread* self, ArtMethod* method) REQUIRES(Locks::mutator_lock_, !lock_);
+
+  // Frees the tables and the slots of methods allocated in `allocator`. The methods cannot be
+  // executing anymore.
+  void RemoveTablesIn(Thread* self, const LinearAlloc& allocator) REQUIRES(!lock_);
+
+  // Empties all tables. Called whenever the thread-local caches are cleared. The tables are kept
+  // and refill as the methods run.
+  void ClearAllTables(Thread* self) REQUIRES(!lock_);
+
+  // Prints the lookup counts and a histogram of the hit rates of the method tables.
+  void DumpForSigQuit(std::ostream& os) REQUIRES(!lock_);
+
+ private:
+  struct Slot {
+    std::atomic<ArtMethod*> method;
+    std::atomic<MethodInterpreterCache*> table;
+    std::atomic<uint32_t> lookups;
+  };
+
+  // Key of the slots whose method was removed. Lookups probe past them, new methods reuse them.
+  static ArtMethod* RemovedMethod() {
+    return reinterpret_cast<ArtMethod*>(1u);
+  }
+
+  size_t GetFirstProbe(ArtMethod* method) const;
+
+  // Returns null if the method has no slot.
+  Slot* FindSlot(ArtMethod* method);
+
+  // Returns the slot of `method`, giving it one if it has none: an empty or removed slot, or
+  // the slot of the method with the fewest lookups and no table. Returns null if all the slots
+  // the method can use have a table.
+  Slot* ClaimSlot(ArtMethod* method) REQUIRES(lock_);
+
+  void CreateTable(Slot* slot, ArtMethod* method)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(lock_);
+
+  void RemoveSlot(Slot* slot) REQUIRES(lock_);
+
+  Mutex lock_;
+  std::unique_ptr<Slot[]> slots_;
+
+  std::atomic<size_t> num_tables_;
+  std::atomic<size_t> table_bytes_;
+  std::atomic<size_t> evictions_;
+  // Lookups in methods without a table, and lookups that could not get a slot.
+  std::atomic<uint64_t> untabled_lookups_;
+  std::atomic<uint64_t> overflow_lookups_;
+
+  DISALLOW_COPY_AND_ASSIGN(MethodInterpreterCaches);
+};
+
+}  // namespace interpreter
+}  // namespace art
+
+#endif  // ART_RUNTIME_INTERPRETER_METHOD_INTERPRETER_CACHE_H_
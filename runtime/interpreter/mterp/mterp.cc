@@ -156,6 +156,8 @@ bool CanUseMterp()
       // know how to deal with these so we could end up never dealing with it if we are in an
       // infinite loop.
       !runtime->AreAsyncExceptionsThrown() &&
+      // Only the switch interpreter records instruction pairs.
+      runtime->GetInstructionPairHistogram() == nullptr &&
       (runtime->GetJit() == nullptr || !runtime->GetJit()->JitAtFirstUse());
 }
 
@@ -682,10 +684,18 @@ ALWAYS_INLINE bool MterpFieldAccessFast(Instruction* inst,
     REQUIRES_SHARED(Locks::mutator_lock_) {
   constexpr bool kIsStatic = (kAccessType & FindFieldFlags::StaticBit) != 0;
 
-  // Try to find the field in small thread-local cache first.
+  // Try to find the field in small thread-local cache first, then in the table of the method
+  // (only used when nterp is not supported, see below).
   InterpreterCache* tls_cache = self->GetInterpreterCache();
   size_t tls_value;
-  if (LIKELY(tls_cache->Get(inst, &tls_value))) {
+  bool cached = tls_cache->Get(inst, &tls_value);
+  if (!cached &&
+      !IsNterpSupported() &&
+      GetFromMethodInterpreterCache(self, shadow_frame->GetMethod(), inst, &tls_value)) {
+    tls_cache->Set(inst, tls_value);
+    cached = true;
+  }
+  if (LIKELY(cached)) {
     // The meaning of the cache value is opcode-specific.
     // It is ArtFiled* for static fields and the raw offset for instance fields.
     size_t offset = kIsStatic
@@ -732,11 +742,11 @@ ALWAYS_INLINE bool MterpFieldAccessFast(Instruction* inst,
         if (!IsNterpSupported() && LIKELY(kIsStatic || obj != nullptr)) {
           // Only non-volatile fields are allowed in the thread-local cache.
           if (LIKELY(!field->IsVolatile())) {
-            if (kIsStatic) {
-              tls_cache->Set(inst, reinterpret_cast<uintptr_t>(field));
-            } else {
-              tls_cache->Set(inst, field->GetOffset().SizeValue());
-            }
+            size_t value = kIsStatic
+                ? reinterpret_cast<uintptr_t>(field)
+                : field->GetOffset().SizeValue();
+            tls_cache->Set(inst, value);
+            SetInMethodInterpreterCache(referrer, inst, value);
           }
           MterpFieldAccess<PrimType, kAccessType>(
               inst, inst_data, shadow_frame, obj, field->GetOffset(), field->IsVolatile());
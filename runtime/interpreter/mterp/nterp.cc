@@ -119,6 +119,34 @@ inline void UpdateCache(Thread* self, uint16_t* dex_pc_ptr, T* value) {
   UpdateCache(self, dex_pc_ptr, reinterpret_cast<size_t>(value));
 }
 
+// Updates both the thread-local cache and the table of the method, if any. Only used for
+// field offsets, fields and methods.
+inline void UpdateCaches(Thread* self, ArtMethod* caller, uint16_t* dex_pc_ptr, size_t value)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  UpdateCache(self, dex_pc_ptr, value);
+  SetInMethodInterpreterCache(caller, Instruction::At(dex_pc_ptr), value);
+}
+
+template<typename T>
+inline void UpdateCaches(Thread* self, ArtMethod* caller, uint16_t* dex_pc_ptr, T* value)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  UpdateCaches(self, caller, dex_pc_ptr, reinterpret_cast<size_t>(value));
+}
+
+// Called on a miss in the thread-local cache. Looks up the value in the table of the method
+// and copies it to the thread-local cache.
+inline bool GetFromMethodCache(Thread* self,
+                               ArtMethod* caller,
+                               uint16_t* dex_pc_ptr,
+                               /* out */ size_t* value)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  if (!GetFromMethodInterpreterCache(self, caller, Instruction::At(dex_pc_ptr), value)) {
+    return false;
+  }
+  UpdateCache(self, dex_pc_ptr, *value);
+  return true;
+}
+
 extern "C" const dex::CodeItem* NterpGetCodeItem(ArtMethod* method)
     REQUIRES_SHARED(Locks::mutator_lock_) {
   ScopedAssertNoThreadSuspension sants("In nterp");
@@ -162,6 +190,10 @@ extern "C" const char* NterpGetShortyFromInvokeCustom(ArtMethod* caller, uint16_
 extern "C" size_t NterpGetMethod(Thread* self, ArtMethod* caller, uint16_t* dex_pc_ptr)
     REQUIRES_SHARED(Locks::mutator_lock_) {
   UpdateHotness(caller);
+  size_t cached_value;
+  if (GetFromMethodCache(self, caller, dex_pc_ptr, &cached_value)) {
+    return cached_value;
+  }
   const Instruction* inst = Instruction::At(dex_pc_ptr);
   InvokeType invoke_type = kStatic;
   uint16_t method_index = 0;
@@ -287,7 +319,7 @@ extern "C" size_t NterpGetMethod(Thread* self, ArtMethod* caller, uint16_t* dex_
       return resolved_method->GetMethodIndex() | (1U << 31);
     } else {
       DCHECK(resolved_method->GetDeclaringClass()->IsInterface());
-      UpdateCache(self, dex_pc_ptr, resolved_method->GetImtIndex());
+      UpdateCaches(self, caller, dex_pc_ptr, resolved_method->GetImtIndex());
       return resolved_method->GetImtIndex();
     }
   } else if (resolved_method->GetDeclaringClass()->IsStringClass()
@@ -300,10 +332,10 @@ extern "C" size_t NterpGetMethod(Thread* self, ArtMethod* caller, uint16_t* dex_
     // calls.
     return reinterpret_cast<size_t>(resolved_method) | 1;
   } else if (invoke_type == kVirtual) {
-    UpdateCache(self, dex_pc_ptr, resolved_method->GetMethodIndex());
+    UpdateCaches(self, caller, dex_pc_ptr, resolved_method->GetMethodIndex());
     return resolved_method->GetMethodIndex();
   } else {
-    UpdateCache(self, dex_pc_ptr, resolved_method);
+    UpdateCaches(self, caller, dex_pc_ptr, resolved_method);
     return reinterpret_cast<size_t>(resolved_method);
   }
 }
@@ -354,6 +386,10 @@ static ArtField* ResolveFieldWithAccessChecks(Thread* self,
 extern "C" size_t NterpGetStaticField(Thread* self, ArtMethod* caller, uint16_t* dex_pc_ptr)
     REQUIRES_SHARED(Locks::mutator_lock_) {
   UpdateHotness(caller);
+  size_t cached_value;
+  if (GetFromMethodCache(self, caller, dex_pc_ptr, &cached_value)) {
+    return cached_value;
+  }
   const Instruction* inst = Instruction::At(dex_pc_ptr);
   uint16_t field_index = inst->VRegB_21c();
   ClassLinker* const class_linker = Runtime::Current()->GetClassLinker();
@@ -384,9 +420,14 @@ extern "C" size_t NterpGetStaticField(Thread* self, ArtMethod* caller, uint16_t*
     // also don't cache the result as we don't want nterp to have its fast path always
     // check for it.
     return reinterpret_cast<size_t>(resolved_field) | 1;
-  } else {
+  } else if (!resolved_field->GetDeclaringClass()->IsVisiblyInitialized()) {
+    // The class is being initialized by this thread. Other threads must not see the field
+    // before the initialization is done.
     UpdateCache(self, dex_pc_ptr, resolved_field);
     return reinterpret_cast<size_t>(resolved_field);
+  } else {
+    UpdateCaches(self, caller, dex_pc_ptr, resolved_field);
+    return reinterpret_cast<size_t>(resolved_field);
   }
 }
 
@@ -395,6 +436,10 @@ extern "C" uint32_t NterpGetInstanceFieldOffset(Thread* self,
                                                 uint16_t* dex_pc_ptr)
     REQUIRES_SHARED(Locks::mutator_lock_) {
   UpdateHotness(caller);
+  size_t cached_value;
+  if (GetFromMethodCache(self, caller, dex_pc_ptr, &cached_value)) {
+    return cached_value;
+  }
   const Instruction* inst = Instruction::At(dex_pc_ptr);
   uint16_t field_index = inst->VRegC_22c();
   ClassLinker* const class_linker = Runtime::Current()->GetClassLinker();
@@ -414,7 +459,7 @@ extern "C" uint32_t NterpGetInstanceFieldOffset(Thread* self,
     // of volatile.
     return -resolved_field->GetOffset().Uint32Value();
   }
-  UpdateCache(self, dex_pc_ptr, resolved_field->GetOffset().Uint32Value());
+  UpdateCaches(self, caller, dex_pc_ptr, resolved_field->GetOffset().Uint32Value());
   return resolved_field->GetOffset().Uint32Value();
 }
 
@@ -34,6 +34,7 @@
 #include "base/time_utils.h"
 #include "base/utils.h"
 #include "cha.h"
+#include "code_info_cache.h"
 #include "debugger_interface.h"
 #include "dex/dex_file_loader.h"
 #include "dex/method_reference.h"
@@ -71,7 +72,8 @@ class JitCodeCache::JniStubKey {
         is_static_(method->IsStatic()),
         is_fast_native_(method->IsFastNative()),
         is_critical_native_(method->IsCriticalNative()),
-        is_synchronized_(method->IsSynchronized()) {
+        is_synchronized_(method->IsSynchronized()),
+        pinned_array_components_(GetPinnedArrayComponents(method)) {
     DCHECK(!(is_fast_native_ && is_critical_native_));
   }
 
@@ -88,7 +90,11 @@ class JitCodeCache::JniStubKey {
     if (is_critical_native_ != rhs.is_critical_native_) {
       return rhs.is_critical_native_;
     }
-    return strcmp(shorty_, rhs.shorty_) < 0;
+    int shorty_cmp = strcmp(shorty_, rhs.shorty_);
+    if (shorty_cmp != 0) {
+      return shorty_cmp < 0;
+    }
+    return pinned_array_components_ < rhs.pinned_array_components_;
   }
 
   // Update the shorty to point to another method's shorty. Call this function when removing
@@ -101,6 +107,26 @@ class JitCodeCache::JniStubKey {
   }
 
  private:
+  // The shorty records arrays as 'L'. A @PinnedArrayNative stub also depends on the element
+  // type of each array, so collect the component type characters of the array parameters.
+  // Stubs for methods without array parameters are the same as for @CriticalNative.
+  static std::string GetPinnedArrayComponents(ArtMethod* method)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    std::string components;
+    const dex::TypeList* params =
+        method->IsPinnedArrayNative() ? method->GetParameterTypeList() : nullptr;
+    if (params != nullptr) {
+      const DexFile* dex_file = method->GetDexFile();
+      for (size_t i = 0, size = params->Size(); i != size; ++i) {
+        const char* descriptor = dex_file->StringByTypeIdx(params->GetTypeItem(i).type_idx_);
+        if (descriptor[0] == '[') {
+          components += descriptor[1];
+        }
+      }
+    }
+    return components;
+  }
+
   // The shorty points to a DexFile data and may need to change
   // to point to the same shorty in a different DexFile.
   mutable const char* shorty_;
@@ -109,6 +135,7 @@ class JitCodeCache::JniStubKey {
   const bool is_fast_native_;
   const bool is_critical_native_;
   const bool is_synchronized_;
+  const std::string pinned_array_components_;
 };
 
 class JitCodeCache::JniStubData {
@@ -499,7 +526,6 @@ void JitCodeCache::FreeAllMethodHeaders(
   for (const OatQuickMethodHeader* method_header : method_headers) {
     FreeCodeAndData(method_header->GetCode());
   }
-
   // We have potentially removed a lot of debug info. Do maintenance pass to save space.
   RepackNativeDebugInfoForJit();
 
@@ -1021,6 +1047,10 @@ void JitCodeCache::FreeLocked(JitMemoryRegion* region, const uint8_t* code, cons
   if (code != nullptr) {
     RemoveNativeDebugInfoForJit(reinterpret_cast<const void*>(FromAllocationToCode(code)));
     region->FreeCode(code);
+    // The freed memory can be reused for new code only after we release the `jit_lock_`,
+    // so it is enough to invalidate the CodeInfo caches here. This covers every path that
+    // frees code: collections, method removal and redefinition.
+    CodeInfoCache::InvalidateAll();
   }
   if (data != nullptr) {
     region->FreeData(data);
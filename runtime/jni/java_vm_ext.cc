@@ -28,6 +28,7 @@
 #include "base/stl_util.h"
 #include "base/string_view_cpp20.h"
 #include "base/systrace.h"
+#include "base/time_utils.h"
 #include "check_jni.h"
 #include "dex/dex_file-inl.h"
 #include "fault_handler.h"
@@ -36,6 +37,7 @@
 #include "gc_root-inl.h"
 #include "indirect_reference_table-inl.h"
 #include "jni_internal.h"
+#include "jni_symbol_index.h"
 #include "mirror/class-inl.h"
 #include "mirror/class_loader.h"
 #include "mirror/dex_cache-inl.h"
@@ -82,9 +84,19 @@ class SharedLibrary {
         jni_on_load_thread_id_(self->GetThreadId()),
         jni_on_load_result_(kPending) {
     CHECK(class_loader_allocator_ != nullptr);
+    if (!needs_native_bridge_) {
+      uint64_t start_ns = NanoTime();
+      symbol_index_ = JniSymbolIndex::Create(handle_, path_.c_str(), "Java_");
+      VLOG(jni) << "[Indexed " << (symbol_index_ != nullptr ? symbol_index_->Size() : 0u)
+                << " native methods of \"" << path_ << "\" in "
+                << PrettyDuration(NanoTime() - start_ns)
+                << (symbol_index_ != nullptr && symbol_index_->IsComplete() ? " (complete)]" : "]");
+    }
   }
 
   ~SharedLibrary() {
+    // The index refers to the string table of the library.
+    symbol_index_.reset();
     Thread* self = Thread::Current();
     if (self != nullptr) {
       self->GetJniEnv()->DeleteWeakGlobalRef(class_loader_);
@@ -152,6 +164,9 @@ class SharedLibrary {
 
   void SetNeedsNativeBridge(bool needs) {
     needs_native_bridge_ = needs;
+    if (needs) {
+      symbol_index_.reset();
+    }
   }
 
   bool NeedsNativeBridge() const {
@@ -182,6 +197,25 @@ class SharedLibrary {
     return android::NativeBridgeGetTrampoline(handle_, symbol_name.c_str(), shorty, len);
   }
 
+  // Same as FindSymbol(), but looks in the symbol index first. dlsym() searches the library
+  // before its dependencies, so a hit is what it would return. On a miss the symbol may still
+  // come from a dependency and dlsym() is called, unless the library has no dependency that
+  // could define it. Sets `indexed` if the index had the symbol.
+  void* FindNativeMethodSymbol(const std::string& symbol_name, const char* shorty, bool* indexed)
+      REQUIRES(!Locks::mutator_lock_) {
+    if (symbol_index_ != nullptr) {
+      const void* fn = symbol_index_->Lookup(symbol_name);
+      if (fn != nullptr) {
+        *indexed = true;
+        return const_cast<void*>(fn);
+      }
+      if (symbol_index_->IsComplete()) {
+        return nullptr;
+      }
+    }
+    return FindSymbol(symbol_name, shorty);
+  }
+
  private:
   enum JNI_OnLoadState {
     kPending,
@@ -198,6 +232,10 @@ class SharedLibrary {
   // True if a native bridge is required.
   bool needs_native_bridge_;
 
+  // Index of the native methods the library defines, null if it could not be built or the
+  // library needs a native bridge.
+  std::unique_ptr<JniSymbolIndex> symbol_index_;
+
   // The ClassLoader this library is associated with, a weak global JNI reference that is
   // created/deleted with the scope of the library.
   const jweak class_loader_;
@@ -307,6 +345,7 @@ class Libraries {
       REQUIRES(!Locks::jni_libraries_lock_)
       REQUIRES(!Locks::mutator_lock_) {
     MutexLock mu(self, *Locks::jni_libraries_lock_);
+    uint64_t start_ns = NanoTime();
     for (const auto& lib : libraries_) {
       SharedLibrary* const library = lib.second;
       // Use the allocator address for class loader equality to avoid unnecessary weak root decode.
@@ -316,19 +355,40 @@ class Libraries {
       }
       // Try the short name then the long name...
       const char* arg_shorty = library->NeedsNativeBridge() ? shorty : nullptr;
-      void* fn = library->FindSymbol(jni_short_name, arg_shorty);
+      bool indexed = false;
+      void* fn = library->FindNativeMethodSymbol(jni_short_name, arg_shorty, &indexed);
       if (fn == nullptr) {
-        fn = library->FindSymbol(jni_long_name, arg_shorty);
+        fn = library->FindNativeMethodSymbol(jni_long_name, arg_shorty, &indexed);
       }
       if (fn != nullptr) {
         VLOG(jni) << "[Found native code for " << jni_long_name
-                  << " in \"" << library->GetPath() << "\"]";
+                  << " in \"" << library->GetPath() << "\""
+                  << (indexed ? " (indexed)]" : "]");
+        if (indexed) {
+          ++indexed_links_;
+          indexed_link_time_ns_ += NanoTime() - start_ns;
+        } else {
+          ++dlsym_links_;
+          dlsym_link_time_ns_ += NanoTime() - start_ns;
+        }
         return fn;
       }
     }
     return nullptr;
   }
 
+  // Report how many native methods were linked with the symbol indexes and with dlsym(), and
+  // the average time a link took with each.
+  void DumpLinkStats(std::ostream& os) const REQUIRES(Locks::jni_libraries_lock_) {
+    auto average = [](uint64_t time_ns, size_t count) {
+      return (count != 0u) ? time_ns / count : 0u;
+    };
+    os << "Native method links: " << indexed_links_ << " indexed (avg "
+       << PrettyDuration(average(indexed_link_time_ns_, indexed_links_)) << "), "
+       << dlsym_links_ << " dlsym (avg "
+       << PrettyDuration(average(dlsym_link_time_ns_, dlsym_links_)) << ")\n";
+  }
+
   // Unload native libraries with cleared class loaders.
   void UnloadNativeLibraries()
       REQUIRES(!Locks::jni_libraries_lock_)
@@ -376,6 +436,11 @@ class Libraries {
  private:
   AllocationTrackingSafeMap<std::string, SharedLibrary*, kAllocatorTagJNILibraries> libraries_
       GUARDED_BY(Locks::jni_libraries_lock_);
+
+  size_t indexed_links_ GUARDED_BY(Locks::jni_libraries_lock_) = 0u;
+  uint64_t indexed_link_time_ns_ GUARDED_BY(Locks::jni_libraries_lock_) = 0u;
+  size_t dlsym_links_ GUARDED_BY(Locks::jni_libraries_lock_) = 0u;
+  uint64_t dlsym_link_time_ns_ GUARDED_BY(Locks::jni_libraries_lock_) = 0u;
 };
 
 class JII {
@@ -514,6 +579,7 @@ JavaVMExt::JavaVMExt(Runtime* runtime,
       old_allocation_tracking_state_(false) {
   functions = unchecked_functions_;
   SetCheckJniEnabled(runtime_options.Exists(RuntimeArgumentMap::CheckJni));
+  globals_.EnableSharedAccess();
 }
 
 JavaVMExt::~JavaVMExt() {
@@ -658,6 +724,19 @@ void JavaVMExt::CheckGlobalRefAllocationTracking() {
   }
 }
 
+IrtFreeSlotCache* JavaVMExt::GetGlobalsFreeSlotCache(Thread* self) {
+  JNIEnvExt* env = self->GetJniEnv();
+  return (env != nullptr) ? env->GetGlobalsFreeSlotCache() : nullptr;
+}
+
+void JavaVMExt::ReleaseGlobalsFreeSlotCache(Thread* self, IrtFreeSlotCache* cache) {
+  if (cache->IsEmpty()) {
+    return;
+  }
+  ReaderMutexLock mu(self, *Locks::jni_globals_lock_);
+  globals_.ReleaseFreeSlotCache(cache);
+}
+
 jobject JavaVMExt::AddGlobalRef(Thread* self, ObjPtr<mirror::Object> obj) {
   // Check for null after decoding the object to handle cleared weak globals.
   if (obj == nullptr) {
@@ -666,8 +745,9 @@ jobject JavaVMExt::AddGlobalRef(Thread* self, ObjPtr<mirror::Object> obj) {
   IndirectRef ref;
   std::string error_msg;
   {
-    WriterMutexLock mu(self, *Locks::jni_globals_lock_);
-    ref = globals_.Add(kIRTFirstSegment, obj, &error_msg);
+    // Adds and removes only exclude operations that need a stable table, see VisitRoots().
+    ReaderMutexLock mu(self, *Locks::jni_globals_lock_);
+    ref = globals_.AddShared(GetGlobalsFreeSlotCache(self), obj, &error_msg);
   }
   if (UNLIKELY(ref == nullptr)) {
     LOG(FATAL) << error_msg;
@@ -705,8 +785,8 @@ void JavaVMExt::DeleteGlobalRef(Thread* self, jobject obj) {
     return;
   }
   {
-    WriterMutexLock mu(self, *Locks::jni_globals_lock_);
-    if (!globals_.Remove(kIRTFirstSegment, obj)) {
+    ReaderMutexLock mu(self, *Locks::jni_globals_lock_);
+    if (!globals_.RemoveShared(GetGlobalsFreeSlotCache(self), obj)) {
       LOG(WARNING) << "JNI WARNING: DeleteGlobalRef(" << obj << ") "
                    << "failed to find entry";
     }
@@ -760,6 +840,7 @@ void JavaVMExt::DumpForSigQuit(std::ostream& os) {
   {
     MutexLock mu(self, *Locks::jni_libraries_lock_);
     os << "Libraries: " << Dumpable<Libraries>(*libraries_) << " (" << libraries_->size() << ")\n";
+    libraries_->DumpLinkStats(os);
   }
 }
 
@@ -873,7 +954,7 @@ void JavaVMExt::UpdateWeakGlobal(Thread* self, IndirectRef ref, ObjPtr<mirror::O
 void JavaVMExt::DumpReferenceTables(std::ostream& os) {
   Thread* self = Thread::Current();
   {
-    ReaderMutexLock mu(self, *Locks::jni_globals_lock_);
+    WriterMutexLock mu(self, *Locks::jni_globals_lock_);
     globals_.Dump(os);
   }
   {
@@ -1173,7 +1254,10 @@ void JavaVMExt::TrimGlobals() {
 
 void JavaVMExt::VisitRoots(RootVisitor* visitor) {
   Thread* self = Thread::Current();
-  ReaderMutexLock mu(self, *Locks::jni_globals_lock_);
+  // Exclusive, as AddGlobalRef() and DeleteGlobalRef() modify the table with the lock shared.
+  WriterMutexLock mu(self, *Locks::jni_globals_lock_);
+  // Entries freed at the top of the table no longer need to be visited.
+  globals_.TrimSharedTopIndex();
   globals_.VisitRoots(visitor, RootInfo(kRootJNIGlobal));
   // The weak_globals table is visited by the GC itself (because it mutates the table).
 }
@@ -156,6 +156,10 @@ class JavaVMExt : public JavaVM {
 
   void DeleteGlobalRef(Thread* self, jobject obj) REQUIRES(!Locks::jni_globals_lock_);
 
+  // Returns the slots in `cache`, the free slot cache of an exiting thread, to globals_.
+  void ReleaseGlobalsFreeSlotCache(Thread* self, IrtFreeSlotCache* cache)
+      REQUIRES(!Locks::jni_globals_lock_);
+
   void DeleteWeakGlobalRef(Thread* self, jweak obj) REQUIRES(!Locks::jni_weak_globals_lock_);
 
   void SweepJniWeakGlobals(IsMarkedVisitor* visitor)
@@ -223,6 +227,9 @@ class JavaVMExt : public JavaVM {
 
   void CheckGlobalRefAllocationTracking();
 
+  // Return the free slot cache of `self` for globals_, or null if `self` has no JNIEnv.
+  static IrtFreeSlotCache* GetGlobalsFreeSlotCache(Thread* self);
+
   Runtime* const runtime_;
 
   // Used for testing. By default, we'll LOG(FATAL) the reason.
@@ -238,6 +245,8 @@ class JavaVMExt : public JavaVM {
   const std::string trace_;
 
   // Not guarded by globals_lock since we sometimes use SynchronizedGet in Thread::DecodeJObject.
+  // The table has shared access: adding and removing globals holds jni_globals_lock_ shared,
+  // everything else that modifies or walks the table holds it exclusively.
   IndirectReferenceTable globals_;
 
   // No lock annotation since UnloadNativeLibraries is called on libraries_ but locks the
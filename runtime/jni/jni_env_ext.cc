@@ -93,6 +93,11 @@ void JNIEnvExt::SetFunctionsToRuntimeShutdownFunctions() {
 }
 
 JNIEnvExt::~JNIEnvExt() {
+  // Give the free slots of the global reference table back, so that the next thread using them
+  // does not need to wait for the table to fill up and be scanned.
+  if (!IsRuntimeDeleted()) {
+    vm_->ReleaseGlobalsFreeSlotCache(Thread::Current(), &globals_free_slot_cache_);
+  }
 }
 
 jobject JNIEnvExt::NewLocalRef(mirror::Object* obj) {
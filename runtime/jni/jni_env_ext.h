@@ -110,6 +110,8 @@ class JNIEnvExt : public JNIEnv {
   }
   JavaVMExt* GetVm() const { return vm_; }
 
+  IrtFreeSlotCache* GetGlobalsFreeSlotCache() { return &globals_free_slot_cache_; }
+
   void SetRuntimeDeleted() { runtime_deleted_.store(true, std::memory_order_relaxed); }
   bool IsRuntimeDeleted() const { return runtime_deleted_.load(std::memory_order_relaxed); }
   bool IsCheckJniEnabled() const { return check_jni_; }
@@ -188,6 +190,10 @@ class JNIEnvExt : public JNIEnv {
   // Entered JNI monitors, for bulk exit on thread detach.
   ReferenceTable monitors_;
 
+  // Free slots of the JavaVM's global reference table, see IndirectReferenceTable::AddShared().
+  // Slots still in the cache are released to the table when the JNIEnvExt is deleted.
+  IrtFreeSlotCache globals_free_slot_cache_;
+
   // Used by -Xcheck:jni.
   JNINativeInterface const* unchecked_functions_;
 
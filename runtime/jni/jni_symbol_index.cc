@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jni_symbol_index.h"
+
+#include <dlfcn.h>
+#ifndef __APPLE__
+#include <link.h>  // for dl_iterate_phdr.
+#endif
+#include <string.h>
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace art {
+
+#ifdef __APPLE__
+
+std::unique_ptr<JniSymbolIndex> JniSymbolIndex::Create(void* handle ATTRIBUTE_UNUSED,
+                                                       const char* path ATTRIBUTE_UNUSED,
+                                                       std::string_view prefix ATTRIBUTE_UNUSED) {
+  // The dl_iterate_phdr syscall is missing. Native methods are found with dlsym().
+  return nullptr;
+}
+
+#else
+
+namespace {
+
+struct LoadedObject {
+  const char* file_name;
+  // Number of loaded objects with the file name to skip.
+  size_t skip;
+  ElfW(Addr) base = 0u;
+  const ElfW(Phdr)* phdr = nullptr;
+  ElfW(Half) phnum = 0u;
+};
+
+// Returns the part of `path` after the last '/'. The dynamic linker may report a library by
+// another path than the one it was opened with, e.g. when it was found in a search path or
+// inside an APK.
+const char* GetFileName(const char* path) {
+  const char* slash = strrchr(path, '/');
+  return (slash != nullptr) ? slash + 1 : path;
+}
+
+int FindLoadedObject(dl_phdr_info* info, size_t size ATTRIBUTE_UNUSED, void* data) {
+  // We must not allocate any memory in the callback, see b/156312036 .
+  LoadedObject* object = reinterpret_cast<LoadedObject*>(data);
+  if (info->dlpi_name == nullptr ||
+      strcmp(GetFileName(info->dlpi_name), object->file_name) != 0) {
+    return 0;  // Continue iteration.
+  }
+  if (object->skip != 0u) {
+    --object->skip;
+    return 0;  // Continue iteration.
+  }
+  object->base = info->dlpi_addr;
+  object->phdr = info->dlpi_phdr;
+  object->phnum = info->dlpi_phnum;
+  return 1;  // Stop iteration.
+}
+
+// Returns true if the library `name` from a DT_NEEDED entry is one of the C and C++ runtime
+// libraries. These do not define JNI functions, and neither do their own dependencies.
+bool IsSystemDependency(std::string_view name) {
+  static constexpr const char* kSystemLibraries[] = {
+      "libc", "libm", "libdl", "liblog", "libz", "libc++", "libc++_shared", "libstdc++",
+      "libpthread", "librt", "libgcc_s",
+  };
+  // The dynamic linker, e.g. ld-android.so or ld-linux-x86-64.so.2.
+  if (name.substr(0u, 3u) == "ld-") {
+    return true;
+  }
+  // Ignore the version suffix, e.g. libc.so.6.
+  size_t so = name.find(".so");
+  if (so == std::string_view::npos) {
+    return false;
+  }
+  name = name.substr(0u, so);
+  return std::find(std::begin(kSystemLibraries), std::end(kSystemLibraries), name) !=
+      std::end(kSystemLibraries);
+}
+
+// Returns the number of symbols in a DT_GNU_HASH table. Unlike DT_HASH, the table does not
+// record it, so find the end of the longest chain.
+size_t CountGnuHashSymbols(const uint32_t* gnu_hash) {
+  uint32_t num_buckets = gnu_hash[0];
+  uint32_t symbol_offset = gnu_hash[1];
+  uint32_t bloom_size = gnu_hash[2];
+  const uint32_t* buckets =
+      reinterpret_cast<const uint32_t*>(reinterpret_cast<const ElfW(Addr)*>(gnu_hash + 4) +
+                                        bloom_size);
+  const uint32_t* chains = buckets + num_buckets;
+  uint32_t last_symbol = 0u;
+  for (uint32_t i = 0; i != num_buckets; ++i) {
+    last_symbol = std::max(last_symbol, buckets[i]);
+  }
+  if (last_symbol < symbol_offset) {
+    return symbol_offset;
+  }
+  // The lowest bit of a chain entry marks the end of the chain.
+  while ((chains[last_symbol - symbol_offset] & 1u) == 0u) {
+    ++last_symbol;
+  }
+  return last_symbol + 1u;
+}
+
+// Adds the exported functions of `object` whose names start with `prefix` to `index`, and sets
+// `system_dependencies_only` if the object only depends on the C and C++ runtime libraries.
+// Returns false if the dynamic section cannot be parsed.
+bool IndexLoadedObject(const LoadedObject& object,
+                       std::string_view prefix,
+                       std::unordered_map<std::string_view, const void*>* index,
+                       bool* system_dependencies_only) {
+  const ElfW(Dyn)* dynamic = nullptr;
+  for (ElfW(Half) i = 0; i != object.phnum; ++i) {
+    if (object.phdr[i].p_type == PT_DYNAMIC) {
+      dynamic = reinterpret_cast<const ElfW(Dyn)*>(object.base + object.phdr[i].p_vaddr);
+      break;
+    }
+  }
+  if (dynamic == nullptr) {
+    return false;
+  }
+
+  // Some dynamic linkers relocate the addresses in the dynamic section, others leave them
+  // relative to the load base. Relative addresses are always below the load base.
+  auto to_address = [&object](ElfW(Addr) address) {
+    return (address < object.base) ? object.base + address : address;
+  };
+  const ElfW(Sym)* symbols = nullptr;
+  const char* strings = nullptr;
+  size_t strings_size = 0u;
+  const ElfW(Half)* versions = nullptr;
+  size_t num_symbols = 0u;
+  std::vector<size_t> needed;  // String table offsets of the DT_NEEDED names.
+  for (const ElfW(Dyn)* entry = dynamic; entry->d_tag != DT_NULL; ++entry) {
+    switch (entry->d_tag) {
+      case DT_NEEDED:
+        needed.push_back(entry->d_un.d_val);
+        break;
+      case DT_SYMTAB:
+        symbols = reinterpret_cast<const ElfW(Sym)*>(to_address(entry->d_un.d_ptr));
+        break;
+      case DT_STRTAB:
+        strings = reinterpret_cast<const char*>(to_address(entry->d_un.d_ptr));
+        break;
+      case DT_STRSZ:
+        strings_size = entry->d_un.d_val;
+        break;
+      case DT_VERSYM:
+        versions = reinterpret_cast<const ElfW(Half)*>(to_address(entry->d_un.d_ptr));
+        break;
+      case DT_HASH:
+        // The number of chain entries equals the number of symbols.
+        num_symbols = reinterpret_cast<const uint32_t*>(to_address(entry->d_un.d_ptr))[1];
+        break;
+      case DT_GNU_HASH:
+        if (num_symbols == 0u) {
+          num_symbols = CountGnuHashSymbols(
+              reinterpret_cast<const uint32_t*>(to_address(entry->d_un.d_ptr)));
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  if (symbols == nullptr || strings == nullptr || num_symbols == 0u) {
+    return false;
+  }
+
+  *system_dependencies_only = std::all_of(
+      needed.begin(),
+      needed.end(),
+      [&](size_t offset) {
+        return offset < strings_size && IsSystemDependency(strings + offset);
+      });
+
+  // Symbol 0 is always the undefined symbol.
+  for (size_t i = 1; i != num_symbols; ++i) {
+    const ElfW(Sym)& symbol = symbols[i];
+    // The ELF32_ST_* accessors are the same for 64-bit symbols.
+    unsigned char binding = ELF32_ST_BIND(symbol.st_info);
+    unsigned char visibility = ELF32_ST_VISIBILITY(symbol.st_other);
+    if (symbol.st_shndx == SHN_UNDEF ||
+        ELF32_ST_TYPE(symbol.st_info) != STT_FUNC ||
+        (binding != STB_GLOBAL && binding != STB_WEAK) ||
+        visibility == STV_HIDDEN ||
+        visibility == STV_INTERNAL ||
+        symbol.st_name >= strings_size) {
+      continue;
+    }
+    // dlsym() only returns the default version of a symbol, skip hidden and local versions.
+    if (versions != nullptr && ((versions[i] & 0x8000u) != 0u || versions[i] == 0u)) {
+      continue;
+    }
+    std::string_view name(strings + symbol.st_name);
+    if (name.substr(0u, prefix.size()) != prefix) {
+      continue;
+    }
+    index->emplace(name, reinterpret_cast<const void*>(object.base + symbol.st_value));
+  }
+  return true;
+}
+
+}  // namespace
+
+std::unique_ptr<JniSymbolIndex> JniSymbolIndex::Create(void* handle,
+                                                       const char* path,
+                                                       std::string_view prefix) {
+  const char* file_name = GetFileName(path);
+  for (size_t skip = 0u; ; ++skip) {
+    LoadedObject object = { file_name, skip };
+    if (dl_iterate_phdr(FindLoadedObject, &object) == 0) {
+      return nullptr;
+    }
+    std::unique_ptr<JniSymbolIndex> index(new JniSymbolIndex());
+    if (!IndexLoadedObject(object, prefix, &index->symbols_, &index->complete_) ||
+        index->symbols_.empty()) {
+      continue;
+    }
+    // Libraries with the same file name may be loaded from other directories or in other
+    // linker namespaces. Only use the index if `handle` resolves a symbol to this object.
+    // The names are null terminated in the string table.
+    const auto& [name, address] = *index->symbols_.begin();
+    if (dlsym(handle, name.data()) == address) {
+      return index;
+    }
+  }
+}
+
+#endif  // __APPLE__
+
+}  // namespace art
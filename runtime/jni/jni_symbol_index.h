@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_JNI_JNI_SYMBOL_INDEX_H_
+#define ART_RUNTIME_JNI_JNI_SYMBOL_INDEX_H_
+
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+#include "base/macros.h"
+
+namespace art {
+
+// Hash index of the symbols a loaded shared library defines, built from its dynamic symbol
+// table, so that linking a native method does not need a dlsym() call per library and per
+// JNI name.
+//
+// Only symbols the library defines itself are indexed. dlsym() on the library handle also
+// searches its dependencies, so a miss does not mean that dlsym() would fail, unless the index
+// is complete.
+class JniSymbolIndex {
+ public:
+  // Index the exported functions whose names start with `prefix` of the library `path`, loaded
+  // as `handle` by dlopen(). The loaded objects with the same file name are candidates, and the
+  // one whose symbols dlsym() on `handle` resolves to is indexed. Returns null if there is no
+  // such object, it defines no symbol with the prefix or its dynamic section cannot be parsed.
+  static std::unique_ptr<JniSymbolIndex> Create(void* handle,
+                                                const char* path,
+                                                std::string_view prefix);
+
+  // Returns the address of the symbol `name`, or null if it is not in the index.
+  const void* Lookup(std::string_view name) const {
+    auto it = symbols_.find(name);
+    return (it != symbols_.end()) ? it->second : nullptr;
+  }
+
+  size_t Size() const {
+    return symbols_.size();
+  }
+
+  // Returns true if the library only depends on the C and C++ runtime libraries. These define
+  // no JNI functions, so for the "Java_" prefix dlsym() on the library handle cannot find a
+  // symbol that is not in the index.
+  bool IsComplete() const {
+    return complete_;
+  }
+
+ private:
+  JniSymbolIndex() {}
+
+  // The names point to the string table of the library.
+  std::unordered_map<std::string_view, const void*> symbols_;
+  bool complete_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(JniSymbolIndex);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_JNI_JNI_SYMBOL_INDEX_H_
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jni_symbol_index.h"
+
+#include <dirent.h>
+#include <dlfcn.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+#ifndef __APPLE__
+
+TEST(JniSymbolIndexTest, MatchesDlsym) {
+  // Index libc, which is always loaded, and compare with the symbols dlsym() finds in it.
+  Dl_info info;
+  ASSERT_NE(dladdr(reinterpret_cast<void*>(&opendir), &info), 0);
+  void* handle = dlopen(info.dli_fname, RTLD_NOW | RTLD_NOLOAD);
+  ASSERT_TRUE(handle != nullptr);
+  std::unique_ptr<JniSymbolIndex> index = JniSymbolIndex::Create(handle, info.dli_fname, "");
+  ASSERT_TRUE(index != nullptr);
+  EXPECT_NE(index->Size(), 0u);
+  for (const char* name : { "opendir", "closedir", "readdir" }) {
+    EXPECT_EQ(index->Lookup(name), dlsym(handle, name)) << name;
+  }
+  EXPECT_TRUE(index->Lookup("ThisSymbolDoesNotExist") == nullptr);
+  // libc only depends on the dynamic linker.
+  EXPECT_TRUE(index->IsComplete());
+
+  // Only symbols with the prefix are indexed.
+  std::unique_ptr<JniSymbolIndex> prefix_index =
+      JniSymbolIndex::Create(handle, info.dli_fname, "close");
+  ASSERT_TRUE(prefix_index != nullptr);
+  EXPECT_LT(prefix_index->Size(), index->Size());
+  EXPECT_EQ(prefix_index->Lookup("closedir"), index->Lookup("closedir"));
+  EXPECT_TRUE(prefix_index->Lookup("opendir") == nullptr);
+  dlclose(handle);
+}
+
+TEST(JniSymbolIndexTest, MatchesHandle) {
+  Dl_info info;
+  ASSERT_NE(dladdr(reinterpret_cast<void*>(&opendir), &info), 0);
+  void* handle = dlopen(info.dli_fname, RTLD_NOW | RTLD_NOLOAD);
+  ASSERT_TRUE(handle != nullptr);
+  // The library is found by the handle, not by the path it was opened with.
+  std::string file_name(info.dli_fname);
+  file_name = file_name.substr(file_name.rfind('/') + 1u);
+  std::unique_ptr<JniSymbolIndex> index =
+      JniSymbolIndex::Create(handle, ("/does/not/exist/" + file_name).c_str(), "");
+  ASSERT_TRUE(index != nullptr);
+  EXPECT_EQ(index->Lookup("opendir"), dlsym(handle, "opendir"));
+  dlclose(handle);
+}
+
+TEST(JniSymbolIndexTest, NotLoaded) {
+  void* handle = dlopen(nullptr, RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr);
+  EXPECT_TRUE(JniSymbolIndex::Create(handle, "/does/not/exist/libfoo.so", "Java_") == nullptr);
+  dlclose(handle);
+}
+
+#endif  // __APPLE__
+
+}  // namespace art
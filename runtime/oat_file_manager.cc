@@ -34,6 +34,7 @@
 #include "base/systrace.h"
 #include "class_linker.h"
 #include "class_loader_context.h"
+#include "code_info_cache.h"
 #include "dex/art_dex_file_loader.h"
 #include "dex/dex_file-inl.h"
 #include "dex/dex_file_loader.h"
@@ -93,6 +94,8 @@ void OatFileManager::UnRegisterAndDeleteOatFile(const OatFile* oat_file) {
   CHECK(it != oat_files_.end());
   oat_files_.erase(it);
   compare.release();  // NOLINT b/117926937
+  // The oat file's code may be unmapped, so forget about its CodeInfo.
+  CodeInfoCache::InvalidateAll();
 }
 
 const OatFile* OatFileManager::FindOpenedOatFileFromDexLocation(
@@ -159,6 +159,12 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
       .Define("-XX:FinalizerTimeoutMs=_")
           .WithType<unsigned int>()
           .IntoKey(M::FinalizerTimeoutMs)
+      .Define("-XX:FinalizerThreadCount=_")
+          .WithType<unsigned int>()
+          .IntoKey(M::FinalizerThreadCount)
+      .Define("-XX:FinalizerBackpressureThreshold=_")
+          .WithType<unsigned int>()
+          .IntoKey(M::FinalizerBackpressureThreshold)
       .Define("-Xss_")
           .WithType<Memory<1>>()
           .IntoKey(M::StackSize)
@@ -193,6 +199,17 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
           .WithType<bool>()
           .WithValueMap({{"false", false}, {"true", true}})
           .IntoKey(M::DumpNativeStackOnSigQuit)
+      .Define("-XX:DedupeStackTraces:_")
+          .WithType<bool>()
+          .WithValueMap({{"false", false}, {"true", true}})
+          .IntoKey(M::DedupeStackTraces)
+      .Define("-XX:NumaAwareRegions:_")
+          .WithType<bool>()
+          .WithValueMap({{"false", false}, {"true", true}})
+          .IntoKey(M::NumaAwareRegions)
+      .Define("-XX:ElasticHeapIdleTime=_")  // in ms
+          .WithType<MillisecondsToNanoseconds>()  // store as ns
+          .IntoKey(M::ElasticHeapIdleTime)
       .Define("-XX:MadviseRandomAccess:_")
           .WithType<bool>()
           .WithValueMap({{"false", false}, {"true", true}})
@@ -214,6 +231,17 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
           .WithType<bool>()
           .WithValueMap({{"false", false}, {"true", true}})
           .IntoKey(M::UseTieredJitCompilation)
+      .Define("-XX:InterpreterPairHistogramFile=_")
+          .WithType<std::string>()
+          .IntoKey(M::InterpreterPairHistogramFile)
+      .Define("-XX:InterpreterMethodCaches:_")
+          .WithType<bool>()
+          .WithValueMap({{"false", false}, {"true", true}})
+          .IntoKey(M::InterpreterMethodCaches)
+      .Define("-XX:MethodEntryExitHooks:_")
+          .WithType<bool>()
+          .WithValueMap({{"false", false}, {"true", true}})
+          .IntoKey(M::MethodEntryExitHooks)
       .Define("-Xjitinitialsize:_")
           .WithType<MemoryKiB>()
           .IntoKey(M::JITCodeCacheInitialCapacity)
@@ -276,6 +304,12 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
       .Define("-XX:LargeObjectThreshold=_")
           .WithType<Memory<1>>()
           .IntoKey(M::LargeObjectThreshold)
+      .Define("-XX:AllocationSampleInterval=_")
+          .WithType<Memory<1>>()
+          .IntoKey(M::AllocationSampleInterval)
+      .Define("-XX:AllocationProfileFile=_")
+          .WithType<std::string>()
+          .IntoKey(M::AllocationProfileFile)
       .Define("-XX:BackgroundGC=_")
           .WithType<BackgroundGcOption>()
           .IntoKey(M::BackgroundGc)
@@ -771,6 +805,8 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -XX:ParallelGCThreads=integervalue\n");
   UsageMessage(stream, "  -XX:ConcGCThreads=integervalue\n");
   UsageMessage(stream, "  -XX:FinalizerTimeoutMs=integervalue\n");
+  UsageMessage(stream, "  -XX:FinalizerThreadCount=integervalue\n");
+  UsageMessage(stream, "  -XX:FinalizerBackpressureThreshold=integervalue\n");
   UsageMessage(stream, "  -XX:MaxSpinsBeforeThinLockInflation=integervalue\n");
   UsageMessage(stream, "  -XX:LongPauseLogThreshold=integervalue\n");
   UsageMessage(stream, "  -XX:LongGCLogThreshold=integervalue\n");
@@ -782,8 +818,13 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -XX:BackgroundGC=none\n");
   UsageMessage(stream, "  -XX:LargeObjectSpace={disabled,map,freelist}\n");
   UsageMessage(stream, "  -XX:LargeObjectThreshold=N\n");
+  UsageMessage(stream, "  -XX:AllocationSampleInterval=N\n");
+  UsageMessage(stream, "  -XX:AllocationProfileFile=filename\n");
   UsageMessage(stream, "  -XX:StopForNativeAllocs=N\n");
   UsageMessage(stream, "  -XX:DumpNativeStackOnSigQuit=booleanvalue\n");
+  UsageMessage(stream, "  -XX:DedupeStackTraces:booleanvalue\n");
+  UsageMessage(stream, "  -XX:NumaAwareRegions:booleanvalue\n");
+  UsageMessage(stream, "  -XX:ElasticHeapIdleTime=integervalue\n");
   UsageMessage(stream, "  -XX:MadviseRandomAccess:booleanvalue\n");
   UsageMessage(stream, "  -XX:SlowDebug={false,true}\n");
   UsageMessage(stream, "  -Xmethod-trace\n");
@@ -801,6 +842,9 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -Xcompiler-option dex2oat-option\n");
   UsageMessage(stream, "  -Ximage-compiler-option dex2oat-option\n");
   UsageMessage(stream, "  -Xusejit:booleanvalue\n");
+  UsageMessage(stream, "  -XX:MethodEntryExitHooks:booleanvalue\n");
+  UsageMessage(stream, "  -XX:InterpreterPairHistogramFile=filename\n");
+  UsageMessage(stream, "  -XX:InterpreterMethodCaches:booleanvalue\n");
   UsageMessage(stream, "  -Xjitinitialsize:N\n");
   UsageMessage(stream, "  -Xjitmaxsize:N\n");
   UsageMessage(stream, "  -Xjitwarmupthreshold:integervalue\n");
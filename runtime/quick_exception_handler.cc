@@ -21,12 +21,14 @@
 #include "base/enums.h"
 #include "base/logging.h"  // For VLOG_IS_ON.
 #include "base/systrace.h"
+#include "code_info_cache.h"
 #include "dex/dex_file_types.h"
 #include "dex/dex_instruction.h"
 #include "entrypoints/entrypoint_utils.h"
 #include "entrypoints/quick/quick_entrypoints_enum.h"
 #include "entrypoints/runtime_asm_entrypoints.h"
 #include "handle_scope-inl.h"
+#include "instrumentation.h"
 #include "interpreter/shadow_frame-inl.h"
 #include "jit/jit.h"
 #include "jit/jit_code_cache.h"
@@ -63,14 +65,16 @@ class CatchBlockStackVisitor final : public StackVisitor {
  public:
   CatchBlockStackVisitor(Thread* self,
                          Context* context,
-                         Handle<mirror::Throwable>* exception,
+                         MutableHandle<mirror::Throwable>* exception,
                          QuickExceptionHandler* exception_handler,
-                         uint32_t skip_frames)
+                         uint32_t skip_frames,
+                         bool skip_top_java_frame)
       REQUIRES_SHARED(Locks::mutator_lock_)
       : StackVisitor(self, context, StackVisitor::StackWalkKind::kIncludeInlinedFrames),
         exception_(exception),
         exception_handler_(exception_handler),
-        skip_frames_(skip_frames) {
+        skip_frames_(skip_frames),
+        skip_top_java_frame_(skip_top_java_frame) {
   }
 
   bool VisitFrame() override REQUIRES_SHARED(Locks::mutator_lock_) {
@@ -93,6 +97,12 @@ class CatchBlockStackVisitor final : public StackVisitor {
       DCHECK(method->IsCalleeSaveMethod());
       return true;
     }
+    if (skip_top_java_frame_) {
+      // The exception was thrown by a method entry/exit listener. The entry hook reported the
+      // unwind itself and the exit hook already reported the exit.
+      skip_top_java_frame_ = false;
+      return true;
+    }
     return HandleTryItems(method);
   }
 
@@ -127,23 +137,49 @@ class CatchBlockStackVisitor final : public StackVisitor {
           ShadowFrame::DeleteDeoptimizedFrame(frame);
         }
       }
+      instrumentation::Instrumentation* instrumentation =
+          Runtime::Current()->GetInstrumentation();
+      if (UNLIKELY(instrumentation->AreEntryExitHooksEnabled()) &&
+          GetCurrentQuickFrame() != nullptr &&
+          !IsInInlinedFrame() &&  // Inlined methods report no entry.
+          instrumentation->CodeHasEntryExitHooks(
+              method, GetCurrentOatQuickMethodHeader()->GetEntryPoint())) {
+        // The exit hook of compiled code is not run when the frame is unwound.
+        ReportMethodUnwind(instrumentation, method, dex_pc);
+      }
     }
     return true;  // Continue stack walk.
   }
 
+  void ReportMethodUnwind(instrumentation::Instrumentation* instrumentation,
+                          ArtMethod* method,
+                          uint32_t dex_pc)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    // The instrumentation events expect the exception to be set. A listener may throw a new
+    // exception, which is then delivered instead from the next frame.
+    Thread* self = GetThread();
+    self->SetException(exception_->Get());
+    instrumentation->MethodUnwindEvent(self, GetThisObject(), method, dex_pc);
+    exception_->Assign(self->GetException());
+    self->ClearException();
+  }
+
   // The exception we're looking for the catch block of.
-  Handle<mirror::Throwable>* exception_;
+  MutableHandle<mirror::Throwable>* exception_;
   // The quick exception handler we're visiting for.
   QuickExceptionHandler* const exception_handler_;
   // The number of frames to skip searching for catches in.
   uint32_t skip_frames_;
+  // Whether to unwind the innermost Java frame without searching for catches in it.
+  bool skip_top_java_frame_;
 
   DISALLOW_COPY_AND_ASSIGN(CatchBlockStackVisitor);
 };
 
 // Finds the appropriate exception catch after calling all method exit instrumentation functions.
 // Note that this might change the exception being thrown.
-void QuickExceptionHandler::FindCatch(ObjPtr<mirror::Throwable> exception) {
+void QuickExceptionHandler::FindCatch(ObjPtr<mirror::Throwable> exception,
+                                      bool skip_top_java_frame) {
   DCHECK(!is_deoptimization_);
   instrumentation::InstrumentationStackPopper popper(self_);
   // The number of total frames we have so far popped.
@@ -167,8 +203,11 @@ void QuickExceptionHandler::FindCatch(ObjPtr<mirror::Throwable> exception) {
     CatchBlockStackVisitor visitor(self_, context_,
                                    &exception_ref,
                                    this,
-                                   /*skip_frames=*/already_popped);
+                                   /*skip_frames=*/already_popped,
+                                   skip_top_java_frame);
     visitor.WalkStack(true);
+    // Later walks start past that frame.
+    skip_top_java_frame = false;
     uint32_t new_pop_count = handler_frame_depth_;
     DCHECK_GE(new_pop_count, already_popped);
     already_popped = new_pop_count;
@@ -245,7 +284,7 @@ void QuickExceptionHandler::SetCatchEnvironmentForOptimizedHandler(StackVisitor*
 
   CodeItemDataAccessor accessor(GetHandlerMethod()->DexInstructionData());
   const size_t number_of_vregs = accessor.RegistersSize();
-  CodeInfo code_info(handler_method_header_);
+  CodeInfo code_info = CodeInfoCache::Decode(handler_method_header_);
 
   // Find stack map of the catch block.
   StackMap catch_stack_map = code_info.GetCatchStackMapForDexPc(GetHandlerDexPc());
@@ -258,8 +297,8 @@ void QuickExceptionHandler::SetCatchEnvironmentForOptimizedHandler(StackVisitor*
   }
 
   // Find stack map of the throwing instruction.
-  StackMap throw_stack_map =
-      code_info.GetStackMapForNativePcOffset(stack_visitor->GetNativePcOffset());
+  StackMap throw_stack_map = CodeInfoCache::GetStackMapForNativePcOffset(
+      handler_method_header_, code_info, stack_visitor->GetNativePcOffset());
   DCHECK(throw_stack_map.IsValid());
   DexRegisterMap throw_vreg_map = code_info.GetDexRegisterMapOf(throw_stack_map);
   DCHECK_EQ(throw_vreg_map.size(), number_of_vregs);
@@ -454,9 +493,10 @@ class DeoptimizeStackVisitor final : public StackVisitor {
                                       const bool* updated_vregs)
       REQUIRES_SHARED(Locks::mutator_lock_) {
     const OatQuickMethodHeader* method_header = GetCurrentOatQuickMethodHeader();
-    CodeInfo code_info(method_header);
+    CodeInfo code_info = CodeInfoCache::Decode(method_header);
     uintptr_t native_pc_offset = method_header->NativeQuickPcOffset(GetCurrentQuickFramePc());
-    StackMap stack_map = code_info.GetStackMapForNativePcOffset(native_pc_offset);
+    StackMap stack_map = CodeInfoCache::GetStackMapForNativePcOffset(
+        method_header, code_info, native_pc_offset);
     CodeItemDataAccessor accessor(m->DexInstructionData());
     const size_t number_of_vregs = accessor.RegistersSize();
     uint32_t register_mask = code_info.GetRegisterMaskOf(stack_map);
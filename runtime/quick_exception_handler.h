@@ -49,7 +49,10 @@ class QuickExceptionHandler {
 
   // Find the catch handler for the given exception and call all required Instrumentation methods.
   // Note this might result in the exception being caught being different from 'exception'.
-  void FindCatch(ObjPtr<mirror::Throwable> exception) REQUIRES_SHARED(Locks::mutator_lock_);
+  // If `skip_top_java_frame`, the innermost Java frame is unwound without looking at its
+  // catch blocks.
+  void FindCatch(ObjPtr<mirror::Throwable> exception, bool skip_top_java_frame = false)
+      REQUIRES_SHARED(Locks::mutator_lock_);
 
   // Deoptimize the stack to the upcall/some code that's not deoptimizeable. For
   // every compiled frame, we create a "copy" shadow frame that will be executed
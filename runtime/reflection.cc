@@ -31,6 +31,7 @@
 #include "mirror/object_array-inl.h"
 #include "nativehelper/scoped_local_ref.h"
 #include "nth_caller_visitor.h"
+#include "reflective_invoke_stub.h"
 #include "scoped_thread_state_change-inl.h"
 #include "stack_reference.h"
 #include "thread-inl.h"
@@ -222,9 +223,58 @@ class ArgArray {
                      PrettyDescriptor(found_descriptor).c_str()).c_str());
   }
 
+  // Appends an argument of the exact type expected by a ReflectiveInvokeStub parameter.
+  // Returns false if the argument needs the generic conversion.
+  ALWAYS_INLINE bool TryAppendForStub(const ReflectiveInvokeStub::Parameter& parameter,
+                                      ObjPtr<mirror::Object> arg)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    if (parameter.type == 'L') {
+      if (arg != nullptr && !parameter.accepts_any_object) {
+        return false;
+      }
+      Append(arg);
+      return true;
+    }
+    ArtField* field = parameter.box_value_field;
+    if (arg == nullptr || arg->GetClass() != field->GetDeclaringClass()) {
+      return false;
+    }
+    switch (parameter.type) {
+      case 'Z':
+        Append(field->GetBoolean(arg));
+        break;
+      case 'B':
+        Append(field->GetByte(arg));
+        break;
+      case 'C':
+        Append(field->GetChar(arg));
+        break;
+      case 'S':
+        Append(field->GetShort(arg));
+        break;
+      case 'I':
+        Append(field->GetInt(arg));
+        break;
+      case 'J':
+        AppendWide(field->GetLong(arg));
+        break;
+      case 'F':
+        AppendFloat(field->GetFloat(arg));
+        break;
+      case 'D':
+        AppendDouble(field->GetDouble(arg));
+        break;
+      default:
+        LOG(FATAL) << "Unexpected shorty character: " << parameter.type;
+        UNREACHABLE();
+    }
+    return true;
+  }
+
   bool BuildArgArrayFromObjectArray(ObjPtr<mirror::Object> receiver,
                                     ObjPtr<mirror::ObjectArray<mirror::Object>> raw_args,
                                     ArtMethod* m,
+                                    const ReflectiveInvokeStub* stub,
                                     Thread* self)
       REQUIRES_SHARED(Locks::mutator_lock_) {
     const dex::TypeList* classes = m->GetParameterTypeList();
@@ -238,6 +288,9 @@ class ArgArray {
         hs.NewHandle<mirror::ObjectArray<mirror::Object>>(raw_args));
     for (size_t i = 1, args_offset = 0; i < shorty_len_; ++i, ++args_offset) {
       arg.Assign(args->Get(args_offset));
+      if (stub != nullptr && TryAppendForStub(stub->GetParameter(args_offset), arg.Get())) {
+        continue;
+      }
       if (((shorty_[i] == 'L') && (arg != nullptr)) ||
           ((arg == nullptr && shorty_[i] != 'L'))) {
         // TODO: The method's parameter's type must have been previously resolved, yet
@@ -484,8 +537,10 @@ bool InvokeMethodImpl(const ScopedObjectAccessAlreadyRunnable& soa,
   // Invoke the method.
   uint32_t shorty_len = 0;
   *shorty = np_method->GetShorty(&shorty_len);
+  const ReflectiveInvokeStub* stub = ReflectiveInvokeStubCache::Get(soa.Self(), np_method);
+  DCHECK(stub == nullptr || stub->Matches(*shorty, shorty_len)) << np_method->PrettyMethod();
   ArgArray arg_array(*shorty, shorty_len);
-  if (!arg_array.BuildArgArrayFromObjectArray(receiver, objects, np_method, soa.Self())) {
+  if (!arg_array.BuildArgArrayFromObjectArray(receiver, objects, np_method, stub, soa.Self())) {
     CHECK(soa.Self()->IsExceptionPending());
     return false;
   }
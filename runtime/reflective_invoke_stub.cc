@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "reflective_invoke_stub.h"
+
+#include <string.h>
+
+#include "art_method-inl.h"
+#include "class_linker.h"
+#include "dex/dex_file-inl.h"
+#include "dex/primitive.h"
+#include "mirror/class-inl.h"
+#include "runtime.h"
+#include "thread-current-inl.h"
+
+namespace art {
+
+std::atomic<uint32_t> ReflectiveInvokeStubCache::generation_(0u);
+
+bool ReflectiveInvokeStub::Matches(const char* shorty, uint32_t shorty_len) const {
+  return shorty_len == shorty_len_ && memcmp(shorty, shorty_, shorty_len) == 0;
+}
+
+bool ReflectiveInvokeStub::Init(ArtMethod* method) {
+  uint32_t shorty_len = 0u;
+  const char* shorty = method->GetShorty(&shorty_len);
+  if (shorty_len - 1u > kMaxParameters) {
+    return false;
+  }
+  const dex::TypeList* types = method->GetParameterTypeList();
+  const DexFile* dex_file = method->GetDexFile();
+  Thread* self = Thread::Current();
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  for (size_t i = 0; i + 1u < shorty_len; ++i) {
+    Parameter& parameter = parameters_[i];
+    parameter.type = shorty[i + 1u];
+    parameter.accepts_any_object = false;
+    parameter.box_value_field = nullptr;
+    if (parameter.type == 'L') {
+      const char* descriptor = dex_file->StringByTypeIdx(types->GetTypeItem(i).type_idx_);
+      parameter.accepts_any_object = strcmp(descriptor, "Ljava/lang/Object;") == 0;
+    } else {
+      // Box classes are in the boot class path, so their fields are never freed.
+      const char* box_descriptor = Primitive::BoxedDescriptor(Primitive::GetType(parameter.type));
+      ObjPtr<mirror::Class> box_class =
+          class_linker->LookupClass(self, box_descriptor, /*class_loader=*/ nullptr);
+      if (box_class == nullptr) {
+        return false;
+      }
+      // The generic conversion also expects the value to be the only instance field.
+      parameter.box_value_field = box_class->GetInstanceField(0);
+    }
+  }
+  memcpy(shorty_, shorty, shorty_len);
+  shorty_len_ = shorty_len;
+  return true;
+}
+
+ReflectiveInvokeStubCache::ReflectiveInvokeStubCache()
+    : seen_generation_(generation_.load(std::memory_order_acquire)) {}
+
+const ReflectiveInvokeStub* ReflectiveInvokeStubCache::Get(Thread* self, ArtMethod* method) {
+  ReflectiveInvokeStubCache* cache = self->GetReflectiveInvokeStubCache();
+  uint32_t generation = generation_.load(std::memory_order_acquire);
+  if (UNLIKELY(generation != cache->seen_generation_)) {
+    cache->entries_.fill(Entry());
+    cache->seen_generation_ = generation;
+  }
+  Entry& entry = cache->entries_[IndexOf(method)];
+  if (entry.method != method) {
+    entry.method = method;
+    entry.hotness = 0u;
+    entry.state = State::kCounting;
+  }
+  if (LIKELY(entry.state == State::kReady)) {
+    return &entry.stub;
+  }
+  if (entry.state == State::kCounting && ++entry.hotness == kHotnessThreshold) {
+    if (entry.stub.Init(method)) {
+      entry.state = State::kReady;
+      return &entry.stub;
+    }
+    entry.state = State::kUnsupported;
+  }
+  return nullptr;
+}
+
+}  // namespace art
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_REFLECTIVE_INVOKE_STUB_H_
+#define ART_RUNTIME_REFLECTIVE_INVOKE_STUB_H_
+
+#include <array>
+#include <atomic>
+
+#include "base/bit_utils.h"
+#include "base/locks.h"
+#include "base/macros.h"
+
+namespace art {
+
+class ArtField;
+class ArtMethod;
+class Thread;
+
+// Argument conversion specialized for a hot target of Method.invoke() and
+// Constructor.newInstance().
+//
+// The generic conversion resolves the type of each reference parameter and compares the class
+// descriptor of each boxed argument with the descriptors of all box types the parameter accepts.
+// A stub records which reference parameters accept any object and the `value` field of the box
+// class of each primitive parameter, so that arguments of the exact expected types are checked
+// and unboxed with a single class comparison. Other arguments, including those that need
+// widening or fail the conversion, still take the generic path.
+class ReflectiveInvokeStub {
+ public:
+  static constexpr size_t kMaxParameters = 8;
+
+  struct Parameter {
+    // Shorty character of the parameter type.
+    char type;
+    // For a reference parameter, whether its type is java.lang.Object.
+    bool accepts_any_object;
+    // For a primitive parameter, the `value` field of the box class of its type.
+    ArtField* box_value_field;
+  };
+
+  const Parameter& GetParameter(size_t index) const {
+    DCHECK_LT(index + 1u, shorty_len_);
+    return parameters_[index];
+  }
+
+  // Returns whether the stub was built for a method with the given shorty.
+  bool Matches(const char* shorty, uint32_t shorty_len) const;
+
+ private:
+  // Returns false if the method cannot have a stub.
+  bool Init(ArtMethod* method) REQUIRES_SHARED(Locks::mutator_lock_);
+
+  uint32_t shorty_len_ = 0u;
+  char shorty_[kMaxParameters + 1u];
+  Parameter parameters_[kMaxParameters];
+
+  friend class ReflectiveInvokeStubCache;
+};
+
+// Thread-local cache of reflective invoke stubs. A stub is built once the target method was
+// invoked reflectively kHotnessThreshold times by the thread.
+//
+// The cache is keyed by ArtMethod*, so InvalidateAll() must be called before the memory of
+// unloaded methods can be reused. All operations must be done from the owning thread.
+class ReflectiveInvokeStubCache {
+ public:
+  static constexpr size_t kNumEntries = 16;
+  static constexpr uint32_t kHotnessThreshold = 16u;
+
+  ReflectiveInvokeStubCache();
+
+  // Returns the stub for `method` if it is hot, otherwise counts the call and returns null.
+  static const ReflectiveInvokeStub* Get(Thread* self, ArtMethod* method)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Invalidate the caches of all threads. Each cache is cleared on its next use.
+  static void InvalidateAll() {
+    generation_.fetch_add(1u, std::memory_order_release);
+  }
+
+ private:
+  enum class State : uint8_t {
+    kCounting,
+    kReady,
+    kUnsupported,
+  };
+
+  struct Entry {
+    ArtMethod* method = nullptr;
+    uint32_t hotness = 0u;
+    State state = State::kCounting;
+    ReflectiveInvokeStub stub;
+  };
+
+  static ALWAYS_INLINE size_t IndexOf(ArtMethod* method) {
+    static_assert(IsPowerOfTwo(kNumEntries), "Size must be power of two");
+    return (reinterpret_cast<uintptr_t>(method) >> 5) & (kNumEntries - 1);
+  }
+
+  static std::atomic<uint32_t> generation_;
+
+  uint32_t seen_generation_;
+  std::array<Entry, kNumEntries> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReflectiveInvokeStubCache);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_REFLECTIVE_INVOKE_STUB_H_
@@ -69,6 +69,7 @@
 #include "base/utils.h"
 #include "class_linker-inl.h"
 #include "class_root-inl.h"
+#include "code_info_cache.h"
 #include "compiler_callbacks.h"
 #include "debugger.h"
 #include "dex/art_dex_file_loader.h"
@@ -78,6 +79,7 @@
 #include "experimental_flags.h"
 #include "fault_handler.h"
 #include "gc/accounting/card_table-inl.h"
+#include "gc/finalizer_pool.h"
 #include "gc/heap.h"
 #include "gc/scoped_gc_critical_section.h"
 #include "gc/space/image_space.h"
@@ -89,7 +91,9 @@
 #include "image-inl.h"
 #include "instrumentation.h"
 #include "intern_table-inl.h"
+#include "interpreter/instruction_pair_histogram.h"
 #include "interpreter/interpreter.h"
+#include "interpreter/method_interpreter_cache.h"
 #include "jit/jit.h"
 #include "jit/jit_code_cache.h"
 #include "jit/profile_saver.h"
@@ -161,6 +165,7 @@
 #include "sigchain.h"
 #include "signal_catcher.h"
 #include "signal_set.h"
+#include "stack_trace_intern_table.h"
 #include "thread.h"
 #include "thread_list.h"
 #include "ti/agent.h"
@@ -377,6 +382,14 @@ Runtime::~Runtime() {
         << "\n";
   }
 
+  if (heap_ != nullptr && heap_->GetAllocationSampler() != nullptr) {
+    heap_->GetAllocationSampler()->WriteProfile(self);
+  }
+
+  if (instruction_pair_histogram_ != nullptr) {
+    instruction_pair_histogram_->WriteToFile();
+  }
+
   // Wait for the workers of thread pools to be created since there can't be any
   // threads attaching during shutdown.
   WaitForThreadPoolWorkersToStart();
@@ -391,6 +404,10 @@ Runtime::~Runtime() {
     // as shutting down as some tasks may require mutator access.
     jit_->DeleteThreadPool();
   }
+  if (heap_ != nullptr && heap_->GetFinalizerPool() != nullptr) {
+    // Finalizers still queued are not run, like the ones left to the FinalizerDaemon.
+    heap_->GetFinalizerPool()->Stop(self);
+  }
   if (oat_file_manager_ != nullptr) {
     oat_file_manager_->WaitForWorkersToBeCreated();
   }
@@ -1051,6 +1068,9 @@ void Runtime::InitNonZygoteOrPostFork(
 
   // Create the thread pools.
   heap_->CreateThreadPool();
+  if (heap_->GetFinalizerPool() != nullptr) {
+    heap_->GetFinalizerPool()->Start(Thread::Current());
+  }
   // Avoid creating the runtime thread pool for system server since it will not be used and would
   // waste memory.
   if (!is_system_server) {
@@ -1354,6 +1374,9 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
   if (runtime_options.GetOrDefault(Opt::Interpret)) {
     GetInstrumentation()->ForceInterpretOnly();
   }
+  if (runtime_options.GetOrDefault(Opt::MethodEntryExitHooks)) {
+    GetInstrumentation()->EnableEntryExitHooksInJitCode();
+  }
 
   zygote_max_failed_boots_ = runtime_options.GetOrDefault(Opt::ZygoteMaxFailedBoots);
   experimental_flags_ = runtime_options.GetOrDefault(Opt::Experimental);
@@ -1429,7 +1452,8 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
                        runtime_options.GetOrDefault(Opt::HSpaceCompactForOOMMinIntervalsMs),
                        runtime_options.Exists(Opt::DumpRegionInfoBeforeGC),
                        runtime_options.Exists(Opt::DumpRegionInfoAfterGC),
-                       image_space_loading_order_);
+                       image_space_loading_order_,
+                       runtime_options.GetOrDefault(Opt::NumaAwareRegions));
 
   if (!heap_->HasBootImageSpace() && !allow_dex_file_fallback_) {
     LOG(ERROR) << "Dex file fallback disabled, cannot continue without image.";
@@ -1566,6 +1590,35 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
 
   self->SetIsRuntimeThread(IsAotCompiler());
 
+  if (runtime_options.GetOrDefault(Opt::DedupeStackTraces) && !IsAotCompiler()) {
+    stack_trace_intern_table_.reset(new StackTraceInternTable());
+    AddSystemWeakHolder(stack_trace_intern_table_.get());
+  }
+
+  if (!runtime_options.GetOrDefault(Opt::InterpreterPairHistogramFile).empty() &&
+      !IsAotCompiler()) {
+    instruction_pair_histogram_.reset(new interpreter::InstructionPairHistogram(
+        runtime_options.GetOrDefault(Opt::InterpreterPairHistogramFile)));
+  }
+
+  if (runtime_options.GetOrDefault(Opt::InterpreterMethodCaches) && !IsAotCompiler()) {
+    method_interpreter_caches_.reset(new interpreter::MethodInterpreterCaches());
+  }
+
+  if (runtime_options.GetOrDefault(Opt::AllocationSampleInterval) != 0u && !IsAotCompiler()) {
+    heap_->EnableAllocationSampling(runtime_options.GetOrDefault(Opt::AllocationSampleInterval),
+                                    runtime_options.GetOrDefault(Opt::AllocationProfileFile));
+  }
+
+  if (runtime_options.GetOrDefault(Opt::FinalizerThreadCount) != 0u && !IsAotCompiler()) {
+    heap_->EnableFinalizerPool(runtime_options.GetOrDefault(Opt::FinalizerThreadCount),
+                               runtime_options.GetOrDefault(Opt::FinalizerBackpressureThreshold));
+  }
+
+  if (runtime_options.GetOrDefault(Opt::ElasticHeapIdleTime) != 0u && !IsAotCompiler()) {
+    heap_->EnableElasticHeap(runtime_options.GetOrDefault(Opt::ElasticHeapIdleTime));
+  }
+
   // Set us to runnable so tools using a runtime can allocate and GC by default
   self->TransitionFromSuspendedToRunnable();
 
@@ -2035,6 +2088,16 @@ void Runtime::DumpForSigQuit(std::ostream& os) {
   }
   DumpDeoptimizations(os);
   TrackedAllocators::Dump(os);
+  CodeInfoCache::DumpStats(os);
+  if (stack_trace_intern_table_ != nullptr) {
+    stack_trace_intern_table_->DumpForSigQuit(os);
+  }
+  if (instruction_pair_histogram_ != nullptr) {
+    instruction_pair_histogram_->DumpForSigQuit(os);
+  }
+  if (method_interpreter_caches_ != nullptr) {
+    method_interpreter_caches_->DumpForSigQuit(os);
+  }
   os << "\n";
 
   thread_list_->DumpForSigQuit(os);
@@ -2223,6 +2286,9 @@ void Runtime::VisitTransactionRoots(RootVisitor* visitor) {
 
 void Runtime::VisitNonThreadRoots(RootVisitor* visitor) {
   java_vm_->VisitRoots(visitor);
+  if (heap_->GetFinalizerPool() != nullptr) {
+    heap_->GetFinalizerPool()->VisitRoots(visitor);
+  }
   sentinel_.VisitRootIfNonNull(visitor, RootInfo(kRootVMInternal));
   pre_allocated_OutOfMemoryError_when_throwing_exception_
       .VisitRootIfNonNull(visitor, RootInfo(kRootVMInternal));
@@ -58,6 +58,11 @@ namespace hiddenapi {
 enum class EnforcementPolicy;
 }  // namespace hiddenapi
 
+namespace interpreter {
+class InstructionPairHistogram;
+class MethodInterpreterCaches;
+}  // namespace interpreter
+
 namespace jit {
 class Jit;
 class JitCodeCache;
@@ -104,6 +109,7 @@ struct RuntimeArgumentMap;
 class RuntimeCallbacks;
 class SignalCatcher;
 class StackOverflowHandler;
+class StackTraceInternTable;
 class SuspensionHandler;
 class ThreadList;
 class ThreadPool;
@@ -317,6 +323,24 @@ class Runtime {
     return java_vm_.get();
   }
 
+  // Returns the table for sharing identical internal stack traces, or null if
+  // -XX:DedupeStackTraces is not enabled.
+  StackTraceInternTable* GetStackTraceInternTable() const {
+    return stack_trace_intern_table_.get();
+  }
+
+  // Returns the histogram of interpreted instruction pairs, or null if
+  // -XX:InterpreterPairHistogramFile is not set.
+  interpreter::InstructionPairHistogram* GetInstructionPairHistogram() const {
+    return instruction_pair_histogram_.get();
+  }
+
+  // Returns the per-method interpreter caches, or null if -XX:InterpreterMethodCaches is not
+  // enabled.
+  interpreter::MethodInterpreterCaches* GetMethodInterpreterCaches() const {
+    return method_interpreter_caches_.get();
+  }
+
   size_t GetMaxSpinsBeforeThinLockInflation() const {
     return max_spins_before_thin_lock_inflation_;
   }
@@ -1126,6 +1150,12 @@ class Runtime {
 
   std::unique_ptr<JavaVMExt> java_vm_;
 
+  std::unique_ptr<StackTraceInternTable> stack_trace_intern_table_;
+
+  std::unique_ptr<interpreter::InstructionPairHistogram> instruction_pair_histogram_;
+
+  std::unique_ptr<interpreter::MethodInterpreterCaches> method_interpreter_caches_;
+
   std::unique_ptr<jit::Jit> jit_;
   std::unique_ptr<jit::JitCodeCache> jit_code_cache_;
   std::unique_ptr<jit::JitOptions> jit_options_;
@@ -36,6 +36,7 @@
 #include "base/time_utils.h"
 #include "base/utils.h"
 #include "class_linker.h"
+#include "gc/allocation_sampler.h"
 #include "gc/heap.h"
 #include "jit/profile_saver.h"
 #include "palette/palette.h"
@@ -146,6 +147,11 @@ void SignalCatcher::HandleSigUsr1() {
   LOG(INFO) << "SIGUSR1 forcing GC (no HPROF) and profile save";
   Runtime::Current()->GetHeap()->CollectGarbage(/* clear_soft_references= */ false);
   ProfileSaver::ForceProcessProfiles();
+  gc::AllocationSampler* allocation_sampler = Runtime::Current()->GetHeap()->GetAllocationSampler();
+  if (allocation_sampler != nullptr) {
+    LOG(INFO) << "SIGUSR1 writing the allocation profile";
+    allocation_sampler->WriteProfile(Thread::Current());
+  }
 }
 
 int SignalCatcher::WaitForSignal(Thread* self, SignalSet& signals) {
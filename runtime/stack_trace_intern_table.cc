@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stack_trace_intern_table.h"
+
+#include <algorithm>
+#include <functional>
+#include <ostream>
+#include <unordered_set>
+#include <vector>
+
+#include "gc_root-inl.h"
+#include "mirror/object-inl.h"
+#include "thread-current-inl.h"
+
+namespace art {
+
+StackTraceInternTable::Shard::Shard()
+    : gc::SystemWeakHolder(kStackTraceInternTableLock),
+      next_node_(kRootNode + 1u),
+      hits_(0u),
+      misses_(0u),
+      resets_(0u) {}
+
+uint32_t StackTraceInternTable::Shard::FindNode(ArrayRef<const Frame> frames, bool create) {
+  uint32_t node = kRootNode;
+  // Start from the outermost frame so that traces with a common caller share the prefix.
+  for (size_t i = frames.size(); i != 0u; ) {
+    --i;
+    NodeKey key = { node, frames[i].second, frames[i].first };
+    auto it = nodes_.find(key);
+    if (it != nodes_.end()) {
+      node = it->second;
+    } else if (create) {
+      node = next_node_;
+      ++next_node_;
+      nodes_.emplace(key, node);
+    } else {
+      return kNoNode;
+    }
+  }
+  return node;
+}
+
+ObjPtr<mirror::Object> StackTraceInternTable::Shard::Lookup(Thread* self,
+                                                            ArrayRef<const Frame> frames) {
+  MutexLock mu(self, allow_disallow_lock_);
+  Wait(self);
+  uint32_t node = FindNode(frames, /*create=*/ false);
+  if (node != kNoNode) {
+    auto it = traces_.find(node);
+    if (it != traces_.end()) {
+      ++hits_;
+      return it->second.Read();
+    }
+  }
+  ++misses_;
+  return nullptr;
+}
+
+void StackTraceInternTable::Shard::Insert(Thread* self,
+                                          ArrayRef<const Frame> frames,
+                                          ObjPtr<mirror::Object> trace) {
+  DCHECK(trace != nullptr);
+  MutexLock mu(self, allow_disallow_lock_);
+  Wait(self);
+  if (nodes_.size() + frames.size() > kMaxNodesPerShard) {
+    // Existing trace objects remain valid, they just will not be shared anymore.
+    nodes_.clear();
+    traces_.clear();
+    next_node_ = kRootNode + 1u;
+    ++resets_;
+  }
+  uint32_t node = FindNode(frames, /*create=*/ true);
+  // Another thread may have inserted a trace for the same frames. Keep the older one.
+  traces_.emplace(node, GcRoot<mirror::Object>(trace));
+}
+
+void StackTraceInternTable::Shard::Sweep(IsMarkedVisitor* visitor) {
+  MutexLock mu(Thread::Current(), allow_disallow_lock_);
+  size_t old_num_traces = traces_.size();
+  for (auto it = traces_.begin(); it != traces_.end(); ) {
+    mirror::Object* old_trace = it->second.Read<kWithoutReadBarrier>();
+    mirror::Object* new_trace = visitor->IsMarked(old_trace);
+    if (new_trace == nullptr) {
+      it = traces_.erase(it);
+    } else {
+      if (new_trace != old_trace) {
+        it->second = GcRoot<mirror::Object>(new_trace);
+      }
+      ++it;
+    }
+  }
+  if (traces_.size() != old_num_traces) {
+    RemoveUnusedNodes();
+  }
+}
+
+void StackTraceInternTable::Shard::RemoveUnusedNodes() {
+  if (traces_.empty()) {
+    nodes_.clear();
+    next_node_ = kRootNode + 1u;
+    return;
+  }
+  // Visit the nodes from the innermost frames out, a node is used if one of its children is.
+  std::vector<std::pair<uint32_t, uint32_t>> parents;  // Node and parent.
+  parents.reserve(nodes_.size());
+  for (const auto& entry : nodes_) {
+    parents.emplace_back(entry.second, entry.first.parent);
+  }
+  std::sort(parents.begin(), parents.end(), std::greater<>());
+  std::unordered_set<uint32_t> used_nodes;
+  for (const auto& entry : traces_) {
+    used_nodes.insert(entry.first);
+  }
+  for (const auto& [node, parent] : parents) {
+    if (used_nodes.find(node) != used_nodes.end()) {
+      used_nodes.insert(parent);
+    }
+  }
+  for (auto it = nodes_.begin(); it != nodes_.end(); ) {
+    if (used_nodes.find(it->second) == used_nodes.end()) {
+      it = nodes_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void StackTraceInternTable::Shard::AddStats(Stats* stats) {
+  MutexLock mu(Thread::Current(), allow_disallow_lock_);
+  stats->traces += traces_.size();
+  stats->nodes += nodes_.size();
+  stats->hits += hits_;
+  stats->misses += misses_;
+  stats->resets += resets_;
+}
+
+StackTraceInternTable::Shard& StackTraceInternTable::GetShard(ArrayRef<const Frame> frames) {
+  if (frames.empty()) {
+    return shards_[0];
+  }
+  // Select the shard by the outermost frame, the root of the trie, so that traces which share
+  // a prefix also share the trie nodes. ArtMethods are aligned, mix in the higher bits.
+  size_t hash = reinterpret_cast<uintptr_t>(frames.back().first);
+  hash ^= hash >> 16;
+  hash ^= hash >> 6;
+  return shards_[hash % kNumShards];
+}
+
+void StackTraceInternTable::Allow() {
+  for (Shard& shard : shards_) {
+    shard.Allow();
+  }
+}
+
+void StackTraceInternTable::Disallow() {
+  for (Shard& shard : shards_) {
+    shard.Disallow();
+  }
+}
+
+void StackTraceInternTable::Broadcast(bool broadcast_for_checkpoint) {
+  for (Shard& shard : shards_) {
+    shard.Broadcast(broadcast_for_checkpoint);
+  }
+}
+
+void StackTraceInternTable::Sweep(IsMarkedVisitor* visitor) {
+  for (Shard& shard : shards_) {
+    shard.Sweep(visitor);
+  }
+}
+
+void StackTraceInternTable::DumpForSigQuit(std::ostream& os) {
+  Stats stats;
+  for (Shard& shard : shards_) {
+    shard.AddStats(&stats);
+  }
+  os << "Stack trace intern table: " << stats.traces << " traces " << stats.nodes
+     << " nodes; " << stats.hits << " hits " << stats.misses << " misses " << stats.resets
+     << " resets\n";
+}
+
+}  // namespace art
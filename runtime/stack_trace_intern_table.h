@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_STACK_TRACE_INTERN_TABLE_H_
+#define ART_RUNTIME_STACK_TRACE_INTERN_TABLE_H_
+
+#include <array>
+#include <iosfwd>
+#include <unordered_map>
+#include <utility>
+
+#include "base/array_ref.h"
+#include "base/locks.h"
+#include "base/macros.h"
+#include "gc/system_weak.h"
+#include "gc_root.h"
+#include "obj_ptr.h"
+
+namespace art {
+
+class ArtMethod;
+class IsMarkedVisitor;
+
+namespace mirror {
+class Object;
+}  // namespace mirror
+
+// Table of internal stack traces (see Thread::CreateInternalStackTrace()) that lets threads
+// which capture identical stack traces share a single trace object instead of allocating new
+// method and dex pc arrays for each exception.
+//
+// The frames are interned in a trie of stack prefixes rooted at the outermost frame, so that
+// the many traces that only differ in their innermost frames share most of the nodes. Each
+// trie node that ends a captured trace weakly holds the trace object. Internal stack traces
+// are immutable and hold the declaring classes of their methods, so a live trace guarantees
+// that the ArtMethod* keys on its path are still valid.
+//
+// The table is split into shards selected by the method of the outermost frame, each with its
+// own trie and lock. All traces with the same outermost frame land in the same trie and share
+// their common prefix, while threads started from different entry points rarely contend. When
+// the GC sweeps the table, the nodes that no longer lead to a live trace are removed. The number
+// of nodes of a shard is bounded, and a shard that reaches the bound between two GCs is dropped.
+class StackTraceInternTable : public gc::AbstractSystemWeakHolder {
+ public:
+  using Frame = std::pair<ArtMethod*, uint32_t>;  // Method and dex pc.
+
+  StackTraceInternTable() {}
+
+  // Returns the trace previously inserted for `frames`, or null if there is none.
+  ObjPtr<mirror::Object> Lookup(Thread* self, ArrayRef<const Frame> frames)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    return GetShard(frames).Lookup(self, frames);
+  }
+
+  // Records `trace` as the internal stack trace for `frames`.
+  void Insert(Thread* self, ArrayRef<const Frame> frames, ObjPtr<mirror::Object> trace)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    GetShard(frames).Insert(self, frames, trace);
+  }
+
+  void Allow() override REQUIRES_SHARED(Locks::mutator_lock_);
+  void Disallow() override REQUIRES_SHARED(Locks::mutator_lock_);
+  void Broadcast(bool broadcast_for_checkpoint) override;
+  void Sweep(IsMarkedVisitor* visitor) override REQUIRES_SHARED(Locks::mutator_lock_);
+
+  void DumpForSigQuit(std::ostream& os);
+
+ private:
+  struct NodeKey {
+    uint32_t parent;
+    uint32_t dex_pc;
+    ArtMethod* method;
+
+    bool operator==(const NodeKey& other) const {
+      return parent == other.parent && dex_pc == other.dex_pc && method == other.method;
+    }
+  };
+
+  struct NodeKeyHash {
+    size_t operator()(const NodeKey& key) const {
+      size_t hash = reinterpret_cast<uintptr_t>(key.method);
+      hash = hash * 31u + key.dex_pc;
+      hash = hash * 31u + key.parent;
+      return hash;
+    }
+  };
+
+  struct Stats {
+    size_t traces = 0u;
+    size_t nodes = 0u;
+    size_t hits = 0u;
+    size_t misses = 0u;
+    size_t resets = 0u;
+  };
+
+  class Shard : public gc::SystemWeakHolder {
+   public:
+    Shard();
+
+    ObjPtr<mirror::Object> Lookup(Thread* self, ArrayRef<const Frame> frames)
+        REQUIRES_SHARED(Locks::mutator_lock_)
+        REQUIRES(!allow_disallow_lock_);
+
+    void Insert(Thread* self, ArrayRef<const Frame> frames, ObjPtr<mirror::Object> trace)
+        REQUIRES_SHARED(Locks::mutator_lock_)
+        REQUIRES(!allow_disallow_lock_);
+
+    // Removes the dead traces and the nodes that do not lead to a live trace anymore.
+    void Sweep(IsMarkedVisitor* visitor) override
+        REQUIRES_SHARED(Locks::mutator_lock_)
+        REQUIRES(!allow_disallow_lock_);
+
+    void AddStats(Stats* stats) REQUIRES(!allow_disallow_lock_);
+
+   private:
+    // Returns the node for the `frames`, creating missing nodes if `create` is true.
+    // Returns kNoNode if `create` is false and the trie does not contain `frames`.
+    uint32_t FindNode(ArrayRef<const Frame> frames, bool create) REQUIRES(allow_disallow_lock_);
+
+    void RemoveUnusedNodes() REQUIRES(allow_disallow_lock_);
+
+    std::unordered_map<NodeKey, uint32_t, NodeKeyHash> nodes_ GUARDED_BY(allow_disallow_lock_);
+    std::unordered_map<uint32_t, GcRoot<mirror::Object>> traces_
+        GUARDED_BY(allow_disallow_lock_);
+    // Nodes are numbered in creation order, so a parent always has a lower number than its
+    // children.
+    uint32_t next_node_ GUARDED_BY(allow_disallow_lock_);
+
+    size_t hits_ GUARDED_BY(allow_disallow_lock_);
+    size_t misses_ GUARDED_BY(allow_disallow_lock_);
+    size_t resets_ GUARDED_BY(allow_disallow_lock_);
+
+    DISALLOW_COPY_AND_ASSIGN(Shard);
+  };
+
+  static constexpr uint32_t kRootNode = 0u;
+  static constexpr uint32_t kNoNode = static_cast<uint32_t>(-1);
+  static constexpr size_t kNumShards = 16;
+  static constexpr size_t kMaxNodesPerShard = 64 * 1024 / kNumShards;
+
+  Shard& GetShard(ArrayRef<const Frame> frames);
+
+  std::array<Shard, kNumShards> shards_;
+
+  friend class StackTraceInternTableTest;
+
+  DISALLOW_COPY_AND_ASSIGN(StackTraceInternTable);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_STACK_TRACE_INTERN_TABLE_H_
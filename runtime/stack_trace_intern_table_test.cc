@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stack_trace_intern_table.h"
+
+#include <vector>
+
+#include "art_method-inl.h"
+#include "class_linker.h"
+#include "common_runtime_test.h"
+#include "handle_scope-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/string.h"
+#include "scoped_thread_state_change-inl.h"
+
+namespace art {
+
+class StackTraceInternTableTest : public CommonRuntimeTest {
+ protected:
+  using Frame = StackTraceInternTable::Frame;
+
+  static size_t GetNumNodes(StackTraceInternTable* table) {
+    StackTraceInternTable::Stats stats;
+    for (StackTraceInternTable::Shard& shard : table->shards_) {
+      shard.AddStats(&stats);
+    }
+    return stats.nodes;
+  }
+};
+
+// Reports a single object as dead.
+class DeadObjectVisitor : public IsMarkedVisitor {
+ public:
+  explicit DeadObjectVisitor(mirror::Object* dead) : dead_(dead) {}
+
+  mirror::Object* IsMarked(mirror::Object* obj) override REQUIRES_SHARED(Locks::mutator_lock_) {
+    return (obj == dead_) ? nullptr : obj;
+  }
+
+ private:
+  mirror::Object* const dead_;
+};
+
+TEST_F(StackTraceInternTableTest, LookupAndSweep) {
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  StackHandleScope<3> hs(self);
+  Handle<mirror::Class> klass =
+      hs.NewHandle(class_linker_->FindSystemClass(self, "Ljava/lang/Object;"));
+  ASSERT_TRUE(klass != nullptr);
+  ArtMethod* outer =
+      klass->FindClassMethod("toString", "()Ljava/lang/String;", kRuntimePointerSize);
+  ArtMethod* inner = klass->FindClassMethod("hashCode", "()I", kRuntimePointerSize);
+  ASSERT_TRUE(outer != nullptr);
+  ASSERT_TRUE(inner != nullptr);
+  // Frames are innermost first. Both traces share the outer frame.
+  const std::vector<Frame> frames1 = { { inner, 1u }, { outer, 0u } };
+  const std::vector<Frame> frames2 = { { inner, 2u }, { outer, 0u } };
+  Handle<mirror::String> trace1 = hs.NewHandle(mirror::String::AllocFromModifiedUtf8(self, "1"));
+  Handle<mirror::String> trace2 = hs.NewHandle(mirror::String::AllocFromModifiedUtf8(self, "2"));
+  ASSERT_TRUE(trace1 != nullptr);
+  ASSERT_TRUE(trace2 != nullptr);
+
+  StackTraceInternTable table;
+  EXPECT_TRUE(table.Lookup(self, ArrayRef<const Frame>(frames1)) == nullptr);
+  table.Insert(self, ArrayRef<const Frame>(frames1), trace1.Get());
+  table.Insert(self, ArrayRef<const Frame>(frames2), trace2.Get());
+  EXPECT_OBJ_PTR_EQ(trace1.Get(), table.Lookup(self, ArrayRef<const Frame>(frames1)));
+  EXPECT_OBJ_PTR_EQ(trace2.Get(), table.Lookup(self, ArrayRef<const Frame>(frames2)));
+  // A prefix of a trace is not a trace.
+  EXPECT_TRUE(table.Lookup(self, ArrayRef<const Frame>(frames1).SubArray(1u)) == nullptr);
+  // Traces with the same outermost frame are in the same trie and share the outer node.
+  EXPECT_EQ(3u, GetNumNodes(&table));
+
+  // Sweeping removes the dead trace and the nodes that only led to it.
+  DeadObjectVisitor visitor(trace1.Get());
+  table.Sweep(&visitor);
+  EXPECT_TRUE(table.Lookup(self, ArrayRef<const Frame>(frames1)) == nullptr);
+  EXPECT_OBJ_PTR_EQ(trace2.Get(), table.Lookup(self, ArrayRef<const Frame>(frames2)));
+  EXPECT_EQ(2u, GetNumNodes(&table));
+
+  DeadObjectVisitor visitor2(trace2.Get());
+  table.Sweep(&visitor2);
+  EXPECT_TRUE(table.Lookup(self, ArrayRef<const Frame>(frames2)) == nullptr);
+  EXPECT_EQ(0u, GetNumNodes(&table));
+}
+
+}  // namespace art
@@ -57,6 +57,7 @@
 #include "base/utils.h"
 #include "class_linker-inl.h"
 #include "class_root-inl.h"
+#include "code_info_cache.h"
 #include "debugger.h"
 #include "dex/descriptors_names.h"
 #include "dex/dex_file-inl.h"
@@ -66,6 +67,7 @@
 #include "entrypoints/quick/quick_alloc_entrypoints.h"
 #include "gc/accounting/card_table-inl.h"
 #include "gc/accounting/heap_bitmap-inl.h"
+#include "gc/allocation_sampler.h"
 #include "gc/allocator/rosalloc.h"
 #include "gc/heap.h"
 #include "gc/space/space-inl.h"
@@ -74,6 +76,7 @@
 #include "indirect_reference_table-inl.h"
 #include "instrumentation.h"
 #include "interpreter/interpreter.h"
+#include "interpreter/method_interpreter_cache.h"
 #include "interpreter/mterp/mterp.h"
 #include "interpreter/shadow_frame-inl.h"
 #include "java_frame_root_info.h"
@@ -100,12 +103,14 @@
 #include "read_barrier-inl.h"
 #include "reflection.h"
 #include "reflective_handle_scope-inl.h"
+#include "reflective_invoke_stub.h"
 #include "runtime-inl.h"
 #include "runtime.h"
 #include "runtime_callbacks.h"
 #include "scoped_thread_state_change-inl.h"
 #include "stack.h"
 #include "stack_map.h"
+#include "stack_trace_intern_table.h"
 #include "thread-inl.h"
 #include "thread_list.h"
 #include "verifier/method_verifier.h"
@@ -2446,6 +2451,9 @@ void Thread::Destroy() {
   {
     ScopedObjectAccess soa(self);
     Runtime::Current()->GetHeap()->RevokeThreadLocalBuffers(this);
+    if (allocation_sample_buffer_ != nullptr) {
+      Runtime::Current()->GetHeap()->GetAllocationSampler()->Flush(allocation_sample_buffer_.get());
+    }
   }
   // Mark-stack revocation must be performed at the very end. No
   // checkpoint/flip-function or read-barrier should be called after this.
@@ -2826,34 +2834,55 @@ jobject Thread::CreateInternalStackTrace(const ScopedObjectAccessAlreadyRunnable
   const uint32_t depth = count_visitor.GetDepth();
   const uint32_t skip_depth = count_visitor.GetSkipDepth();
 
-  // Build internal stack trace.
-  BuildInternalStackTraceVisitor<kTransactionActive> build_trace_visitor(soa.Self(),
-                                                                         const_cast<Thread*>(this),
-                                                                         skip_depth);
-  if (!build_trace_visitor.Init(depth)) {
-    return nullptr;  // Allocation failed.
-  }
-  // If we saved all of the frames we don't even need to do the actual stack walk. This is faster
-  // than doing the stack walk twice.
-  if (depth < kMaxSavedFrames) {
-    for (size_t i = 0; i < depth; ++i) {
-      build_trace_visitor.AddFrame(saved_frames[i].first, saved_frames[i].second);
+  // If enabled, share the trace with earlier identical stack traces. Transactions need
+  // a fresh trace so that it can be rolled back.
+  StackTraceInternTable* intern_table = Runtime::Current()->GetStackTraceInternTable();
+  const bool use_intern_table =
+      !kTransactionActive && intern_table != nullptr && depth < kMaxSavedFrames;
+  ArrayRef<const ArtMethodDexPcPair> frames(saved_frames.get(), depth);
+  if (use_intern_table) {
+    ObjPtr<mirror::Object> interned_trace = intern_table->Lookup(soa.Self(), frames);
+    if (interned_trace != nullptr) {
+      return soa.AddLocalReference<jobject>(interned_trace);
     }
-  } else {
-    build_trace_visitor.WalkStack();
   }
 
-  mirror::ObjectArray<mirror::Object>* trace = build_trace_visitor.GetInternalStackTrace();
-  if (kIsDebugBuild) {
-    ObjPtr<mirror::PointerArray> trace_methods = build_trace_visitor.GetTraceMethodsAndPCs();
-    // Second half of trace_methods is dex PCs.
-    for (uint32_t i = 0; i < static_cast<uint32_t>(trace_methods->GetLength() / 2); ++i) {
-      auto* method = trace_methods->GetElementPtrSize<ArtMethod*>(
-          i, Runtime::Current()->GetClassLinker()->GetImagePointerSize());
-      CHECK(method != nullptr);
+  jobject result;
+  {
+    // Build internal stack trace.
+    BuildInternalStackTraceVisitor<kTransactionActive> build_trace_visitor(
+        soa.Self(), const_cast<Thread*>(this), skip_depth);
+    if (!build_trace_visitor.Init(depth)) {
+      return nullptr;  // Allocation failed.
+    }
+    // If we saved all of the frames we don't even need to do the actual stack walk. This is
+    // faster than doing the stack walk twice.
+    if (depth < kMaxSavedFrames) {
+      for (size_t i = 0; i < depth; ++i) {
+        build_trace_visitor.AddFrame(saved_frames[i].first, saved_frames[i].second);
+      }
+    } else {
+      build_trace_visitor.WalkStack();
+    }
+
+    mirror::ObjectArray<mirror::Object>* trace = build_trace_visitor.GetInternalStackTrace();
+    if (kIsDebugBuild) {
+      ObjPtr<mirror::PointerArray> trace_methods = build_trace_visitor.GetTraceMethodsAndPCs();
+      // Second half of trace_methods is dex PCs.
+      for (uint32_t i = 0; i < static_cast<uint32_t>(trace_methods->GetLength() / 2); ++i) {
+        auto* method = trace_methods->GetElementPtrSize<ArtMethod*>(
+            i, Runtime::Current()->GetClassLinker()->GetImagePointerSize());
+        CHECK(method != nullptr);
+      }
     }
+    result = soa.AddLocalReference<jobject>(trace);
+  }
+  // Insert only after leaving the no-suspension region of the visitor since the intern table
+  // may need to wait for the GC to finish sweeping system weaks.
+  if (use_intern_table) {
+    intern_table->Insert(soa.Self(), frames, soa.Decode<mirror::Object>(result));
   }
-  return soa.AddLocalReference<jobject>(trace);
+  return result;
 }
 template jobject Thread::CreateInternalStackTrace<false>(
     const ScopedObjectAccessAlreadyRunnable& soa) const;
@@ -3477,6 +3506,8 @@ void Thread::DumpThreadOffset(std::ostream& os, uint32_t offset) {
   QUICK_ENTRY_POINT_INFO(pInvokeVirtualTrampolineWithAccessCheck)
   QUICK_ENTRY_POINT_INFO(pInvokePolymorphic)
   QUICK_ENTRY_POINT_INFO(pTestSuspend)
+  QUICK_ENTRY_POINT_INFO(pMethodEntryHook)
+  QUICK_ENTRY_POINT_INFO(pMethodExitHook)
   QUICK_ENTRY_POINT_INFO(pDeliverException)
   QUICK_ENTRY_POINT_INFO(pThrowArrayBounds)
   QUICK_ENTRY_POINT_INFO(pThrowDivZero)
@@ -3542,7 +3573,7 @@ void Thread::DumpThreadOffset(std::ostream& os, uint32_t offset) {
   os << offset;
 }
 
-void Thread::QuickDeliverException() {
+void Thread::QuickDeliverException(bool from_entry_exit_hook) {
   // Get exception from thread.
   ObjPtr<mirror::Throwable> exception = GetException();
   CHECK(exception != nullptr);
@@ -3630,7 +3661,7 @@ void Thread::QuickDeliverException() {
   // resolution.
   ClearException();
   QuickExceptionHandler exception_handler(this, false);
-  exception_handler.FindCatch(exception);
+  exception_handler.FindCatch(exception, /* skip_top_java_frame= */ from_entry_exit_hook);
   if (exception_handler.GetClearException()) {
     // Exception was cleared as part of delivery.
     DCHECK(!IsExceptionPending());
@@ -3821,10 +3852,12 @@ class ReferenceMapVisitor : public StackVisitor {
       StackReference<mirror::Object>* vreg_base =
           reinterpret_cast<StackReference<mirror::Object>*>(cur_quick_frame);
       uintptr_t native_pc_offset = method_header->NativeQuickPcOffset(GetCurrentQuickFramePc());
-      CodeInfo code_info = kPrecise
-          ? CodeInfo(method_header)  // We will need dex register maps.
-          : CodeInfo::DecodeGcMasksOnly(method_header);
-      StackMap map = code_info.GetStackMapForNativePcOffset(native_pc_offset);
+      CodeInfo code_info = CodeInfoCache::Decode(
+          method_header,
+          kPrecise ? CodeInfoCache::DecodeMode::kAllTables  // We will need dex register maps.
+                   : CodeInfoCache::DecodeMode::kGcMasksOnly);
+      StackMap map =
+          CodeInfoCache::GetStackMapForNativePcOffset(method_header, code_info, native_pc_offset);
       DCHECK(map.IsValid());
 
       T vreg_info(m, code_info, map, visitor_);
@@ -4067,6 +4100,9 @@ void Thread::VisitRoots(RootVisitor* visitor) {
   for (auto& entry : *GetInstrumentationStack()) {
     visitor->VisitRootIfNonNull(&entry.second.this_object_, RootInfo(kRootVMInternal, thread_id));
   }
+  if (allocation_sample_buffer_ != nullptr) {
+    allocation_sample_buffer_->VisitRoots(visitor, RootInfo(kRootVMInternal, thread_id));
+  }
 }
 
 void Thread::SweepInterpreterCache(IsMarkedVisitor* visitor) {
@@ -4299,13 +4335,66 @@ void Thread::SetReadBarrierEntrypoints() {
   UpdateReadBarrierEntrypoints(&tlsPtr_.quick_entrypoints, /* is_active=*/ true);
 }
 
+CodeInfoCache* Thread::GetCodeInfoCache() {
+  DCHECK(this == Thread::Current());
+  if (UNLIKELY(code_info_cache_ == nullptr)) {
+    code_info_cache_.reset(new CodeInfoCache());
+  }
+  return code_info_cache_.get();
+}
+
+ReflectiveInvokeStubCache* Thread::GetReflectiveInvokeStubCache() {
+  DCHECK(this == Thread::Current());
+  if (UNLIKELY(reflective_invoke_stub_cache_ == nullptr)) {
+    reflective_invoke_stub_cache_.reset(new ReflectiveInvokeStubCache());
+  }
+  return reflective_invoke_stub_cache_.get();
+}
+
+gc::AllocationSampleBuffer* Thread::GetAllocationSampleBuffer() {
+  DCHECK(this == Thread::Current());
+  if (UNLIKELY(allocation_sample_buffer_ == nullptr)) {
+    allocation_sample_buffer_.reset(new gc::AllocationSampleBuffer(
+        this, Runtime::Current()->GetHeap()->GetAllocationSampler()));
+  }
+  return allocation_sample_buffer_.get();
+}
+
 void Thread::ClearAllInterpreterCaches() {
-  static struct ClearInterpreterCacheClosure : Closure {
+  class ClearInterpreterCacheClosure : public Closure {
+   public:
+    explicit ClearInterpreterCacheClosure(Barrier* barrier) : barrier_(barrier) {}
+
     void Run(Thread* thread) override {
       thread->GetInterpreterCache()->Clear(thread);
+      if (barrier_ != nullptr) {
+        barrier_->Pass(Thread::Current());
+      }
     }
-  } closure;
-  Runtime::Current()->GetThreadList()->RunCheckpoint(&closure);
+
+   private:
+    Barrier* const barrier_;
+  };
+  Thread* self = Thread::Current();
+  Runtime* runtime = Runtime::Current();
+  interpreter::MethodInterpreterCaches* method_caches = runtime->GetMethodInterpreterCaches();
+  // Empty the method tables first, so that they cannot refill the thread-local caches.
+  if (method_caches != nullptr) {
+    method_caches->ClearAllTables(self);
+  }
+  // Only wait for the checkpoint when the method tables need to be emptied again.
+  Barrier barrier(0);
+  ClearInterpreterCacheClosure closure(method_caches != nullptr ? &barrier : nullptr);
+  size_t threads_running_checkpoint = runtime->GetThreadList()->RunCheckpoint(&closure);
+  // A thread may have stored in a method table a value it resolved before the tables were
+  // emptied. Empty them again once all threads went through the checkpoint.
+  if (method_caches != nullptr) {
+    if (threads_running_checkpoint != 0) {
+      ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
+      barrier.Increment(self, threads_running_checkpoint);
+    }
+    method_caches->ClearAllTables(self);
+  }
 }
 
 
@@ -50,6 +50,7 @@ class BacktraceMap;
 namespace art {
 
 namespace gc {
+class AllocationSampleBuffer;
 namespace accounting {
 template<class T> class AtomicStack;
 }  // namespace accounting
@@ -84,6 +85,7 @@ class ArtMethod;
 class BaseMutex;
 class ClassLinker;
 class Closure;
+class CodeInfoCache;
 class Context;
 class DeoptimizationContextRecord;
 class DexFile;
@@ -92,6 +94,7 @@ class IsMarkedVisitor;
 class JavaVMExt;
 class JNIEnvExt;
 class Monitor;
+class ReflectiveInvokeStubCache;
 class RootVisitor;
 class ScopedObjectAccessAlreadyRunnable;
 class ShadowFrame;
@@ -488,8 +491,12 @@ class Thread {
   // that needs to be dealt with, false otherwise.
   bool ObserveAsyncException() REQUIRES_SHARED(Locks::mutator_lock_);
 
-  // Find catch block and perform long jump to appropriate exception handle
-  NO_RETURN void QuickDeliverException() REQUIRES_SHARED(Locks::mutator_lock_);
+  // Find catch block and perform long jump to appropriate exception handle. If
+  // `from_entry_exit_hook`, the exception was thrown by a listener called from the method
+  // entry/exit hook of compiled code, and the frame of that code is unwound without looking
+  // for a catch block in it or reporting its unwind.
+  NO_RETURN void QuickDeliverException(bool from_entry_exit_hook = false)
+      REQUIRES_SHARED(Locks::mutator_lock_);
 
   Context* GetLongJumpContext();
   void ReleaseLongJumpContext(Context* context) {
@@ -1342,6 +1349,23 @@ class Thread {
     return WhichPowerOf2(InterpreterCache::kSize);
   }
 
+  // Returns the thread-local cache of decoded CodeInfo used by stack walks.
+  // It is created on first use. Must be called from the owning thread.
+  CodeInfoCache* GetCodeInfoCache();
+
+  // Returns the thread-local cache of stubs for hot targets of reflective calls.
+  // It is created on first use. Must be called from the owning thread.
+  ReflectiveInvokeStubCache* GetReflectiveInvokeStubCache();
+
+  // Returns the thread-local buffer of sampled allocations. It is created on first use.
+  // Must be called from the owning thread.
+  gc::AllocationSampleBuffer* GetAllocationSampleBuffer();
+
+  // Returns the buffer of sampled allocations, or null if the thread has not created it.
+  gc::AllocationSampleBuffer* PeekAllocationSampleBuffer() {
+    return allocation_sample_buffer_.get();
+  }
+
  private:
   explicit Thread(bool daemon);
   ~Thread() REQUIRES(!Locks::mutator_lock_, !Locks::thread_suspend_count_lock_);
@@ -1898,6 +1922,15 @@ class Thread {
   // the caller is allowed to access all fields and methods in the Core Platform API.
   uint32_t core_platform_api_cookie_ = 0;
 
+  // Thread-local cache of decoded CodeInfo, created on first use.
+  std::unique_ptr<CodeInfoCache> code_info_cache_;
+
+  // Thread-local cache of reflective invoke stubs, created on first use.
+  std::unique_ptr<ReflectiveInvokeStubCache> reflective_invoke_stub_cache_;
+
+  // Thread-local buffer of sampled allocations, created on first use.
+  std::unique_ptr<gc::AllocationSampleBuffer> allocation_sample_buffer_;
+
   friend class gc::collector::SemiSpace;  // For getting stack traces.
   friend class Runtime;  // For CreatePeer.
   friend class QuickExceptionHandler;  // For dumping the stack.
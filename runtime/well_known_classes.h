@@ -115,7 +115,9 @@ struct WellKnownClasses {
   static jmethodID java_lang_invoke_MethodHandles_lookup;
   static jmethodID java_lang_invoke_MethodHandles_Lookup_findConstructor;
   static jmethodID java_lang_Long_valueOf;
+  static jmethodID java_lang_Object_finalize;
   static jmethodID java_lang_ref_FinalizerReference_add;
+  static jmethodID java_lang_ref_FinalizerReference_remove;
   static jmethodID java_lang_ref_ReferenceQueue_add;
   static jmethodID java_lang_reflect_InvocationTargetException_init;
   static jmethodID java_lang_reflect_Parameter_init;
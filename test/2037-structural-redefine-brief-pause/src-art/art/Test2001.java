@@ -0,0 +1 @@
+../../../2001-virtual-structural-multithread/src-art/art/Test2001.java
\ No newline at end of file
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package art;
+
+import java.lang.reflect.Field;
+
+public class Test2037 {
+  private static final int NUM_THREADS = 20;
+
+  public static void run() throws Exception {
+    Redefinition.setTestConfiguration(Redefinition.Config.COMMON_REDEFINE);
+    doTest();
+  }
+
+  // The new definition of Test2001.Transform, shared with test 2001.
+  private static byte[] getDexBytes() throws Exception {
+    Field dex_bytes = Test2001.class.getDeclaredField("DEX_BYTES");
+    dex_bytes.setAccessible(true);
+    return (byte[]) dex_bytes.get(null);
+  }
+
+  public static void doTest() throws Exception {
+    Test2001.Transform existing = new Test2001.Transform();
+    Test2001.MyThread[] threads = Test2001.startThreads(NUM_THREADS);
+    // The other threads keep running while the field and method mappings and the objects to
+    // replace are computed, and are only suspended to install the class and update the heap.
+    long pause_time_ns = Redefinition.doCommonStructuralClassRedefinitionBriefPause(
+        Test2001.Transform.class, getDexBytes());
+    Test2001.finishThreads(threads);
+    if (pause_time_ns < 0) {
+      System.out.println("FAIL: Brief pause structural redefinition is not available");
+    } else if (pause_time_ns == 0) {
+      System.out.println("FAIL: Unexpected pause time: " + pause_time_ns);
+    }
+    // The instance allocated before the redefinition was replaced with one of the new class.
+    String expected = "Hello, null, null, null from " + Thread.currentThread().getName();
+    String result = existing.sayHi();
+    if (!result.equals(expected)) {
+      System.out.println("FAIL: Unexpected result: " + result);
+    }
+  }
+}
@@ -17,6 +17,7 @@
 package art;
 
 import java.util.ArrayList;
+import java.util.Arrays;
 import java.util.List;
 
 public class AllTraces {
@@ -60,6 +61,8 @@ public class AllTraces {
 
     printAll(25);
 
+    compareAsync(N, 25);
+
     // Let the thread make progress and die.
     synchronized(data.waitFor) {
       data.waitFor.notifyAll();
@@ -71,6 +74,38 @@ public class AllTraces {
     RETAIN.clear();
   }
 
+  // The test threads are blocked, so they record their stacks for the asynchronous version well
+  // before the timeout, and the stacks are the same as the ones from getAllStackTraces.
+  private static void compareAsync(int n, int max) {
+    Object[][] sync = getAllStackTraces(max);
+    Object[][] async = getAllStackTracesAsync(max, 60000);
+    if (async == null) {
+      // Not running on ART.
+      return;
+    }
+    int found = 0;
+    for (Object[] syncInfo : sync) {
+      Thread thread = (Thread) syncInfo[0];
+      if (!thread.getName().startsWith("AllTraces Thread")) {
+        continue;
+      }
+      Object[] asyncInfo = null;
+      for (Object[] info : async) {
+        if (info[0] == thread) {
+          asyncInfo = info;
+        }
+      }
+      if (asyncInfo == null ||
+          !Arrays.deepEquals((Object[]) syncInfo[1], (Object[]) asyncInfo[1])) {
+        throw new Error("Asynchronous stack of " + thread.getName() + " does not match");
+      }
+      found++;
+    }
+    if (found != n) {
+      throw new Error("Expected " + n + " test threads, found " + found);
+    }
+  }
+
   public static void printAll(int max) {
     PrintThread.printAll(getAllStackTraces(max));
   }
@@ -79,4 +114,8 @@ public class AllTraces {
   // is an array itself with the first element being the thread, and the second element a nested
   // String array as in getStackTrace.
   public static native Object[][] getAllStackTraces(int max);
+
+  // Same as getAllStackTraces, using the asynchronous extension. Threads that do not record their
+  // stack within the timeout are left out. Returns null if the extension is not available.
+  public static native Object[][] getAllStackTracesAsync(int max, int timeoutMs);
 }
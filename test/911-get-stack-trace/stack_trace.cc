@@ -17,6 +17,7 @@
 #include <inttypes.h>
 
 #include <cstdio>
+#include <cstring>
 #include <memory>
 
 #include "android-base/logging.h"
@@ -168,6 +169,71 @@ extern "C" JNIEXPORT jobjectArray JNICALL Java_art_AllTraces_getAllStackTraces(
   return ret;
 }
 
+using GetAllStackTracesAsync = jvmtiError (*)(jvmtiEnv* env,
+                                              jint max_frame_count,
+                                              jint timeout_ms,
+                                              jvmtiStackInfo** stack_info_ptr,
+                                              jint* thread_count_ptr,
+                                              jint* missed_thread_count_ptr);
+
+static GetAllStackTracesAsync FindGetAllStackTracesAsync(JNIEnv* env) {
+  jint n_ext = 0;
+  jvmtiExtensionFunctionInfo* infos = nullptr;
+  if (JvmtiErrorToException(env, jvmti_env, jvmti_env->GetExtensionFunctions(&n_ext, &infos))) {
+    return nullptr;
+  }
+  GetAllStackTracesAsync result = nullptr;
+  for (jint i = 0; i < n_ext; i++) {
+    jvmtiExtensionFunctionInfo* cur_info = &infos[i];
+    if (strcmp("com.android.art.stack.get_all_stack_traces_async", cur_info->id) == 0) {
+      result = reinterpret_cast<GetAllStackTracesAsync>(cur_info->func);
+    }
+    for (jint j = 0; j < cur_info->param_count; j++) {
+      jvmti_env->Deallocate(reinterpret_cast<unsigned char*>(cur_info->params[j].name));
+    }
+    jvmti_env->Deallocate(reinterpret_cast<unsigned char*>(cur_info->id));
+    jvmti_env->Deallocate(reinterpret_cast<unsigned char*>(cur_info->short_description));
+    jvmti_env->Deallocate(reinterpret_cast<unsigned char*>(cur_info->params));
+    jvmti_env->Deallocate(reinterpret_cast<unsigned char*>(cur_info->errors));
+  }
+  jvmti_env->Deallocate(reinterpret_cast<unsigned char*>(infos));
+  return result;
+}
+
+extern "C" JNIEXPORT jobjectArray JNICALL Java_art_AllTraces_getAllStackTracesAsync(
+    JNIEnv* env, jclass klass ATTRIBUTE_UNUSED, jint max, jint timeout_ms) {
+  GetAllStackTracesAsync get_all_stack_traces_async = FindGetAllStackTracesAsync(env);
+  if (get_all_stack_traces_async == nullptr) {
+    return nullptr;
+  }
+  jint thread_count;
+  jint missed_thread_count;
+  jvmtiStackInfo* stack_infos;
+  {
+    jvmtiError result = get_all_stack_traces_async(
+        jvmti_env, max, timeout_ms, &stack_infos, &thread_count, &missed_thread_count);
+    if (JvmtiErrorToException(env, jvmti_env, result)) {
+      return nullptr;
+    }
+  }
+
+  auto callback = [&](jint thread_index) -> jobject {
+    auto inner_callback = [&](jint index) -> jobject {
+      if (index == 0) {
+        return stack_infos[thread_index].thread;
+      } else {
+        return TranslateJvmtiFrameInfoArray(env,
+                                            stack_infos[thread_index].frame_buffer,
+                                            stack_infos[thread_index].frame_count);
+      }
+    };
+    return CreateObjectArray(env, 2, "java/lang/Object", inner_callback);
+  };
+  jobjectArray ret = CreateObjectArray(env, thread_count, "[Ljava/lang/Object;", callback);
+  jvmti_env->Deallocate(reinterpret_cast<unsigned char*>(stack_infos));
+  return ret;
+}
+
 extern "C" JNIEXPORT jobjectArray JNICALL Java_art_ThreadListTraces_getThreadListStackTraces(
     JNIEnv* env, jclass klass ATTRIBUTE_UNUSED, jobjectArray jthreads, jint max) {
   jint thread_count = env->GetArrayLength(jthreads);
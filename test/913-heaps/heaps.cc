@@ -16,9 +16,11 @@
 
 #include <inttypes.h>
 
+#include <atomic>
 #include <cstdio>
 #include <cstring>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <sstream>
 #include <vector>
@@ -881,6 +883,14 @@ using IterateThroughHeapExt = jvmtiError(*)(jvmtiEnv*,
                                             const void*);
 static IterateThroughHeapExt gIterateThroughHeapExt = nullptr;
 
+using IterateThroughHeapParallel = jvmtiError(*)(jvmtiEnv*,
+                                                 jint,
+                                                 jclass,
+                                                 const jvmtiHeapCallbacks*,
+                                                 const void*,
+                                                 jint);
+static IterateThroughHeapParallel gIterateThroughHeapParallel = nullptr;
+
 
 static void FreeExtensionFunctionInfo(jvmtiExtensionFunctionInfo* extensions, jint count) {
   for (size_t i = 0; i != static_cast<size_t>(count); ++i) {
@@ -977,6 +987,22 @@ extern "C" JNIEXPORT void JNICALL Java_art_Test913_checkForExtensionApis(
       CHECK(extensions[i].errors[1] == JVMTI_ERROR_INVALID_CLASS);
       CHECK(extensions[i].errors[2] == JVMTI_ERROR_NULL_POINTER);
     }
+
+    if (strcmp("com.android.art.heap.iterate_through_heap_parallel", extensions[i].id) == 0) {
+      CHECK(gIterateThroughHeapParallel == nullptr);
+      gIterateThroughHeapParallel =
+          reinterpret_cast<IterateThroughHeapParallel>(extensions[i].func);
+
+      CHECK_EQ(extensions[i].param_count, 5);
+
+      CHECK_EQ(strcmp("thread_count", extensions[i].params[4].name), 0);
+      CHECK_EQ(extensions[i].params[4].base_type, JVMTI_TYPE_JINT);
+      CHECK_EQ(extensions[i].params[4].kind, JVMTI_KIND_IN);
+
+      CHECK_EQ(extensions[i].error_count, 4);
+      CHECK(extensions[i].errors != nullptr);
+      CHECK(extensions[i].errors[3] == JVMTI_ERROR_ILLEGAL_ARGUMENT);
+    }
   }
 
   CHECK(gGetObjectHeapIdFn != nullptr);
@@ -1129,6 +1155,72 @@ extern "C" JNIEXPORT void JNICALL Java_art_Test913_iterateThroughHeapExt(
   CHECK(gFoundExt);
 }
 
+// Tags at or above the threshold of the extension test are moved up by kParallelRetag.
+static constexpr jlong kParallelThreshold = 30000000;
+static constexpr jlong kParallelRetag = 1000;
+static std::atomic<jint> gParallelRetagged(0);
+
+static jint JNICALL HeapIterationParallelCallback(jlong class_tag ATTRIBUTE_UNUSED,
+                                                  jlong size ATTRIBUTE_UNUSED,
+                                                  jlong* tag_ptr,
+                                                  jint length ATTRIBUTE_UNUSED,
+                                                  void* user_data ATTRIBUTE_UNUSED) {
+  if (*tag_ptr >= kParallelThreshold && *tag_ptr < kParallelThreshold + kParallelRetag) {
+    *tag_ptr += kParallelRetag;
+    gParallelRetagged.fetch_add(1);
+  }
+  return 0;
+}
+
+static jint JNICALL HeapIterationCountRetaggedCallback(jlong class_tag ATTRIBUTE_UNUSED,
+                                                       jlong size ATTRIBUTE_UNUSED,
+                                                       jlong* tag_ptr,
+                                                       jint length ATTRIBUTE_UNUSED,
+                                                       void* user_data) {
+  if (*tag_ptr >= kParallelThreshold + kParallelRetag) {
+    ++*reinterpret_cast<jint*>(user_data);
+  }
+  return 0;
+}
+
+extern "C" JNIEXPORT void JNICALL Java_art_Test913_iterateThroughHeapParallel(
+    JNIEnv* env, jclass klass ATTRIBUTE_UNUSED) {
+  CHECK(gIterateThroughHeapParallel != nullptr);
+
+  jvmtiHeapCallbacks callbacks;
+  memset(&callbacks, 0, sizeof(jvmtiHeapCallbacks));
+  callbacks.heap_iteration_callback = HeapIterationParallelCallback;
+
+  jvmtiError ret = gIterateThroughHeapParallel(jvmti_env, 0, nullptr, &callbacks, nullptr, 0);
+  CHECK_EQ(ret, JVMTI_ERROR_ILLEGAL_ARGUMENT);
+  ret = gIterateThroughHeapParallel(jvmti_env, 0, nullptr, &callbacks, nullptr, -1);
+  CHECK_EQ(ret, JVMTI_ERROR_ILLEGAL_ARGUMENT);
+
+  ret = gIterateThroughHeapParallel(jvmti_env, 0, nullptr, &callbacks, nullptr, 4);
+  if (JvmtiErrorToException(env, jvmti_env, ret)) {
+    return;
+  }
+  CHECK_GT(gParallelRetagged.load(), 0);
+
+  // The tags set by the parallel callbacks must be in the table afterwards.
+  jint retagged = 0;
+  callbacks.heap_iteration_callback = HeapIterationCountRetaggedCallback;
+  ret = jvmti_env->IterateThroughHeap(0, nullptr, &callbacks, &retagged);
+  if (JvmtiErrorToException(env, jvmti_env, ret)) {
+    return;
+  }
+  CHECK_EQ(retagged, gParallelRetagged.load());
+
+  // The thread count is capped at the number of processors. Nothing is left to retag.
+  callbacks.heap_iteration_callback = HeapIterationParallelCallback;
+  ret = gIterateThroughHeapParallel(
+      jvmti_env, 0, nullptr, &callbacks, nullptr, std::numeric_limits<jint>::max());
+  if (JvmtiErrorToException(env, jvmti_env, ret)) {
+    return;
+  }
+  CHECK_EQ(retagged, gParallelRetagged.load());
+}
+
 extern "C" JNIEXPORT jboolean JNICALL Java_art_Test913_checkInitialized(JNIEnv* env, jclass, jclass c) {
   jint status;
   jvmtiError error = jvmti_env->GetClassStatus(c, &status);
@@ -16,6 +16,7 @@
 
 import dalvik.annotation.optimization.CriticalNative;
 import dalvik.annotation.optimization.FastNative;
+import dalvik.annotation.optimization.PinnedArrayNative;
 
 /*
  * AUTOMATICALLY GENERATED FROM art/tools/mako-source-generator/...../MyClassNatives.java.mako
@@ -337,4 +338,8 @@ class MyClassNatives {
     public static native void fastNative();
     @CriticalNative
     public static native void criticalNative();
+
+    // Check that @PinnedArrayNative passes pointers to the array data.
+    @PinnedArrayNative
+    static native long pinnedArrays(int i, byte[] bytes, long l, long[] longs);
 }
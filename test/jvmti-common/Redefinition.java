@@ -97,6 +97,10 @@ public class Redefinition {
                                                           byte[] dex_bytes);
 
   public static native void doCommonStructuralClassRedefinition(Class<?> target, byte[] dex_file);
+  // Returns the time all threads were suspended in nanoseconds, or -1 if the brief pause mode is
+  // not available.
+  public static native long doCommonStructuralClassRedefinitionBriefPause(Class<?> target,
+                                                                          byte[] dex_file);
   public static void doMultiStructuralClassRedefinition(CommonClassDefinition... defs) {
     ArrayList<Class<?>> classes = new ArrayList<>();
     ArrayList<byte[]> dex_files = new ArrayList<>();
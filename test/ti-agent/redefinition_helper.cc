@@ -189,6 +189,30 @@ extern "C" JNIEXPORT void JNICALL Java_art_Redefinition_doCommonStructuralClassR
   DoClassRedefine<RedefineType::kStructural>(jvmti_env, env, target, nullptr, dex_file_bytes);
 }
 
+extern "C" JNIEXPORT jlong JNICALL
+Java_art_Redefinition_doCommonStructuralClassRedefinitionBriefPause(
+    JNIEnv* env, jclass, jclass target, jbyteArray dex_file_bytes) {
+  using ArtStructurallyRedefineClassesBriefPause = jvmtiError (*)(
+      jvmtiEnv* env, jint num_defs, const jvmtiClassDefinition* defs, jlong* pause_time_ns);
+  ArtStructurallyRedefineClassesBriefPause redefine =
+      GetExtensionFunction<ArtStructurallyRedefineClassesBriefPause>(
+          env, jvmti_env, "com.android.art.class.structurally_redefine_classes_brief_pause");
+  if (redefine == nullptr || env->ExceptionCheck()) {
+    return -1;
+  }
+  jint len = env->GetArrayLength(dex_file_bytes);
+  jbyte* redef_bytes = env->GetByteArrayElements(dex_file_bytes, nullptr);
+  jvmtiClassDefinition def = {
+      target, len, reinterpret_cast<const unsigned char*>(redef_bytes) };
+  jlong pause_time_ns = -1;
+  jvmtiError res = redefine(jvmti_env, 1, &def, &pause_time_ns);
+  env->ReleaseByteArrayElements(dex_file_bytes, redef_bytes, JNI_ABORT);
+  if (res != JVMTI_ERROR_NONE) {
+    throwRedefinitionError(jvmti_env, env, 1, &target, res);
+  }
+  return pause_time_ns;
+}
+
 // Magic JNI export that classes can use for redefining classes.
 // To use classes should declare this as a native function with signature (Ljava/lang/Class;[B[B)V
 extern "C" JNIEXPORT void JNICALL Java_art_Redefinition_doCommonClassRedefinition(